@@ -179,9 +179,12 @@ def _lota_add_arguments(parser: argparse.ArgumentParser) -> None:
     Note: `-h/--host` option is provided by `CoapCommand`.
     """
     parser.add_argument("fw_path", help="Path to the firmware `.bin` file to upload")
-    parser.add_argument("--block-size", type=int, default=512, choices=[16, 32, 64, 128, 256, 512],
+    parser.add_argument("--block-size", type=int, default=512, choices=[16, 32, 64, 128, 256, 512, 1024],
                         help="CoAP block size in bytes (default: 512)")
     parser.add_argument("--status-only", action="store_true", help="only query OTA status and exit without uploading")
+    parser.add_argument("--no-window", action="store_true",
+                        help="use the stop-and-wait Block1 upload instead of the windowed one")
+    parser.add_argument("--compress", action="store_true", help="LZSS-compress the image for the upload")
 
 
 async def _lota_handler(args: argparse.Namespace) -> int:
@@ -194,7 +197,8 @@ async def _lota_handler(args: argparse.Namespace) -> int:
     from borneo.coap_ota import CoAPFirmwareUpdater
 
     # `host` is added by CoapCommand
-    updater = CoAPFirmwareUpdater(args.host, args.fw_path, args.block_size)
+    updater = CoAPFirmwareUpdater(args.host, args.fw_path, args.block_size, windowed=not args.no_window,
+                                  compress=args.compress)
 
     # quick status check
     try:
@@ -238,6 +242,8 @@ async def _lota_handler(args: argparse.Namespace) -> int:
             print(f"SHA256: {result['sha256']}")
         if result.get("next_boot") is not None:
             print(f"Next boot partition: {result['next_boot']}")
+        if result.get("bytes_per_second"):
+            print(f"Upload: {result['mode']}, {result['elapsed']:.1f} s, {result['bytes_per_second'] / 1024:.1f} KiB/s")
         return 0
 
     print("\nFirmware update failed")
@@ -5,9 +5,11 @@ It is a direct rename of the previous `borneo.ota` implementation.
 """
 from __future__ import annotations
 
+import asyncio
 import hashlib
 import logging
 import os
+import time
 from typing import Any, Dict, Optional
 from urllib.parse import urljoin
 
@@ -17,8 +19,15 @@ import cbor2
 from aiocoap import Context, Message, Code
 from aiocoap.numbers.constants import MAX_REGULAR_BLOCK_SIZE_EXP
 
+from .ota_compress import compress as lzss_compress
+
 logger = logging.getLogger(__name__)
 
+STREAM_PATH = "borneo/ota/coap/stream"
+DOWNLOAD_PATH = "borneo/ota/coap/download"
+DELTA_PATCH_MAGIC = b"BOD1"  # Patches built by `fw/scripts/ota-delta.py`
+BUSY_TIMEOUT = 60.0  # Seconds the device may answer 5.03 while it decodes, a COPY of a patch can take long
+
 
 class CoAPFirmwareUpdater:
     """Asynchronous CoAP firmware uploader.
@@ -30,14 +39,34 @@ class CoAPFirmwareUpdater:
             status = await updater.check_server_status(ctx)
             result = await updater.send_firmware(ctx)
 
+    By default the image is sent with the windowed protocol of
+    `borneo/ota/coap/stream`: offset-addressed chunks with as many requests in
+    flight as the device's window allows. Devices without that resource get
+    the stop-and-wait Block1 upload instead.
+
+    A delta patch made with `fw/scripts/ota-delta.py` is uploaded the same
+    way; the device rebuilds the new image from its running one. With
+    ``compress`` the upload is LZSS-compressed on the fly and decompressed on
+    the device before it is written. A windowed upload that loses the link
+    is resumed up to ``resume_attempts`` times from where the device left off,
+    even across a reboot of the device for plain images.
+
     All methods use logging and return structured results or raise
     exceptions — they never print.
     """
 
-    def __init__(self, target_url: str, firmware_path: str, block_size: int = 512, logger: Optional[logging.Logger] = None) -> None:
+    def __init__(self, target_url: str, firmware_path: str, block_size: int = 512, logger: Optional[logging.Logger] = None,
+                 windowed: bool = True, window: Optional[int] = None, compress: bool = False,
+                 compress_window_bits: int = 10, resume_attempts: int = 5, resume_delay: float = 1.0) -> None:
         self.target_url = target_url.rstrip('/')
         self.firmware_path = firmware_path
         self.block_size = block_size
+        self.windowed = windowed
+        self.window = window
+        self.compress = compress
+        self.compress_window_bits = compress_window_bits
+        self.resume_attempts = resume_attempts
+        self.resume_delay = resume_delay
         self.block_exp = self._calculate_block_exp(block_size)
         self.logger = logger or logging.getLogger(__name__)
 
@@ -91,6 +120,112 @@ class CoAPFirmwareUpdater:
             self.logger.debug("Failed to parse status payload: %s", exc)
             return None
 
+    async def _upload_block1(self, context: Any, firmware_data: bytes, flags: Dict[str, bool]) -> Optional[str]:
+        """Stop-and-wait Block1 PUT of the whole image, returns an error message or ``None``."""
+        uri = urljoin(self.target_url + '/', DOWNLOAD_PATH)
+        options = [name for name, enabled in flags.items() if enabled]
+        if options:
+            uri += "?" + "&".join(options)
+        request = Message(code=Code.PUT, uri=uri, payload=firmware_data)
+
+        # prefer to set block size if remote object is accessible
+        try:
+            request.remote.maximum_block_size_exp = self.block_exp
+        except Exception:
+            # older aiocoap versions may not expose `remote` until sending
+            pass
+
+        try:
+            resp = await context.request(request).response
+        except Exception as exc:
+            return f"PUT request failed: {exc}"
+
+        if not resp.code.is_successful():
+            return f"Server returned non-success response for PUT: {resp.code}"
+        return None
+
+    @staticmethod
+    async def _request_until_ready(context: Any, message: Message) -> Any:
+        """Send ``message`` again while the device answers 5.03, up to ``BUSY_TIMEOUT`` seconds."""
+        deadline = time.monotonic() + BUSY_TIMEOUT
+        while True:
+            r = await context.request(message).response
+            if r.code != Code.SERVICE_UNAVAILABLE or time.monotonic() > deadline:
+                return r
+            await asyncio.sleep(0.05)  # Ahead of the window, or the device is still writing earlier chunks
+
+    async def _start_stream(self, context: Any, uri: str, payload: Dict[str, Any]) -> Any:
+        start = Message(code=Code.POST, uri=uri, payload=cbor2.dumps(payload))
+        resp = await context.request(start).response
+        if resp.code in (Code.NOT_FOUND, Code.METHOD_NOT_ALLOWED):
+            raise NotImplementedError()
+        if not resp.code.is_successful():
+            raise RuntimeError(f"Server returned non-success response for stream start: {resp.code}")
+        return cbor2.loads(resp.payload)
+
+    async def _upload_windowed(self, context: Any, firmware_data: bytes, flags: Dict[str, bool]) -> Optional[str]:
+        """Windowed upload through `borneo/ota/coap/stream`, returns an error message or ``None``.
+
+        The start request names the SHA-256 of the uploaded bytes, so after a
+        lost link the upload is started again and the device answers with the
+        offset it already has. Raises ``NotImplementedError`` if the device does
+        not offer the resource.
+        """
+        uri = urljoin(self.target_url + '/', STREAM_PATH)
+        start_payload = {"size": len(firmware_data), "sha256": hashlib.sha256(firmware_data).digest(), **flags}
+        error = None
+        for attempt in range(self.resume_attempts + 1):
+            if attempt > 0:
+                self.logger.info("Upload interrupted (%s), resuming", error)
+                await asyncio.sleep(self.resume_delay)
+            try:
+                session = await self._start_stream(context, uri, start_payload)
+            except NotImplementedError:
+                if attempt == 0:
+                    raise
+                error = "Device no longer offers the windowed upload"
+                break
+            except Exception as exc:
+                error = f"Stream start failed: {exc}"
+                continue
+
+            offset = session.get("offset", 0)
+            if offset > 0:
+                self.logger.info("Resuming upload at %d of %d bytes", offset, len(firmware_data))
+            error = await self._send_chunks(context, uri, firmware_data, session, offset)
+            if error is None:
+                return None
+        return error
+
+    async def _send_chunks(self, context: Any, uri: str, firmware_data: bytes, session: Dict[str, Any],
+                           first: int) -> Optional[str]:
+        chunk_size = session["chunk"]
+        window = min(self.window or session["window"], session["window"])
+        self.logger.debug("Windowed upload: chunk %d bytes, window %d, from %d", chunk_size, window, first)
+
+        # Every chunk fits into one datagram, so aiocoap never falls back to blockwise transfer. The device only
+        # keeps `window` chunks past the first missing one, and the semaphore releases a slot only once a chunk
+        # has been acknowledged, so the requests in flight always fit.
+        slots = asyncio.Semaphore(window)
+        failure: Dict[str, str] = {}
+
+        async def put_chunk(offset: int) -> None:
+            async with slots:
+                if failure:
+                    return
+                message = Message(code=Code.PUT, uri=f"{uri}?o={offset}",
+                                  payload=firmware_data[offset:offset + chunk_size])
+                try:
+                    r = await self._request_until_ready(context, message)
+                except Exception as exc:
+                    failure.setdefault("error", f"Chunk at {offset} failed: {exc}")
+                    return
+                if not r.code.is_successful():
+                    failure.setdefault("error", f"Server returned {r.code} for the chunk at {offset}")
+
+        await asyncio.gather(*(put_chunk(offset) for offset in range(first, len(firmware_data), chunk_size)))
+        return failure.get("error")
+
     async def send_firmware(self, context: Optional[Any] = None) -> Dict[str, Any]:
         """Upload firmware and trigger update.
 
@@ -119,20 +254,30 @@ class CoAPFirmwareUpdater:
         async with aiofiles.open(self.firmware_path, 'rb') as f:
             firmware_data = await f.read()
 
-        uri = urljoin(self.target_url + '/', "borneo/ota/coap/download")
-        request = Message(code=Code.PUT, uri=uri, payload=firmware_data)
-
-        # prefer to set block size if remote object is accessible
-        try:
-            request.remote.maximum_block_size_exp = self.block_exp
-        except Exception:
-            # older aiocoap versions may not expose `remote` until sending
-            pass
-
-        try:
-            resp = await context.request(request).response
-        except Exception as exc:
-            result["error"] = f"PUT request failed: {exc}"
+        # The device verifies the checksum against the image it rebuilt, so it stays the one of the file
+        flags = {"patch": firmware_data.startswith(DELTA_PATCH_MAGIC), "compressed": self.compress}
+        if self.compress:
+            firmware_data = lzss_compress(firmware_data, self.compress_window_bits)
+            self.logger.info("Compressed %d bytes to %d (%.1f%%)", file_size, len(firmware_data),
+                             100.0 * len(firmware_data) / file_size)
+
+        started = time.monotonic()
+        error = None
+        mode = "block1"
+        if self.windowed:
+            try:
+                error = await self._upload_windowed(context, firmware_data, flags)
+                mode = "windowed"
+            except NotImplementedError:
+                self.logger.info("Device has no windowed upload, falling back to Block1")
+        if mode == "block1" and flags["patch"]:
+            error = "Delta patches need a device with the windowed upload"
+        elif mode == "block1":
+            error = await self._upload_block1(context, firmware_data, flags)
+        elapsed = time.monotonic() - started
+
+        if error is not None:
+            result["error"] = error
             self.logger.debug(result["error"])
             if created_context:
                 try:
@@ -141,21 +286,16 @@ class CoAPFirmwareUpdater:
                     pass
             return result
 
-        if not resp.code.is_successful():
-            result["error"] = f"Server returned non-success response for PUT: {resp.code}"
-            result["response_code"] = str(resp.code)
-            if created_context:
-                try:
-                    await context.shutdown()
-                except Exception:
-                    pass
-            return result
+        bytes_per_second = len(firmware_data) / elapsed if elapsed > 0 else 0.0
+        self.logger.info("Uploaded %d bytes in %.1f s (%s, %.1f KiB/s)", len(firmware_data), elapsed, mode,
+                         bytes_per_second / 1024)
 
-        # now POST checksum to trigger update
+        uri = urljoin(self.target_url + '/', DOWNLOAD_PATH)
+        # now POST checksum to trigger update, the device answers 5.03 until it has written the image
         post_payload = cbor2.dumps({"checksum": sha256_digest})
         post_req = Message(code=Code.POST, payload=post_payload, uri=uri)
         try:
-            resp2 = await context.request(post_req).response
+            resp2 = await self._request_until_ready(context, post_req)
         except Exception as exc:
             result["error"] = f"POST trigger failed: {exc}"
             self.logger.debug(result["error"])
@@ -189,6 +329,10 @@ class CoAPFirmwareUpdater:
             "sha256": sha256_digest.hex(),
             "next_boot": details.get("next_boot") if isinstance(details, dict) else None,
             "details": details,
+            "mode": mode,
+            "elapsed": elapsed,
+            "bytes_per_second": bytes_per_second,
+            "bytes_sent": len(firmware_data),
         })
 
         if created_context:
@@ -200,13 +344,14 @@ class CoAPFirmwareUpdater:
         return result
 
 
-async def perform_coap_ota(target_url: str, firmware_path: str, block_size: int = 512, status_only: bool = False, logger: Optional[logging.Logger] = None) -> Dict[str, Any]:
+async def perform_coap_ota(target_url: str, firmware_path: str, block_size: int = 512, status_only: bool = False, logger: Optional[logging.Logger] = None,
+                           windowed: bool = True) -> Dict[str, Any]:
     """High-level helper that checks status and (optionally) uploads firmware.
 
     Returns a dict with keys ``'success'``, ``'status'`` (server status if
     available) and ``'result'`` (upload result if performed).
     """
-    updater = CoAPFirmwareUpdater(target_url, firmware_path, block_size=block_size, logger=logger)
+    updater = CoAPFirmwareUpdater(target_url, firmware_path, block_size=block_size, logger=logger, windowed=windowed)
 
     context = await Context.create_client_context()
     try:
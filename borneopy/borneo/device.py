@@ -83,6 +83,25 @@ class AbstractBorneoDeviceCoapClient:
         except Exception as e:
             raise BorneoError(f"Error getting info: {str(e)}")
 
+    async def batch(self, *calls):
+        """Call several read methods in one round trip.
+
+        Each call is a method name (the path of its CoAP resource, e.g. 'borneo/lyfi/status') or a `(name, args)`
+        tuple. Returns one result per call, in order; failed calls raise `BorneoError` with their errno.
+        """
+        uri = self.address + '/borneo/rpc/batch'
+        payload: bytes = dumps([c if isinstance(c, str) else list(c) for c in calls])
+        request = Message(code=POST, payload=payload, uri=uri)
+        response = await self._context.request(request).response
+        if not response.code.is_successful():
+            raise BorneoError(f"Batch request failed with code {response.code}")
+        results = []
+        for call, entry in zip(calls, loads(response.payload)):
+            if entry[0] != 0:
+                raise BorneoError(f"Batched call {call!r} failed with errcode {entry[0]}")
+            results.append(entry[1] if len(entry) > 1 else None)
+        return results
+
     async def get_timezone(self):
         uri = self.address + '/borneo/settings/timezone'
         request = Message(code=GET, uri=uri)
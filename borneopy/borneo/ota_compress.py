@@ -0,0 +1,125 @@
+"""LZSS compression of firmware images for the CoAP OTA.
+
+The format is the one `borneo-core/include/borneo/algo/lzss.h` decodes: a
+12-byte header followed by a heatshrink-compatible bit stream. The device
+decodes with a window of ``2 ** window_bits`` bytes, so the window is kept
+small; 10 bits (1 KB) already catches most of the repetition in a firmware
+image.
+"""
+from __future__ import annotations
+
+import struct
+
+MAGIC = b"BOZ1"
+HEADER_SIZE = 12
+MIN_MATCH = 3  # Matches are found through 3-byte prefixes
+
+
+class _BitWriter:
+    def __init__(self) -> None:
+        self.out = bytearray()
+        self.acc = 0
+        self.nbits = 0
+
+    def write(self, value: int, nbits: int) -> None:
+        self.acc = (self.acc << nbits) | value
+        self.nbits += nbits
+        while self.nbits >= 8:
+            self.nbits -= 8
+            self.out.append((self.acc >> self.nbits) & 0xFF)
+        self.acc &= (1 << self.nbits) - 1
+
+    def finish(self) -> bytes:
+        if self.nbits:
+            self.out.append((self.acc << (8 - self.nbits)) & 0xFF)
+        return bytes(self.out)
+
+
+def compress(data: bytes, window_bits: int = 10, lookahead_bits: int = 4, chain: int = 32) -> bytes:
+    """Compress ``data``; ``chain`` bounds how many earlier positions are tried per byte."""
+    if not 4 <= window_bits <= 15 or not 3 <= lookahead_bits < window_bits:
+        raise ValueError("Unsupported window or lookahead size")
+
+    window = 1 << window_bits
+    lookahead = 1 << lookahead_bits
+    backref_bits = 1 + window_bits + lookahead_bits
+    heads: dict = {}
+    writer = _BitWriter()
+
+    def insert(pos: int) -> None:
+        positions = heads.setdefault(data[pos:pos + MIN_MATCH], [])
+        positions.append(pos)
+        if len(positions) > chain * 2:
+            del positions[:chain]
+
+    n = len(data)
+    i = 0
+    while i < n:
+        best_len = best_dist = 0
+        if i + MIN_MATCH <= n:
+            max_len = min(lookahead, n - i)
+            for p in reversed(heads.get(data[i:i + MIN_MATCH], [])[-chain:]):
+                dist = i - p
+                if dist > window:
+                    break
+                length = MIN_MATCH
+                while length < max_len and data[p + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, dist
+                    if length == max_len:
+                        break
+
+        if best_len >= MIN_MATCH and best_len * 9 > backref_bits:
+            writer.write(0, 1)
+            writer.write(best_dist - 1, window_bits)
+            writer.write(best_len - 1, lookahead_bits)
+            for k in range(i, min(i + best_len, n - MIN_MATCH + 1)):
+                insert(k)
+            i += best_len
+        else:
+            writer.write(0x100 | data[i], 9)
+            if i + MIN_MATCH <= n:
+                insert(i)
+            i += 1
+
+    header = MAGIC + bytes([window_bits, lookahead_bits, 0, 0]) + struct.pack("<I", n)
+    return header + writer.finish()
+
+
+def decompress(blob: bytes) -> bytes:
+    """Reference decoder, the device uses `lzss.c`."""
+    if blob[:4] != MAGIC:
+        raise ValueError("Not a compressed image")
+    window_bits, lookahead_bits = blob[4], blob[5]
+    (size,) = struct.unpack_from("<I", blob, 8)
+
+    out = bytearray()
+    acc = nbits = 0
+    pos = HEADER_SIZE
+
+    def read(count: int) -> int:
+        nonlocal acc, nbits, pos
+        while nbits < count:
+            acc = (acc << 8) | blob[pos]
+            pos += 1
+            nbits += 8
+        nbits -= count
+        return (acc >> nbits) & ((1 << count) - 1)
+
+    while len(out) < size:
+        if read(1):
+            out.append(read(8))
+        else:
+            dist = read(window_bits) + 1
+            count = read(lookahead_bits) + 1
+            for _ in range(count):
+                out.append(out[-dist])
+    return bytes(out)
+
+
+def is_compressed(blob: bytes) -> bool:
+    return blob.startswith(MAGIC)
+
+
+__all__ = ["compress", "decompress", "is_compressed"]
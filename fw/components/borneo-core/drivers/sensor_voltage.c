@@ -24,10 +24,13 @@
 
 #if CONFIG_BORNEO_MEAS_VOLTAGE_SUPPORT
 
+#define SENSOR_VOLTAGE_MEDIAN_WINDOW 5
+
 struct sensor_voltage_data {
     const struct drvfx_device* adc_dev;
     int32_t voltage_mv;
-    int32_t filtered_voltage;
+    struct median_filter median;
+    struct ema_filter ema;
 };
 
 static int _fetch_sample(const struct drvfx_device* dev)
@@ -43,7 +46,7 @@ static int _fetch_sample(const struct drvfx_device* dev)
     int32_t adc_mv;
     BO_TRY(adc_read_mv(data->adc_dev, CONFIG_BORNEO_MEAS_VOLTAGE_ADC_CHANNEL, &adc_mv));
     int32_t raw_mv = (adc_mv * CONFIG_BORNEO_MEAS_VOLTAGE_FACTOR + 500) / 1000;
-    data->voltage_mv = ema_filter(raw_mv, &data->filtered_voltage, 1, 10);
+    data->voltage_mv = ema_filter_update(&data->ema, median_filter_update(&data->median, raw_mv));
     return 0;
 }
 
@@ -77,6 +80,9 @@ static int sensor_voltage_init(const struct drvfx_device* dev)
         ESP_LOGE(TAG, "Failed to get device 'adc'");
     }
 
+    BO_TRY(median_filter_init(&data->median, SENSOR_VOLTAGE_MEDIAN_WINDOW));
+    BO_TRY(ema_filter_init(&data->ema, 1, 10));
+
     BO_TRY(_fetch_sample(dev));
 
     return 0;
@@ -0,0 +1,86 @@
+/** @file delta-patch.h
+ * @brief Streaming applier of the delta firmware patches built by `fw/scripts/ota-delta.py`
+ *
+ * A patch turns the running image (the source) into the next one (the target). It is a fixed header followed by a
+ * list of operations, each an opcode byte followed by LEB128 varints:
+ *
+ * - `COPY n`: copies `n` source bytes.
+ * - `ADD n, bytes[n]`: adds `bytes[i]` to each of the next `n` source bytes, modulo 256. Code that only moved
+ *   differs from the old code in a few address bytes, and the deltas are mostly zero.
+ * - `INSERT n, bytes[n]`: emits new bytes without consuming source.
+ * - `SEEK d`: moves the source position by the zigzag-encoded signed offset `d`.
+ * - `END`: the patch ends.
+ *
+ * The applier keeps no more than a small scratch buffer. Patch data can be fed in chunks of any size. Source bytes
+ * are read and target bytes are written through caller callbacks, so it runs on flash partitions on the device and
+ * on plain files on a host. It has no platform dependencies.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DELTA_PATCH_MAGIC "BOD1"
+#define DELTA_PATCH_HEADER_SIZE 76 ///< Magic, source size, target size, source and target SHA-256
+#define DELTA_PATCH_SCRATCH_SIZE 256
+
+enum delta_patch_op {
+    DELTA_PATCH_OP_END = 0,
+    DELTA_PATCH_OP_COPY = 1,
+    DELTA_PATCH_OP_ADD = 2,
+    DELTA_PATCH_OP_INSERT = 3,
+    DELTA_PATCH_OP_SEEK = 4,
+};
+
+struct delta_patch_header {
+    uint32_t source_size;
+    uint32_t target_size;
+    uint8_t source_sha256[32]; ///< Of the first `source_size` bytes of the source
+    uint8_t target_sha256[32];
+};
+
+/** @brief Callbacks of the applier, each returns 0 or a negative errno that aborts the patch. */
+struct delta_patch_io {
+    /// Called once the header is complete, e.g. to check the source and the target space
+    int (*header)(void* ctx, const struct delta_patch_header* header);
+    int (*read_source)(void* ctx, size_t offset, uint8_t* buf, size_t len);
+    int (*write_target)(void* ctx, const uint8_t* buf, size_t len);
+};
+
+struct delta_patch {
+    const struct delta_patch_io* io;
+    void* ctx;
+    struct delta_patch_header header;
+    uint8_t header_buf[DELTA_PATCH_HEADER_SIZE];
+    size_t header_len;
+    uint8_t state;
+    uint8_t op;
+    uint32_t varint;
+    uint8_t varint_shift;
+    uint32_t remaining; ///< Bytes left of the current operation
+    size_t source_pos;
+    size_t target_len;
+    int error; ///< Sticky, every feed after an error fails with it
+    uint8_t scratch[DELTA_PATCH_SCRATCH_SIZE];
+};
+
+void delta_patch_init(struct delta_patch* patch, const struct delta_patch_io* io, void* ctx);
+
+/**
+ * @brief Consumes the next `len` bytes of the patch.
+ * @return 0, -EINVAL for a malformed patch, or the error of a callback
+ */
+int delta_patch_feed(struct delta_patch* patch, const uint8_t* data, size_t len);
+
+/** @brief Whether the `END` operation was reached with exactly `target_size` bytes written. */
+bool delta_patch_done(const struct delta_patch* patch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,6 +3,9 @@
  *
  * This header provides various filtering functions to smooth sensor readings
  * and reduce noise in embedded systems.
+ *
+ * The streaming filters keep all of their state in a caller-owned struct, use integer arithmetic on the update path
+ * and carry an explicit `initialized` flag, so a legitimate zero sample is never mistaken for "no data yet".
  */
 
 #pragma once
@@ -11,6 +14,59 @@
 extern "C" {
 #endif
 
+#define MEDIAN_FILTER_WINDOW_MAX 7
+#define WINDOW_STATS_CAPACITY 32
+
+/// Fixed-point fraction bits of the biquad coefficients
+#define BIQUAD_Q 28
+
+/** @brief Streaming median filter over the last 3, 5 or 7 samples. */
+struct median_filter {
+    int32_t window[MEDIAN_FILTER_WINDOW_MAX];
+    uint8_t size; ///< Window size: 3, 5 or 7
+    uint8_t index; ///< Next slot to overwrite
+    bool initialized;
+};
+
+/** @brief Exponential Moving Average filter state. */
+struct ema_filter {
+    int32_t value;
+    uint16_t alpha_num;
+    uint16_t alpha_denom;
+    bool initialized;
+};
+
+/** @brief Second-order IIR (Direct Form I) with Q`BIQUAD_Q` coefficients. */
+struct biquad_filter {
+    int32_t b0;
+    int32_t b1;
+    int32_t b2;
+    int32_t a1;
+    int32_t a2;
+    int32_t x1;
+    int32_t x2;
+    int32_t y1;
+    int32_t y2;
+    bool initialized;
+};
+
+/** @brief Running min/max/mean/variance over a sliding window of samples. */
+struct window_stats {
+    int32_t samples[WINDOW_STATS_CAPACITY];
+    int64_t sum;
+    int64_t sum_sq;
+    uint32_t seq; ///< Sequence number of the next sample
+    uint16_t size; ///< Window size, at most `WINDOW_STATS_CAPACITY`
+    uint16_t count; ///< Samples currently in the window
+    // Monotonic deques of sequence numbers, used for amortized O(1) min/max
+    uint32_t min_q[WINDOW_STATS_CAPACITY];
+    uint32_t max_q[WINDOW_STATS_CAPACITY];
+    uint16_t min_head;
+    uint16_t min_len;
+    uint16_t max_head;
+    uint16_t max_len;
+};
+
 /** @brief Median filter for uint16_t arrays
  *
  * Sorts the buffer in-place and returns the median value.
@@ -22,19 +78,94 @@ extern "C" {
  */
 uint16_t median_filter_u16(uint16_t* buffer, size_t buffer_size);
 
+/** @brief Median of three values, branch-free min/max network. */
+int32_t median3_i32(int32_t a, int32_t b, int32_t c);
+
+/** @brief Median of five values using a fixed 7-comparator selection network.
+ *
+ * @param values Array of 5 values, left untouched
+ */
+int32_t median5_i32(const int32_t* values);
+
+/** @brief Median of seven values using a fixed 13-comparator selection network.
+ *
+ * @param values Array of 7 values, left untouched
+ */
+int32_t median7_i32(const int32_t* values);
+
+/** @brief Initializes a streaming median filter.
+ *
+ * @param size Window size, must be 3, 5 or 7
+ * @return 0 on success, -EINVAL for an unsupported window size
+ */
+int median_filter_init(struct median_filter* filter, size_t size);
+
+/** @brief Pushes a sample and returns the median of the current window.
+ *
+ * The first sample fills the whole window, so the output is valid from the first call.
+ */
+int32_t median_filter_update(struct median_filter* filter, int32_t sample);
+
 /** @brief Exponential Moving Average filter for int32_t values
  *
  * Applies EMA filtering using integer arithmetic to avoid floating point operations.
  * Formula: filtered = (alpha_num * current + (alpha_denom - alpha_num) * previous) / alpha_denom
  *
- * @param current The new input value
- * @param filtered Pointer to the filtered value (updated in-place)
  * @param alpha_num Numerator for alpha (e.g., 1 for alpha=0.1)
  * @param alpha_denom Denominator for alpha (e.g., 10 for alpha=0.1)
+ * @return 0 on success, -EINVAL if alpha is not in (0, 1]
+ */
+int ema_filter_init(struct ema_filter* filter, uint16_t alpha_num, uint16_t alpha_denom);
+
+/** @brief Feeds a sample into the EMA filter; the first sample initializes it.
+ *
  * @return The updated filtered value
  */
-int32_t ema_filter(int32_t current, int32_t* filtered, int alpha_num, int alpha_denom);
+int32_t ema_filter_update(struct ema_filter* filter, int32_t sample);
+
+/** @brief Drops the EMA state so the next sample re-initializes the filter. */
+void ema_filter_reset(struct ema_filter* filter);
+
+/** @brief Initializes a Butterworth (Q = 1/√2) low-pass biquad.
+ *
+ * Coefficients are computed once in floating point and stored in fixed point; the update path is integer only.
+ *
+ * @param sample_rate_mhz Sampling rate in mHz
+ * @param cutoff_mhz Cut-off frequency in mHz, must be below the Nyquist frequency
+ * @return 0 on success, -EINVAL on bad frequencies
+ */
+int biquad_lowpass_init(struct biquad_filter* filter, uint32_t sample_rate_mhz, uint32_t cutoff_mhz);
+
+/** @brief Feeds a sample into the biquad filter.
+ *
+ * The first sample primes the delay line at steady state, so there is no start-up transient from zero. Input
+ * magnitude should stay below 2^28 to keep the 64-bit accumulator from overflowing.
+ *
+ * @return The filtered value
+ */
+int32_t biquad_filter_update(struct biquad_filter* filter, int32_t sample);
+
+/** @brief Initializes the sliding-window statistics.
+ *
+ * @param size Window size in samples, 1 to `WINDOW_STATS_CAPACITY`
+ * @return 0 on success, -EINVAL for a bad window size
+ */
+int window_stats_init(struct window_stats* stats, size_t size);
+
+/** @brief Pushes a sample into the window.
+ *
+ * Mean and variance are updated in O(1); min/max are amortized O(1). Samples are expected to fit in 24 bits of
+ * magnitude so the sum of squares cannot overflow.
+ */
+void window_stats_update(struct window_stats* stats, int32_t sample);
+
+int32_t window_stats_min(const struct window_stats* stats);
+int32_t window_stats_max(const struct window_stats* stats);
+int32_t window_stats_mean(const struct window_stats* stats);
+
+/** @brief Population variance of the samples in the window. */
+int64_t window_stats_variance(const struct window_stats* stats);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,76 @@
+/** @file lzss.h
+ * @brief Streaming decoder of LZSS-compressed firmware images
+ *
+ * A compressed image is a fixed header followed by a heatshrink-compatible bit stream, read MSB first:
+ *
+ * - `1` and 8 bits: a literal byte.
+ * - `0`, `index - 1` in `window_bits` bits and `count - 1` in `lookahead_bits` bits: copies `count` bytes starting
+ *   `index` bytes back in the output.
+ *
+ * The stream ends once `size` bytes have been produced, so the padding of the last byte is ignored. The decoder only
+ * needs a window of `2^window_bits` bytes, which the caller provides. Compressed data can be fed in chunks of any size,
+ * and decoded bytes are handed to a callback in runs of up to `LZSS_OUTPUT_SIZE` bytes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZSS_MAGIC "BOZ1"
+#define LZSS_HEADER_SIZE 12 ///< Magic, window bits, lookahead bits, 2 reserved bytes, decompressed size
+#define LZSS_WINDOW_BITS_MIN 4
+#define LZSS_WINDOW_BITS_MAX 15
+#define LZSS_LOOKAHEAD_BITS_MIN 3
+#define LZSS_OUTPUT_SIZE 256
+
+struct lzss_header {
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint32_t size; ///< Of the decompressed data
+};
+
+/** @brief Callbacks of the decoder, each returns 0 or a negative errno that aborts decoding. */
+struct lzss_io {
+    /// Called once the header is complete, must point `*window` to `2^window_bits` bytes
+    int (*header)(void* ctx, const struct lzss_header* header, uint8_t** window);
+    int (*write)(void* ctx, const uint8_t* buf, size_t len);
+};
+
+struct lzss_decoder {
+    const struct lzss_io* io;
+    void* ctx;
+    struct lzss_header header;
+    uint8_t header_buf[LZSS_HEADER_SIZE];
+    size_t header_len;
+    uint8_t* window;
+    uint32_t window_mask;
+    uint32_t pos; ///< Bytes decoded so far, also the write position in the window
+    uint32_t bits; ///< Bit buffer, the low `nbits` bits are pending
+    uint8_t nbits;
+    uint8_t state;
+    uint16_t index; ///< Of the back-reference being read
+    int error; ///< Sticky, every feed after an error fails with it
+    size_t out_len;
+    uint8_t out[LZSS_OUTPUT_SIZE];
+};
+
+void lzss_decoder_init(struct lzss_decoder* dec, const struct lzss_io* io, void* ctx);
+
+/**
+ * @brief Consumes the next `len` bytes of compressed data.
+ * @return 0, -EINVAL for malformed data, -ENOTSUP for an unsupported header, or the error of a callback
+ */
+int lzss_decoder_feed(struct lzss_decoder* dec, const uint8_t* data, size_t len);
+
+/** @brief Whether all `size` bytes have been decoded and handed to the `write` callback. */
+bool lzss_decoder_done(const struct lzss_decoder* dec);
+
+#ifdef __cplusplus
+}
+#endif
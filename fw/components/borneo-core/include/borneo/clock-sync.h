@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BO_CLOCK_SYNC_GROUP_NONE 0 ///< A master that leads no group sends no beacons
+
+/** @brief Snapshot of the fleet clock, as reported by `borneo/clock-sync`. */
+struct bo_clock_sync_status {
+    bool is_master;
+    bool locked; ///< Following a master with enough samples for a stable estimate
+    uint16_t group; ///< Group led by this master, or followed by this follower
+    uint32_t seed; ///< Seed shared by all fixtures that follow the same master
+    int64_t offset_us; ///< Fleet time minus local uptime
+    int32_t skew_ppb; ///< Estimated rate of the master clock relative to the local one
+    int64_t delay_us; ///< Round-trip delay of the sample the estimate is based on
+    uint32_t samples; ///< Samples accepted since the current master was found
+};
+
+/*
+ * Fleet time: the uptime of the group master as seen by this fixture. Without fleet synchronization, or before a
+ * master was found, it is the local uptime and the seed is a local random one.
+ */
+int64_t bo_clock_sync_time_us();
+int64_t bo_clock_sync_time_ms();
+uint32_t bo_clock_sync_seed();
+
+#if CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+void bo_clock_sync_get_status(struct bo_clock_sync_status* status);
+int bo_clock_sync_set_master(bool is_master, uint16_t group, uint32_t seed);
+
+#endif // CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+#ifdef __cplusplus
+}
+#endif
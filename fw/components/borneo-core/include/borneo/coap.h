@@ -15,6 +15,8 @@ struct coap_resource_desc {
     coap_method_handler_t put_handler;
     coap_method_handler_t delete_handler;
     bool is_observable;
+    uint16_t notify_interval_ms; ///< Minimum interval between notifications, 0 for the Kconfig default
+    uint32_t (*get_generation)(void); ///< Content version used as the ETag, NULL if the resource is not versioned
 };
 
 #define __COAP_MAKE_UNIQUE_TOKEN(x, y) _CONCAT(x, y)
@@ -35,6 +37,47 @@ struct coap_resource_desc {
               .delete_handler = (res_delete),                                                                          \
           };
 
+/// Defines an observable resource whose notifications are at least `res_notify_interval_ms` apart
+#define COAP_RESOURCE_DEFINE_THROTTLED(res_path, res_notify_interval_ms, res_get, res_post, res_put, res_delete)       \
+    static const struct coap_resource_desc                                                                             \
+        __attribute__((section(".coap_resource_desc"), used)) __COAP_MAKE_UNIQUE_TOKEN(__coap_resource_desc_,          \
+                                                                                       __LINE__)                       \
+        = {                                                                                                            \
+              .path = {                                                                                                \
+                  .s = (const uint8_t *)res_path,                                                                      \
+                  .length = sizeof(res_path) - 1,                                                                      \
+              },                                                                                                       \
+              .is_observable = true,                                                                                   \
+              .notify_interval_ms = (res_notify_interval_ms),                                                          \
+              .get_handler = (res_get),                                                                                \
+              .post_handler = (res_post),                                                                              \
+              .put_handler = (res_put),                                                                                \
+              .delete_handler = (res_delete),                                                                          \
+          };
+
+/**
+ * @brief Defines a resource whose representation only changes when `res_get_generation()` returns a new value.
+ *
+ * GET responses carry an ETag derived from the generation and requests presenting a current ETag are answered with
+ * 2.03 Valid without calling `res_get`. PUTs with a stale If-Match are rejected with 4.12.
+ */
+#define COAP_RESOURCE_DEFINE_VERSIONED(res_path, res_get_generation, res_get, res_post, res_put, res_delete)           \
+    static const struct coap_resource_desc                                                                             \
+        __attribute__((section(".coap_resource_desc"), used)) __COAP_MAKE_UNIQUE_TOKEN(__coap_resource_desc_,          \
+                                                                                       __LINE__)                       \
+        = {                                                                                                            \
+              .path = {                                                                                                \
+                  .s = (const uint8_t *)res_path,                                                                      \
+                  .length = sizeof(res_path) - 1,                                                                      \
+              },                                                                                                       \
+              .is_observable = false,                                                                                  \
+              .get_generation = (res_get_generation),                                                                  \
+              .get_handler = (res_get),                                                                                \
+              .post_handler = (res_post),                                                                              \
+              .put_handler = (res_put),                                                                                \
+              .delete_handler = (res_delete),                                                                          \
+          };
+
 #define BO_COAP_TRY(expression, response)                                                                              \
     ({                                                                                                                 \
         int _rc = (expression);                                                                                        \
@@ -93,6 +136,7 @@ struct coap_resource_desc {
 #define BO_COAP_CODE_401_UNAUTHORIZED COAP_RESPONSE_CODE(401)
 #define BO_COAP_CODE_405_METHOD_NOT_ALLOWED COAP_RESPONSE_CODE(405)
 #define BO_COAP_CODE_406_NOT_ACCEPTABLE COAP_RESPONSE_CODE(406)
+#define BO_COAP_CODE_412_PRECONDITION_FAILED COAP_RESPONSE_CODE(412)
 #define BO_COAP_CODE_500_INTERNAL_SERVER_ERROR COAP_RESPONSE_CODE(500)
 #define BO_COAP_CODE_501_NOT_IMPLEMENTED COAP_RESPONSE_CODE(501)
 
@@ -101,8 +145,52 @@ struct coap_resource_desc {
 #define BO_COAP_PATH_HEARTBEAT "borneo/heartbeat"
 #define BO_COAP_PATH_POWER "borneo/power"
 
+/// Query option selecting the compact, integer-keyed CBOR schema of a resource, where one exists
+#define BO_COAP_QUERY_COMPACT "compact"
+
+/**
+ * @brief Checks whether the `&`-separated URI query contains `option`, either bare or as `option=...`.
+ */
+bool bo_coap_query_has(const coap_string_t* query, const char* option);
+int bo_coap_query_get_uint(const coap_string_t* query, const char* option, uint32_t* value);
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+#define BO_COAP_GROUP_MAX 8 ///< Maximum number of groups a device can belong to
+#define BO_COAP_GROUP_ALL 0 ///< Group addressing every device, no membership needed
+
+int bo_coap_group_load();
+bool bo_coap_group_is_member(uint16_t group_id);
+size_t bo_coap_group_get_all(uint16_t groups[BO_COAP_GROUP_MAX]);
+int bo_coap_group_set_all(const uint16_t* groups, size_t count);
+
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+/**
+ * @brief Marks an observable resource as changed.
+ *
+ * Lock-free and safe to call from an ISR. Repeated calls before the CoAP I/O task runs are coalesced into a single
+ * notification.
+ *
+ * @return 0 on success, -ENOENT if no resource is registered under `resource_uri`
+ */
 int bo_coap_notify_resource_changed(const coap_str_const_t* resource_uri);
 
+struct CborValue;
+struct CborEncoder;
+
+/// Same signature as the RPC methods, e.g. `bo_rpc_borneo_info_get()`
+typedef int (*bo_coap_cbor_encoder_t)(const struct CborValue* args, struct CborEncoder* retvals);
+
+/**
+ * @brief Encodes a CBOR response with `encode` and attaches it to `response`.
+ *
+ * The payload is built in a buffer shared by all handlers, so this must only be called from a resource handler.
+ * Errors returned by `encode` are mapped to response codes like `BO_COAP_TRY()` does.
+ */
+void bo_coap_respond_cbor(const coap_pdu_t* request, coap_pdu_t* response, bo_coap_cbor_encoder_t encode,
+                          const struct CborValue* args);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -6,6 +6,9 @@ extern "C" {
 
 struct drvfx_device;
 
+/// Temperature sensors report their values in fixed point, 1/SENSOR_TEMP_SCALE ℃ per LSB
+#define SENSOR_TEMP_SCALE 10
+
 struct sensor_api {
     int (*fetch_sample)(const struct drvfx_device* dev);
     int (*get_value)(const struct drvfx_device* dev, int32_t* value);
@@ -29,6 +32,15 @@ __SYSCALL int sensor_get_value(const struct drvfx_device* dev, int32_t* value)
     return api->get_value(dev, value);
 }
 
+/**
+ * @brief Rounds a fixed-point temperature (see `SENSOR_TEMP_SCALE`) to whole degrees Celsius.
+ */
+static inline int32_t sensor_temp_to_celsius(int32_t value)
+{
+    return value >= 0 ? (value + SENSOR_TEMP_SCALE / 2) / SENSOR_TEMP_SCALE
+                      : (value - SENSOR_TEMP_SCALE / 2) / SENSOR_TEMP_SCALE;
+}
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
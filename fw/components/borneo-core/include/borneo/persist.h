@@ -0,0 +1,58 @@
+/** @file persist.h
+ * @brief Debounced, batched persistence of user settings
+ *
+ * A module registers a section with a callback that writes it to NVS, and its setters mark the section dirty instead
+ * of writing and committing themselves. A background task flushes the dirty sections once nothing has been marked for
+ * `CONFIG_BORNEO_PERSIST_DEBOUNCE_MS`, but no later than `CONFIG_BORNEO_PERSIST_MAX_DELAY_MS` after the first mark, so
+ * dragging a slider ends up as one commit. Pending sections are also flushed before a reboot or a shutdown.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BO_PERSIST_SECTIONS_MAX 16
+
+/**
+ * @brief Writes a section to NVS, called with no other flush running.
+ * @return Number of NVS keys written, 0 if nothing changed, or a negative errno; a failed section is retried later
+ */
+typedef int (*bo_persist_flush_fn)(void* ctx);
+
+/** @brief Counters of a section since boot, for wear monitoring. */
+struct bo_persist_stats {
+    const char* name;
+    uint32_t marks; ///< Times the section was marked dirty
+    uint32_t flushes; ///< Flushes that wrote at least one key
+    uint32_t keys_written;
+    uint32_t failures;
+    int last_error;
+};
+
+int bo_persist_init();
+
+/**
+ * @brief Registers a section.
+ * @return Its ID for `bo_persist_mark_dirty()`, or -ENOMEM if all `BO_PERSIST_SECTIONS_MAX` are taken
+ */
+int bo_persist_register(const char* name, bo_persist_flush_fn flush, void* ctx);
+
+void bo_persist_mark_dirty(int section);
+
+/** @brief Flushes every dirty section now, returns the first error. */
+int bo_persist_flush();
+
+/** @brief Drops every pending change and ignores later ones until restart, used before erasing the user settings. */
+void bo_persist_discard_all();
+
+/** @brief Copies the counters of up to `max` sections, returns the number of registered sections. */
+size_t bo_persist_get_stats(struct bo_persist_stats* stats, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -31,6 +31,20 @@ int bo_rpc_borneo_settings_timezone_put(const CborValue* args, CborEncoder* retv
 int bo_rpc_borneo_settings_name_get(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_settings_name_put(const CborValue* args, CborEncoder* retvals);
 
+// Multicast group membership
+int bo_rpc_borneo_groups_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_groups_put(const CborValue* args, CborEncoder* retvals);
+
+// Fleet clock synchronization
+int bo_rpc_borneo_clock_sync_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_clock_sync_put(const CborValue* args, CborEncoder* retvals);
+
+// Write counters of the settings persistence, see `borneo/persist.h`
+int bo_rpc_borneo_persist_get(const CborValue* args, CborEncoder* retvals);
+
+// Init timings of this boot, see `K_INIT_STEP()`
+int bo_rpc_borneo_boot_profile_get(const CborValue* args, CborEncoder* retvals);
+
 // RPC function declarations for sensors
 int bo_rpc_borneo_sensors_get(const CborValue* args, CborEncoder* retvals);
 
@@ -40,6 +54,9 @@ int bo_rpc_borneo_network_reset_post(const CborValue* args, CborEncoder* retvals
 // Factory functions
 int bo_rpc_borneo_factory_reset_post(const CborValue* args, CborEncoder* retvals);
 
+// Calls several registered methods in one request, see `borneo/rpc/registry.h`
+int bo_rpc_borneo_batch_post(const CborValue* args, CborEncoder* retvals);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
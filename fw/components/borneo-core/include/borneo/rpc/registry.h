@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*bo_rpc_method_t)(const CborValue* args, CborEncoder* retvals);
+
+struct bo_rpc_method_desc {
+    const char* name;
+    bo_rpc_method_t method;
+};
+
+#define __BO_RPC_MAKE_UNIQUE_TOKEN(x, y) _CONCAT(x, y)
+
+/**
+ * @brief Registers an RPC method so it can be called by name, e.g. in a batch.
+ *
+ * By convention a read-only method is registered under the path of the CoAP resource that serves it.
+ */
+#define BO_RPC_METHOD_DEFINE(method_name, method_fn)                                                                   \
+    static const struct bo_rpc_method_desc                                                                             \
+        __attribute__((section(".bo_rpc_method_desc"), used)) __BO_RPC_MAKE_UNIQUE_TOKEN(__bo_rpc_method_desc_,        \
+                                                                                         __LINE__)                     \
+        = {                                                                                                            \
+              .name = (method_name),                                                                                   \
+              .method = (method_fn),                                                                                   \
+          };
+
+/**
+ * @brief Looks up a registered RPC method.
+ *
+ * @return The method, or NULL if nothing is registered under `name`
+ */
+const struct bo_rpc_method_desc* bo_rpc_method_find(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -50,6 +50,7 @@ struct system_info {
     char manuf[BO_DEVICE_MANUF_MAX];
     uint8_t id[BO_DEVICE_ID_LENGTH];
     char hex_id[(BO_DEVICE_ID_LENGTH * 2) + 1];
+    uint32_t generation; ///< Bumped whenever a field changes at runtime
 };
 
 struct system_status {
@@ -0,0 +1,218 @@
+#include <errno.h>
+#include <string.h>
+
+#include "borneo/algo/delta-patch.h"
+
+enum {
+    STATE_HEADER = 0,
+    STATE_OPCODE,
+    STATE_VARINT,
+    STATE_DATA,
+    STATE_DONE,
+};
+
+static inline uint32_t read_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int parse_header(struct delta_patch* patch)
+{
+    const uint8_t* p = patch->header_buf;
+    if (memcmp(p, DELTA_PATCH_MAGIC, 4) != 0) {
+        return -EINVAL;
+    }
+    patch->header.source_size = read_le32(p + 4);
+    patch->header.target_size = read_le32(p + 8);
+    memcpy(patch->header.source_sha256, p + 12, 32);
+    memcpy(patch->header.target_sha256, p + 44, 32);
+    if (patch->io->header != NULL) {
+        return patch->io->header(patch->ctx, &patch->header);
+    }
+    return 0;
+}
+
+static int copy_source(struct delta_patch* patch, uint32_t len)
+{
+    while (len > 0) {
+        size_t n = len < DELTA_PATCH_SCRATCH_SIZE ? len : DELTA_PATCH_SCRATCH_SIZE;
+        int rc = patch->io->read_source(patch->ctx, patch->source_pos, patch->scratch, n);
+        if (rc != 0) {
+            return rc;
+        }
+        rc = patch->io->write_target(patch->ctx, patch->scratch, n);
+        if (rc != 0) {
+            return rc;
+        }
+        patch->source_pos += n;
+        patch->target_len += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Called once the operand of the current operation is complete
+static int begin_op(struct delta_patch* patch)
+{
+    uint32_t n = patch->varint;
+    const struct delta_patch_header* h = &patch->header;
+
+    switch (patch->op) {
+    case DELTA_PATCH_OP_SEEK: {
+        int64_t delta = (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+        int64_t pos = (int64_t)patch->source_pos + delta;
+        if (pos < 0 || pos > (int64_t)h->source_size) {
+            return -EINVAL;
+        }
+        patch->source_pos = (size_t)pos;
+        patch->state = STATE_OPCODE;
+        return 0;
+    }
+
+    case DELTA_PATCH_OP_COPY:
+    case DELTA_PATCH_OP_ADD:
+        if (n > h->source_size - patch->source_pos) {
+            return -EINVAL;
+        }
+        // fallthrough
+    case DELTA_PATCH_OP_INSERT:
+        if (n > h->target_size - patch->target_len) {
+            return -EINVAL;
+        }
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    if (patch->op == DELTA_PATCH_OP_COPY) {
+        patch->state = STATE_OPCODE;
+        return copy_source(patch, n);
+    }
+    patch->remaining = n;
+    patch->state = n > 0 ? STATE_DATA : STATE_OPCODE;
+    return 0;
+}
+
+// Consumes operand bytes of an ADD or INSERT, returns the count used or a negative errno
+static int feed_data(struct delta_patch* patch, const uint8_t* data, size_t len)
+{
+    size_t n = len < patch->remaining ? len : patch->remaining;
+    int rc;
+
+    if (patch->op == DELTA_PATCH_OP_ADD) {
+        if (n > DELTA_PATCH_SCRATCH_SIZE) {
+            n = DELTA_PATCH_SCRATCH_SIZE;
+        }
+        rc = patch->io->read_source(patch->ctx, patch->source_pos, patch->scratch, n);
+        if (rc != 0) {
+            return rc;
+        }
+        for (size_t i = 0; i < n; i++) {
+            patch->scratch[i] += data[i];
+        }
+        rc = patch->io->write_target(patch->ctx, patch->scratch, n);
+        patch->source_pos += n;
+    }
+    else {
+        rc = patch->io->write_target(patch->ctx, data, n);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    patch->target_len += n;
+    patch->remaining -= n;
+    if (patch->remaining == 0) {
+        patch->state = STATE_OPCODE;
+    }
+    return (int)n;
+}
+
+static int feed(struct delta_patch* patch, const uint8_t* data, size_t len)
+{
+    while (len > 0) {
+        switch (patch->state) {
+        case STATE_HEADER: {
+            size_t n = DELTA_PATCH_HEADER_SIZE - patch->header_len;
+            if (n > len) {
+                n = len;
+            }
+            memcpy(patch->header_buf + patch->header_len, data, n);
+            patch->header_len += n;
+            data += n;
+            len -= n;
+            if (patch->header_len == DELTA_PATCH_HEADER_SIZE) {
+                int rc = parse_header(patch);
+                if (rc != 0) {
+                    return rc;
+                }
+                patch->state = STATE_OPCODE;
+            }
+        } break;
+
+        case STATE_OPCODE:
+            patch->op = *data++;
+            len--;
+            if (patch->op == DELTA_PATCH_OP_END) {
+                if (patch->target_len != patch->header.target_size) {
+                    return -EINVAL;
+                }
+                patch->state = STATE_DONE;
+            }
+            else {
+                patch->varint = 0;
+                patch->varint_shift = 0;
+                patch->state = STATE_VARINT;
+            }
+            break;
+
+        case STATE_VARINT: {
+            uint8_t b = *data++;
+            len--;
+            if (patch->varint_shift > 28 || (patch->varint_shift == 28 && (b & 0x70) != 0)) {
+                return -EINVAL;
+            }
+            patch->varint |= (uint32_t)(b & 0x7F) << patch->varint_shift;
+            patch->varint_shift += 7;
+            if ((b & 0x80) == 0) {
+                int rc = begin_op(patch);
+                if (rc != 0) {
+                    return rc;
+                }
+            }
+        } break;
+
+        case STATE_DATA: {
+            int n = feed_data(patch, data, len);
+            if (n < 0) {
+                return n;
+            }
+            data += n;
+            len -= n;
+        } break;
+
+        default:
+            return -EINVAL; // Data after the end
+        }
+    }
+    return 0;
+}
+
+void delta_patch_init(struct delta_patch* patch, const struct delta_patch_io* io, void* ctx)
+{
+    memset(patch, 0, sizeof(*patch));
+    patch->io = io;
+    patch->ctx = ctx;
+    patch->state = STATE_HEADER;
+}
+
+int delta_patch_feed(struct delta_patch* patch, const uint8_t* data, size_t len)
+{
+    if (patch->error == 0) {
+        patch->error = feed(patch, data, len);
+    }
+    return patch->error;
+}
+
+bool delta_patch_done(const struct delta_patch* patch) { return patch->error == 0 && patch->state == STATE_DONE; }
@@ -1,6 +1,19 @@
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
 #include "borneo/common.h"
 #include "borneo/algo/filters.h"
 
+// Compare-exchange: afterwards `a <= b`. Written with ternaries so the compiler can emit conditional moves.
+#define FILTER_SORT2(a, b)                                                                                             \
+    do {                                                                                                               \
+        int32_t _lo = (a) < (b) ? (a) : (b);                                                                           \
+        int32_t _hi = (a) < (b) ? (b) : (a);                                                                           \
+        (a) = _lo;                                                                                                     \
+        (b) = _hi;                                                                                                     \
+    } while (0)
+
 uint16_t median_filter_u16(uint16_t* buffer, size_t buffer_size)
 {
     for (size_t i = 1; i < buffer_size; i++) {
@@ -15,14 +28,242 @@ uint16_t median_filter_u16(uint16_t* buffer, size_t buffer_size)
     return buffer[(buffer_size - 1) / 2];
 }
 
-int32_t ema_filter(int32_t current, int32_t* filtered, int alpha_num, int alpha_denom)
+int32_t median3_i32(int32_t a, int32_t b, int32_t c)
+{
+    FILTER_SORT2(a, b);
+    FILTER_SORT2(b, c);
+    FILTER_SORT2(a, b);
+    return b;
+}
+
+int32_t median5_i32(const int32_t* values)
+{
+    int32_t p[5];
+    memcpy(p, values, sizeof(p));
+    FILTER_SORT2(p[0], p[1]);
+    FILTER_SORT2(p[3], p[4]);
+    FILTER_SORT2(p[0], p[3]);
+    FILTER_SORT2(p[1], p[4]);
+    FILTER_SORT2(p[1], p[2]);
+    FILTER_SORT2(p[2], p[3]);
+    FILTER_SORT2(p[1], p[2]);
+    return p[2];
+}
+
+int32_t median7_i32(const int32_t* values)
+{
+    int32_t p[7];
+    memcpy(p, values, sizeof(p));
+    FILTER_SORT2(p[0], p[5]);
+    FILTER_SORT2(p[0], p[3]);
+    FILTER_SORT2(p[1], p[6]);
+    FILTER_SORT2(p[2], p[4]);
+    FILTER_SORT2(p[0], p[1]);
+    FILTER_SORT2(p[3], p[5]);
+    FILTER_SORT2(p[2], p[6]);
+    FILTER_SORT2(p[2], p[3]);
+    FILTER_SORT2(p[3], p[6]);
+    FILTER_SORT2(p[4], p[5]);
+    FILTER_SORT2(p[1], p[4]);
+    FILTER_SORT2(p[1], p[3]);
+    FILTER_SORT2(p[3], p[4]);
+    return p[3];
+}
+
+int median_filter_init(struct median_filter* filter, size_t size)
+{
+    if (size != 3 && size != 5 && size != 7) {
+        return -EINVAL;
+    }
+    memset(filter, 0, sizeof(*filter));
+    filter->size = (uint8_t)size;
+    return 0;
+}
+
+int32_t median_filter_update(struct median_filter* filter, int32_t sample)
+{
+    if (!filter->initialized) {
+        for (size_t i = 0; i < filter->size; i++) {
+            filter->window[i] = sample;
+        }
+        filter->index = 0;
+        filter->initialized = true;
+        return sample;
+    }
+
+    filter->window[filter->index] = sample;
+    filter->index = (filter->index + 1) % filter->size;
+
+    switch (filter->size) {
+    case 3:
+        return median3_i32(filter->window[0], filter->window[1], filter->window[2]);
+    case 5:
+        return median5_i32(filter->window);
+    default:
+        return median7_i32(filter->window);
+    }
+}
+
+int ema_filter_init(struct ema_filter* filter, uint16_t alpha_num, uint16_t alpha_denom)
+{
+    if (alpha_denom == 0 || alpha_num == 0 || alpha_num > alpha_denom) {
+        return -EINVAL;
+    }
+    memset(filter, 0, sizeof(*filter));
+    filter->alpha_num = alpha_num;
+    filter->alpha_denom = alpha_denom;
+    return 0;
+}
+
+int32_t ema_filter_update(struct ema_filter* filter, int32_t sample)
+{
+    if (!filter->initialized) {
+        filter->value = sample; // Initialize on first call
+        filter->initialized = true;
+    }
+    else {
+        int64_t temp = (int64_t)filter->alpha_num * sample
+            + (int64_t)(filter->alpha_denom - filter->alpha_num) * filter->value;
+        filter->value = (int32_t)(temp / filter->alpha_denom);
+    }
+    return filter->value;
+}
+
+void ema_filter_reset(struct ema_filter* filter) { filter->initialized = false; }
+
+int biquad_lowpass_init(struct biquad_filter* filter, uint32_t sample_rate_mhz, uint32_t cutoff_mhz)
+{
+    if (sample_rate_mhz == 0 || cutoff_mhz == 0 || cutoff_mhz >= sample_rate_mhz / 2) {
+        return -EINVAL;
+    }
+
+    // RBJ audio EQ cookbook low-pass, Q = 1/sqrt(2)
+    const double w0 = 2.0 * M_PI * (double)cutoff_mhz / (double)sample_rate_mhz;
+    const double cos_w0 = cos(w0);
+    const double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    const double a0 = 1.0 + alpha;
+    const double scale = (double)(1LL << BIQUAD_Q) / a0;
+
+    memset(filter, 0, sizeof(*filter));
+    filter->b0 = (int32_t)lround((1.0 - cos_w0) / 2.0 * scale);
+    filter->b1 = (int32_t)lround((1.0 - cos_w0) * scale);
+    filter->b2 = filter->b0;
+    filter->a1 = (int32_t)lround(-2.0 * cos_w0 * scale);
+    filter->a2 = (int32_t)lround((1.0 - alpha) * scale);
+    return 0;
+}
+
+int32_t biquad_filter_update(struct biquad_filter* filter, int32_t sample)
 {
-    if (*filtered == 0) {
-        *filtered = current; // Initialize on first call
+    if (!filter->initialized) {
+        filter->x1 = filter->x2 = sample;
+        filter->y1 = filter->y2 = sample;
+        filter->initialized = true;
+    }
+
+    int64_t acc = (int64_t)filter->b0 * sample + (int64_t)filter->b1 * filter->x1 + (int64_t)filter->b2 * filter->x2
+        - (int64_t)filter->a1 * filter->y1 - (int64_t)filter->a2 * filter->y2;
+    int32_t y = (int32_t)((acc + (1LL << (BIQUAD_Q - 1))) >> BIQUAD_Q);
+
+    filter->x2 = filter->x1;
+    filter->x1 = sample;
+    filter->y2 = filter->y1;
+    filter->y1 = y;
+    return y;
+}
+
+int window_stats_init(struct window_stats* stats, size_t size)
+{
+    if (size == 0 || size > WINDOW_STATS_CAPACITY) {
+        return -EINVAL;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->size = (uint16_t)size;
+    return 0;
+}
+
+static inline int32_t window_stats_at(const struct window_stats* stats, uint32_t seq)
+{
+    return stats->samples[seq % stats->size];
+}
+
+void window_stats_update(struct window_stats* stats, int32_t sample)
+{
+    const uint32_t seq = stats->seq;
+    const uint16_t size = stats->size;
+
+    // Evict the oldest sample from the running sums
+    if (stats->count == size) {
+        int32_t oldest = window_stats_at(stats, seq - size);
+        stats->sum -= oldest;
+        stats->sum_sq -= (int64_t)oldest * oldest;
     }
     else {
-        int64_t temp = (int64_t)alpha_num * current + (int64_t)(alpha_denom - alpha_num) * (*filtered);
-        *filtered = temp / alpha_denom;
+        stats->count++;
+    }
+
+    // Drop deque heads that fall out of the window
+    if (stats->min_len > 0 && stats->min_q[stats->min_head] + size <= seq) {
+        stats->min_head = (stats->min_head + 1) % size;
+        stats->min_len--;
+    }
+    if (stats->max_len > 0 && stats->max_q[stats->max_head] + size <= seq) {
+        stats->max_head = (stats->max_head + 1) % size;
+        stats->max_len--;
+    }
+
+    stats->samples[seq % size] = sample;
+    stats->sum += sample;
+    stats->sum_sq += (int64_t)sample * sample;
+
+    // Keep the deques monotonic: increasing values for min, decreasing for max
+    while (stats->min_len > 0
+           && window_stats_at(stats, stats->min_q[(stats->min_head + stats->min_len - 1) % size]) >= sample) {
+        stats->min_len--;
     }
-    return *filtered;
-}
\ No newline at end of file
+    stats->min_q[(stats->min_head + stats->min_len) % size] = seq;
+    stats->min_len++;
+
+    while (stats->max_len > 0
+           && window_stats_at(stats, stats->max_q[(stats->max_head + stats->max_len - 1) % size]) <= sample) {
+        stats->max_len--;
+    }
+    stats->max_q[(stats->max_head + stats->max_len) % size] = seq;
+    stats->max_len++;
+
+    stats->seq = seq + 1;
+}
+
+int32_t window_stats_min(const struct window_stats* stats)
+{
+    if (stats->min_len == 0) {
+        return 0;
+    }
+    return window_stats_at(stats, stats->min_q[stats->min_head]);
+}
+
+int32_t window_stats_max(const struct window_stats* stats)
+{
+    if (stats->max_len == 0) {
+        return 0;
+    }
+    return window_stats_at(stats, stats->max_q[stats->max_head]);
+}
+
+int32_t window_stats_mean(const struct window_stats* stats)
+{
+    if (stats->count == 0) {
+        return 0;
+    }
+    int64_t n = stats->count;
+    return (int32_t)(stats->sum >= 0 ? (stats->sum + n / 2) / n : (stats->sum - n / 2) / n);
+}
+
+int64_t window_stats_variance(const struct window_stats* stats)
+{
+    if (stats->count == 0) {
+        return 0;
+    }
+    int64_t n = stats->count;
+    return (n * stats->sum_sq - stats->sum * stats->sum) / (n * n);
+}
@@ -0,0 +1,177 @@
+#include <errno.h>
+#include <string.h>
+
+#include "borneo/algo/lzss.h"
+
+enum {
+    STATE_HEADER = 0,
+    STATE_TAG,
+    STATE_LITERAL,
+    STATE_INDEX,
+    STATE_COUNT,
+    STATE_DONE,
+};
+
+static int flush_output(struct lzss_decoder* dec)
+{
+    if (dec->out_len == 0) {
+        return 0;
+    }
+    int rc = dec->io->write(dec->ctx, dec->out, dec->out_len);
+    dec->out_len = 0;
+    return rc;
+}
+
+static inline int emit(struct lzss_decoder* dec, uint8_t b)
+{
+    dec->window[dec->pos & dec->window_mask] = b;
+    dec->pos++;
+    dec->out[dec->out_len++] = b;
+    if (dec->out_len == LZSS_OUTPUT_SIZE) {
+        return flush_output(dec);
+    }
+    return 0;
+}
+
+static int parse_header(struct lzss_decoder* dec)
+{
+    const uint8_t* p = dec->header_buf;
+    if (memcmp(p, LZSS_MAGIC, 4) != 0) {
+        return -EINVAL;
+    }
+    dec->header.window_bits = p[4];
+    dec->header.lookahead_bits = p[5];
+    dec->header.size = (uint32_t)p[8] | ((uint32_t)p[9] << 8) | ((uint32_t)p[10] << 16) | ((uint32_t)p[11] << 24);
+    if (dec->header.window_bits < LZSS_WINDOW_BITS_MIN || dec->header.window_bits > LZSS_WINDOW_BITS_MAX
+        || dec->header.lookahead_bits < LZSS_LOOKAHEAD_BITS_MIN
+        || dec->header.lookahead_bits >= dec->header.window_bits) {
+        return -ENOTSUP;
+    }
+
+    int rc = dec->io->header(dec->ctx, &dec->header, &dec->window);
+    if (rc != 0) {
+        return rc;
+    }
+    if (dec->window == NULL) {
+        return -ENOMEM;
+    }
+    dec->window_mask = (1U << dec->header.window_bits) - 1;
+    dec->state = dec->header.size > 0 ? STATE_TAG : STATE_DONE;
+    return 0;
+}
+
+// Number of bits the current state needs
+static inline uint8_t state_bits(const struct lzss_decoder* dec)
+{
+    switch (dec->state) {
+    case STATE_TAG:
+        return 1;
+    case STATE_LITERAL:
+        return 8;
+    case STATE_INDEX:
+        return dec->header.window_bits;
+    default:
+        return dec->header.lookahead_bits;
+    }
+}
+
+static int feed(struct lzss_decoder* dec, const uint8_t* data, size_t len)
+{
+    if (dec->state == STATE_HEADER) {
+        size_t n = LZSS_HEADER_SIZE - dec->header_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dec->header_buf + dec->header_len, data, n);
+        dec->header_len += n;
+        data += n;
+        len -= n;
+        if (dec->header_len < LZSS_HEADER_SIZE) {
+            return 0;
+        }
+        int rc = parse_header(dec);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    while (dec->state != STATE_DONE) {
+        uint8_t need = state_bits(dec);
+        while (dec->nbits < need && len > 0) {
+            dec->bits = (dec->bits << 8) | *data++;
+            dec->nbits += 8;
+            len--;
+        }
+        if (dec->nbits < need) {
+            return 0; // Wait for more data
+        }
+        dec->nbits -= need;
+        uint32_t value = (dec->bits >> dec->nbits) & ((1U << need) - 1);
+
+        int rc = 0;
+        switch (dec->state) {
+        case STATE_TAG:
+            dec->state = value ? STATE_LITERAL : STATE_INDEX;
+            break;
+
+        case STATE_LITERAL:
+            rc = emit(dec, (uint8_t)value);
+            dec->state = STATE_TAG;
+            break;
+
+        case STATE_INDEX:
+            dec->index = (uint16_t)(value + 1);
+            if (dec->index > dec->pos) {
+                return -EINVAL;
+            }
+            dec->state = STATE_COUNT;
+            break;
+
+        default: {
+            uint32_t count = value + 1;
+            if (count > dec->header.size - dec->pos) {
+                return -EINVAL;
+            }
+            for (uint32_t i = 0; i < count && rc == 0; i++) {
+                rc = emit(dec, dec->window[(dec->pos - dec->index) & dec->window_mask]);
+            }
+            dec->state = STATE_TAG;
+        } break;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+
+        if (dec->pos == dec->header.size) {
+            dec->state = STATE_DONE;
+        }
+    }
+
+    // Only the padding bits of the last byte may follow the end
+    if (len > 0 || (dec->bits & ((1U << dec->nbits) - 1)) != 0) {
+        return -EINVAL;
+    }
+    return flush_output(dec);
+}
+
+void lzss_decoder_init(struct lzss_decoder* dec, const struct lzss_io* io, void* ctx)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->io = io;
+    dec->ctx = ctx;
+    dec->state = STATE_HEADER;
+}
+
+int lzss_decoder_feed(struct lzss_decoder* dec, const uint8_t* data, size_t len)
+{
+    if (dec->error == 0) {
+        dec->error = feed(dec, data, len);
+        // Decoded bytes are handed on before returning, so the caller sees every byte its data produced
+        if (dec->error == 0 && dec->state != STATE_DONE) {
+            dec->error = flush_output(dec);
+        }
+    }
+    return dec->error;
+}
+
+bool lzss_decoder_done(const struct lzss_decoder* dec) { return dec->error == 0 && dec->state == STATE_DONE; }
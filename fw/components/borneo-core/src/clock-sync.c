@@ -0,0 +1,526 @@
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_system.h>
+#include <esp_event.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_netif.h>
+#include <nvs_flash.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <drvfx/drvfx.h>
+#include <borneo/common.h>
+#include <borneo/system.h>
+#include <borneo/nvs.h>
+#include <borneo/coap.h>
+#include <borneo/clock-sync.h>
+
+#if CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+/*
+ * PTP-lite fleet clock.
+ *
+ * The master of a group multicasts a beacon carrying the group, its boot ID and the shared seed once per second.
+ * Followers that are members of the group poll the master with a request; the master answers with the time it
+ * received the request (t2) and the time it sent the answer (t3). With the follower's send (t1) and receive (t4)
+ * times this gives one offset sample and its round-trip delay, as in NTP.
+ *
+ * Wi-Fi queuing only ever adds delay, so the sample with the smallest delay out of the last few is the most accurate
+ * one. Its offset, extrapolated with the estimated skew between the two crystals, is the fleet clock estimate.
+ */
+
+#define TAG "clock-sync"
+
+#define TASK_PRIORITY 12 // Above the CoAP task, timestamps are taken in this task
+#define TASK_STACK_SIZE 3072
+
+#define CLOCK_SYNC_NVS_NS "clksync"
+#define CLOCK_SYNC_NVS_KEY_CONFIG "cfg"
+
+#define CLOCK_SYNC_MAGIC0 'B'
+#define CLOCK_SYNC_MAGIC1 'T'
+#define CLOCK_SYNC_VERSION 1
+
+#define CLOCK_SYNC_SAMPLE_COUNT 16 ///< Window the minimum-delay sample is picked from
+#define CLOCK_SYNC_LOCK_SAMPLES 4 ///< Samples needed before the estimate is reported as locked
+#define CLOCK_SYNC_MAX_DELAY_US 50000 ///< Round trips slower than this carry no useful information
+#define CLOCK_SYNC_SKEW_SPAN_US 16000000 ///< Minimum baseline of a skew measurement
+#define CLOCK_SYNC_MAX_SKEW_PPB 200000 ///< Crystals are far better than 200 ppm; anything larger is noise
+#define CLOCK_SYNC_BEACON_PERIOD_US 1000000
+#define CLOCK_SYNC_MASTER_TIMEOUT_US (5 * CLOCK_SYNC_BEACON_PERIOD_US) ///< Silence before a master is considered gone
+
+enum {
+    CLOCK_SYNC_MSG_BEACON = 1,
+    CLOCK_SYNC_MSG_REQUEST = 2,
+    CLOCK_SYNC_MSG_RESPONSE = 3,
+};
+
+#define CLOCK_SYNC_HEADER_SIZE 4
+#define CLOCK_SYNC_BEACON_SIZE (CLOCK_SYNC_HEADER_SIZE + 2 + 4 + 4)
+#define CLOCK_SYNC_REQUEST_SIZE (CLOCK_SYNC_HEADER_SIZE + 4 + 8)
+#define CLOCK_SYNC_RESPONSE_SIZE (CLOCK_SYNC_REQUEST_SIZE + 8 + 8)
+
+struct clock_sync_config {
+    uint8_t is_master;
+    uint8_t reserved;
+    uint16_t group;
+    uint32_t seed;
+};
+
+struct clock_sync_sample {
+    int64_t local_us; ///< Local time the response was received
+    int64_t offset_us;
+    int64_t delay_us;
+};
+
+struct clock_sync_follower {
+    struct sockaddr_in master_addr;
+    uint32_t master_id; ///< Boot ID of the master being followed, 0 if none
+    uint16_t group;
+    int64_t last_beacon_us;
+    uint32_t seq;
+    int64_t request_t1_us; ///< Send time of the outstanding request, 0 if none
+    struct clock_sync_sample samples[CLOCK_SYNC_SAMPLE_COUNT];
+    uint32_t sample_count;
+    struct clock_sync_sample skew_ref; ///< Baseline of the next skew measurement
+};
+
+/// State read by the render task, guarded by `_lock`
+struct clock_sync_estimate {
+    int64_t anchor_us;
+    int64_t offset_us;
+    int32_t skew_ppb;
+    int64_t delay_us;
+    bool locked;
+    uint32_t seed;
+};
+
+static void clock_sync_task();
+static void clock_sync_handle(const uint8_t* buf, size_t len, const struct sockaddr_in* from, int64_t rx_us);
+static void clock_sync_add_sample(const struct clock_sync_sample* sample);
+static void clock_sync_reset_follower();
+static void clock_sync_join_group();
+static int clock_sync_load_config();
+static void ip_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
+
+static portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+static struct clock_sync_config _config = { 0 };
+static struct clock_sync_estimate _estimate = { 0 };
+static struct clock_sync_follower _follower = { 0 };
+static uint32_t _boot_id = 0;
+static int _sock = -1;
+static atomic_bool _join_pending = false;
+static atomic_bool _reset_pending = false; ///< Follower state is owned by the task, others only request a reset
+
+static inline void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void put_u32(uint8_t* p, uint32_t v)
+{
+    put_u16(p, (uint16_t)(v >> 16));
+    put_u16(p + 2, (uint16_t)v);
+}
+
+static inline void put_i64(uint8_t* p, int64_t v)
+{
+    put_u32(p, (uint32_t)((uint64_t)v >> 32));
+    put_u32(p + 4, (uint32_t)v);
+}
+
+static inline uint16_t get_u16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static inline uint32_t get_u32(const uint8_t* p) { return ((uint32_t)get_u16(p) << 16) | get_u16(p + 2); }
+
+static inline int64_t get_i64(const uint8_t* p) { return (int64_t)(((uint64_t)get_u32(p) << 32) | get_u32(p + 4)); }
+
+static inline void put_header(uint8_t* p, uint8_t type)
+{
+    p[0] = CLOCK_SYNC_MAGIC0;
+    p[1] = CLOCK_SYNC_MAGIC1;
+    p[2] = CLOCK_SYNC_VERSION;
+    p[3] = type;
+}
+
+static inline int64_t estimate_offset_at(const struct clock_sync_estimate* est, int64_t local_us)
+{
+    return est->offset_us + (local_us - est->anchor_us) * est->skew_ppb / 1000000000LL;
+}
+
+static int _clock_sync_init()
+{
+    ESP_LOGI(TAG, "Initializing fleet clock synchronization...");
+
+    _boot_id = esp_random() | 1;
+    BO_TRY(clock_sync_load_config());
+    _estimate.seed = _config.seed;
+
+    _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (_sock < 0) {
+        return -ENOMEM;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_BORNEO_CLOCK_SYNC_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int reuse = 1;
+    setsockopt(_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(_sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(_sock);
+        _sock = -1;
+        return -EIO;
+    }
+    uint8_t ttl = 1;
+    setsockopt(_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    BO_TRY_ESP(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &ip_event_handler, NULL));
+    atomic_store(&_join_pending, true);
+
+    if (xTaskCreate(&clock_sync_task, "clock_sync", TASK_STACK_SIZE, NULL, TASK_PRIORITY, NULL) != pdPASS) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+int64_t bo_clock_sync_time_us()
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&_lock);
+    int64_t offset_us = estimate_offset_at(&_estimate, now_us);
+    portEXIT_CRITICAL(&_lock);
+    return now_us + offset_us;
+}
+
+int64_t bo_clock_sync_time_ms() { return bo_clock_sync_time_us() / 1000LL; }
+
+uint32_t bo_clock_sync_seed()
+{
+    portENTER_CRITICAL(&_lock);
+    uint32_t seed = _estimate.seed;
+    portEXIT_CRITICAL(&_lock);
+    return seed;
+}
+
+void bo_clock_sync_get_status(struct bo_clock_sync_status* status)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&_lock);
+    status->is_master = _config.is_master;
+    status->locked = _estimate.locked;
+    status->group = _config.is_master ? _config.group : _follower.group;
+    status->seed = _estimate.seed;
+    status->offset_us = estimate_offset_at(&_estimate, now_us);
+    status->skew_ppb = _estimate.skew_ppb;
+    status->delay_us = _estimate.delay_us;
+    status->samples = _follower.sample_count;
+    portEXIT_CRITICAL(&_lock);
+}
+
+int bo_clock_sync_set_master(bool is_master, uint16_t group, uint32_t seed)
+{
+    if (is_master && group == BO_CLOCK_SYNC_GROUP_NONE) {
+        return -EINVAL;
+    }
+
+    struct clock_sync_config config = {
+        .is_master = is_master,
+        .group = is_master ? group : BO_CLOCK_SYNC_GROUP_NONE,
+        .seed = seed != 0 ? seed : (esp_random() | 1),
+    };
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(CLOCK_SYNC_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+    BO_TRY(nvs_set_blob(handle, CLOCK_SYNC_NVS_KEY_CONFIG, &config, sizeof(config)));
+    BO_TRY(nvs_commit(handle));
+
+    // A new master starts its own timeline; a demoted one waits for a beacon like any other follower
+    portENTER_CRITICAL(&_lock);
+    _config = config;
+    memset(&_estimate, 0, sizeof(_estimate));
+    _estimate.seed = config.seed;
+    portEXIT_CRITICAL(&_lock);
+    atomic_store(&_reset_pending, true);
+
+    ESP_LOGI(TAG, "Role: %s, group=%u", is_master ? "master" : "follower", config.group);
+    return 0;
+}
+
+static void clock_sync_task()
+{
+    uint8_t buf[CLOCK_SYNC_RESPONSE_SIZE + 8];
+    const int64_t poll_interval_us = CONFIG_BORNEO_CLOCK_SYNC_INTERVAL * 1000LL;
+    int64_t next_beacon_us = esp_timer_get_time();
+    int64_t next_poll_us = next_beacon_us;
+
+    for (;;) {
+        if (atomic_exchange(&_join_pending, false)) {
+            clock_sync_join_group();
+        }
+        if (atomic_exchange(&_reset_pending, false)) {
+            clock_sync_reset_follower();
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        if (_config.is_master && now_us >= next_beacon_us) {
+            next_beacon_us = now_us + CLOCK_SYNC_BEACON_PERIOD_US;
+
+            struct sockaddr_in to = {
+                .sin_family = AF_INET,
+                .sin_port = htons(CONFIG_BORNEO_CLOCK_SYNC_PORT),
+                .sin_addr.s_addr = inet_addr(CONFIG_BORNEO_COAP_MULTICAST_ADDRESS),
+            };
+            put_header(buf, CLOCK_SYNC_MSG_BEACON);
+            put_u16(&buf[4], _config.group);
+            put_u32(&buf[6], _boot_id);
+            put_u32(&buf[10], _config.seed);
+            sendto(_sock, buf, CLOCK_SYNC_BEACON_SIZE, 0, (struct sockaddr*)&to, sizeof(to));
+        }
+
+        if (!_config.is_master && _follower.master_id != 0 && now_us >= next_poll_us) {
+            next_poll_us = now_us + poll_interval_us;
+
+            if (now_us - _follower.last_beacon_us > CLOCK_SYNC_MASTER_TIMEOUT_US) {
+                ESP_LOGW(TAG, "Lost master of group %u", _follower.group);
+                clock_sync_reset_follower();
+            }
+            else {
+                put_header(buf, CLOCK_SYNC_MSG_REQUEST);
+                put_u32(&buf[4], ++_follower.seq);
+                _follower.request_t1_us = esp_timer_get_time();
+                put_i64(&buf[8], _follower.request_t1_us);
+                sendto(_sock, buf, CLOCK_SYNC_REQUEST_SIZE, 0, (struct sockaddr*)&_follower.master_addr,
+                       sizeof(_follower.master_addr));
+            }
+        }
+
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(_sock, &readfds);
+        // A follower without a master only waits for beacons
+        int64_t next_us = now_us + CLOCK_SYNC_BEACON_PERIOD_US;
+        if (_config.is_master) {
+            next_us = next_beacon_us;
+        }
+        else if (_follower.master_id != 0) {
+            next_us = next_poll_us;
+        }
+        int64_t wait_us = next_us - esp_timer_get_time();
+        struct timeval tv = {
+            .tv_sec = wait_us > 0 ? wait_us / 1000000 : 0,
+            .tv_usec = wait_us > 0 ? wait_us % 1000000 : 0,
+        };
+        if (select(_sock + 1, &readfds, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(_sock, buf, sizeof(buf), 0, (struct sockaddr*)&from, &from_len);
+        int64_t rx_us = esp_timer_get_time();
+        if (len >= CLOCK_SYNC_HEADER_SIZE && buf[0] == CLOCK_SYNC_MAGIC0 && buf[1] == CLOCK_SYNC_MAGIC1
+            && buf[2] == CLOCK_SYNC_VERSION) {
+            clock_sync_handle(buf, (size_t)len, &from, rx_us);
+        }
+    }
+}
+
+static void clock_sync_handle(const uint8_t* buf, size_t len, const struct sockaddr_in* from, int64_t rx_us)
+{
+    switch (buf[3]) {
+
+    case CLOCK_SYNC_MSG_REQUEST: {
+        if (!_config.is_master || len < CLOCK_SYNC_REQUEST_SIZE) {
+            return;
+        }
+        uint8_t resp[CLOCK_SYNC_RESPONSE_SIZE];
+        memcpy(resp, buf, CLOCK_SYNC_REQUEST_SIZE);
+        put_header(resp, CLOCK_SYNC_MSG_RESPONSE);
+        put_i64(&resp[16], rx_us);
+        put_i64(&resp[24], esp_timer_get_time());
+        sendto(_sock, resp, sizeof(resp), 0, (const struct sockaddr*)from, sizeof(*from));
+    } break;
+
+    case CLOCK_SYNC_MSG_BEACON: {
+        if (_config.is_master || len < CLOCK_SYNC_BEACON_SIZE) {
+            return;
+        }
+        uint16_t group = get_u16(&buf[4]);
+        uint32_t master_id = get_u32(&buf[6]);
+        uint32_t seed = get_u32(&buf[10]);
+
+        if (master_id != _follower.master_id) {
+            // Stick to the current master until it goes silent
+            if (_follower.master_id != 0 || !bo_coap_group_is_member(group)) {
+                return;
+            }
+            clock_sync_reset_follower();
+            _follower.master_id = master_id;
+            _follower.group = group;
+            _follower.master_addr = *from;
+            _follower.master_addr.sin_port = htons(CONFIG_BORNEO_CLOCK_SYNC_PORT);
+            ESP_LOGI(TAG, "Following master %08" PRIx32 " of group %u", master_id, group);
+        }
+        _follower.last_beacon_us = rx_us;
+
+        portENTER_CRITICAL(&_lock);
+        _estimate.seed = seed;
+        portEXIT_CRITICAL(&_lock);
+    } break;
+
+    case CLOCK_SYNC_MSG_RESPONSE: {
+        if (_config.is_master || len < CLOCK_SYNC_RESPONSE_SIZE || _follower.request_t1_us == 0) {
+            return;
+        }
+        int64_t t1 = get_i64(&buf[8]);
+        if (get_u32(&buf[4]) != _follower.seq || t1 != _follower.request_t1_us) {
+            return; // Late answer to an earlier request
+        }
+        _follower.request_t1_us = 0;
+
+        int64_t t2 = get_i64(&buf[16]);
+        int64_t t3 = get_i64(&buf[24]);
+        struct clock_sync_sample sample = {
+            .local_us = rx_us,
+            .offset_us = ((t2 - t1) + (t3 - rx_us)) / 2,
+            .delay_us = (rx_us - t1) - (t3 - t2),
+        };
+        if (sample.delay_us >= 0 && sample.delay_us <= CLOCK_SYNC_MAX_DELAY_US) {
+            clock_sync_add_sample(&sample);
+        }
+    } break;
+
+    default:
+        break;
+    }
+}
+
+static void clock_sync_add_sample(const struct clock_sync_sample* sample)
+{
+    struct clock_sync_follower* f = &_follower;
+    f->samples[f->sample_count % CLOCK_SYNC_SAMPLE_COUNT] = *sample;
+    f->sample_count++;
+
+    size_t n = f->sample_count < CLOCK_SYNC_SAMPLE_COUNT ? f->sample_count : CLOCK_SYNC_SAMPLE_COUNT;
+    const struct clock_sync_sample* best = &f->samples[0];
+    for (size_t i = 1; i < n; i++) {
+        if (f->samples[i].delay_us < best->delay_us
+            || (f->samples[i].delay_us == best->delay_us && f->samples[i].local_us > best->local_us)) {
+            best = &f->samples[i];
+        }
+    }
+
+    struct clock_sync_estimate est;
+    portENTER_CRITICAL(&_lock);
+    est = _estimate;
+    portEXIT_CRITICAL(&_lock);
+
+    if (f->sample_count == 1) {
+        f->skew_ref = *best;
+        est.skew_ppb = 0;
+    }
+    else if (best->local_us - f->skew_ref.local_us >= CLOCK_SYNC_SKEW_SPAN_US) {
+        int64_t measured_ppb = (best->offset_us - f->skew_ref.offset_us) * 1000000000LL
+                               / (best->local_us - f->skew_ref.local_us);
+        int64_t skew_ppb = est.skew_ppb + (measured_ppb - est.skew_ppb) / 2;
+        if (skew_ppb > CLOCK_SYNC_MAX_SKEW_PPB) {
+            skew_ppb = CLOCK_SYNC_MAX_SKEW_PPB;
+        }
+        else if (skew_ppb < -CLOCK_SYNC_MAX_SKEW_PPB) {
+            skew_ppb = -CLOCK_SYNC_MAX_SKEW_PPB;
+        }
+        est.skew_ppb = (int32_t)skew_ppb;
+        f->skew_ref = *best;
+    }
+
+    est.anchor_us = best->local_us;
+    est.offset_us = best->offset_us;
+    est.delay_us = best->delay_us;
+    est.locked = f->sample_count >= CLOCK_SYNC_LOCK_SAMPLES;
+
+    portENTER_CRITICAL(&_lock);
+    est.seed = _estimate.seed;
+    _estimate = est;
+    portEXIT_CRITICAL(&_lock);
+
+    if (f->sample_count == CLOCK_SYNC_LOCK_SAMPLES) {
+        ESP_LOGI(TAG, "Locked to group %u: offset=%lld us, delay=%lld us", f->group, est.offset_us, est.delay_us);
+    }
+}
+
+static void clock_sync_reset_follower()
+{
+    memset(&_follower, 0, sizeof(_follower));
+    portENTER_CRITICAL(&_lock);
+    _estimate.locked = false;
+    portEXIT_CRITICAL(&_lock);
+}
+
+static void clock_sync_join_group()
+{
+    struct ip_mreq mreq = {
+        .imr_multiaddr.s_addr = inet_addr(CONFIG_BORNEO_COAP_MULTICAST_ADDRESS),
+        .imr_interface.s_addr = htonl(INADDR_ANY),
+    };
+    // Dropping first makes the join idempotent across reconnections
+    setsockopt(_sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+    if (setsockopt(_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+        ESP_LOGW(TAG, "Failed to join multicast group %s", CONFIG_BORNEO_COAP_MULTICAST_ADDRESS);
+    }
+}
+
+static int clock_sync_load_config()
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(CLOCK_SYNC_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    size_t size = sizeof(_config);
+    int rc = nvs_get_blob(handle, CLOCK_SYNC_NVS_KEY_CONFIG, &_config, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND || (rc == 0 && size != sizeof(_config))) {
+        memset(&_config, 0, sizeof(_config));
+        _config.seed = esp_random() | 1;
+        return 0;
+    }
+    BO_TRY(rc);
+    return 0;
+}
+
+static void ip_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        atomic_store(&_join_pending, true);
+    }
+}
+
+DRVFX_SYS_INIT_ASYNC(_clock_sync_init, DRVFX_INIT_APP_DEFAULT_PRIORITY, DRVFX_INIT_DEPS("_borneo_net_init"));
+
+#else
+
+static uint32_t _seed = 0;
+
+int64_t bo_clock_sync_time_us() { return esp_timer_get_time(); }
+
+int64_t bo_clock_sync_time_ms() { return esp_timer_get_time() / 1000LL; }
+
+uint32_t bo_clock_sync_seed()
+{
+    if (_seed == 0) {
+        _seed = esp_random() | 1;
+    }
+    return _seed;
+}
+
+#endif // CONFIG_BORNEO_CLOCK_SYNC_ENABLED
@@ -1,13 +1,25 @@
 
 
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <assert.h>
+
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
+#include <freertos/task.h>
 #include <esp_system.h>
 #include <esp_event.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <esp_vfs_eventfd.h>
+#include <esp_netif.h>
 #include <sys/socket.h>
+#include <sys/select.h>
+#include <unistd.h>
 
 #include <coap3/coap.h>
+#include <cbor.h>
 
 #include <drvfx/drvfx.h>
 #include <borneo/system.h>
@@ -15,19 +27,26 @@
 #include <borneo/sntp.h>
 
 #define COAP_TASK_PRIO 10
-#define NOTIFY_TASK_PRIO 9
 
 static int notify_init();
-static void notify_task();
+static uint32_t notify_process();
+static void coap_wakeup();
 static void _system_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 
-#define NOTIFY_QUEUE_LENGTH 32
-#define NOTIFY_QUEUE_ITEM_SIZE (sizeof(coap_str_const_t))
+#define NOTIFY_WORD_BITS 32
+#define ETAG_SIZE 8
+#define ETAG_VARIANT_INDEX 3
+#define ETAG_VARIANT_TEXT 0 ///< Text-keyed schema, the default representation
+#define ETAG_VARIANT_COMPACT 1 ///< Integer-keyed schema, see `BO_COAP_QUERY_COMPACT`
 
 unsigned int coap_adjust_basetime(coap_context_t* ctx, coap_tick_t now);
 
 static void bo_coap_deinit();
 static int register_resource(coap_context_t* ctx, const struct coap_resource_desc* res);
+static void versioned_get_handler(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                  const coap_string_t* query, coap_pdu_t* response);
+static void versioned_put_handler(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                  const coap_string_t* query, coap_pdu_t* response);
 static void _bo_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 
 #define TAG "coap-server"
@@ -39,30 +58,78 @@ static coap_address_t _serv_addr;
 static coap_endpoint_t* _ep_udp = NULL;
 static TaskHandle_t _coap_server_task = NULL;
 static volatile bool _should_stop = false;
-
-static StaticQueue_t s_notify_queue_struct;
-static uint8_t s_notify_queue_storage[NOTIFY_QUEUE_LENGTH * NOTIFY_QUEUE_ITEM_SIZE];
-static QueueHandle_t s_notify_queue = NULL;
+static atomic_bool _clock_adjust_pending = false;
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+static atomic_bool _mcast_join_pending = false; ///< Set whenever the station (re)gets an address
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+static int _wakeup_fd = -1; ///< eventfd that interrupts `coap_io_process_with_fds()` in the I/O task
+static uint32_t _etag_nonce = 0; ///< Random per boot, so ETags from before a reboot never match
+
+/*
+ * Response payloads are encoded into this buffer instead of a stack array in every handler. All handlers, including
+ * the GETs replayed for observe notifications, run in the CoAP I/O task, so the buffer never has two users.
+ */
+static uint8_t s_response_buf[CONFIG_BORNEO_COAP_RESPONSE_BUFFER_SIZE];
+
+extern const struct coap_resource_desc _coap_resources_start[];
+extern const struct coap_resource_desc _coap_resources_end[];
+
+/*
+ * Pending notifications are a bitset indexed by the position of the resource in the `.coap_resource_desc` section.
+ * Producers only set a bit and wake the CoAP I/O task, so bursts of changes to one resource collapse into a single
+ * fan-out and there is nothing that can overflow.
+ *
+ * `_ctx` is only ever touched by the I/O task: the fan-out runs between two `coap_io_process_with_fds()` calls.
+ */
+struct notify_state {
+    size_t resource_count;
+    size_t word_count;
+    atomic_uint* dirty; ///< Set by producers, drained by the I/O task
+    uint32_t* pending; ///< Drained but held back by the minimum interval, owned by the I/O task
+    int64_t* last_notify_ms; ///< Per-resource time of the last fan-out
+    coap_resource_t** resources; ///< Lazily resolved libcoap resources
+    coap_resource_t* heartbeat;
+    int64_t last_activity_ms; ///< Time of the last fan-out or heartbeat
+};
+
+static struct notify_state s_notify = { 0 };
 
 static void _coap_server_proc(void* p)
 {
-    uint32_t wait_ms;
-    wait_ms = COAP_RESOURCE_CHECK_TIME * 1000;
-
     while (!_should_stop) {
-        taskYIELD();
-        int result = coap_io_process(_ctx, wait_ms);
-        if (result < 0) {
-            break;
+        if (atomic_exchange(&_clock_adjust_pending, false)) {
+            coap_tick_t now;
+            coap_clock_init();
+            coap_ticks(&now);
+            coap_adjust_basetime(_ctx, now);
         }
-        else if (result != 0 && (uint32_t)result < wait_ms) {
-            /* decrement if there is a result wait time returned */
-            wait_ms -= result;
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+        // IGMP membership is tied to the interface address, so join again after every reconnection
+        if (atomic_exchange(&_mcast_join_pending, false)) {
+            if (coap_join_mcast_group_intf(_ctx, CONFIG_BORNEO_COAP_MULTICAST_ADDRESS, NULL) != 0) {
+                ESP_LOGW(TAG, "Failed to join multicast group %s", CONFIG_BORNEO_COAP_MULTICAST_ADDRESS);
+            }
         }
-        if (result != 0) {
-            /* result must have been >= wait_ms, so reset wait_ms */
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+        uint32_t wait_ms = notify_process();
+        if (wait_ms > COAP_RESOURCE_CHECK_TIME * 1000) {
             wait_ms = COAP_RESOURCE_CHECK_TIME * 1000;
         }
+
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(_wakeup_fd, &readfds);
+        int result = coap_io_process_with_fds(_ctx, wait_ms, _wakeup_fd + 1, &readfds, NULL, NULL);
+        if (result < 0) {
+            break;
+        }
+
+        if (FD_ISSET(_wakeup_fd, &readfds)) {
+            uint64_t count;
+            read(_wakeup_fd, &count, sizeof(count));
+        }
     }
     ESP_LOGI(TAG, "Closing the CoAP sub-system...");
     bo_coap_deinit();
@@ -73,14 +140,19 @@ void _bo_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id,
 {
     // Reset the time in CoAP library
     if (event_base == BO_SNTP_EVENTS && event_id == BO_SNTP_EVENT_SUCCEED) {
-        coap_tick_t now;
-        coap_clock_init();
-        coap_ticks(&now);
-        coap_adjust_basetime(_ctx, now);
+        atomic_store(&_clock_adjust_pending, true);
+        coap_wakeup();
     }
     else if (event_base == BO_SYSTEM_EVENTS && event_id == BO_EVENT_SHUTDOWN_SCHEDULED) {
         _should_stop = true;
+        coap_wakeup();
     }
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        atomic_store(&_mcast_join_pending, true);
+        coap_wakeup();
+    }
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
 }
 
 static int _coap_init()
@@ -89,8 +161,14 @@ static int _coap_init()
     ESP_LOGI(TAG, "Initializing CoAP server...");
 
     coap_set_log_level(CONFIG_COAP_LOG_DEFAULT_LEVEL);
+    _etag_nonce = esp_random();
 
     BO_TRY_ESP(esp_event_handler_register(BO_SNTP_EVENTS, ESP_EVENT_ANY_ID, &_bo_event_handler, NULL));
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+    BO_TRY(bo_coap_group_load());
+    BO_TRY_ESP(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &_bo_event_handler, NULL));
+    atomic_store(&_mcast_join_pending, true);
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
 
     // Prepare the CoAP server socket
     coap_address_init(&_serv_addr);
@@ -113,8 +191,6 @@ static int _coap_init()
     }
 
     // Register all handlers
-    extern const struct coap_resource_desc _coap_resources_start[];
-    extern const struct coap_resource_desc _coap_resources_end[];
     for (const struct coap_resource_desc* it = _coap_resources_start; it != _coap_resources_end; ++it) {
         rc = register_resource(_ctx, it);
         if (rc != 0) {
@@ -128,15 +204,19 @@ static int _coap_init()
         ESP_LOGI(TAG, "Registered %u CoAP resources", (size_t)res_count);
     }
 
+    rc = notify_init();
+    if (rc != 0) {
+        goto _DEINIT_AND_EXIT;
+    }
+
     ESP_LOGI(TAG, "Starting CoAP server...");
-    rc = xTaskCreate(&_coap_server_proc, "coap", 8 * 1024, NULL, COAP_TASK_PRIO, &_coap_server_task);
+    rc = xTaskCreate(&_coap_server_proc, "coap", CONFIG_BORNEO_COAP_TASK_STACK_SIZE, NULL, COAP_TASK_PRIO,
+                     &_coap_server_task);
     if (rc != pdPASS) {
         rc = -ENOMEM;
         goto _DEINIT_AND_EXIT;
     }
 
-    BO_TRY(notify_init());
-
     ESP_LOGI(TAG, "CoAP module has been initialized successfully.");
     return 0;
 
@@ -151,12 +231,21 @@ void bo_coap_deinit()
     // Unregister event handlers
     esp_event_handler_unregister(BO_SNTP_EVENTS, ESP_EVENT_ANY_ID, _bo_event_handler);
     esp_event_handler_unregister(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, _system_event_handler);
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+    esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, _bo_event_handler);
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
 
     if (_ctx != NULL) {
         coap_free_context(_ctx);
         _ctx = NULL;
         coap_cleanup();
     }
+
+    if (_wakeup_fd >= 0) {
+        int fd = _wakeup_fd;
+        _wakeup_fd = -1;
+        close(fd);
+    }
 }
 
 static int register_resource(coap_context_t* ctx, const struct coap_resource_desc* res)
@@ -171,14 +260,20 @@ static int register_resource(coap_context_t* ctx, const struct coap_resource_des
         return -EINVAL;
     }
 
+    // Versioned resources go through handlers that validate ETags before calling the real ones
+    const bool is_versioned = res->get_generation != NULL;
+    coap_resource_set_userdata(resource, (void*)res);
+
     if (res->get_handler != NULL) {
-        coap_register_request_handler(resource, COAP_REQUEST_GET, res->get_handler);
+        coap_register_request_handler(resource, COAP_REQUEST_GET,
+                                      is_versioned ? versioned_get_handler : res->get_handler);
     }
     if (res->post_handler != NULL) {
         coap_register_request_handler(resource, COAP_REQUEST_POST, res->post_handler);
     }
     if (res->put_handler != NULL) {
-        coap_register_request_handler(resource, COAP_REQUEST_PUT, res->put_handler);
+        coap_register_request_handler(resource, COAP_REQUEST_PUT,
+                                      is_versioned ? versioned_put_handler : res->put_handler);
     }
     if (res->delete_handler != NULL) {
         coap_register_request_handler(resource, COAP_REQUEST_DELETE, res->delete_handler);
@@ -188,61 +283,306 @@ static int register_resource(coap_context_t* ctx, const struct coap_resource_des
     return 0;
 }
 
-int bo_coap_notify_resource_changed(const coap_str_const_t* resource_uri)
+/**
+ * @brief Finds `option` in a `&`-separated query and returns its item, e.g. `o=1024`, or NULL.
+ */
+static const uint8_t* query_find(const coap_string_t* query, const char* option, const uint8_t** item_end)
+{
+    if (query == NULL || option == NULL) {
+        return NULL;
+    }
+
+    const size_t option_len = strlen(option);
+    const uint8_t* p = query->s;
+    const uint8_t* end = query->s + query->length;
+    while (p < end) {
+        const uint8_t* sep = memchr(p, '&', end - p);
+        *item_end = sep != NULL ? sep : end;
+        if ((size_t)(*item_end - p) >= option_len && memcmp(p, option, option_len) == 0
+            && (p + option_len == *item_end || p[option_len] == '=')) {
+            return p;
+        }
+        p = *item_end + 1;
+    }
+    return NULL;
+}
+
+bool bo_coap_query_has(const coap_string_t* query, const char* option)
 {
-    BaseType_t rc;
-    if (xPortInIsrContext()) {
-        rc = xQueueSendToBackFromISR(s_notify_queue, resource_uri, NULL);
+    const uint8_t* item_end;
+    return query_find(query, option, &item_end) != NULL;
+}
+
+int bo_coap_query_get_uint(const coap_string_t* query, const char* option, uint32_t* value)
+{
+    const uint8_t* item_end;
+    const uint8_t* item = query_find(query, option, &item_end);
+    if (item == NULL) {
+        return -ENOENT;
+    }
+
+    const uint8_t* p = item + strlen(option) + 1;
+    if (p >= item_end || item_end - p > 10) {
+        return -EINVAL;
     }
-    else {
-        rc = xQueueSendToBack(s_notify_queue, resource_uri, 0);
+    uint64_t result = 0;
+    for (; p < item_end; p++) {
+        if (*p < '0' || *p > '9') {
+            return -EINVAL;
+        }
+        result = result * 10 + (*p - '0');
     }
-    if (rc != pdTRUE) {
-        return -EIO;
+    if (result > UINT32_MAX) {
+        return -EINVAL;
     }
+    *value = (uint32_t)result;
     return 0;
 }
 
+/*
+ * ETag layout: 3 bytes of the boot nonce, 1 byte identifying the representation the query selects and the 32-bit
+ * generation. The variant follows the schema, not the query text, so `?compact` and `?compact=1` share their ETag.
+ */
+static void make_etag(const struct coap_resource_desc* desc, const coap_string_t* query, uint8_t etag[ETAG_SIZE])
+{
+    const uint32_t generation = desc->get_generation();
+    const uint8_t variant = bo_coap_query_has(query, BO_COAP_QUERY_COMPACT) ? ETAG_VARIANT_COMPACT : ETAG_VARIANT_TEXT;
+
+    etag[0] = (uint8_t)(_etag_nonce >> 16);
+    etag[1] = (uint8_t)(_etag_nonce >> 8);
+    etag[2] = (uint8_t)_etag_nonce;
+    etag[ETAG_VARIANT_INDEX] = variant;
+    for (size_t i = 0; i < 4; i++) {
+        etag[4 + i] = (uint8_t)(generation >> (24 - i * 8));
+    }
+}
+
+/**
+ * Returns 1 if one of the `option_num` options of `request` equals `etag`, 0 if none does and -ENOENT if the request
+ * has no such option. If-Match ignores the variant byte since all representations share one state, and an empty
+ * If-Match matches any existing representation (RFC 7252, 5.10.8.1).
+ */
+static int match_etag_option(const coap_pdu_t* request, coap_option_num_t option_num, const uint8_t etag[ETAG_SIZE])
+{
+    coap_opt_filter_t filter;
+    coap_option_filter_clear(&filter);
+    coap_option_filter_set(&filter, option_num);
+
+    coap_opt_iterator_t opt_iter;
+    coap_option_iterator_init(request, &opt_iter, &filter);
+
+    const bool is_if_match = option_num == COAP_OPTION_IF_MATCH;
+    int rc = -ENOENT;
+    coap_opt_t* opt;
+    while ((opt = coap_option_next(&opt_iter)) != NULL) {
+        const size_t len = coap_opt_length(opt);
+        const uint8_t* value = coap_opt_value(opt);
+        if (len == 0 && is_if_match) {
+            return 1;
+        }
+        if (len == ETAG_SIZE && memcmp(value, etag, ETAG_VARIANT_INDEX) == 0
+            && (is_if_match || value[ETAG_VARIANT_INDEX] == etag[ETAG_VARIANT_INDEX])
+            && memcmp(value + ETAG_VARIANT_INDEX + 1, etag + ETAG_VARIANT_INDEX + 1,
+                      ETAG_SIZE - ETAG_VARIANT_INDEX - 1)
+                   == 0) {
+            return 1;
+        }
+        rc = 0;
+    }
+    return rc;
+}
+
+static void versioned_get_handler(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                  const coap_string_t* query, coap_pdu_t* response)
+{
+    const struct coap_resource_desc* desc = coap_resource_get_userdata(resource);
+
+    uint8_t etag[ETAG_SIZE];
+    make_etag(desc, query, etag);
+    coap_add_option(response, COAP_OPTION_ETAG, sizeof(etag), etag);
+
+    // The client already holds this version, skip encoding it again (RFC 7252, 5.10.6.2)
+    if (match_etag_option(request, COAP_OPTION_ETAG, etag) == 1) {
+        coap_pdu_set_code(response, BO_COAP_CODE_203_VALID);
+        return;
+    }
+
+    desc->get_handler(resource, session, request, query, response);
+}
+
+static void versioned_put_handler(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                  const coap_string_t* query, coap_pdu_t* response)
+{
+    const struct coap_resource_desc* desc = coap_resource_get_userdata(resource);
+
+    uint8_t etag[ETAG_SIZE];
+    make_etag(desc, query, etag);
+    if (match_etag_option(request, COAP_OPTION_IF_MATCH, etag) == 0) {
+        coap_pdu_set_code(response, BO_COAP_CODE_412_PRECONDITION_FAILED);
+        return;
+    }
+
+    desc->put_handler(resource, session, request, query, response);
+}
+
+int bo_coap_notify_resource_changed(const coap_str_const_t* resource_uri)
+{
+    if (_wakeup_fd < 0) {
+        return -ENODEV;
+    }
+
+    for (size_t i = 0; i < s_notify.resource_count; i++) {
+        const coap_str_const_t* path = &_coap_resources_start[i].path;
+        if (path->length != resource_uri->length || memcmp(path->s, resource_uri->s, path->length) != 0) {
+            continue;
+        }
+
+        atomic_fetch_or(&s_notify.dirty[i / NOTIFY_WORD_BITS], 1U << (i % NOTIFY_WORD_BITS));
+        coap_wakeup();
+        return 0;
+    }
+
+    return -ENOENT;
+}
+
+void bo_coap_respond_cbor(const coap_pdu_t* request, coap_pdu_t* response, bo_coap_cbor_encoder_t encode,
+                          const struct CborValue* args)
+{
+    assert(xTaskGetCurrentTaskHandle() == _coap_server_task);
+
+#if CONFIG_BORNEO_COAP_RESPONSE_PROFILING
+    const int64_t started_us = esp_timer_get_time();
+#endif
+
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, s_response_buf, sizeof(s_response_buf), 0);
+    BO_COAP_TRY(encode(args, &encoder), response);
+
+    // Goes out in a single PDU when it fits, block-wise (RFC 7959) otherwise
+    size_t encoded_size = cbor_encoder_get_buffer_size(&encoder, s_response_buf);
+    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size,
+                                   s_response_buf);
+
+#if CONFIG_BORNEO_COAP_RESPONSE_PROFILING
+    ESP_LOGI(TAG, "CBOR response: %u bytes in %lld us, stack high-water mark %u bytes", encoded_size,
+             esp_timer_get_time() - started_us, uxTaskGetStackHighWaterMark(NULL));
+#endif
+}
+
 int notify_init()
 {
-    s_notify_queue = xQueueCreateStatic(NOTIFY_QUEUE_LENGTH, NOTIFY_QUEUE_ITEM_SIZE, s_notify_queue_storage,
-                                        &s_notify_queue_struct);
-    if (!s_notify_queue) {
+    s_notify.resource_count = _coap_resources_end - _coap_resources_start;
+    s_notify.word_count = (s_notify.resource_count + NOTIFY_WORD_BITS - 1) / NOTIFY_WORD_BITS;
+
+    s_notify.dirty = calloc(s_notify.word_count, sizeof(atomic_uint));
+    s_notify.pending = calloc(s_notify.word_count, sizeof(uint32_t));
+    s_notify.last_notify_ms = calloc(s_notify.resource_count, sizeof(int64_t));
+    s_notify.resources = calloc(s_notify.resource_count, sizeof(coap_resource_t*));
+    if (s_notify.dirty == NULL || s_notify.pending == NULL || s_notify.last_notify_ms == NULL
+        || s_notify.resources == NULL) {
         return -ENOMEM;
     }
 
-    BO_TRY_ESP(esp_event_handler_register(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, &_system_event_handler, NULL));
+    s_notify.last_activity_ms = esp_timer_get_time() / 1000;
 
-    BaseType_t rc = xTaskCreate(&notify_task, "coap.notify", 1024 * 3, NULL, NOTIFY_TASK_PRIO, NULL);
-    if (rc != pdPASS) {
+    // The eventfd is written from ISRs too, hence `EFD_SUPPORT_ISR`
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err = esp_vfs_eventfd_register(&eventfd_config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
         return -ENOMEM;
     }
+    _wakeup_fd = eventfd(0, EFD_SUPPORT_ISR);
+    if (_wakeup_fd < 0) {
+        return -ENOMEM;
+    }
+
+    BO_TRY_ESP(esp_event_handler_register(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, &_system_event_handler, NULL));
 
     return 0;
 }
 
-void notify_task()
+static inline uint32_t notify_interval_ms(size_t index)
+{
+    uint16_t interval = _coap_resources_start[index].notify_interval_ms;
+    return interval > 0 ? interval : CONFIG_BORNEO_COAP_NOTIFY_MIN_INTERVAL;
+}
+
+static void notify_fan_out(size_t index)
+{
+    if (s_notify.resources[index] == NULL) {
+        s_notify.resources[index]
+            = coap_get_resource_from_uri_path(_ctx, (coap_str_const_t*)&_coap_resources_start[index].path);
+    }
+    if (s_notify.resources[index] != NULL) {
+        coap_resource_notify_observers(s_notify.resources[index], NULL);
+    }
+}
+
+static void coap_wakeup()
+{
+    if (_wakeup_fd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    write(_wakeup_fd, &one, sizeof(one));
+}
+
+/**
+ * @brief Fans out every due notification. Runs in the CoAP I/O task only.
+ *
+ * @return Milliseconds until the next pending notification or heartbeat is due
+ */
+static uint32_t notify_process()
 {
     static const coap_str_const_t BO_COAP_URI_HEARTBEAT = {
         .s = (const uint8_t*)BO_COAP_PATH_HEARTBEAT,
         .length = sizeof(BO_COAP_PATH_HEARTBEAT) - 1,
     };
-    coap_resource_t* res_heartbeat = coap_get_resource_from_uri_path(_ctx, (coap_str_const_t*)&BO_COAP_URI_HEARTBEAT);
-
-    for (;;) {
-        coap_str_const_t path;
-        if (xQueueReceive(s_notify_queue, &path, pdMS_TO_TICKS(BO_COAP_HEARTBEAT_INTERVAL_MS)) == pdTRUE) {
-            coap_resource_t* res = coap_get_resource_from_uri_path(_ctx, &path);
-            if (res) {
-                coap_resource_notify_observers(res, NULL);
+    if (s_notify.heartbeat == NULL) {
+        s_notify.heartbeat = coap_get_resource_from_uri_path(_ctx, (coap_str_const_t*)&BO_COAP_URI_HEARTBEAT);
+    }
+
+    const int64_t now_ms = esp_timer_get_time() / 1000;
+    int64_t next_due_ms = INT64_MAX;
+    bool notified = false;
+
+    // Drain every dirty bit in one pass; resources still inside their minimum interval stay pending
+    for (size_t w = 0; w < s_notify.word_count; w++) {
+        s_notify.pending[w] |= atomic_exchange(&s_notify.dirty[w], 0);
+        uint32_t bits = s_notify.pending[w];
+        while (bits != 0) {
+            const unsigned bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            const size_t index = w * NOTIFY_WORD_BITS + bit;
+            const int64_t due_ms = s_notify.last_notify_ms[index] + notify_interval_ms(index);
+            if (now_ms >= due_ms) {
+                s_notify.pending[w] &= ~(1U << bit);
+                s_notify.last_notify_ms[index] = now_ms;
+                notify_fan_out(index);
+                notified = true;
             }
-        }
-        else {
-            if (res_heartbeat) {
-                coap_resource_notify_observers(res_heartbeat, NULL);
+            else if (due_ms < next_due_ms) {
+                next_due_ms = due_ms;
             }
         }
     }
+
+    if (notified) {
+        s_notify.last_activity_ms = now_ms;
+    }
+    else if (now_ms - s_notify.last_activity_ms >= BO_COAP_HEARTBEAT_INTERVAL_MS) {
+        if (s_notify.heartbeat) {
+            coap_resource_notify_observers(s_notify.heartbeat, NULL);
+        }
+        s_notify.last_activity_ms = now_ms;
+    }
+
+    const int64_t heartbeat_due_ms = s_notify.last_activity_ms + BO_COAP_HEARTBEAT_INTERVAL_MS;
+    if (heartbeat_due_ms < next_due_ms) {
+        next_due_ms = heartbeat_due_ms;
+    }
+    return next_due_ms > now_ms ? (uint32_t)(next_due_ms - now_ms) : 1;
 }
 
 void _system_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
@@ -253,7 +593,10 @@ void _system_event_handler(void* arg, esp_event_base_t event_base, int32_t event
     case BO_EVENT_SHUTDOWN_SCHEDULED:
     case BO_EVENT_SHUTDOWN_FAULT: {
         coap_str_const_t uri = { .s = (const uint8_t*)BO_COAP_PATH_POWER, .length = sizeof(BO_COAP_PATH_POWER) - 1 };
-        BO_MUST(bo_coap_notify_resource_changed(&uri));
+        int rc = bo_coap_notify_resource_changed(&uri);
+        if (rc) {
+            ESP_LOGW(TAG, "Failed to mark `%s` as changed, errcode=%d", BO_COAP_PATH_POWER, rc);
+        }
     } break;
 
     default:
@@ -261,4 +604,4 @@ void _system_event_handler(void* arg, esp_event_base_t event_base, int32_t event
     }
 }
 
-DRVFX_SYS_INIT(_coap_init, APPLICATION, DRVFX_INIT_APP_DEFAULT_PRIORITY);
\ No newline at end of file
+DRVFX_SYS_INIT_ASYNC(_coap_init, DRVFX_INIT_APP_DEFAULT_PRIORITY, DRVFX_INIT_DEPS("_borneo_net_init"));
\ No newline at end of file
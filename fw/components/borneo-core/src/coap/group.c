@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <esp_system.h>
+#include <esp_log.h>
+#include <nvs_flash.h>
+
+#include <coap3/coap.h>
+
+#include <borneo/common.h>
+#include <borneo/coap.h>
+#include <borneo/nvs.h>
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+/*
+ * Multicast group membership.
+ *
+ * Every fixture listens on the same multicast address; group commands carry a group ID and a fixture only acts on the
+ * groups it belongs to. Group 0 addresses every fixture and needs no membership.
+ */
+
+#define TAG "coap-group"
+
+#define GROUP_NVS_NS "group"
+#define GROUP_NVS_KEY_IDS "ids"
+
+static portMUX_TYPE _group_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t _groups[BO_COAP_GROUP_MAX] = { 0 };
+static size_t _group_count = 0;
+
+int bo_coap_group_load()
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(GROUP_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    uint16_t groups[BO_COAP_GROUP_MAX];
+    size_t size = sizeof(groups);
+    int rc = nvs_get_blob(handle, GROUP_NVS_KEY_IDS, groups, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND) {
+        return 0;
+    }
+    BO_TRY(rc);
+
+    portENTER_CRITICAL(&_group_lock);
+    memcpy(_groups, groups, size);
+    _group_count = size / sizeof(uint16_t);
+    portEXIT_CRITICAL(&_group_lock);
+
+    ESP_LOGI(TAG, "Member of %u multicast group(s)", _group_count);
+    return 0;
+}
+
+bool bo_coap_group_is_member(uint16_t group_id)
+{
+    if (group_id == BO_COAP_GROUP_ALL) {
+        return true;
+    }
+
+    bool is_member = false;
+    portENTER_CRITICAL(&_group_lock);
+    for (size_t i = 0; i < _group_count; i++) {
+        if (_groups[i] == group_id) {
+            is_member = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_group_lock);
+    return is_member;
+}
+
+size_t bo_coap_group_get_all(uint16_t groups[BO_COAP_GROUP_MAX])
+{
+    portENTER_CRITICAL(&_group_lock);
+    size_t count = _group_count;
+    memcpy(groups, _groups, count * sizeof(uint16_t));
+    portEXIT_CRITICAL(&_group_lock);
+    return count;
+}
+
+int bo_coap_group_set_all(const uint16_t* groups, size_t count)
+{
+    if (count > BO_COAP_GROUP_MAX || (count > 0 && groups == NULL)) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (groups[i] == BO_COAP_GROUP_ALL) {
+            return -EINVAL;
+        }
+    }
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(GROUP_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+    if (count > 0) {
+        BO_TRY(nvs_set_blob(handle, GROUP_NVS_KEY_IDS, groups, count * sizeof(uint16_t)));
+    }
+    else {
+        int rc = nvs_erase_key(handle, GROUP_NVS_KEY_IDS);
+        if (rc != ESP_ERR_NVS_NOT_FOUND) {
+            BO_TRY(rc);
+        }
+    }
+    BO_TRY(nvs_commit(handle));
+
+    portENTER_CRITICAL(&_group_lock);
+    memcpy(_groups, groups, count * sizeof(uint16_t));
+    _group_count = count;
+    portEXIT_CRITICAL(&_group_lock);
+
+    return 0;
+}
+
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
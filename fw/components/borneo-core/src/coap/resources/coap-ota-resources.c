@@ -12,11 +12,17 @@
 #include <esp_http_client.h>
 #include <esp_flash_partitions.h>
 #include <esp_partition.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+
+#include <mbedtls/sha256.h>
 
 #include <sys/socket.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/portmacro.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
 
 #include <coap3/coap.h>
 #include <cbor.h>
@@ -28,25 +34,116 @@
 #include <borneo/system.h>
 #include <borneo/power.h>
 #include <borneo/nvs.h>
+#include <borneo/algo/delta-patch.h>
+#include <borneo/algo/lzss.h>
 
 #if CONFIG_BORNEO_EDITION_CE
 
 #define TAG "borneo-coap-ota"
 
 #define OTA_COAP_UPDATE_TIMEOUT 5000
-#define OTA_BUFFER_SIZE 1024
-#define COAP_MAX_BLOCK_SIZE 512
+#define OTA_STREAM_IDLE_TIMEOUT 60000 ///< A windowed upload without requests for longer gives way to a Block1 one
+#define OTA_PAGE_SIZE 4096 ///< One flash sector, the unit the writer task erases and programs
+#define OTA_PAGE_COUNT CONFIG_BORNEO_OTA_WRITER_BUFFERS
+#define COAP_MAX_BLOCK_SIZE 1024
+
+#define OTA_WRITER_TASK_PRIORITY 9 // Below the CoAP task, so receiving the next block wins over programming
+#define OTA_WRITER_TASK_STACK_SIZE 4096 // Room for the LZSS decoder calling into the patch applier
+
+#define OTA_CHUNK_SIZE 1024 ///< Payload of a windowed upload chunk, the last one may be shorter
+#define OTA_WINDOW_SIZE CONFIG_BORNEO_OTA_WINDOW_SIZE
+#define OTA_QUERY_OFFSET "o"
+#define OTA_QUERY_PATCH "patch"
+#define OTA_QUERY_COMPRESSED "compressed"
+#define OTA_LZSS_WINDOW_BITS_MAX CONFIG_BORNEO_OTA_LZSS_WINDOW_BITS_MAX
+
+#define OTA_NVS_NS "ota"
+#define OTA_NVS_KEY_RESUME "resume"
+#define OTA_RESUME_COMMIT_PAGES CONFIG_BORNEO_OTA_RESUME_COMMIT_PAGES
+
+/// How the uploaded bytes turn into the image, the stages run in this order
+enum ota_session_flags {
+    OTA_SESSION_WINDOWED = 1, ///< Offset-addressed chunks through the reorder window
+    OTA_SESSION_COMPRESSED = 2, ///< LZSS-compressed, see `lzss.h`
+    OTA_SESSION_DELTA = 4, ///< A delta patch against the running image, see `delta-patch.h`
+};
+
+/*
+ * Windowed upload: the client starts a session with the image size, then PUTs offset-addressed chunks with up to
+ * `OTA_WINDOW_SIZE` requests in flight instead of waiting a round trip per Block1 block. Chunks ahead of the first
+ * missing byte wait in a reorder buffer; each slot holds the chunk at `next_offset + slot * OTA_CHUNK_SIZE`, relative
+ * to the slot the in-order chunk lands in.
+ */
+struct ota_window {
+    size_t image_size;
+    size_t next_offset; ///< Bytes accepted in order so far
+    size_t head; ///< Slot of the chunk at `next_offset`
+    uint8_t* slots; ///< `OTA_WINDOW_SIZE` chunks
+    uint16_t slot_len[OTA_WINDOW_SIZE]; ///< 0 if the slot is empty
+    uint32_t reordered; ///< Chunks that arrived ahead of a missing one
+    uint32_t duplicates;
+};
+
+/*
+ * Flash writer: the CoAP handlers only copy incoming data into a ring of `OTA_PAGE_COUNT` page buffers. Filled pages
+ * are queued to the writer task, which erases and programs them while the next blocks are being received. Compressed
+ * and delta uploads are decoded by the writer task as well: a single COPY of a patch can produce megabytes, far too
+ * long for a request handler. Block1 handlers wait, delaying their acknowledgement, when every page is still queued
+ * for writing; windowed uploads never wait, their chunks stay in the reorder window until a page is free.
+ */
+struct ota_page {
+    uint8_t* data;
+    size_t len;
+};
+
+struct ota_writer_stats {
+    uint64_t bytes_written;
+    uint64_t write_us; ///< Time spent in `esp_ota_write()`
+    uint32_t pages_written;
+    uint32_t stalls; ///< Times a handler had to wait for a free page
+    uint64_t stall_us;
+};
+
+/*
+ * Resumable sessions: a windowed upload that names the SHA-256 of its bytes can be continued after the client lost
+ * the link, by starting a session for the same bytes again. A plain image is also recorded in NVS together with the
+ * bytes the writer task has programmed, in whole pages, so it even continues after a reboot. Compressed and delta
+ * uploads keep decoder state in RAM and start over after a reboot.
+ */
+struct ota_resume_record {
+    uint32_t session_id;
+    uint32_t image_size;
+    uint32_t committed; ///< Bytes programmed, a multiple of `OTA_PAGE_SIZE`
+    uint8_t sha256[32];
+};
 
 struct ota_state {
     portMUX_TYPE lock;
     esp_ota_handle_t update_handle;
     bool update_in_progress;
     size_t total_bytes_received;
-    uint8_t* buffer;
-    size_t buffer_len;
+    struct ota_page* page; ///< Page being filled, NULL if none is taken yet
     TickType_t last_block_time;
     size_t last_block_num;
     uint32_t last_processed_block_num;
+    int64_t started_us;
+    struct ota_window window; ///< Only used by windowed uploads, `slots` is NULL otherwise
+    bool ota_begun; ///< Whether `update_handle` is valid, see `ota_session_begin()`
+    struct lzss_decoder* lzss; ///< Only used when the upload is compressed
+    uint8_t* lzss_window;
+    struct delta_patch* patch; ///< Only used when the upload is a delta patch against the running image
+    struct ota_page pages[OTA_PAGE_COUNT];
+    uint8_t* output; ///< Decoded image bytes not programmed yet, only used by compressed and delta uploads
+    size_t output_len;
+    QueueHandle_t free_pages;
+    QueueHandle_t full_pages;
+    volatile int write_error; ///< First error of the writer task in the current session, -ECANCELED on abort
+    struct ota_writer_stats stats;
+    unsigned int flags; ///< `enum ota_session_flags` of the current session
+    bool has_sha256; ///< Whether `resume` describes the current session
+    bool persistent; ///< Whether the writer task keeps the NVS record of the session up to date
+    size_t resumed_from; ///< Offset the session continued from, 0 if it started from scratch
+    struct ota_resume_record resume;
 };
 
 static struct ota_state s_ota_state = {
@@ -54,13 +151,639 @@ static struct ota_state s_ota_state = {
     .update_handle = 0,
     .update_in_progress = false,
     .total_bytes_received = 0,
-    .buffer = NULL,
-    .buffer_len = 0,
+    .page = NULL,
     .last_block_time = 0,
     .last_block_num = 0,
     .last_processed_block_num = UINT32_MAX,
 };
 
+static int ota_resume_load(struct ota_resume_record* record)
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(OTA_NVS_NS, NVS_READONLY, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    size_t size = sizeof(*record);
+    int rc = nvs_get_blob(handle, OTA_NVS_KEY_RESUME, record, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND || (rc == ESP_OK && size != sizeof(*record))) {
+        return -ENOENT;
+    }
+    BO_TRY(rc);
+    return 0;
+}
+
+static int ota_resume_save(const struct ota_resume_record* record)
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(OTA_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    BO_TRY(nvs_set_blob(handle, OTA_NVS_KEY_RESUME, record, sizeof(*record)));
+    BO_TRY(nvs_commit(handle));
+    return 0;
+}
+
+static int ota_resume_clear()
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(OTA_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    int rc = nvs_erase_key(handle, OTA_NVS_KEY_RESUME);
+    if (rc == ESP_ERR_NVS_NOT_FOUND) {
+        return 0;
+    }
+    BO_TRY(rc);
+    BO_TRY(nvs_commit(handle));
+    return 0;
+}
+
+/**
+ * @brief Programs the next bytes of the image. Only called by the writer task, or while it is idle.
+ */
+static int ota_program(const uint8_t* data, size_t len)
+{
+    int64_t begin_us = esp_timer_get_time();
+    esp_err_t err = esp_ota_write(s_ota_state.update_handle, data, len);
+    int64_t elapsed_us = esp_timer_get_time() - begin_us;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "OTA write failed: %s", esp_err_to_name(err));
+        return -EIO;
+    }
+
+    portENTER_CRITICAL(&s_ota_state.lock);
+    s_ota_state.stats.bytes_written += len;
+    s_ota_state.stats.write_us += elapsed_us;
+    s_ota_state.stats.pages_written++;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+    return 0;
+}
+
+/**
+ * @brief Collects decoded image bytes into whole pages before programming them.
+ */
+static int ota_output_write(const uint8_t* data, size_t len)
+{
+    while (len > 0) {
+        // Set by `ota_session_abort()`, so a long COPY of a dropped patch stops within a few hundred bytes
+        if (s_ota_state.write_error != 0) {
+            return s_ota_state.write_error;
+        }
+
+        size_t n = OTA_PAGE_SIZE - s_ota_state.output_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s_ota_state.output + s_ota_state.output_len, data, n);
+        s_ota_state.output_len += n;
+        data += n;
+        len -= n;
+
+        if (s_ota_state.output_len == OTA_PAGE_SIZE) {
+            s_ota_state.output_len = 0;
+            BO_TRY(ota_program(s_ota_state.output, OTA_PAGE_SIZE));
+        }
+    }
+    return 0;
+}
+
+static int ota_session_decode(const uint8_t* data, size_t data_len);
+
+static int ota_writer_process(const struct ota_page* page)
+{
+    if (s_ota_state.lzss != NULL || s_ota_state.patch != NULL) {
+        return ota_session_decode(page->data, page->len);
+    }
+
+    BO_TRY(ota_program(page->data, page->len));
+    if (s_ota_state.persistent && page->len == OTA_PAGE_SIZE
+        && s_ota_state.stats.pages_written % OTA_RESUME_COMMIT_PAGES == 0) {
+        portENTER_CRITICAL(&s_ota_state.lock);
+        s_ota_state.resume.committed = s_ota_state.resumed_from + s_ota_state.stats.bytes_written;
+        struct ota_resume_record record = s_ota_state.resume;
+        portEXIT_CRITICAL(&s_ota_state.lock);
+        ota_resume_save(&record);
+    }
+    return 0;
+}
+
+static void ota_writer_task(void* params)
+{
+    struct ota_page* page;
+    for (;;) {
+        xQueueReceive(s_ota_state.full_pages, &page, portMAX_DELAY);
+
+        if (s_ota_state.write_error == 0) {
+            int rc = ota_writer_process(page);
+            if (rc != 0 && s_ota_state.write_error == 0) {
+                s_ota_state.write_error = rc;
+            }
+        }
+
+        page->len = 0;
+        xQueueSend(s_ota_state.free_pages, &page, portMAX_DELAY);
+    }
+}
+
+static const struct delta_patch_io s_ota_delta_io;
+static const struct lzss_io s_ota_lzss_io;
+
+static int ota_writer_init()
+{
+    if (s_ota_state.free_pages != NULL) {
+        return 0;
+    }
+    s_ota_state.free_pages = xQueueCreate(OTA_PAGE_COUNT, sizeof(struct ota_page*));
+    s_ota_state.full_pages = xQueueCreate(OTA_PAGE_COUNT, sizeof(struct ota_page*));
+    if (s_ota_state.free_pages == NULL || s_ota_state.full_pages == NULL) {
+        return -ENOMEM;
+    }
+    if (xTaskCreate(&ota_writer_task, "ota_writer", OTA_WRITER_TASK_STACK_SIZE, NULL, OTA_WRITER_TASK_PRIORITY, NULL)
+        != pdPASS) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+/**
+ * @brief Queues the page being filled, if any, to the writer task.
+ */
+static void ota_session_flush()
+{
+    if (s_ota_state.page != NULL && s_ota_state.page->len > 0) {
+        xQueueSend(s_ota_state.full_pages, &s_ota_state.page, portMAX_DELAY);
+        s_ota_state.page = NULL;
+    }
+}
+
+/**
+ * @brief Waits until the writer task has programmed every queued page.
+ * @return The first write error of the session, or -ETIMEDOUT
+ */
+static int ota_session_drain()
+{
+    ota_session_flush();
+
+    // Every page sits in the free queue once the writer is idle
+    struct ota_page* taken[OTA_PAGE_COUNT];
+    size_t ntaken = 0;
+    int rc = 0;
+    if (s_ota_state.page != NULL) {
+        taken[ntaken++] = s_ota_state.page;
+        s_ota_state.page = NULL;
+    }
+    while (ntaken < OTA_PAGE_COUNT) {
+        if (xQueueReceive(s_ota_state.free_pages, &taken[ntaken], pdMS_TO_TICKS(OTA_COAP_UPDATE_TIMEOUT)) != pdTRUE) {
+            rc = -ETIMEDOUT;
+            break;
+        }
+        ntaken++;
+    }
+    for (size_t i = 0; i < ntaken; i++) {
+        xQueueSend(s_ota_state.free_pages, &taken[i], 0);
+    }
+    return rc != 0 ? rc : s_ota_state.write_error;
+}
+
+/**
+ * @brief Whether the writer task has programmed or decoded every queued page, without waiting for it.
+ */
+static bool ota_session_idle()
+{
+    size_t held = s_ota_state.page != NULL ? 1 : 0;
+    return uxQueueMessagesWaiting(s_ota_state.free_pages) + held == OTA_PAGE_COUNT;
+}
+
+/**
+ * @brief Bytes `ota_session_append()` takes without waiting for the writer task.
+ */
+static size_t ota_session_room()
+{
+    size_t room = uxQueueMessagesWaiting(s_ota_state.free_pages) * OTA_PAGE_SIZE;
+    if (s_ota_state.page != NULL) {
+        room += OTA_PAGE_SIZE - s_ota_state.page->len;
+    }
+    return room;
+}
+
+/**
+ * @brief Programs the decoded bytes short of a whole page, once the writer task is idle.
+ */
+static int ota_output_flush()
+{
+    if (s_ota_state.output_len == 0) {
+        return 0;
+    }
+    size_t len = s_ota_state.output_len;
+    s_ota_state.output_len = 0;
+    return ota_program(s_ota_state.output, len);
+}
+
+static void ota_session_release()
+{
+    portENTER_CRITICAL(&s_ota_state.lock);
+    s_ota_state.update_in_progress = false;
+    s_ota_state.ota_begun = false;
+    s_ota_state.persistent = false;
+    s_ota_state.has_sha256 = false;
+    free(s_ota_state.window.slots);
+    s_ota_state.window.slots = NULL;
+    free(s_ota_state.patch);
+    s_ota_state.patch = NULL;
+    free(s_ota_state.lzss);
+    s_ota_state.lzss = NULL;
+    free(s_ota_state.lzss_window);
+    s_ota_state.lzss_window = NULL;
+    free(s_ota_state.output);
+    s_ota_state.output = NULL;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+}
+
+/**
+ * @brief Records a request of the current session, see `OTA_STREAM_IDLE_TIMEOUT`.
+ */
+static void ota_session_touch()
+{
+    portENTER_CRITICAL(&s_ota_state.lock);
+    s_ota_state.last_block_time = xTaskGetTickCount();
+    portEXIT_CRITICAL(&s_ota_state.lock);
+}
+
+static void ota_session_abort()
+{
+    s_ota_state.persistent = false;
+    if (s_ota_state.write_error == 0) {
+        s_ota_state.write_error = -ECANCELED;
+    }
+    // The decoders must be out of the writer task before they are freed
+    while (ota_session_drain() == -ETIMEDOUT) {
+        ESP_LOGW(TAG, "Waiting for the OTA writer");
+    }
+    if (s_ota_state.ota_begun) {
+        esp_ota_abort(s_ota_state.update_handle);
+    }
+    ota_session_release();
+    ota_resume_clear();
+}
+
+/**
+ * @brief Starts writing a new image into the next OTA partition.
+ * @param image_size Bytes that will be uploaded, 0 if unknown
+ * @param flags `enum ota_session_flags`
+ * @param resume_offset Page-aligned offset of a plain image to continue from, the bytes before it are in flash
+ */
+static int ota_session_begin(size_t image_size, unsigned int flags, size_t resume_offset)
+{
+    bool windowed = flags & OTA_SESSION_WINDOWED;
+    bool compressed = flags & OTA_SESSION_COMPRESSED;
+    bool delta = flags & OTA_SESSION_DELTA;
+
+    const esp_partition_t* update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        ESP_LOGE(TAG, "No OTA update partition found");
+        return -ENODEV;
+    }
+    if (image_size > update_partition->size) {
+        return -EINVAL;
+    }
+
+    BO_TRY(ota_writer_init());
+
+    // The page ring is allocated on the first upload and kept, so a later upload cannot fail for lack of memory
+    for (size_t i = 0; i < OTA_PAGE_COUNT; i++) {
+        struct ota_page* page = &s_ota_state.pages[i];
+        if (page->data == NULL) {
+            page->data = malloc(OTA_PAGE_SIZE);
+            if (page->data == NULL) {
+                ESP_LOGE(TAG, "OTA buffer malloc failed");
+                return -ENOMEM;
+            }
+            page->len = 0;
+            xQueueSend(s_ota_state.free_pages, &page, 0);
+        }
+    }
+
+    uint8_t* slots = windowed ? malloc(OTA_WINDOW_SIZE * OTA_CHUNK_SIZE) : NULL;
+    struct delta_patch* patch = delta ? malloc(sizeof(struct delta_patch)) : NULL;
+    struct lzss_decoder* lzss = compressed ? malloc(sizeof(struct lzss_decoder)) : NULL;
+    uint8_t* output = delta || compressed ? malloc(OTA_PAGE_SIZE) : NULL;
+    if ((windowed && slots == NULL) || (delta && patch == NULL) || (compressed && lzss == NULL)
+        || ((delta || compressed) && output == NULL)) {
+        ESP_LOGE(TAG, "OTA buffer malloc failed");
+        free(slots);
+        free(patch);
+        free(lzss);
+        free(output);
+        return -ENOMEM;
+    }
+
+    // Patches and compressed images carry the size of the image they produce, so those uploads begin once their
+    // header is in, in `ota_delta_header()` or `ota_lzss_header()`
+    if (resume_offset == 0) {
+        // The partial image of an earlier upload is about to be overwritten
+        ota_resume_clear();
+    }
+
+    if (resume_offset > 0) {
+        esp_err_t err = esp_ota_resume(update_partition, OTA_WITH_SEQUENTIAL_WRITES, resume_offset,
+                                       &s_ota_state.update_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "OTA resume failed: %s", esp_err_to_name(err));
+            free(slots);
+            return -EIO;
+        }
+    }
+    else if (!delta && !compressed) {
+        // Erasing the whole image here would stall the CoAP task for seconds, the writer task erases each sector as
+        // `esp_ota_write()` reaches it instead
+        esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_ota_state.update_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "OTA begin failed: %s", esp_err_to_name(err));
+            free(slots);
+            return -EIO;
+        }
+    }
+    if (delta) {
+        delta_patch_init(patch, &s_ota_delta_io, NULL);
+    }
+    if (compressed) {
+        lzss_decoder_init(lzss, &s_ota_lzss_io, NULL);
+    }
+
+    portENTER_CRITICAL(&s_ota_state.lock);
+    s_ota_state.update_in_progress = true;
+    s_ota_state.total_bytes_received = resume_offset;
+    s_ota_state.last_block_time = xTaskGetTickCount();
+    s_ota_state.started_us = esp_timer_get_time();
+    s_ota_state.write_error = 0;
+    memset(&s_ota_state.stats, 0, sizeof(s_ota_state.stats));
+    memset(&s_ota_state.window, 0, sizeof(s_ota_state.window));
+    s_ota_state.window.image_size = image_size;
+    s_ota_state.window.next_offset = resume_offset;
+    s_ota_state.window.slots = slots;
+    s_ota_state.flags = flags;
+    s_ota_state.has_sha256 = false;
+    s_ota_state.persistent = false;
+    s_ota_state.resumed_from = resume_offset;
+    s_ota_state.ota_begun = resume_offset > 0 || (!delta && !compressed);
+    s_ota_state.patch = patch;
+    s_ota_state.lzss = lzss;
+    s_ota_state.output = output;
+    s_ota_state.output_len = 0;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+
+    return 0;
+}
+
+/**
+ * @brief Appends in-order upload data, handing every filled page to the writer task.
+ *
+ * Blocks only while all pages are waiting to be written.
+ */
+static int ota_session_append(const uint8_t* data, size_t data_len)
+{
+    while (data_len > 0) {
+        if (s_ota_state.write_error != 0) {
+            return s_ota_state.write_error;
+        }
+
+        if (s_ota_state.page == NULL) {
+            if (xQueueReceive(s_ota_state.free_pages, &s_ota_state.page, 0) != pdTRUE) {
+                int64_t begin_us = esp_timer_get_time();
+                if (xQueueReceive(s_ota_state.free_pages, &s_ota_state.page, pdMS_TO_TICKS(OTA_COAP_UPDATE_TIMEOUT))
+                    != pdTRUE) {
+                    ESP_LOGE(TAG, "OTA writer stalled");
+                    return -ETIMEDOUT;
+                }
+                portENTER_CRITICAL(&s_ota_state.lock);
+                s_ota_state.stats.stalls++;
+                s_ota_state.stats.stall_us += esp_timer_get_time() - begin_us;
+                portEXIT_CRITICAL(&s_ota_state.lock);
+            }
+        }
+
+        struct ota_page* page = s_ota_state.page;
+        size_t n = OTA_PAGE_SIZE - page->len;
+        if (n > data_len) {
+            n = data_len;
+        }
+        memcpy(page->data + page->len, data, n);
+        page->len += n;
+        portENTER_CRITICAL(&s_ota_state.lock);
+        s_ota_state.total_bytes_received += n;
+        s_ota_state.last_block_time = xTaskGetTickCount();
+        portEXIT_CRITICAL(&s_ota_state.lock);
+        data += n;
+        data_len -= n;
+
+        if (page->len == OTA_PAGE_SIZE) {
+            ota_session_flush();
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief SHA-256 of the first `size` bytes of a partition.
+ */
+static int ota_partition_sha256(const esp_partition_t* partition, size_t size, uint8_t* digest)
+{
+    uint8_t buf[256];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    int rc = 0;
+    for (size_t offset = 0; offset < size; offset += sizeof(buf)) {
+        size_t n = size - offset < sizeof(buf) ? size - offset : sizeof(buf);
+        if (esp_partition_read(partition, offset, buf, n) != ESP_OK) {
+            rc = -EIO;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, buf, n);
+    }
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return rc;
+}
+
+static int ota_delta_header(void* ctx, const struct delta_patch_header* header)
+{
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* update_partition = esp_ota_get_next_update_partition(NULL);
+    if (header->source_size > running->size || header->target_size > update_partition->size) {
+        return -EINVAL;
+    }
+
+    uint8_t digest[32];
+    BO_TRY(ota_partition_sha256(running, header->source_size, digest));
+    if (memcmp(digest, header->source_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "The patch was made for a different firmware");
+        return -EINVAL;
+    }
+
+    ESP_LOGI(TAG, "Applying patch, %lu -> %lu bytes", header->source_size, header->target_size);
+    // Sectors are erased on demand by the writer task, as for plain images
+    esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_ota_state.update_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "OTA begin failed: %s", esp_err_to_name(err));
+        return -EIO;
+    }
+    s_ota_state.ota_begun = true;
+    return 0;
+}
+
+static int ota_delta_read_source(void* ctx, size_t offset, uint8_t* buf, size_t len)
+{
+    if (esp_partition_read(esp_ota_get_running_partition(), offset, buf, len) != ESP_OK) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int ota_delta_write_target(void* ctx, const uint8_t* buf, size_t len) { return ota_output_write(buf, len); }
+
+static const struct delta_patch_io s_ota_delta_io = {
+    .header = ota_delta_header,
+    .read_source = ota_delta_read_source,
+    .write_target = ota_delta_write_target,
+};
+
+// Hands decompressed data on to the patch applier or straight to the image
+static int ota_session_feed_plain(const uint8_t* data, size_t data_len)
+{
+    if (s_ota_state.patch != NULL) {
+        return delta_patch_feed(s_ota_state.patch, data, data_len);
+    }
+    return ota_output_write(data, data_len);
+}
+
+static int ota_lzss_header(void* ctx, const struct lzss_header* header, uint8_t** window)
+{
+    if (header->window_bits > OTA_LZSS_WINDOW_BITS_MAX) {
+        ESP_LOGE(TAG, "Compression window of %u bits is too large", header->window_bits);
+        return -ENOTSUP;
+    }
+
+    if (s_ota_state.patch == NULL) {
+        const esp_partition_t* update_partition = esp_ota_get_next_update_partition(NULL);
+        if (header->size > update_partition->size) {
+            return -EINVAL;
+        }
+        // Sectors are erased on demand by the writer task, as for plain images
+        esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_ota_state.update_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "OTA begin failed: %s", esp_err_to_name(err));
+            return -EIO;
+        }
+        s_ota_state.ota_begun = true;
+    }
+
+    s_ota_state.lzss_window = malloc(1U << header->window_bits);
+    *window = s_ota_state.lzss_window;
+    ESP_LOGI(TAG, "Decompressing %lu bytes, window %u bytes", header->size, 1U << header->window_bits);
+    return 0;
+}
+
+static int ota_lzss_write(void* ctx, const uint8_t* buf, size_t len) { return ota_session_feed_plain(buf, len); }
+
+static const struct lzss_io s_ota_lzss_io = {
+    .header = ota_lzss_header,
+    .write = ota_lzss_write,
+};
+
+/**
+ * @brief Turns in-order upload data of a compressed or delta session into the image, in the writer task.
+ */
+static int ota_session_decode(const uint8_t* data, size_t data_len)
+{
+    if (s_ota_state.lzss != NULL) {
+        return lzss_decoder_feed(s_ota_state.lzss, data, data_len);
+    }
+    return ota_session_feed_plain(data, data_len);
+}
+
+/**
+ * @brief Appends the chunks that are now in order, as far as the page ring has room for them.
+ *
+ * Never waits for the writer task, which can be busy for seconds with a single instruction of a patch: a chunk that
+ * does not fit stays in its slot until a later request of the client.
+ */
+static int ota_window_drain()
+{
+    struct ota_window* w = &s_ota_state.window;
+    while (w->slot_len[w->head] != 0 && ota_session_room() >= w->slot_len[w->head]) {
+        size_t len = w->slot_len[w->head];
+        BO_TRY(ota_session_append(&w->slots[w->head * OTA_CHUNK_SIZE], len));
+        w->slot_len[w->head] = 0;
+        w->next_offset += len;
+        w->head = (w->head + 1) % OTA_WINDOW_SIZE;
+    }
+
+    if (w->next_offset == w->image_size) {
+        ota_session_flush();
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether every byte of a windowed upload has arrived, even if not all of it is appended yet.
+ */
+static bool ota_window_received()
+{
+    const struct ota_window* w = &s_ota_state.window;
+    size_t end = w->next_offset;
+    for (size_t i = 0; i < OTA_WINDOW_SIZE && w->slot_len[(w->head + i) % OTA_WINDOW_SIZE] != 0; i++) {
+        end += w->slot_len[(w->head + i) % OTA_WINDOW_SIZE];
+    }
+    return end == w->image_size;
+}
+
+/**
+ * @brief Accepts one chunk of a windowed upload, in any order within the window.
+ * @return 0 if accepted or already received, -ERANGE if outside the window, -EINVAL if malformed, -EIO if the image
+ * could not be written
+ */
+static int ota_window_put(size_t offset, const uint8_t* data, size_t data_len)
+{
+    struct ota_window* w = &s_ota_state.window;
+
+    if (offset % OTA_CHUNK_SIZE != 0 || data_len == 0 || data_len > OTA_CHUNK_SIZE || offset + data_len > w->image_size
+        || (data_len < OTA_CHUNK_SIZE && offset + data_len != w->image_size)) {
+        return -EINVAL;
+    }
+
+    // Pages the writer task freed since the last request make room for chunks left waiting
+    if (ota_window_drain() != 0) {
+        return -EIO;
+    }
+
+    if (offset < w->next_offset) {
+        w->duplicates++;
+        return 0; // A retransmission of a chunk whose acknowledgement got lost
+    }
+
+    size_t distance = (offset - w->next_offset) / OTA_CHUNK_SIZE;
+    if (distance >= OTA_WINDOW_SIZE) {
+        return -ERANGE;
+    }
+
+    size_t slot = (w->head + distance) % OTA_WINDOW_SIZE;
+    if (w->slot_len[slot] != 0) {
+        w->duplicates++;
+        return 0;
+    }
+    memcpy(&w->slots[slot * OTA_CHUNK_SIZE], data, data_len);
+    w->slot_len[slot] = (uint16_t)data_len;
+    if (distance > 0 && w->slot_len[(slot + OTA_WINDOW_SIZE - 1) % OTA_WINDOW_SIZE] == 0) {
+        w->reordered++;
+    }
+
+    if (ota_window_drain() != 0) {
+        return -EIO;
+    }
+    return 0;
+}
+
 /**
  * @brief Build status response in CBOR format
  * @param buffer Output buffer for CBOR data
@@ -72,6 +795,13 @@ static size_t build_status_response(uint8_t* buffer, size_t buffer_size)
     portENTER_CRITICAL(&s_ota_state.lock);
     bool update_in_progress = s_ota_state.update_in_progress;
     size_t total_bytes_received = s_ota_state.total_bytes_received;
+    bool windowed = update_in_progress && s_ota_state.window.slots != NULL;
+    struct ota_window window = s_ota_state.window;
+    int64_t elapsed_us = esp_timer_get_time() - s_ota_state.started_us;
+    struct ota_writer_stats stats = s_ota_state.stats;
+    bool has_session = update_in_progress && s_ota_state.has_sha256;
+    uint32_t session_id = s_ota_state.resume.session_id;
+    size_t resumed_from = s_ota_state.resumed_from;
     portEXIT_CRITICAL(&s_ota_state.lock);
 
     CborEncoder encoder, map_encoder;
@@ -92,6 +822,46 @@ static size_t build_status_response(uint8_t* buffer, size_t buffer_size)
     cbor_encode_text_stringz(&map_encoder, "bytes_received");
     cbor_encode_uint(&map_encoder, total_bytes_received);
 
+    // Windowed upload progress
+    cbor_encode_text_stringz(&map_encoder, "window_size");
+    cbor_encode_uint(&map_encoder, OTA_WINDOW_SIZE);
+    if (windowed) {
+        cbor_encode_text_stringz(&map_encoder, "image_size");
+        cbor_encode_uint(&map_encoder, window.image_size);
+        cbor_encode_text_stringz(&map_encoder, "next_offset");
+        cbor_encode_uint(&map_encoder, window.next_offset);
+        cbor_encode_text_stringz(&map_encoder, "reordered");
+        cbor_encode_uint(&map_encoder, window.reordered);
+        cbor_encode_text_stringz(&map_encoder, "duplicates");
+        cbor_encode_uint(&map_encoder, window.duplicates);
+    }
+    if (has_session) {
+        cbor_encode_text_stringz(&map_encoder, "session");
+        cbor_encode_uint(&map_encoder, session_id);
+        cbor_encode_text_stringz(&map_encoder, "resumed_from");
+        cbor_encode_uint(&map_encoder, resumed_from);
+    }
+    if (update_in_progress && elapsed_us > 0) {
+        cbor_encode_text_stringz(&map_encoder, "bytes_per_second");
+        cbor_encode_uint(&map_encoder, (uint64_t)total_bytes_received * 1000000ULL / (uint64_t)elapsed_us);
+    }
+
+    // Flash writer counters of the current or last upload
+    cbor_encode_text_stringz(&map_encoder, "bytes_written");
+    cbor_encode_uint(&map_encoder, stats.bytes_written);
+    cbor_encode_text_stringz(&map_encoder, "pages_written");
+    cbor_encode_uint(&map_encoder, stats.pages_written);
+    cbor_encode_text_stringz(&map_encoder, "write_ms");
+    cbor_encode_uint(&map_encoder, stats.write_us / 1000);
+    if (stats.write_us > 0) {
+        cbor_encode_text_stringz(&map_encoder, "write_bytes_per_second");
+        cbor_encode_uint(&map_encoder, stats.bytes_written * 1000000ULL / stats.write_us);
+    }
+    cbor_encode_text_stringz(&map_encoder, "writer_stalls");
+    cbor_encode_uint(&map_encoder, stats.stalls);
+    cbor_encode_text_stringz(&map_encoder, "writer_stall_ms");
+    cbor_encode_uint(&map_encoder, stats.stall_us / 1000);
+
     // OTA partition info
     cbor_encode_text_stringz(&map_encoder, "ota_partitions");
     CborEncoder array_encoder;
@@ -120,7 +890,7 @@ static size_t build_status_response(uint8_t* buffer, size_t buffer_size)
 static void coap_hnd_status_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                 const coap_string_t* query, coap_pdu_t* response)
 {
-    uint8_t cbor_buffer[256];
+    uint8_t cbor_buffer[512];
     size_t cbor_len = build_status_response(cbor_buffer, sizeof(cbor_buffer));
 
     coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, cbor_len, cbor_buffer);
@@ -176,8 +946,18 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
         // If first block, initialize OTA
         portENTER_CRITICAL(&s_ota_state.lock);
         bool update_in_progress = s_ota_state.update_in_progress;
+        bool windowed = update_in_progress && s_ota_state.window.slots != NULL;
+        TickType_t idle_ticks = xTaskGetTickCount() - s_ota_state.last_block_time;
         portEXIT_CRITICAL(&s_ota_state.lock);
 
+        // A windowed upload waits for its client to resume it, but not forever
+        if (block_num == 0 && windowed && idle_ticks > pdMS_TO_TICKS(OTA_STREAM_IDLE_TIMEOUT)) {
+            ESP_LOGW(TAG, "Dropping the windowed upload idle for %lu ms", pdTICKS_TO_MS(idle_ticks));
+            ota_session_abort();
+            update_in_progress = false;
+            windowed = false;
+        }
+
         if (block_num == 0 && !update_in_progress) {
             portENTER_CRITICAL(&s_ota_state.lock);
             s_ota_state.last_block_num = 0;
@@ -186,34 +966,23 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
 
             ESP_LOGI(TAG, "Starting new OTA download...");
 
-            const esp_partition_t* update_partition = esp_ota_get_next_update_partition(NULL);
-            if (update_partition == NULL) {
-                ESP_LOGE(TAG, "No OTA update partition found");
-                coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+            // A COPY of a patch keeps the writer task busy for longer than a Block1 client waits for its acknowledgement
+            if (bo_coap_query_has(query, OTA_QUERY_PATCH)) {
+                ESP_LOGE(TAG, "Delta patches need a windowed upload");
+                coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
                 return;
             }
 
-            esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &s_ota_state.update_handle);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "OTA begin failed: %s", esp_err_to_name(err));
+            unsigned int flags = bo_coap_query_has(query, OTA_QUERY_COMPRESSED) ? OTA_SESSION_COMPRESSED : 0;
+            if (ota_session_begin(0, flags, 0) != 0) {
                 coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
                 return;
             }
-
-            uint8_t* buf = malloc(OTA_BUFFER_SIZE);
-            if (buf == NULL) {
-                ESP_LOGE(TAG, "OTA buffer malloc failed");
-                err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                goto put_abort_err;
-            }
-
-            portENTER_CRITICAL(&s_ota_state.lock);
-            s_ota_state.buffer = buf;
-            s_ota_state.update_in_progress = true;
-            s_ota_state.total_bytes_received = 0;
-            s_ota_state.buffer_len = 0;
-            s_ota_state.last_block_time = xTaskGetTickCount();
-            portEXIT_CRITICAL(&s_ota_state.lock);
+        }
+        else if (windowed) {
+            ESP_LOGE(TAG, "A windowed upload is in progress");
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+            return;
         }
 
         // Check for duplicate block
@@ -254,22 +1023,11 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
                 return;
             }
 
-            if (s_ota_state.buffer_len + data_len >= OTA_BUFFER_SIZE) {
-                esp_err_t err = esp_ota_write(s_ota_state.update_handle, s_ota_state.buffer, s_ota_state.buffer_len);
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "OTA write failed: %s", esp_err_to_name(err));
-                    err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                    goto put_abort_err;
-                }
-                portENTER_CRITICAL(&s_ota_state.lock);
-                s_ota_state.buffer_len = 0;
-                portEXIT_CRITICAL(&s_ota_state.lock);
+            if (ota_session_append(data, data_len) != 0) {
+                err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+                goto put_abort_err;
             }
             portENTER_CRITICAL(&s_ota_state.lock);
-            memcpy(s_ota_state.buffer + s_ota_state.buffer_len, data, data_len);
-            s_ota_state.buffer_len += data_len;
-            s_ota_state.total_bytes_received += data_len;
-            s_ota_state.last_block_time = xTaskGetTickCount();
             s_ota_state.last_block_num = block_num;
             s_ota_state.last_processed_block_num = block_num;
             portEXIT_CRITICAL(&s_ota_state.lock);
@@ -285,19 +1043,8 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
                 coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTINUE);
             }
             else {
-                // Write remaining data
-                if (s_ota_state.buffer_len > 0) {
-                    esp_err_t err
-                        = esp_ota_write(s_ota_state.update_handle, s_ota_state.buffer, s_ota_state.buffer_len);
-                    if (err != ESP_OK) {
-                        ESP_LOGE(TAG, "OTA write failed: %s", esp_err_to_name(err));
-                        err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-                        goto put_abort_err;
-                    }
-                    portENTER_CRITICAL(&s_ota_state.lock);
-                    s_ota_state.buffer_len = 0;
-                    portEXIT_CRITICAL(&s_ota_state.lock);
-                }
+                // Queue the remaining data
+                ota_session_flush();
                 ESP_LOGI(TAG, "All firmware blocks received, total size %zu bytes", s_ota_state.total_bytes_received);
                 coap_pdu_set_code(response, COAP_RESPONSE_CODE_CREATED);
             }
@@ -308,12 +1055,7 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
         return;
 
     put_abort_err:
-        esp_ota_abort(s_ota_state.update_handle);
-        portENTER_CRITICAL(&s_ota_state.lock);
-        s_ota_state.update_in_progress = false;
-        free(s_ota_state.buffer);
-        s_ota_state.buffer = NULL;
-        portEXIT_CRITICAL(&s_ota_state.lock);
+        ota_session_abort();
         coap_pdu_set_code(response, err_code);
         return;
     }
@@ -329,8 +1071,69 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
             return;
         }
 
+        bool windowed = s_ota_state.window.slots != NULL;
+        if (windowed && ota_window_drain() != 0) {
+            ota_session_abort();
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+            return;
+        }
+        if (windowed && s_ota_state.window.next_offset != s_ota_state.window.image_size && !ota_window_received()) {
+            ESP_LOGE(TAG, "Windowed upload incomplete: %zu of %zu bytes", s_ota_state.window.next_offset,
+                     s_ota_state.window.image_size);
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+            return;
+        }
+
+        // A windowed client retries while the writer task is still decoding, a Block1 client only waits for the
+        // last few pages
+        if (windowed && (s_ota_state.window.next_offset != s_ota_state.window.image_size || !ota_session_idle())) {
+            ota_session_touch();
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE);
+            return;
+        }
+
         ESP_LOGI(TAG, "Completing OTA update...");
 
+        if (ota_session_drain() != 0 || ota_output_flush() != 0) {
+            ota_session_abort();
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+            return;
+        }
+
+        if (s_ota_state.lzss != NULL && !lzss_decoder_done(s_ota_state.lzss)) {
+            ESP_LOGE(TAG, "Compressed image incomplete or invalid");
+            ota_session_abort();
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+            return;
+        }
+
+        if (s_ota_state.patch != NULL && !delta_patch_done(s_ota_state.patch)) {
+            ESP_LOGE(TAG, "Delta patch incomplete or invalid");
+            ota_session_abort();
+            coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+            return;
+        }
+
+        // The image is checked against the hash of the patch, or against the checksum the client sent
+        uint8_t expected_sha256[32];
+        bool has_expected_sha256 = false;
+        if (s_ota_state.patch != NULL) {
+            memcpy(expected_sha256, s_ota_state.patch->header.target_sha256, sizeof(expected_sha256));
+            has_expected_sha256 = true;
+        }
+        else if (has_data && data_len > 0) {
+            CborParser parser;
+            CborValue it, value;
+            size_t len = sizeof(expected_sha256);
+            if (cbor_parser_init(data, data_len, 0, &parser, &it) == CborNoError && cbor_value_is_map(&it)
+                && cbor_value_map_find_value(&it, "checksum", &value) == CborNoError
+                && cbor_value_is_byte_string(&value)
+                && cbor_value_copy_byte_string(&value, expected_sha256, &len, NULL) == CborNoError
+                && len == sizeof(expected_sha256)) {
+                has_expected_sha256 = true;
+            }
+        }
+
         // Finalize OTA update
         esp_err_t err = esp_ota_end(s_ota_state.update_handle);
         if (err != ESP_OK) {
@@ -341,12 +1144,20 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
 
         const esp_partition_t* update_partition = esp_ota_get_next_update_partition(NULL);
 
-        uint8_t sha_256[32] = { 0 };
-        esp_err_t ret = esp_partition_get_sha256(update_partition, sha_256);
-        if (ret) {
-            ESP_LOGE(TAG, "OTA get partition SHA256 failed: %s", esp_err_to_name(ret));
-            err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
-            goto post_err;
+        if (has_expected_sha256) {
+            uint8_t sha_256[32] = { 0 };
+            // Decoded uploads produce more bytes than they received
+            size_t image_size = s_ota_state.resumed_from + s_ota_state.stats.bytes_written;
+            if (ota_partition_sha256(update_partition, image_size, sha_256) != 0) {
+                ESP_LOGE(TAG, "OTA get partition SHA256 failed");
+                err_code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+                goto post_err;
+            }
+            if (memcmp(sha_256, expected_sha256, sizeof(sha_256)) != 0) {
+                ESP_LOGE(TAG, "SHA-256 of the new image does not match");
+                err_code = COAP_RESPONSE_CODE_BAD_REQUEST;
+                goto post_err;
+            }
         }
 
         // Verify signature (only for first block)
@@ -367,11 +1178,8 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
             goto post_err;
         }
 
-        portENTER_CRITICAL(&s_ota_state.lock);
-        s_ota_state.update_in_progress = false;
-        free(s_ota_state.buffer);
-        s_ota_state.buffer = NULL;
-        portEXIT_CRITICAL(&s_ota_state.lock);
+        ota_session_release();
+        ota_resume_clear();
 
         // Prepare response
         uint8_t cbor_buffer[128];
@@ -406,11 +1214,8 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
         return;
 
     post_err:
-        portENTER_CRITICAL(&s_ota_state.lock);
-        s_ota_state.update_in_progress = false;
-        free(s_ota_state.buffer);
-        s_ota_state.buffer = NULL;
-        portEXIT_CRITICAL(&s_ota_state.lock);
+        ota_session_release();
+        ota_resume_clear();
         coap_pdu_set_code(response, err_code);
         return;
     }
@@ -419,7 +1224,244 @@ static void coap_hnd_download(coap_resource_t* resource, coap_session_t* session
     }
 }
 
+static int encode_stream_session(const CborValue* args, CborEncoder* encoder)
+{
+    CborEncoder map_encoder;
+    BO_TRY(cbor_encoder_create_map(encoder, &map_encoder, 4));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "chunk"));
+    BO_TRY(cbor_encode_uint(&map_encoder, OTA_CHUNK_SIZE));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "window"));
+    BO_TRY(cbor_encode_uint(&map_encoder, OTA_WINDOW_SIZE));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "session"));
+    BO_TRY(cbor_encode_uint(&map_encoder, s_ota_state.resume.session_id));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "offset"));
+    BO_TRY(cbor_encode_uint(&map_encoder, s_ota_state.window.next_offset));
+    BO_TRY(cbor_encoder_close_container(encoder, &map_encoder));
+    return 0;
+}
+
+/**
+ * @brief Starts or resumes a windowed upload.
+ *
+ * Request payload is `{"size": upload_size, "sha256": bytes, "patch": bool, "compressed": bool}`. With `patch` set the
+ * upload is a delta patch against the running image, see `delta-patch.h`; with `compressed` set it is LZSS-compressed,
+ * see `lzss.h`. If `sha256` names the same bytes as the unfinished upload, or as the one recorded before a reboot, the
+ * session continues. Otherwise any unfinished upload is dropped. The response tells the client the chunk size, how
+ * many chunks it may have in flight and the offset to send from.
+ */
+static void coap_hnd_stream_post(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                 const coap_string_t* query, coap_pdu_t* response)
+{
+    size_t size = 0;
+    const uint8_t* data = NULL;
+    if (!coap_get_data(request, &size, &data)) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+
+    CborParser parser;
+    CborValue it, value;
+    uint64_t image_size = 0;
+    bool delta = false;
+    bool compressed = false;
+    uint8_t sha256[32];
+    size_t sha256_len = sizeof(sha256);
+    bool has_sha256 = false;
+    if (cbor_parser_init(data, size, 0, &parser, &it) != CborNoError || !cbor_value_is_map(&it)
+        || cbor_value_map_find_value(&it, "size", &value) != CborNoError || !cbor_value_is_unsigned_integer(&value)
+        || cbor_value_get_uint64(&value, &image_size) != CborNoError || image_size == 0 || image_size > UINT32_MAX) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+    if (cbor_value_map_find_value(&it, "patch", &value) == CborNoError && cbor_value_is_boolean(&value)) {
+        cbor_value_get_boolean(&value, &delta);
+    }
+    if (cbor_value_map_find_value(&it, "compressed", &value) == CborNoError && cbor_value_is_boolean(&value)) {
+        cbor_value_get_boolean(&value, &compressed);
+    }
+    if (cbor_value_map_find_value(&it, "sha256", &value) == CborNoError && cbor_value_is_byte_string(&value)
+        && cbor_value_copy_byte_string(&value, sha256, &sha256_len, NULL) == CborNoError
+        && sha256_len == sizeof(sha256)) {
+        has_sha256 = true;
+    }
+    unsigned int flags
+        = OTA_SESSION_WINDOWED | (compressed ? OTA_SESSION_COMPRESSED : 0) | (delta ? OTA_SESSION_DELTA : 0);
+
+    portENTER_CRITICAL(&s_ota_state.lock);
+    bool update_in_progress = s_ota_state.update_in_progress;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+
+    if (update_in_progress) {
+        if (has_sha256 && s_ota_state.has_sha256 && s_ota_state.flags == flags
+            && s_ota_state.window.image_size == image_size && s_ota_state.write_error == 0
+            && memcmp(s_ota_state.resume.sha256, sha256, sizeof(sha256)) == 0) {
+            // Chunks past the first missing byte are dropped, the client sends everything from `next_offset` again
+            memset(s_ota_state.window.slot_len, 0, sizeof(s_ota_state.window.slot_len));
+            ota_session_touch();
+            ESP_LOGI(TAG, "Resuming windowed OTA upload at %zu of %zu bytes", s_ota_state.window.next_offset,
+                     s_ota_state.window.image_size);
+            bo_coap_respond_cbor(request, response, encode_stream_session, NULL);
+            return;
+        }
+        ESP_LOGW(TAG, "Dropping the unfinished upload");
+        ota_session_abort();
+    }
+
+    // Only plain images are resumable after a reboot, decoders cannot pick up in the middle of their input
+    struct ota_resume_record record;
+    bool resumable = has_sha256 && flags == OTA_SESSION_WINDOWED;
+    size_t resume_offset = 0;
+    if (resumable && ota_resume_load(&record) == 0 && record.image_size == image_size
+        && record.committed <= image_size && record.committed % OTA_PAGE_SIZE == 0
+        && memcmp(record.sha256, sha256, sizeof(sha256)) == 0) {
+        resume_offset = record.committed;
+    }
+    else {
+        record.session_id = esp_random();
+        record.image_size = (uint32_t)image_size;
+        record.committed = 0;
+        memcpy(record.sha256, sha256, sizeof(sha256));
+    }
+
+    int rc = ota_session_begin((size_t)image_size, flags, resume_offset);
+    if (rc != 0 && resume_offset > 0) {
+        ESP_LOGW(TAG, "Cannot resume the recorded upload, starting over");
+        resume_offset = 0;
+        record.committed = 0;
+        rc = ota_session_begin((size_t)image_size, flags, 0);
+    }
+    if (rc != 0) {
+        coap_pdu_set_code(response,
+                          rc == -EINVAL ? COAP_RESPONSE_CODE_REQUEST_TOO_LARGE : COAP_RESPONSE_CODE_INTERNAL_ERROR);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_ota_state.lock);
+    s_ota_state.resume = record;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+    s_ota_state.has_sha256 = has_sha256;
+    if (resumable) {
+        ota_resume_save(&record);
+        s_ota_state.persistent = true;
+    }
+
+    ESP_LOGI(TAG, "%s windowed OTA upload, %zu bytes%s%s from %zu, window %d",
+             resume_offset > 0 ? "Resuming" : "Starting", (size_t)image_size, compressed ? " compressed" : "",
+             delta ? " of patch" : "", resume_offset, OTA_WINDOW_SIZE);
+    bo_coap_respond_cbor(request, response, encode_stream_session, NULL);
+}
+
+/// What `coap_hnd_stream_get()` reports, only used by the CoAP task
+static struct {
+    struct ota_resume_record record;
+    bool active;
+} s_resume_report;
+
+static int encode_resume_record(const CborValue* args, CborEncoder* encoder)
+{
+    const struct ota_resume_record* record = &s_resume_report.record;
+    CborEncoder map_encoder;
+    BO_TRY(cbor_encoder_create_map(encoder, &map_encoder, 5));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "session"));
+    BO_TRY(cbor_encode_uint(&map_encoder, record->session_id));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "size"));
+    BO_TRY(cbor_encode_uint(&map_encoder, record->image_size));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "offset"));
+    BO_TRY(cbor_encode_uint(&map_encoder, record->committed));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "sha256"));
+    BO_TRY(cbor_encode_byte_string(&map_encoder, record->sha256, sizeof(record->sha256)));
+    BO_TRY(cbor_encode_text_stringz(&map_encoder, "active"));
+    BO_TRY(cbor_encode_boolean(&map_encoder, s_resume_report.active));
+    BO_TRY(cbor_encoder_close_container(encoder, &map_encoder));
+    return 0;
+}
+
+/**
+ * @brief Reports the resumable upload and the offset to continue from, 4.04 if there is none.
+ */
+static void coap_hnd_stream_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                const coap_string_t* query, coap_pdu_t* response)
+{
+    // The writer task updates `resume.committed` of the session as it programs pages
+    portENTER_CRITICAL(&s_ota_state.lock);
+    bool update_in_progress = s_ota_state.update_in_progress;
+    bool active = update_in_progress && s_ota_state.has_sha256;
+    s_resume_report.record = s_ota_state.resume;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+
+    if (active) {
+        // A running session continues from the first missing byte, not from the last page committed to NVS
+        s_resume_report.record.committed = s_ota_state.window.next_offset;
+    }
+    else if (update_in_progress || ota_resume_load(&s_resume_report.record) != 0) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_NOT_FOUND);
+        return;
+    }
+    s_resume_report.active = update_in_progress;
+    bo_coap_respond_cbor(request, response, encode_resume_record, NULL);
+}
+
+/**
+ * @brief Receives one chunk of a windowed upload, the byte offset goes in the `o` query.
+ *
+ * A windowed upload waits for its client to resume it after a lost link, so it does not time out like a Block1 one.
+ * It is only dropped when another upload replaces it, or when a Block1 upload starts after it went without requests
+ * for `OTA_STREAM_IDLE_TIMEOUT`.
+ */
+static void coap_hnd_stream_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                const coap_string_t* query, coap_pdu_t* response)
+{
+    uint32_t offset = 0;
+    if (bo_coap_query_get_uint(query, OTA_QUERY_OFFSET, &offset) != 0) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+
+    size_t data_len = 0;
+    const uint8_t* data = NULL;
+    if (!coap_get_data(request, &data_len, &data)) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_ota_state.lock);
+    bool update_in_progress = s_ota_state.update_in_progress && s_ota_state.window.slots != NULL;
+    portEXIT_CRITICAL(&s_ota_state.lock);
+
+    if (!update_in_progress) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+
+    // Chunks refused with 5.03 count too: the client is there, the writer task is behind
+    ota_session_touch();
+    int rc = ota_window_put(offset, data, data_len);
+    if (rc == -EINVAL) {
+        ESP_LOGE(TAG, "Malformed chunk at offset %lu, %zu bytes", offset, data_len);
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        return;
+    }
+    if (rc == -ERANGE) {
+        // The client ran ahead of the window, or the writer task is behind: it retries once earlier chunks have been
+        // appended
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE);
+        return;
+    }
+    if (rc != 0) {
+        ota_session_abort();
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+        return;
+    }
+
+    if (offset % (64 * OTA_CHUNK_SIZE) == 0) {
+        ESP_LOGI(TAG, "Received chunk at offset %lu", offset);
+    }
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CHANGED);
+}
+
 COAP_RESOURCE_DEFINE("borneo/ota/coap/status", false, coap_hnd_status_get, NULL, NULL, NULL);
 COAP_RESOURCE_DEFINE("borneo/ota/coap/download", false, NULL, coap_hnd_download, coap_hnd_download, NULL);
+COAP_RESOURCE_DEFINE("borneo/ota/coap/stream", false, coap_hnd_stream_get, coap_hnd_stream_post, coap_hnd_stream_put,
+                     NULL);
 
 #endif // CONFIG_BORNEO_EDITION_CE
\ No newline at end of file
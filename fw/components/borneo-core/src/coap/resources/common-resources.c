@@ -21,20 +21,16 @@
 #include <borneo/timer.h>
 #include <borneo/product.h>
 #include <borneo/rpc/common.h>
+#include <borneo/rpc/registry.h>
 
 #define TAG "borneo-core-coap"
 
+static uint32_t borneo_info_generation() { return bo_system_get_info()->generation; }
+
 static void coap_hnd_borneo_info_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                      const coap_string_t* query, coap_pdu_t* response)
 {
-    uint8_t buf[1024];
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_info_get(NULL, &encoder), response);
-
-    size_t encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_info_get, NULL);
 }
 
 static void coap_hnd_borneo_reboot_post(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -48,103 +44,38 @@ static void coap_hnd_borneo_reboot_post(coap_resource_t* resource, coap_session_
 static void coap_hnd_borneo_status_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                        const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_status_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_status_get, NULL);
 }
 
 static void coap_hnd_borneo_fw_ver_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                        const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_fw_ver_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_fw_ver_get, NULL);
 }
 
 static void coap_hnd_borneo_compatible_get(coap_resource_t* resource, coap_session_t* session,
                                            const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_compatible_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_compatible_get, NULL);
 }
 
 static void coap_hnd_heartbeat_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                    const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_heartbeat_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_heartbeat_get, NULL);
 }
 
 static void coap_hnd_borneo_system_mode_get(coap_resource_t* resource, coap_session_t* session,
                                             const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[256] = { 0 };
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_system_mode_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_system_mode_get, NULL);
 }
 
 static void coap_hnd_borneo_settings_timezone_get(coap_resource_t* resource, coap_session_t* session,
                                                   const coap_pdu_t* request, const coap_string_t* query,
                                                   coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[256] = { 0 };
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_settings_timezone_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_settings_timezone_get, NULL);
 }
 
 static void coap_hnd_borneo_settings_timezone_put(coap_resource_t* resource, coap_session_t* session,
@@ -169,17 +100,7 @@ static void coap_hnd_borneo_settings_name_get(coap_resource_t* resource, coap_se
                                               const coap_pdu_t* request, const coap_string_t* query,
                                               coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[256] = { 0 };
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_settings_name_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_settings_name_get, NULL);
 }
 
 static void coap_hnd_borneo_settings_name_put(coap_resource_t* resource, coap_session_t* session,
@@ -200,8 +121,42 @@ static void coap_hnd_borneo_settings_name_put(coap_resource_t* resource, coap_se
     return;
 }
 
-static void coap_hnd_rtc_local_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
-                                   const coap_string_t* query, coap_pdu_t* response)
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+static void coap_hnd_borneo_groups_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                       const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_groups_get, NULL);
+}
+
+static void coap_hnd_borneo_groups_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                       const coap_string_t* query, coap_pdu_t* response)
+{
+    size_t data_size;
+    const uint8_t* data;
+    coap_get_data(request, &data_size, &data);
+
+    CborParser parser;
+    CborValue value;
+    BO_COAP_TRY(cbor_parser_init(data, data_size, 0, &parser, &value), response);
+    BO_COAP_TRY(bo_rpc_borneo_groups_put(&value, NULL), response);
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE(204));
+}
+
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+#if CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+static void coap_hnd_borneo_clock_sync_get(coap_resource_t* resource, coap_session_t* session,
+                                           const coap_pdu_t* request, const coap_string_t* query,
+                                           coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_clock_sync_get, NULL);
+}
+
+static void coap_hnd_borneo_clock_sync_put(coap_resource_t* resource, coap_session_t* session,
+                                           const coap_pdu_t* request, const coap_string_t* query,
+                                           coap_pdu_t* response)
 {
     size_t data_size;
     const uint8_t* data;
@@ -210,20 +165,41 @@ static void coap_hnd_rtc_local_get(coap_resource_t* resource, coap_session_t* se
     CborParser parser;
     CborValue value;
     BO_COAP_TRY(cbor_parser_init(data, data_size, 0, &parser, &value), response);
+    BO_COAP_TRY(bo_rpc_borneo_clock_sync_put(&value, NULL), response);
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE(204));
+}
 
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
+#endif // CONFIG_BORNEO_CLOCK_SYNC_ENABLED
 
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_rtc_local_get(&value, &encoder), response);
+static void coap_hnd_borneo_persist_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                        const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_persist_get, NULL);
+}
 
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
+#if CONFIG_DRVFX_INIT_PROFILING
 
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+static void coap_hnd_borneo_boot_profile_get(coap_resource_t* resource, coap_session_t* session,
+                                             const coap_pdu_t* request, const coap_string_t* query,
+                                             coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_boot_profile_get, NULL);
+}
 
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+#endif // CONFIG_DRVFX_INIT_PROFILING
+
+static void coap_hnd_rtc_local_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                   const coap_string_t* query, coap_pdu_t* response)
+{
+    size_t data_size;
+    const uint8_t* data;
+    coap_get_data(request, &data_size, &data);
+
+    CborParser parser;
+    CborValue value;
+    BO_COAP_TRY(cbor_parser_init(data, data_size, 0, &parser, &value), response);
+
+    bo_coap_respond_cbor(request, response, bo_rpc_rtc_local_get, &value);
 }
 
 static void coap_hnd_rtc_local_post(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -245,19 +221,7 @@ static void coap_hnd_rtc_local_post(coap_resource_t* resource, coap_session_t* s
 static void coap_hnd_rtc_timestamp_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                        const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[64] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_rtc_timestamp_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_rtc_timestamp_get, NULL);
 }
 
 static void coap_hnd_sensors_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -271,19 +235,7 @@ static void coap_hnd_sensors_get(coap_resource_t* resource, coap_session_t* sess
     CborValue value;
     BO_COAP_TRY(cbor_parser_init(data, data_size, 0, &parser, &value), response);
 
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[512] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_sensors_get(&value, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_sensors_get, &value);
 }
 
 static void coap_hnd_borneo_network_reset_post(coap_resource_t* resource, coap_session_t* session,
@@ -294,30 +246,58 @@ static void coap_hnd_borneo_network_reset_post(coap_resource_t* resource, coap_s
     coap_pdu_set_code(response, COAP_RESPONSE_CODE(204));
 }
 
-COAP_RESOURCE_DEFINE("borneo/info", false, coap_hnd_borneo_info_get, NULL, NULL, NULL);
+COAP_RESOURCE_DEFINE_VERSIONED("borneo/info", borneo_info_generation, coap_hnd_borneo_info_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/info", bo_rpc_borneo_info_get);
 
 COAP_RESOURCE_DEFINE("borneo/reboot", false, NULL, coap_hnd_borneo_reboot_post, NULL, NULL);
 
 COAP_RESOURCE_DEFINE("borneo/status", false, coap_hnd_borneo_status_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/status", bo_rpc_borneo_status_get);
 
 COAP_RESOURCE_DEFINE("borneo/fwver", false, coap_hnd_borneo_fw_ver_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/fwver", bo_rpc_borneo_fw_ver_get);
 
 COAP_RESOURCE_DEFINE("borneo/compatible", false, coap_hnd_borneo_compatible_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/compatible", bo_rpc_borneo_compatible_get);
 
 COAP_RESOURCE_DEFINE("borneo/heartbeat", true, coap_hnd_heartbeat_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/heartbeat", bo_rpc_heartbeat_get);
 
 COAP_RESOURCE_DEFINE("borneo/mode", true, coap_hnd_borneo_system_mode_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/mode", bo_rpc_system_mode_get);
 
 COAP_RESOURCE_DEFINE("borneo/settings/timezone", false, coap_hnd_borneo_settings_timezone_get, NULL,
                      coap_hnd_borneo_settings_timezone_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/settings/timezone", bo_rpc_borneo_settings_timezone_get);
 
 COAP_RESOURCE_DEFINE("borneo/settings/name", false, coap_hnd_borneo_settings_name_get, NULL,
                      coap_hnd_borneo_settings_name_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/settings/name", bo_rpc_borneo_settings_name_get);
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+COAP_RESOURCE_DEFINE("borneo/groups", false, coap_hnd_borneo_groups_get, NULL, coap_hnd_borneo_groups_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/groups", bo_rpc_borneo_groups_get);
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+#if CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+COAP_RESOURCE_DEFINE("borneo/clock-sync", false, coap_hnd_borneo_clock_sync_get, NULL, coap_hnd_borneo_clock_sync_put,
+                     NULL);
+BO_RPC_METHOD_DEFINE("borneo/clock-sync", bo_rpc_borneo_clock_sync_get);
+#endif // CONFIG_BORNEO_CLOCK_SYNC_ENABLED
 
 COAP_RESOURCE_DEFINE("borneo/rtc/local", false, coap_hnd_rtc_local_get, coap_hnd_rtc_local_post, NULL, NULL);
 
 COAP_RESOURCE_DEFINE("borneo/rtc/ts", true, coap_hnd_rtc_timestamp_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/rtc/ts", bo_rpc_rtc_timestamp_get);
 
 COAP_RESOURCE_DEFINE("borneo/sensors", false, coap_hnd_sensors_get, NULL, NULL, NULL);
 
+COAP_RESOURCE_DEFINE("borneo/persist", false, coap_hnd_borneo_persist_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/persist", bo_rpc_borneo_persist_get);
+
+#if CONFIG_DRVFX_INIT_PROFILING
+COAP_RESOURCE_DEFINE("borneo/boot-profile", false, coap_hnd_borneo_boot_profile_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/boot-profile", bo_rpc_borneo_boot_profile_get);
+#endif // CONFIG_DRVFX_INIT_PROFILING
+
 COAP_RESOURCE_DEFINE("borneo/network/reset", false, NULL, coap_hnd_borneo_network_reset_post, NULL, NULL);
\ No newline at end of file
@@ -17,24 +17,14 @@
 #include <borneo/power.h>
 #include <borneo/nvs.h>
 #include <borneo/rpc/common.h>
+#include <borneo/rpc/registry.h>
 
 #define TAG "borneo-power-coap"
 
 static void coap_hnd_borneo_power_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                       const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_power_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_power_get, NULL);
 }
 
 static void coap_hnd_borneo_power_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -58,18 +48,7 @@ static void coap_hnd_borneo_power_behavior_get(coap_resource_t* resource, coap_s
                                                const coap_pdu_t* request, const coap_string_t* query,
                                                coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[32] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_power_behavior_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_power_behavior_get, NULL);
 }
 
 static void coap_hnd_borneo_power_behavior_put(coap_resource_t* resource, coap_session_t* session,
@@ -90,5 +69,7 @@ static void coap_hnd_borneo_power_behavior_put(coap_resource_t* resource, coap_s
 }
 
 COAP_RESOURCE_DEFINE(BO_COAP_PATH_POWER, true, coap_hnd_borneo_power_get, NULL, coap_hnd_borneo_power_put, NULL);
+BO_RPC_METHOD_DEFINE(BO_COAP_PATH_POWER, bo_rpc_borneo_power_get);
 COAP_RESOURCE_DEFINE("borneo/power/behavior", false, coap_hnd_borneo_power_behavior_get, NULL,
                      coap_hnd_borneo_power_behavior_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/power/behavior", bo_rpc_borneo_power_behavior_get);
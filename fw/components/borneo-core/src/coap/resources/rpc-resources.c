@@ -0,0 +1,62 @@
+#include <string.h>
+
+#include <esp_system.h>
+#include <esp_log.h>
+
+#include <coap3/coap.h>
+#include <cbor.h>
+
+#include <borneo/common.h>
+#include <borneo/coap.h>
+#include <borneo/rpc/common.h>
+
+#define TAG "borneo-rpc-coap"
+
+#define BATCH_REQUEST_MAX 256
+
+/*
+ * Block-wise transfer re-runs the handler for every block. A batch response is too big for one PDU and its content
+ * changes between calls, so it is encoded once on the first block and later blocks of the same request are served from
+ * this snapshot; otherwise the client would stitch together pieces of different encodings.
+ */
+static struct {
+    uint8_t request[BATCH_REQUEST_MAX];
+    size_t request_size;
+    uint8_t body[CONFIG_BORNEO_RPC_BATCH_BUFFER_SIZE];
+    size_t body_size;
+} s_batch = { 0 };
+
+static void coap_hnd_rpc_batch_post(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                    const coap_string_t* query, coap_pdu_t* response)
+{
+    size_t data_size;
+    const uint8_t* data;
+    coap_get_data(request, &data_size, &data);
+    BO_COAP_REQUIRES(data_size > 0 && data_size <= BATCH_REQUEST_MAX, response);
+
+    coap_block_t block2 = { 0 };
+    bool is_continuation = coap_get_block(request, COAP_OPTION_BLOCK2, &block2) && block2.num > 0;
+    bool has_snapshot = s_batch.body_size > 0 && s_batch.request_size == data_size
+                        && memcmp(s_batch.request, data, data_size) == 0;
+
+    if (!is_continuation || !has_snapshot) {
+        s_batch.body_size = 0;
+
+        CborParser parser;
+        CborValue value;
+        BO_COAP_TRY_DECODE(cbor_parser_init(data, data_size, 0, &parser, &value), response);
+
+        CborEncoder encoder;
+        cbor_encoder_init(&encoder, s_batch.body, sizeof(s_batch.body), 0);
+        BO_COAP_TRY(bo_rpc_borneo_batch_post(&value, &encoder), response);
+
+        memcpy(s_batch.request, data, data_size);
+        s_batch.request_size = data_size;
+        s_batch.body_size = cbor_encoder_get_buffer_size(&encoder, s_batch.body);
+    }
+
+    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, s_batch.body_size,
+                                   s_batch.body);
+}
+
+COAP_RESOURCE_DEFINE("borneo/rpc/batch", false, NULL, coap_hnd_rpc_batch_post, NULL, NULL);
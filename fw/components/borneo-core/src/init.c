@@ -24,6 +24,7 @@
 
 #include "borneo/common.h"
 #include "borneo/nvs.h"
+#include "borneo/persist.h"
 #include "borneo/power.h"
 #include "borneo/wifi.h"
 
@@ -51,17 +52,18 @@ static int _borneo_core_init(const struct drvfx_device* dev)
     ESP_LOGI(TAG, "Initializing early stuff...");
 
     // Initialize NVS
-    BO_TRY(bo_nvs_init());
+    BO_TRY(K_INIT_STEP("nvs", bo_nvs_init()));
     BO_TRY(esp_event_loop_create_default());
+    BO_TRY(K_INIT_STEP("persist", bo_persist_init()));
     ESP_LOGI(TAG, "Early stuff has been initialized successfully.");
 
 #if CONFIG_BORNEO_INDICATOR_ENABLED
-    BO_TRY(bo_indicator_init());
+    BO_TRY(K_INIT_STEP("indicator", bo_indicator_init()));
 #endif
 
-    BO_TRY(bo_system_init());
-    BO_TRY(bo_power_init());
-    BO_TRY(bo_rtc_init());
+    BO_TRY(K_INIT_STEP("system", bo_system_init()));
+    BO_TRY(K_INIT_STEP("power", bo_power_init()));
+    BO_TRY(K_INIT_STEP("rtc", bo_rtc_init()));
 
     ESP_LOGI(TAG, "Borneo Core has been initialized successfully.");
     return 0;
@@ -72,20 +74,21 @@ static int _borneo_net_init(const struct drvfx_device* dev)
     ESP_LOGI(TAG, "Initializing Borneo networking...");
 
     ESP_LOGI(TAG, "Initializing ESP-NETIF...");
-    BO_TRY(esp_netif_init());
+    BO_TRY(K_INIT_STEP("netif", esp_netif_init()));
 
     ESP_LOGI(TAG, "Initializing Wi-Fi...");
-    BO_TRY(bo_wifi_init());
+    BO_TRY(K_INIT_STEP("wifi", bo_wifi_init()));
 
     ESP_LOGI(TAG, "Initializing mDNS...");
-    BO_TRY(bo_mdns_init());
+    BO_TRY(K_INIT_STEP("mdns", bo_mdns_init()));
 
     ESP_LOGI(TAG, "Initializing SNTP...");
-    BO_TRY(bo_sntp_init());
+    BO_TRY(K_INIT_STEP("sntp", bo_sntp_init()));
 
     ESP_LOGI(TAG, "Borneo networking has been initialized successfully.");
     return 0;
 }
 
 DRVFX_SYS_INIT(_borneo_core_init, APPLICATION, DRVFX_INIT_APP_HIGHEST_PRIORITY);
-DRVFX_SYS_INIT(_borneo_net_init, APPLICATION, DRVFX_INIT_APP_HIGH_PRIORITY);
\ No newline at end of file
+// Wi-Fi and the rest of the networking start next to the device drivers rather than ahead of them
+DRVFX_SYS_INIT_ASYNC(_borneo_net_init, DRVFX_INIT_APP_HIGH_PRIORITY, DRVFX_INIT_DEPS("_borneo_core_init"));
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <string.h>
+#include <errno.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_system.h>
+#include <esp_event.h>
+#include <esp_log.h>
+
+#include <borneo/common.h>
+#include <borneo/system.h>
+#include <borneo/persist.h>
+
+#define TAG "persist"
+
+#define TASK_PRIORITY 2 // Below everything that reacts to the user, flushes only erase and program flash
+#define TASK_STACK_SIZE 4096
+
+#define PERSIST_DEBOUNCE_TICKS pdMS_TO_TICKS(CONFIG_BORNEO_PERSIST_DEBOUNCE_MS)
+#define PERSIST_MAX_DELAY_TICKS pdMS_TO_TICKS(CONFIG_BORNEO_PERSIST_MAX_DELAY_MS)
+
+struct persist_section {
+    bo_persist_flush_fn flush;
+    void* ctx;
+    struct bo_persist_stats stats;
+};
+
+static portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+static struct persist_section _sections[BO_PERSIST_SECTIONS_MAX];
+static size_t _section_count;
+static uint32_t _dirty; ///< Bit per section
+static bool _discarded;
+static SemaphoreHandle_t _flush_mutex; ///< Held while the callbacks run, so a section is never written twice at once
+static TaskHandle_t _task;
+
+int bo_persist_register(const char* name, bo_persist_flush_fn flush, void* ctx)
+{
+    if (flush == NULL) {
+        return -EINVAL;
+    }
+    portENTER_CRITICAL(&_lock);
+    if (_section_count == BO_PERSIST_SECTIONS_MAX) {
+        portEXIT_CRITICAL(&_lock);
+        return -ENOMEM;
+    }
+    int id = (int)_section_count++;
+    _sections[id].flush = flush;
+    _sections[id].ctx = ctx;
+    _sections[id].stats.name = name;
+    portEXIT_CRITICAL(&_lock);
+    return id;
+}
+
+void bo_persist_mark_dirty(int section)
+{
+    if (section < 0 || section >= (int)_section_count) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    bool ignored = _discarded;
+    if (!ignored) {
+        _dirty |= 1U << section;
+        _sections[section].stats.marks++;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (!ignored && _task != NULL) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+int bo_persist_flush()
+{
+    if (_flush_mutex == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(_flush_mutex, portMAX_DELAY);
+    BO_SEM_AUTO_RELEASE(_flush_mutex);
+
+    portENTER_CRITICAL(&_lock);
+    uint32_t dirty = _discarded ? 0 : _dirty;
+    _dirty = 0; // Marks made while flushing are picked up by the next round
+    portEXIT_CRITICAL(&_lock);
+
+    int first_error = 0;
+    for (size_t i = 0; dirty != 0; i++) {
+        if (!(dirty & (1U << i))) {
+            continue;
+        }
+        dirty &= ~(1U << i);
+
+        struct persist_section* section = &_sections[i];
+        int rc = section->flush(section->ctx);
+
+        portENTER_CRITICAL(&_lock);
+        if (rc < 0) {
+            _dirty |= 1U << i;
+            section->stats.failures++;
+            section->stats.last_error = rc;
+        }
+        else if (rc > 0) {
+            section->stats.flushes++;
+            section->stats.keys_written += rc;
+        }
+        portEXIT_CRITICAL(&_lock);
+
+        if (rc < 0) {
+            ESP_LOGE(TAG, "Failed to save '%s' (%d), retrying later", section->stats.name, rc);
+            if (first_error == 0) {
+                first_error = rc;
+            }
+        }
+        else if (rc > 0) {
+            ESP_LOGI(TAG, "Saved '%s', %d key(s) written", section->stats.name, rc);
+        }
+    }
+    return first_error;
+}
+
+void bo_persist_discard_all()
+{
+    if (_flush_mutex != NULL) {
+        xSemaphoreTake(_flush_mutex, portMAX_DELAY);
+    }
+    portENTER_CRITICAL(&_lock);
+    _discarded = true;
+    _dirty = 0;
+    portEXIT_CRITICAL(&_lock);
+    if (_flush_mutex != NULL) {
+        xSemaphoreGive(_flush_mutex);
+    }
+}
+
+size_t bo_persist_get_stats(struct bo_persist_stats* stats, size_t max)
+{
+    portENTER_CRITICAL(&_lock);
+    size_t count = _section_count;
+    for (size_t i = 0; i < count && i < max; i++) {
+        stats[i] = _sections[i].stats;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+static void persist_task(void* params)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Wait for the marks to stop, but not forever while a slider keeps moving
+        TickType_t first_mark = xTaskGetTickCount();
+        for (;;) {
+            TickType_t elapsed = xTaskGetTickCount() - first_mark;
+            if (elapsed >= PERSIST_MAX_DELAY_TICKS) {
+                break;
+            }
+            TickType_t wait = PERSIST_MAX_DELAY_TICKS - elapsed;
+            if (wait > PERSIST_DEBOUNCE_TICKS) {
+                wait = PERSIST_DEBOUNCE_TICKS;
+            }
+            if (ulTaskNotifyTake(pdTRUE, wait) == 0) {
+                break;
+            }
+        }
+
+        if (bo_persist_flush() != 0) {
+            // Failed sections stay dirty, try again after another debounce window
+            xTaskNotifyGive(_task);
+        }
+    }
+}
+
+static void persist_shutdown_handler()
+{
+    // Runs from `esp_restart()`, which does not always go through `BO_EVENT_REBOOTING`
+    bo_persist_flush();
+}
+
+static void system_events_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    switch (event_id) {
+    case BO_EVENT_REBOOTING:
+    case BO_EVENT_SHUTDOWN_SCHEDULED:
+    case BO_EVENT_SHUTDOWN_FAULT:
+        bo_persist_flush();
+        break;
+
+    default:
+        break;
+    }
+}
+
+int bo_persist_init()
+{
+    ESP_LOGI(TAG, "Initializing settings persistence...");
+
+    _flush_mutex = xSemaphoreCreateMutex();
+    if (_flush_mutex == NULL) {
+        return -ENOMEM;
+    }
+    if (xTaskCreate(&persist_task, "persist", TASK_STACK_SIZE, NULL, TASK_PRIORITY, &_task) != pdPASS) {
+        return -ENOMEM;
+    }
+    BO_TRY_ESP(esp_register_shutdown_handler(&persist_shutdown_handler));
+    BO_TRY_ESP(esp_event_handler_register(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, &system_events_handler, NULL));
+
+    // Sections marked while the core was still starting up
+    if (_dirty != 0) {
+        xTaskNotifyGive(_task);
+    }
+    return 0;
+}
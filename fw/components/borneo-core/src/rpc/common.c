@@ -23,6 +23,9 @@
 #include <borneo/timer.h>
 #include <borneo/product.h>
 #include <borneo/transport.h>
+#include <borneo/coap.h>
+#include <borneo/clock-sync.h>
+#include <borneo/persist.h>
 
 #define TAG "borneo-rpc-common"
 
@@ -305,6 +308,195 @@ int bo_rpc_borneo_settings_name_put(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+int bo_rpc_borneo_groups_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args; // No input args for GET
+    uint16_t groups[BO_COAP_GROUP_MAX];
+    size_t count = bo_coap_group_get_all(groups);
+
+    CborEncoder array;
+    BO_TRY(cbor_encoder_create_array(retvals, &array, count));
+    for (size_t i = 0; i < count; i++) {
+        BO_TRY(cbor_encode_uint(&array, groups[i]));
+    }
+    BO_TRY(cbor_encoder_close_container(retvals, &array));
+    return 0;
+}
+
+int bo_rpc_borneo_groups_put(const CborValue* args, CborEncoder* retvals)
+{
+    (void)retvals; // No output for PUT
+    if (!cbor_value_is_array(args)) {
+        return -EINVAL;
+    }
+
+    uint16_t groups[BO_COAP_GROUP_MAX];
+    size_t count = 0;
+    CborValue item;
+    BO_TRY(cbor_value_enter_container(args, &item));
+    while (!cbor_value_at_end(&item)) {
+        uint64_t id;
+        if (count >= BO_COAP_GROUP_MAX || !cbor_value_is_unsigned_integer(&item)) {
+            return -EINVAL;
+        }
+        BO_TRY(cbor_value_get_uint64(&item, &id));
+        if (id == BO_COAP_GROUP_ALL || id > UINT16_MAX) {
+            return -EINVAL;
+        }
+        groups[count++] = (uint16_t)id;
+        BO_TRY(cbor_value_advance_fixed(&item));
+    }
+
+    BO_TRY(bo_coap_group_set_all(groups, count));
+    return 0;
+}
+
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+#if CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+int bo_rpc_borneo_clock_sync_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args; // No input args for GET
+    struct bo_clock_sync_status status;
+    bo_clock_sync_get_status(&status);
+
+    CborEncoder root_map;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "master"));
+    BO_TRY(cbor_encode_boolean(&root_map, status.is_master));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "locked"));
+    BO_TRY(cbor_encode_boolean(&root_map, status.locked));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "group"));
+    BO_TRY(cbor_encode_uint(&root_map, status.group));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "seed"));
+    BO_TRY(cbor_encode_uint(&root_map, status.seed));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "offset"));
+    BO_TRY(cbor_encode_int(&root_map, status.offset_us));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "skew"));
+    BO_TRY(cbor_encode_int(&root_map, status.skew_ppb));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "delay"));
+    BO_TRY(cbor_encode_int(&root_map, status.delay_us));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "samples"));
+    BO_TRY(cbor_encode_uint(&root_map, status.samples));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "time"));
+    BO_TRY(cbor_encode_int(&root_map, bo_clock_sync_time_us()));
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+    return 0;
+}
+
+int bo_rpc_borneo_clock_sync_put(const CborValue* args, CborEncoder* retvals)
+{
+    (void)retvals; // No output for PUT
+    if (!cbor_value_is_map(args)) {
+        return -EINVAL;
+    }
+
+    CborValue value;
+    bool is_master;
+    BO_TRY(cbor_value_map_find_value(args, "master", &value));
+    BO_TRY(cbor_value_get_boolean(&value, &is_master));
+
+    uint64_t group = BO_CLOCK_SYNC_GROUP_NONE;
+    BO_TRY(cbor_value_map_find_value(args, "group", &value));
+    if (cbor_value_is_valid(&value)) {
+        BO_TRY(cbor_value_get_uint64(&value, &group));
+        if (group > UINT16_MAX) {
+            return -EINVAL;
+        }
+    }
+
+    uint64_t seed = 0;
+    BO_TRY(cbor_value_map_find_value(args, "seed", &value));
+    if (cbor_value_is_valid(&value)) {
+        BO_TRY(cbor_value_get_uint64(&value, &seed));
+        if (seed > UINT32_MAX) {
+            return -EINVAL;
+        }
+    }
+
+    BO_TRY(bo_clock_sync_set_master(is_master, (uint16_t)group, (uint32_t)seed));
+    return 0;
+}
+
+#endif // CONFIG_BORNEO_CLOCK_SYNC_ENABLED
+
+int bo_rpc_borneo_persist_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args; // No input args for GET
+    struct bo_persist_stats stats[BO_PERSIST_SECTIONS_MAX];
+    size_t count = bo_persist_get_stats(stats, BO_PERSIST_SECTIONS_MAX);
+
+    CborEncoder root_map, sections_array;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "sections"));
+    BO_TRY(cbor_encoder_create_array(&root_map, &sections_array, count));
+    for (size_t i = 0; i < count; i++) {
+        CborEncoder section_map;
+        BO_TRY(cbor_encoder_create_map(&sections_array, &section_map, 6));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "name"));
+        BO_TRY(cbor_encode_text_stringz(&section_map, stats[i].name));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "marks"));
+        BO_TRY(cbor_encode_uint(&section_map, stats[i].marks));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "flushes"));
+        BO_TRY(cbor_encode_uint(&section_map, stats[i].flushes));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "keys"));
+        BO_TRY(cbor_encode_uint(&section_map, stats[i].keys_written));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "failures"));
+        BO_TRY(cbor_encode_uint(&section_map, stats[i].failures));
+        BO_TRY(cbor_encode_text_stringz(&section_map, "lastError"));
+        BO_TRY(cbor_encode_int(&section_map, stats[i].last_error));
+        BO_TRY(cbor_encoder_close_container(&sections_array, &section_map));
+    }
+    BO_TRY(cbor_encoder_close_container(&root_map, &sections_array));
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+    return 0;
+}
+
+#if CONFIG_DRVFX_INIT_PROFILING
+
+int bo_rpc_borneo_boot_profile_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args; // No input args for GET
+    const struct drvfx_init_record* records;
+    size_t count = k_init_get_records(&records);
+
+    // Records are encoded as `[name, level, parent, start, duration, rc, flags]` to fit the response buffer
+    CborEncoder root_array;
+    BO_TRY(cbor_encoder_create_array(retvals, &root_array, count));
+    for (size_t i = 0; i < count; i++) {
+        const struct drvfx_init_record* record = &records[i];
+        CborEncoder record_array;
+        BO_TRY(cbor_encoder_create_array(&root_array, &record_array, 7));
+        BO_TRY(cbor_encode_text_stringz(&record_array, record->name != NULL ? record->name : "?"));
+        BO_TRY(cbor_encode_uint(&record_array, record->level));
+        BO_TRY(cbor_encode_int(&record_array, record->parent));
+        BO_TRY(cbor_encode_int(&record_array, record->start_us));
+        BO_TRY(cbor_encode_int(&record_array, record->duration_us));
+        BO_TRY(cbor_encode_int(&record_array, record->rc));
+        BO_TRY(cbor_encode_uint(&record_array, record->flags));
+        BO_TRY(cbor_encoder_close_container(&root_array, &record_array));
+    }
+    BO_TRY(cbor_encoder_close_container(retvals, &root_array));
+    return 0;
+}
+
+#endif // CONFIG_DRVFX_INIT_PROFILING
+
 int bo_rpc_borneo_sensors_get(const CborValue* args, CborEncoder* retvals)
 {
     (void)args; // No input args for GET
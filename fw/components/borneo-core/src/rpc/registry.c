@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include <esp_system.h>
+#include <esp_log.h>
+#include <cbor.h>
+
+#include <borneo/common.h>
+#include <borneo/rpc/common.h>
+#include <borneo/rpc/registry.h>
+
+#define TAG "borneo-rpc-registry"
+
+#define BO_RPC_METHOD_NAME_MAX 63
+
+extern const struct bo_rpc_method_desc _bo_rpc_methods_start[];
+extern const struct bo_rpc_method_desc _bo_rpc_methods_end[];
+
+static int batch_call_one(CborValue* call, CborEncoder* results);
+
+const struct bo_rpc_method_desc* bo_rpc_method_find(const char* name)
+{
+    for (const struct bo_rpc_method_desc* desc = _bo_rpc_methods_start; desc < _bo_rpc_methods_end; desc++) {
+        if (strcmp(desc->name, name) == 0) {
+            return desc;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Request: an array of calls, each one either a method name or a `[name, args]` pair.
+ * Response: an array with one `[status, result...]` entry per call, where `status` is 0 or a negative errno and the
+ * result is present only on success.
+ */
+int bo_rpc_borneo_batch_post(const CborValue* args, CborEncoder* retvals)
+{
+    if (args == NULL || !cbor_value_is_array(args)) {
+        return -EINVAL;
+    }
+
+    size_t call_count;
+    BO_TRY(cbor_value_get_array_length(args, &call_count));
+
+    CborValue call;
+    BO_TRY(cbor_value_enter_container(args, &call));
+
+    CborEncoder results;
+    BO_TRY(cbor_encoder_create_array(retvals, &results, call_count));
+    for (size_t i = 0; i < call_count; i++) {
+        BO_TRY(batch_call_one(&call, &results));
+    }
+    BO_TRY(cbor_encoder_close_container(retvals, &results));
+
+    if (cbor_encoder_get_extra_bytes_needed(retvals) > 0) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static int batch_call_one(CborValue* call, CborEncoder* results)
+{
+    CborValue name = *call;
+    CborValue method_args;
+    bool has_args = false;
+
+    if (cbor_value_is_array(call)) {
+        size_t len;
+        BO_TRY(cbor_value_get_array_length(call, &len));
+        if (len != 1 && len != 2) {
+            return -EINVAL;
+        }
+        BO_TRY(cbor_value_enter_container(call, &name));
+        if (len == 2) {
+            method_args = name;
+            BO_TRY(cbor_value_advance(&method_args));
+            has_args = true;
+        }
+    }
+    if (!cbor_value_is_text_string(&name)) {
+        return -EINVAL;
+    }
+
+    char name_str[BO_RPC_METHOD_NAME_MAX + 1];
+    size_t name_len = sizeof(name_str);
+    if (cbor_value_copy_text_string(&name, name_str, &name_len, NULL) != CborNoError) {
+        return -EINVAL;
+    }
+
+    // The method writes straight into the response, so keep the encoder state to roll back a failed call
+    const CborEncoder saved = *results;
+
+    CborEncoder entry;
+    BO_TRY(cbor_encoder_create_array(results, &entry, CborIndefiniteLength));
+    BO_TRY(cbor_encode_int(&entry, 0));
+
+    const struct bo_rpc_method_desc* desc = bo_rpc_method_find(name_str);
+    int rc = desc != NULL ? desc->method(has_args ? &method_args : NULL, &entry) : -ENOENT;
+    if (rc == 0 && cbor_encoder_get_extra_bytes_needed(&entry) > 0) {
+        rc = -ENOMEM;
+    }
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Batched call to `%s` failed, errcode=%d", name_str, rc);
+        *results = saved;
+        BO_TRY(cbor_encoder_create_array(results, &entry, 1));
+        BO_TRY(cbor_encode_int(&entry, rc));
+    }
+    BO_TRY(cbor_encoder_close_container(results, &entry));
+
+    return cbor_value_advance(call);
+}
@@ -20,6 +20,7 @@
 #include <drvfx/drvfx.h>
 #include <borneo/common.h>
 #include <borneo/nvs.h>
+#include <borneo/persist.h>
 #include <borneo/system.h>
 #include <borneo/power.h>
 
@@ -120,6 +121,8 @@ void bo_system_reboot_later(uint32_t delay_ms)
 
 int bo_system_factory_reset()
 {
+    // Pending settings would otherwise be written back into the erased partition before the restart
+    bo_persist_discard_all();
     BO_TRY(bo_nvs_user_reset());
 
     return 0;
@@ -153,6 +156,7 @@ int bo_system_set_user_name(const char* name)
     // Update in-memory sysinfo
     strncpy(_sysinfo.name, name, BO_DEVICE_NAME_MAX - 1);
     _sysinfo.name[BO_DEVICE_NAME_MAX - 1] = '\0';
+    _sysinfo.generation++;
     return 0;
 }
 
@@ -28,9 +28,9 @@ struct drvfx_device {
 
 #define DRVFX_DEVICE_SECTION(prio) __attribute__((__section__(".drvfx_device." _STRINGIFY(prio) "_")))
 
-#define DRVFX_DEVICE_BASE_DEFINE(dev_id_, name_, init_fn_, data_, config_, prio_, api_)                                \
+#define DRVFX_DEVICE_OBJ_DEFINE(storage_, dev_id_, name_, init_fn_, data_, config_, prio_, api_)                       \
     DRVFX_DEVICE_STATE_DEFINE(dev_id_);                                                                                \
-    static const DRVFX_DECL_ALIGN(struct drvfx_device) DRVFX_DEVICE_SECTION(prio_)                                     \
+    storage_ const DRVFX_DECL_ALIGN(struct drvfx_device) DRVFX_DEVICE_SECTION(prio_)                                   \
         DRVFX_USED __DRVFX_NOASAN DRVFX_DEVICE_NAME_GET(dev_id_)                                                       \
         = {                                                                                                            \
               .name = (name_),                                                                                         \
@@ -42,8 +42,26 @@ struct drvfx_device {
     DRVFX_INIT_ENTRY_DEFINE(DRVFX_DEVICE_NAME_GET(dev_id_), init_fn_, &DRVFX_DEVICE_NAME_GET(dev_id_), POST_KERNEL,    \
                             prio_)
 
+#define DRVFX_DEVICE_BASE_DEFINE(dev_id_, name_, init_fn_, data_, config_, prio_, api_)                                \
+    DRVFX_DEVICE_OBJ_DEFINE(static, dev_id_, name_, init_fn_, data_, config_, prio_, api_)
+
+/**
+ * @brief Defines a device other files can reach without a lookup, see `DRVFX_DEVICE_GET()`.
+ *
+ * Only one device may use a given `dev_id` in the whole program.
+ */
 #define DRVFX_NAMED_DEVICE_DEFINE(dev_id, name, init_fn, data, config, prio, api)                                      \
-    DRVFX_DEVICE_BASE_DEFINE(dev_id, name, init_fn, data, config, prio, api)
+    DRVFX_DEVICE_OBJ_DEFINE(, dev_id, name, init_fn, data, config, prio, api)
+
+/** @brief Declares a device defined with `DRVFX_NAMED_DEVICE_DEFINE()` in another file. */
+#define DRVFX_DEVICE_DECLARE(dev_id) extern const struct drvfx_device DRVFX_DEVICE_NAME_GET(dev_id)
+
+/**
+ * @brief Resolves to the device defined with `DRVFX_NAMED_DEVICE_DEFINE()` at link time.
+ *
+ * Unlike `k_device_get_binding()` the device may not be ready, check it with `k_device_is_ready()`.
+ */
+#define DRVFX_DEVICE_GET(dev_id) (&DRVFX_DEVICE_NAME_GET(dev_id))
 
 #define DRVFX_DEVICE_DEFINE(name, init_fn, data, config, prio, api)                                                    \
     DRVFX_DEVICE_BASE_DEFINE(__DRVFX_DEVICE_MAKE_UNIQUE_TOKEN(_, __LINE__), name, init_fn, data, config, prio, api)
@@ -53,6 +71,9 @@ struct drvfx_device {
 
 // Functions:
 
+/** @brief Builds the name lookup table, called by the kernel before the first init level. */
+int k_device_init();
+
 bool k_device_is_ready(const struct drvfx_device* dev);
 const struct drvfx_device* k_device_get_binding(const char* name);
 size_t k_device_get_all_static(const struct drvfx_device** devices);
@@ -1,17 +1,50 @@
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+
+#include <sdkconfig.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct drvfx_device;
 
-/** @brief Structure to store initialization entry information. */
+/**
+ * @brief Runs the entry on a worker task of its own, next to the entries after it.
+ *
+ * The level still ends once every such entry has finished, so `k_ready()` keeps meaning "all initialized".
+ */
+#define DRVFX_INIT_FLAG_ASYNC 0x01
+
+/** @brief Runs the entry on a worker task of its own once `k_ready()` has been called. */
+#define DRVFX_INIT_FLAG_DEFERRED 0x02
+
+/**
+ * @brief Structure to store initialization entry information.
+ *
+ * `deps` and `flags` are honored at the APPLICATION level only, the levels before it run serially before the
+ * scheduler starts.
+ */
 struct drvfx_init_entry {
     int (*init)(const struct drvfx_device* dev);
     const struct drvfx_device* dev;
+    const char* name; ///< Of the init function, what `deps` of other entries refer to
+    const char* const* deps; ///< NULL-terminated names of the entries to wait for, or NULL
+    uint8_t flags; ///< `DRVFX_INIT_FLAG_*`
 };
 
+/**
+ * @brief Names the entries an entry waits for, e.g. `DRVFX_INIT_DEPS("_borneo_net_init")`.
+ *
+ * An entry of an earlier level has always finished. Only a deferred entry may wait for a deferred one. Before the level
+ * starts, the dependencies are searched for cycles, counting that the main task runs the serial entries in order, so a
+ * serial entry waiting for a later one is a cycle too; the entries whose dependencies close a cycle fail with -EDEADLK
+ * instead of hanging the boot. If a dependency failed, the entry is skipped and fails with -ENODEV.
+ */
+#define DRVFX_INIT_DEPS(...) ((const char* const[]) { __VA_ARGS__, NULL })
+
 /*
 Available level:
     * EARLY
@@ -37,23 +70,95 @@ Available level:
 #define DRVFX_INIT_ENTRY_SECTION(level, prio)                                                                          \
     __attribute__((__section__(".drvfx_init_" #level "." _STRINGIFY(prio) "_"), used))
 
-#define DRVFX_INIT_ENTRY_DEFINE(init_id, init_fn, device, level, prio)                                                 \
+#define DRVFX_INIT_ENTRY_DEFINE_EX(init_id, init_fn, device, level, prio, flags_, deps_)                               \
     static const DRVFX_DECL_ALIGN(struct drvfx_init_entry) DRVFX_INIT_ENTRY_SECTION(level, prio)                       \
         DRVFX_USED __DRVFX_NOASAN                                                                                      \
         DRVFX_INIT_ENTRY_NAME(init_id)                                                                                 \
         = {                                                                                                            \
               .init = (init_fn),                                                                                       \
               .dev = (device),                                                                                         \
+              .name = #init_fn,                                                                                        \
+              .deps = (deps_),                                                                                         \
+              .flags = (flags_),                                                                                       \
           }
 
+#define DRVFX_INIT_ENTRY_DEFINE(init_id, init_fn, device, level, prio)                                                 \
+    DRVFX_INIT_ENTRY_DEFINE_EX(init_id, init_fn, device, level, prio, 0, NULL)
+
 #define DRVFX_SYS_INIT(init_fn, level, prio) DRVFX_SYS_INIT_NAMED(init_fn, init_fn, level, prio)
 
 #define DRVFX_SYS_INIT_NAMED(name, init_fn, level, prio) DRVFX_INIT_ENTRY_DEFINE(name, init_fn, NULL, level, prio)
 
+/**
+ * @brief Registers an init entry with `DRVFX_INIT_FLAG_*` flags and dependencies.
+ *
+ * Example: `DRVFX_SYS_INIT_EX(_coap_init, APPLICATION, prio, DRVFX_INIT_FLAG_ASYNC, DRVFX_INIT_DEPS("_net_init"));`
+ */
+#define DRVFX_SYS_INIT_EX(init_fn, level, prio, flags, deps)                                                           \
+    DRVFX_INIT_ENTRY_DEFINE_EX(init_fn, init_fn, NULL, level, prio, flags, deps)
+
+/** @brief An APPLICATION entry run concurrently with the entries after it, see `DRVFX_INIT_FLAG_ASYNC`. */
+#define DRVFX_SYS_INIT_ASYNC(init_fn, prio, deps)                                                                      \
+    DRVFX_SYS_INIT_EX(init_fn, APPLICATION, prio, DRVFX_INIT_FLAG_ASYNC, deps)
+
+/** @brief An APPLICATION entry run after `k_ready()`, see `DRVFX_INIT_FLAG_DEFERRED`. */
+#define DRVFX_SYS_INIT_DEFERRED(init_fn, prio, deps)                                                                   \
+    DRVFX_SYS_INIT_EX(init_fn, APPLICATION, prio, DRVFX_INIT_FLAG_DEFERRED, deps)
+
 #define DRVFX_SUBSYS_INIT(init_fn, prio) DRVFX_SYS_INIT_NAMED(init_fn, init_fn, POST_KERNEL, prio)
 
 #define DRVFX_SUBSYS_INIT_NAMED(name, init_fn, prio) DRVFX_INIT_ENTRY_DEFINE(name, init_fn, NULL, POST_KERNEL, prio)
 
+/** @brief Timing of an init entry, or of a step inside one, see `K_INIT_STEP()`. */
+struct drvfx_init_record {
+    const char* name;
+    uint8_t level; ///< `DRVFX_INIT_LEVEL_*` the entry ran at
+    uint8_t flags; ///< `DRVFX_INIT_FLAG_*` of the entry
+    int16_t parent; ///< Index of the entry record a step ran in, -1 for an entry
+    int rc;
+    int64_t start_us; ///< Since boot
+    int64_t duration_us;
+};
+
+enum {
+    DRVFX_INIT_LEVEL_EARLY = 0,
+    DRVFX_INIT_LEVEL_PRE_KERNEL_1,
+    DRVFX_INIT_LEVEL_PRE_KERNEL_2,
+    DRVFX_INIT_LEVEL_POST_KERNEL,
+    DRVFX_INIT_LEVEL_APPLICATION,
+};
+
+#if CONFIG_DRVFX_INIT_PROFILING
+
+/**
+ * @brief Times `expr` as a step of the running init entry and evaluates to its result.
+ *
+ * Example: `BO_TRY(K_INIT_STEP("nvs", bo_nvs_init()));`
+ */
+#define K_INIT_STEP(step_name, expr)                                                                                   \
+    ({                                                                                                                 \
+        int64_t _k_step_start = k_init_step_begin();                                                                   \
+        int _k_step_rc = (expr);                                                                                       \
+        k_init_step_end((step_name), _k_step_start, _k_step_rc);                                                       \
+        _k_step_rc;                                                                                                    \
+    })
+
+int64_t k_init_step_begin();
+void k_init_step_end(const char* name, int64_t start_us, int rc);
+
+/**
+ * @brief Returns the records of this boot in the order the entries started.
+ * @param[out] records Points to the table, valid for the lifetime of the program
+ * @return Number of records, records beyond `CONFIG_DRVFX_INIT_PROFILE_RECORDS` are dropped
+ */
+size_t k_init_get_records(const struct drvfx_init_record** records);
+
+#else
+
+#define K_INIT_STEP(step_name, expr) (expr)
+
+#endif // CONFIG_DRVFX_INIT_PROFILING
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
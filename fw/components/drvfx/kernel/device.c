@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include <esp_log.h>
@@ -9,6 +10,80 @@ extern const struct drvfx_device _drvfx_device_end[];
 
 #define TAG "drvfx.device"
 
+#define DEVICE_HASH_SEEDS 256 ///< Seeds tried per table size before doubling it
+#define DEVICE_HASH_MAX_LOAD_SHIFT 5 ///< The table grows to at most 32 slots per device
+
+// Perfect hash of the device names, built once before the first init level and read-only afterwards: every name has
+// a slot of its own, so a lookup is one hash and one string compare
+static uint16_t* s_slots; ///< Device index + 1, 0 for an empty slot
+static uint32_t s_slot_mask;
+static uint32_t s_seed;
+
+static uint32_t device_name_hash(const char* name, uint32_t seed)
+{
+    // Seeded FNV-1a, with a final mix as only the low bits pick the slot
+    uint32_t hash = 2166136261U ^ seed;
+    for (; *name != '\0'; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+static bool device_hash_fill(uint16_t* slots, uint32_t mask, uint32_t seed)
+{
+    size_t count = _drvfx_device_end - _drvfx_device_start;
+    for (size_t i = 0; i < count; i++) {
+        const char* name = _drvfx_device_start[i].name;
+        uint16_t* slot = &slots[device_name_hash(name, seed) & mask];
+        if (*slot != 0) {
+            if (strcmp(_drvfx_device_start[*slot - 1].name, name) == 0) {
+                continue; // A duplicated name finds the first device, as the linear scan did
+            }
+            return false;
+        }
+        *slot = (uint16_t)(i + 1);
+    }
+    return true;
+}
+
+int k_device_init()
+{
+    size_t count = _drvfx_device_end - _drvfx_device_start;
+    if (count == 0 || count >= UINT16_MAX) {
+        return 0;
+    }
+
+    size_t size = 2;
+    while (size < count * 2) {
+        size <<= 1;
+    }
+    for (; size <= (count << DEVICE_HASH_MAX_LOAD_SHIFT) || size <= 64; size <<= 1) {
+        uint16_t* slots = calloc(size, sizeof(uint16_t));
+        if (slots == NULL) {
+            ESP_LOGW(TAG, "Out of memory, device lookups fall back to a linear scan");
+            return -ENOMEM;
+        }
+        for (uint32_t seed = 0; seed < DEVICE_HASH_SEEDS; seed++) {
+            if (device_hash_fill(slots, size - 1, seed)) {
+                s_slot_mask = size - 1;
+                s_seed = seed;
+                s_slots = slots;
+                ESP_LOGI(TAG, "Device lookup table built, %zu devices in %zu slots", count, size);
+                return 0;
+            }
+            memset(slots, 0, size * sizeof(uint16_t));
+        }
+        free(slots);
+    }
+
+    ESP_LOGW(TAG, "No perfect hash for the device names, lookups fall back to a linear scan");
+    return -ENOSPC;
+}
+
 bool k_device_is_ready(const struct drvfx_device* dev)
 {
 	/*
@@ -35,6 +110,18 @@ const struct drvfx_device* k_device_get_binding(const char* name)
         return NULL;
     }
 
+    if (s_slots != NULL) {
+        uint16_t index = s_slots[device_name_hash(name, s_seed) & s_slot_mask];
+        if (index == 0) {
+            return NULL;
+        }
+        const struct drvfx_device* dev = &_drvfx_device_start[index - 1];
+        if ((dev->name == name || strcmp(name, dev->name) == 0) && k_device_is_ready(dev)) {
+            return dev;
+        }
+        return NULL;
+    }
+
     for (const struct drvfx_device* dev = _drvfx_device_start; dev < _drvfx_device_end; dev++) {
         if (k_device_is_ready(dev) && (dev->name == name)) {
             return dev;
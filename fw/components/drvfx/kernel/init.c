@@ -1,7 +1,12 @@
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <esp_private/startup_internal.h>
 
 #include "drvfx/kernel/common.h"
@@ -20,52 +25,388 @@ extern const struct drvfx_init_entry _drvfx_init_POST_KERNEL_end[];
 extern const struct drvfx_init_entry _drvfx_init_APPLICATION_start[];
 extern const struct drvfx_init_entry _drvfx_init_APPLICATION_end[];
 
-enum init_level {
-    DRVFX_INIT_LEVEL_EARLY = 0,
-    DRVFX_INIT_LEVEL_PRE_KERNEL_1,
-    DRVFX_INIT_LEVEL_PRE_KERNEL_2,
-    DRVFX_INIT_LEVEL_POST_KERNEL,
-    DRVFX_INIT_LEVEL_APPLICATION,
+static const struct drvfx_init_entry* const s_levels[] = {
+    // EARLY pair
+    _drvfx_init_EARLY_start,
+    _drvfx_init_EARLY_end,
+
+    // PRE_KERNEL_1 pair
+    _drvfx_init_PRE_KERNEL_1_start,
+    _drvfx_init_PRE_KERNEL_1_end,
+
+    // PRE_KRENEL_2 pair
+    _drvfx_init_PRE_KERNEL_2_start,
+    _drvfx_init_PRE_KERNEL_2_end,
+
+    // POST_KERNEL pair
+    _drvfx_init_POST_KERNEL_start,
+    _drvfx_init_POST_KERNEL_end,
+
+    // APPLICATION pair
+    _drvfx_init_APPLICATION_start,
+    _drvfx_init_APPLICATION_end,
+};
+
+/// An APPLICATION entry and what the entries depending on it wait for
+struct init_job {
+    const struct drvfx_init_entry* entry;
+    SemaphoreHandle_t done; ///< Given once the entry has finished, every waiter takes it and gives it back
+    StaticSemaphore_t done_buffer;
+    int rc;
+    bool deadlocked; ///< On a dependency cycle, fails with -EDEADLK without running
+    uint8_t visit; ///< `INIT_VISIT_*` of the cycle search
+    struct init_job* next; ///< Edge the cycle search follows out of this job
+    bool next_explicit; ///< Whether that edge is a declared dependency
+};
+
+enum {
+    INIT_VISIT_NONE = 0,
+    INIT_VISIT_ACTIVE,
+    INIT_VISIT_DONE,
 };
 
-static void drvfx_sys_init_run_level(enum init_level level)
+// Kept for the lifetime of the program, the deferred entries still run after `app_main()` has returned
+static struct init_job* s_jobs;
+static size_t s_job_count;
+
+#if CONFIG_DRVFX_INIT_PROFILING
+
+static portMUX_TYPE s_records_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct drvfx_init_record s_records[CONFIG_DRVFX_INIT_PROFILE_RECORDS];
+static TaskHandle_t s_record_tasks[CONFIG_DRVFX_INIT_PROFILE_RECORDS]; ///< Task each record was made in
+static size_t s_record_count;
+
+static int init_record_add(const char* name, uint8_t level, uint8_t flags, int16_t parent, int64_t start_us)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    int index = -1;
+    portENTER_CRITICAL_SAFE(&s_records_lock);
+    if (s_record_count < CONFIG_DRVFX_INIT_PROFILE_RECORDS) {
+        index = (int)s_record_count++;
+        struct drvfx_init_record* record = &s_records[index];
+        record->name = name;
+        record->level = level;
+        record->flags = flags;
+        record->parent = parent;
+        record->rc = 0;
+        record->start_us = start_us;
+        record->duration_us = -1; // Still running
+        s_record_tasks[index] = task;
+    }
+    portEXIT_CRITICAL_SAFE(&s_records_lock);
+    return index;
+}
+
+static void init_record_end(int index, int rc)
 {
-    static const struct drvfx_init_entry* levels[] = {
-        // EARLY pair
-        _drvfx_init_EARLY_start,
-        _drvfx_init_EARLY_end,
+    if (index < 0) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_SAFE(&s_records_lock);
+    s_records[index].rc = rc;
+    s_records[index].duration_us = now - s_records[index].start_us;
+    portEXIT_CRITICAL_SAFE(&s_records_lock);
+}
 
-        // PRE_KERNEL_1 pair
-        _drvfx_init_PRE_KERNEL_1_start,
-        _drvfx_init_PRE_KERNEL_1_end,
+int64_t k_init_step_begin() { return esp_timer_get_time(); }
+
+void k_init_step_end(const char* name, int64_t start_us, int rc)
+{
+    // The step belongs to the entry still running in this task, entries on other workers may have started since
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    int parent = -1;
+    portENTER_CRITICAL_SAFE(&s_records_lock);
+    for (int i = (int)s_record_count - 1; i >= 0; i--) {
+        if (s_records[i].parent < 0 && s_records[i].duration_us < 0 && s_record_tasks[i] == task) {
+            parent = i;
+            break;
+        }
+    }
+    uint8_t level = parent >= 0 ? s_records[parent].level : 0;
+    uint8_t flags = parent >= 0 ? s_records[parent].flags : 0;
+    portEXIT_CRITICAL_SAFE(&s_records_lock);
 
-        // PRE_KRENEL_2 pair
-        _drvfx_init_PRE_KERNEL_2_start,
-        _drvfx_init_PRE_KERNEL_2_end,
+    if (parent < 0) {
+        return; // Not inside an init entry
+    }
+    init_record_end(init_record_add(name, level, flags, (int16_t)parent, start_us), rc);
+}
+
+size_t k_init_get_records(const struct drvfx_init_record** records)
+{
+    *records = s_records;
+    return s_record_count;
+}
+
+#endif // CONFIG_DRVFX_INIT_PROFILING
+
+static const char* init_entry_name(const struct drvfx_init_entry* entry)
+{
+    return entry->dev != NULL ? entry->dev->name : entry->name;
+}
 
-        // POST_KERNEL pair
-        _drvfx_init_POST_KERNEL_start,
-        _drvfx_init_POST_KERNEL_end,
+static int init_entry_run(const struct drvfx_init_entry* entry, int level)
+{
+    const struct drvfx_device* dev = entry->dev;
+#if CONFIG_DRVFX_INIT_PROFILING
+    // Added before it runs, so the entry is listed ahead of its steps
+    int record = init_record_add(init_entry_name(entry), (uint8_t)level, entry->flags, -1, esp_timer_get_time());
+#endif
+    int rc = entry->init(dev);
+#if CONFIG_DRVFX_INIT_PROFILING
+    init_record_end(record, rc);
+#endif
 
-        // APPLICATION pair
-        _drvfx_init_APPLICATION_start,
-        _drvfx_init_APPLICATION_end,
-    };
+    if (dev != NULL) {
+        /* Mark device initialized.  If initialization
+         * failed, record the error condition.
+         */
+        if (rc != 0) {
+            dev->state->init_res = rc;
+            ESP_LOGE(TAG, "Failed to initialize: %s", dev->name);
+        }
+        dev->state->initialized = true;
+    }
+    return rc;
+}
 
+static void drvfx_sys_init_run_level(int level)
+{
     int pos = level * 2;
-    for (const struct drvfx_init_entry* entry = levels[pos]; entry != levels[pos + 1]; entry++) {
-        const struct drvfx_device* dev = entry->dev;
-        int rc = entry->init(dev);
-
-        if (dev != NULL) {
-            /* Mark device initialized.  If initialization
-             * failed, record the error condition.
-             */
-            if (rc != 0) {
-                dev->state->init_res = rc;
-                ESP_LOGE(TAG, "Failed to initialize: %s", dev->name);
+    for (const struct drvfx_init_entry* entry = s_levels[pos]; entry != s_levels[pos + 1]; entry++) {
+        init_entry_run(entry, level);
+    }
+}
+
+static bool init_entry_exists_before(int level, const char* name)
+{
+    for (int l = 0; l < level; l++) {
+        for (const struct drvfx_init_entry* entry = s_levels[l * 2]; entry != s_levels[l * 2 + 1]; entry++) {
+            if (strcmp(init_entry_name(entry), name) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static struct init_job* init_job_find(const char* name)
+{
+    for (size_t i = 0; i < s_job_count; i++) {
+        if (strcmp(init_entry_name(s_jobs[i].entry), name) == 0) {
+            return &s_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+static bool init_job_is_serial(const struct init_job* job)
+{
+    return !(job->entry->flags & (DRVFX_INIT_FLAG_ASYNC | DRVFX_INIT_FLAG_DEFERRED));
+}
+
+/**
+ * @brief Returns the serial entry the main task runs before it gets to `job`, NULL if there is none.
+ *
+ * A serial entry starts once that one has finished, and an async one is only spawned then, so it is what `job`
+ * implicitly waits for.
+ */
+static struct init_job* init_job_started_after(const struct init_job* job)
+{
+    if (job->entry->flags & DRVFX_INIT_FLAG_DEFERRED) {
+        return NULL;
+    }
+    for (struct init_job* prev = (struct init_job*)job - 1; prev >= s_jobs; prev--) {
+        if (init_job_is_serial(prev)) {
+            return prev;
+        }
+    }
+    return NULL;
+}
+
+static bool init_job_find_cycle(struct init_job* job);
+
+static bool init_job_follow(struct init_job* from, struct init_job* to, bool explicit_dep)
+{
+    from->next = to;
+    from->next_explicit = explicit_dep;
+    if (to->visit == INIT_VISIT_ACTIVE) {
+        // Only the declared dependencies can be dropped, the implicit edges are the order the main task runs in
+        for (struct init_job* job = to;; job = job->next) {
+            if (job->next_explicit) {
+                job->deadlocked = true;
+                ESP_LOGE(TAG, "`%s` waits for `%s` in a dependency cycle", init_entry_name(job->entry),
+                         init_entry_name(job->next->entry));
             }
-            dev->state->initialized = true;
+            if (job == from) {
+                break;
+            }
+        }
+        return true;
+    }
+    return to->visit == INIT_VISIT_NONE && init_job_find_cycle(to);
+}
+
+static bool init_job_find_cycle(struct init_job* job)
+{
+    job->visit = INIT_VISIT_ACTIVE;
+    if (!job->deadlocked) {
+        struct init_job* prev = init_job_started_after(job);
+        if (prev != NULL && init_job_follow(job, prev, false)) {
+            return true;
+        }
+        const char* const* deps = job->entry->deps;
+        for (size_t i = 0; deps != NULL && deps[i] != NULL; i++) {
+            struct init_job* dep = init_job_find(deps[i]);
+            // Waits for a deferred entry are refused by `init_job_wait_deps()` rather than followed
+            bool refused = dep != NULL && (dep->entry->flags & DRVFX_INIT_FLAG_DEFERRED)
+                           && !(job->entry->flags & DRVFX_INIT_FLAG_DEFERRED);
+            if (dep != NULL && !refused && init_job_follow(job, dep, true)) {
+                return true;
+            }
+        }
+    }
+    job->visit = INIT_VISIT_DONE;
+    return false;
+}
+
+/**
+ * @brief Marks the entries whose dependencies would wait forever, before any of them starts.
+ *
+ * Each search marks at least one more entry, as a cycle made of implicit edges alone cannot exist: those always
+ * point to an earlier entry.
+ */
+static void init_jobs_break_cycles()
+{
+    bool found;
+    do {
+        found = false;
+        for (size_t i = 0; i < s_job_count; i++) {
+            s_jobs[i].visit = INIT_VISIT_NONE;
+        }
+        for (size_t i = 0; i < s_job_count && !found; i++) {
+            if (s_jobs[i].visit == INIT_VISIT_NONE) {
+                found = init_job_find_cycle(&s_jobs[i]);
+            }
+        }
+    } while (found);
+
+    // Dependents see them failed straight away
+    for (size_t i = 0; i < s_job_count; i++) {
+        if (s_jobs[i].deadlocked) {
+            s_jobs[i].rc = -EDEADLK;
+            xSemaphoreGive(s_jobs[i].done);
+        }
+    }
+}
+
+static int init_job_wait_deps(const struct init_job* job)
+{
+    const char* name = init_entry_name(job->entry);
+    const char* const* deps = job->entry->deps;
+
+    for (size_t i = 0; deps != NULL && deps[i] != NULL; i++) {
+        struct init_job* dep = init_job_find(deps[i]);
+        if (dep == NULL) {
+            if (init_entry_exists_before(DRVFX_INIT_LEVEL_APPLICATION, deps[i])) {
+                continue;
+            }
+            ESP_LOGE(TAG, "`%s` depends on `%s`, which does not exist", name, deps[i]);
+            return -ENOENT;
+        }
+
+        // The deferred entries only start once the level has ended, the cycles are broken by `init_jobs_break_cycles()`
+        bool dep_deferred = dep->entry->flags & DRVFX_INIT_FLAG_DEFERRED;
+        if (dep_deferred && !(job->entry->flags & DRVFX_INIT_FLAG_DEFERRED)) {
+            ESP_LOGE(TAG, "`%s` cannot wait for `%s`, it would never finish", name, deps[i]);
+            return -EDEADLK;
+        }
+
+        xSemaphoreTake(dep->done, portMAX_DELAY);
+        xSemaphoreGive(dep->done);
+        if (dep->rc != 0) {
+            ESP_LOGE(TAG, "Skipping `%s`, its dependency `%s` failed (%d)", name, deps[i], dep->rc);
+            return -ENODEV;
+        }
+    }
+    return 0;
+}
+
+static void init_job_run(struct init_job* job)
+{
+    int rc = init_job_wait_deps(job);
+    if (rc == 0) {
+        rc = init_entry_run(job->entry, DRVFX_INIT_LEVEL_APPLICATION);
+    }
+    job->rc = rc;
+    xSemaphoreGive(job->done);
+}
+
+static void init_worker_task(void* params)
+{
+    init_job_run((struct init_job*)params);
+    vTaskDelete(NULL);
+}
+
+static void init_job_spawn(struct init_job* job)
+{
+    // Same priority as the main task, the entries were written to run there
+    if (xTaskCreate(&init_worker_task, init_entry_name(job->entry), CONFIG_DRVFX_INIT_TASK_STACK_SIZE, job,
+                    uxTaskPriorityGet(NULL), NULL)
+        != pdPASS) {
+        ESP_LOGW(TAG, "Failed to create the worker of `%s`, running it here", init_entry_name(job->entry));
+        init_job_run(job);
+    }
+}
+
+static void drvfx_app_init_run()
+{
+    const struct drvfx_init_entry* begin = s_levels[DRVFX_INIT_LEVEL_APPLICATION * 2];
+    const struct drvfx_init_entry* end = s_levels[DRVFX_INIT_LEVEL_APPLICATION * 2 + 1];
+    size_t count = end - begin;
+
+    s_jobs = calloc(count, sizeof(struct init_job));
+    if (s_jobs == NULL && count > 0) {
+        ESP_LOGE(TAG, "Out of memory, running the application entries serially");
+        drvfx_sys_init_run_level(DRVFX_INIT_LEVEL_APPLICATION);
+        return;
+    }
+    s_job_count = count;
+    for (size_t i = 0; i < count; i++) {
+        s_jobs[i].entry = &begin[i];
+        s_jobs[i].done = xSemaphoreCreateBinaryStatic(&s_jobs[i].done_buffer);
+    }
+    init_jobs_break_cycles();
+
+    for (size_t i = 0; i < count; i++) {
+        struct init_job* job = &s_jobs[i];
+        if (job->deadlocked || (job->entry->flags & DRVFX_INIT_FLAG_DEFERRED)) {
+            continue;
+        }
+        if (job->entry->flags & DRVFX_INIT_FLAG_ASYNC) {
+            init_job_spawn(job);
+        }
+        else {
+            init_job_run(job);
+        }
+    }
+
+    // The level ends with its async entries
+    for (size_t i = 0; i < count; i++) {
+        struct init_job* job = &s_jobs[i];
+        if ((job->entry->flags & DRVFX_INIT_FLAG_ASYNC) && !(job->entry->flags & DRVFX_INIT_FLAG_DEFERRED)) {
+            xSemaphoreTake(job->done, portMAX_DELAY);
+            xSemaphoreGive(job->done);
+        }
+    }
+}
+
+static void drvfx_app_deferred_start()
+{
+    for (size_t i = 0; i < s_job_count; i++) {
+        if (!s_jobs[i].deadlocked && (s_jobs[i].entry->flags & DRVFX_INIT_FLAG_DEFERRED)) {
+            init_job_spawn(&s_jobs[i]);
         }
     }
 }
@@ -74,6 +415,7 @@ static void __attribute__((constructor, used)) drvfx_kernel_init()
 {
     ESP_LOGI(TAG, "Drvfx initializing...");
     k_init();
+    k_device_init();
 
     drvfx_sys_init_run_level(DRVFX_INIT_LEVEL_EARLY);
     drvfx_sys_init_run_level(DRVFX_INIT_LEVEL_PRE_KERNEL_1);
@@ -95,9 +437,10 @@ void __attribute__((weak)) drvfx_app_main()
 void app_main()
 {
     ESP_LOGI(TAG, "User land initializing...");
-    drvfx_sys_init_run_level(DRVFX_INIT_LEVEL_APPLICATION);
+    drvfx_app_init_run();
 
     k_ready();
+    drvfx_app_deferred_start();
     ESP_LOGI(TAG, "Main thread initialized.");
     drvfx_app_main();
 }
\ No newline at end of file
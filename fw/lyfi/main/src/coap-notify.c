@@ -41,6 +41,16 @@ static void led_event_handler(void* arg, esp_event_base_t event_base, int32_t ev
         BO_MUST(bo_coap_notify_resource_changed(&uri));
     } break;
 
+    case LYFI_EVENT_LED_COLOR_CHANGED: {
+        coap_str_const_t uri
+            = { .s = (const uint8_t*)LYFI_COAP_PATH_LED_COLOR, .length = sizeof(LYFI_COAP_PATH_LED_COLOR) - 1 };
+        // Dropping a color notification is harmless, the next change carries the full color again
+        int rc = bo_coap_notify_resource_changed(&uri);
+        if (rc) {
+            ESP_LOGW(TAG, "Failed to queue color notification, errcode=%d", rc);
+        }
+    } break;
+
     default:
         break;
     }
@@ -53,4 +63,4 @@ int _coap_notify_init()
     return 0;
 }
 
-DRVFX_SYS_INIT(_coap_notify_init, APPLICATION, DRVFX_INIT_APP_DEFAULT_PRIORITY);
\ No newline at end of file
+DRVFX_SYS_INIT_ASYNC(_coap_notify_init, DRVFX_INIT_APP_DEFAULT_PRIORITY, DRVFX_INIT_DEPS("_coap_init"));
\ No newline at end of file
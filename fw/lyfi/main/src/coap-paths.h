@@ -5,6 +5,9 @@ extern "C" {
 #endif
 
 #define LYFI_COAP_PATH_LED_STATE "borneo/lyfi/state"
+#define LYFI_COAP_PATH_LED_COLOR "borneo/lyfi/color"
+#define LYFI_COAP_PATH_LED_COLOR_STREAM "borneo/lyfi/color/stream"
+#define LYFI_COAP_PATH_LED_GROUP_COMMAND "borneo/lyfi/group/command"
 #define LYFI_COAP_PATH_LED_MODE "borneo/lyfi/mode"
 #define LYFI_COAP_PATH_TEMPERATURE "borneo/lyfi/temperature"
 #define LYFI_COAP_PATH_MOON "borneo/lyfi/moon"
@@ -12,6 +12,7 @@
 
 #include <borneo/system.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 #include <borneo/rtc.h>
 
 #include "../led/led.h"
@@ -22,17 +23,7 @@
 static void coap_hnd_acclimation_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                      const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_acclimation_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_acclimation_get, NULL);
 }
 
 static void coap_hnd_acclimation_post(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -62,4 +53,5 @@ static void coap_hnd_acclimation_delete(coap_resource_t* resource, coap_session_
 }
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/acclimation", false, coap_hnd_acclimation_get, coap_hnd_acclimation_post, NULL,
-                     coap_hnd_acclimation_delete);
\ No newline at end of file
+                     coap_hnd_acclimation_delete);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/acclimation", bo_rpc_borneo_lyfi_acclimation_get);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include <esp_system.h>
+#include <esp_event.h>
+#include <esp_log.h>
+#include <sys/socket.h>
+
+#include <coap3/coap.h>
+#include <cbor.h>
+
+#include <borneo/common.h>
+#include <borneo/system.h>
+#include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
+
+#include "../energy.h"
+#include "../rpc/rpc.h"
+
+#define TAG "lyfi-energy-coap"
+
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+
+static void coap_hnd_energy_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_energy_get, NULL);
+}
+
+static void coap_hnd_energy_delete(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                   const coap_string_t* query, coap_pdu_t* response)
+{
+    BO_COAP_TRY(bo_rpc_borneo_lyfi_energy_delete(NULL, NULL), response);
+
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_DELETED);
+}
+
+COAP_RESOURCE_DEFINE("borneo/lyfi/energy", false, coap_hnd_energy_get, NULL, NULL, coap_hnd_energy_delete);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/energy", bo_rpc_borneo_lyfi_energy_get);
+
+#endif // CONFIG_LYFI_ENERGY_METER_ENABLED
@@ -11,6 +11,7 @@
 
 #include <borneo/common.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 
 #include "../fan.h"
 #include "../rpc/rpc.h"
@@ -20,16 +21,7 @@
 static void _coap_hnd_fan_power_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                     const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_fan_power_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_fan_power_get, NULL);
 }
 
 static void _coap_hnd_fan_power_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -56,4 +48,5 @@ static void _coap_hnd_fan_power_put(coap_resource_t* resource, coap_session_t* s
     return;
 }
 
-COAP_RESOURCE_DEFINE("borneo/lyfi/fan/power", false, _coap_hnd_fan_power_get, NULL, _coap_hnd_fan_power_put, NULL);
\ No newline at end of file
+COAP_RESOURCE_DEFINE("borneo/lyfi/fan/power", false, _coap_hnd_fan_power_get, NULL, _coap_hnd_fan_power_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/fan/power", bo_rpc_borneo_lyfi_fan_power_get);
\ No newline at end of file
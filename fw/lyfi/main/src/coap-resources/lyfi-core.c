@@ -12,6 +12,7 @@
 
 #include <borneo/system.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 #include <borneo/rtc.h>
 
 #include "../led/led.h"
@@ -22,20 +23,36 @@
 
 #define TAG "lyfi-coap"
 
-static void coap_hnd_color_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
-                               const coap_string_t* query, coap_pdu_t* response)
+/**
+ * @brief Packs the color as big-endian 16-bit brightness values, one per channel.
+ *
+ * Used for observe notifications: fixed width, no CBOR encoding on every slider step.
+ */
+static void coap_hnd_color_get_packed(const coap_pdu_t* request, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    led_color_t color;
+    BO_COAP_TRY(led_get_color(color), response);
 
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_color_get(NULL, &encoder), response);
+    uint8_t buf[sizeof(led_color_t)];
+    for (size_t ch = 0; ch < CONFIG_LYFI_LED_CHANNEL_COUNT; ch++) {
+        buf[ch * 2] = (uint8_t)(color[ch] >> 8);
+        buf[ch * 2 + 1] = (uint8_t)(color[ch] & 0xFF);
+    }
 
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
+    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_OCTET_STREAM, 0, sizeof(buf), buf);
+}
 
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+static void coap_hnd_color_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                               const coap_string_t* query, coap_pdu_t* response)
+{
+    // Observers get the packed form; plain GETs keep the CBOR array for compatibility
+    coap_opt_iterator_t opt_iter;
+    if (coap_check_option(request, COAP_OPTION_OBSERVE, &opt_iter) != NULL) {
+        coap_hnd_color_get_packed(request, response);
+        return;
+    }
+
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_color_get, NULL);
 }
 
 static void coap_hnd_color_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -44,8 +61,6 @@ static void coap_hnd_color_put(coap_resource_t* resource, coap_session_t* sessio
     size_t data_size;
     const uint8_t* data;
 
-    coap_resource_notify_observers(resource, NULL);
-
     coap_get_data(request, &data_size, &data);
 
     CborParser parser;
@@ -56,20 +71,79 @@ static void coap_hnd_color_put(coap_resource_t* resource, coap_session_t* sessio
     coap_pdu_set_code(response, BO_COAP_CODE_204_CHANGED);
 }
 
-static void coap_hnd_schedule_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
-                                  const coap_string_t* query, coap_pdu_t* response)
+static void coap_hnd_color_stream_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                      const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_color_stream_get, NULL);
+}
+
+/**
+ * @brief Streaming color set, meant to be sent NON-confirmable with `No-Response`.
+ *
+ * Payload: a big-endian 32-bit sequence number followed by one big-endian 16-bit brightness per channel, the same
+ * packed layout the color observers receive. Stale frames are acknowledged as well, so a client never retries them.
+ */
+static void coap_hnd_color_stream_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                      const coap_string_t* query, coap_pdu_t* response)
+{
+    size_t data_size;
+    const uint8_t* data;
+
+    coap_get_data(request, &data_size, &data);
+    BO_COAP_REQUIRES(data_size == sizeof(uint32_t) + sizeof(led_color_t), response);
+
+    uint32_t seq = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    led_color_t color;
+    for (size_t ch = 0; ch < CONFIG_LYFI_LED_CHANNEL_COUNT; ch++) {
+        const uint8_t* p = &data[sizeof(uint32_t) + ch * 2];
+        color[ch] = (led_brightness_t)(((uint16_t)p[0] << 8) | p[1]);
+    }
+
+    int rc = led_stream_color(seq, color);
+    if (rc != -EAGAIN) {
+        BO_COAP_TRY(rc, response);
+    }
+
+    coap_pdu_set_code(response, BO_COAP_CODE_204_CHANGED);
+}
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+/**
+ * @brief Synchronized scene change, meant to be sent to the multicast group address.
+ *
+ * Devices outside the addressed group answer 4.04, which libcoap never sends back for a multicast request.
+ */
+static void coap_hnd_group_command_post(coap_resource_t* resource, coap_session_t* session,
+                                        const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
+    size_t data_size;
+    const uint8_t* data;
+    coap_get_data(request, &data_size, &data);
 
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    CborParser parser;
+    CborValue value;
+    BO_COAP_TRY(cbor_parser_init(data, data_size, 0, &parser, &value), response);
+
+    int rc = bo_rpc_borneo_lyfi_group_command_post(&value, NULL);
+    if (rc == -ENOENT) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE(404));
+        return;
+    }
+    BO_COAP_TRY(rc, response);
 
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_schedule_get(NULL, &encoder), response);
+    coap_pdu_set_code(response, BO_COAP_CODE_204_CHANGED);
+}
 
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
 
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+static void coap_hnd_schedule_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                  const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response,
+                         bo_coap_query_has(query, BO_COAP_QUERY_COMPACT) ? bo_rpc_borneo_lyfi_schedule_get_compact
+                                                                         : bo_rpc_borneo_lyfi_schedule_get,
+                         NULL);
 }
 
 static void coap_hnd_schedule_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -91,72 +165,49 @@ static void coap_hnd_schedule_put(coap_resource_t* resource, coap_session_t* ses
     coap_pdu_set_code(response, BO_COAP_CODE_204_CHANGED);
 }
 
+// The channel layout comes from the factory settings and only changes across reboots
+static uint32_t lyfi_info_generation() { return 0; }
+
 static void coap_hnd_info_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                               const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_info_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response,
+                         bo_coap_query_has(query, BO_COAP_QUERY_COMPACT) ? bo_rpc_borneo_lyfi_info_get_compact
+                                                                         : bo_rpc_borneo_lyfi_info_get,
+                         NULL);
 }
 
 static void coap_hnd_status_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                 const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_status_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response,
+                         bo_coap_query_has(query, BO_COAP_QUERY_COMPACT) ? bo_rpc_borneo_lyfi_status_get_compact
+                                                                         : bo_rpc_borneo_lyfi_status_get,
+                         NULL);
 }
 
 static void coap_hnd_temp_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                               const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128] = { 0 };
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_temp_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_temp_get, NULL);
+}
 
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+static void coap_hnd_channel_current_get(coap_resource_t* resource, coap_session_t* session,
+                                         const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_channel_current_get, NULL);
+}
 
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+static void coap_hnd_channel_aging_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
+                                       const coap_string_t* query, coap_pdu_t* response)
+{
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_channel_aging_get, NULL);
 }
 
 static void coap_hnd_state_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-
-    uint8_t buf[128];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_state_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_state_get, NULL);
 }
 
 static void coap_hnd_state_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -179,17 +230,7 @@ static void coap_hnd_state_put(coap_resource_t* resource, coap_session_t* sessio
 static void coap_hnd_correction_method_get(coap_resource_t* resource, coap_session_t* session,
                                            const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_correction_method_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_correction_method_get, NULL);
 }
 
 static void coap_hnd_correction_method_put(coap_resource_t* resource, coap_session_t* session,
@@ -212,16 +253,7 @@ static void coap_hnd_correction_method_put(coap_resource_t* resource, coap_sessi
 static void coap_hnd_mode_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                               const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_mode_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_mode_get, NULL);
 }
 
 static void coap_hnd_mode_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -243,16 +275,7 @@ static void coap_hnd_mode_put(coap_resource_t* resource, coap_session_t* session
 static void coap_hnd_temporary_duration_get(coap_resource_t* resource, coap_session_t* session,
                                             const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[32];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_temporary_duration_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_temporary_duration_get, NULL);
 }
 
 static void coap_hnd_temporary_duration_put(coap_resource_t* resource, coap_session_t* session,
@@ -274,17 +297,7 @@ static void coap_hnd_temporary_duration_put(coap_resource_t* resource, coap_sess
 static void coap_hnd_geo_location_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                       const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[128];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_geo_location_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_geo_location_get, NULL);
 }
 
 static void coap_hnd_geo_location_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -307,17 +320,7 @@ static void coap_hnd_geo_location_put(coap_resource_t* resource, coap_session_t*
 static void coap_hnd_tz_enabled_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                     const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[16];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_tz_enabled_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_tz_enabled_get, NULL);
 }
 
 static void coap_hnd_tz_enabled_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -340,17 +343,7 @@ static void coap_hnd_tz_enabled_put(coap_resource_t* resource, coap_session_t* s
 static void coap_hnd_tz_offset_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                    const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[16];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_tz_offset_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_tz_offset_get, NULL);
 }
 
 static void coap_hnd_tz_offset_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -373,17 +366,7 @@ static void coap_hnd_tz_offset_put(coap_resource_t* resource, coap_session_t* se
 static void coap_hnd_cloud_enabled_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                        const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[16];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_cloud_enabled_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_cloud_enabled_get, NULL);
 }
 
 static void coap_hnd_cloud_enabled_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -403,32 +386,63 @@ static void coap_hnd_cloud_enabled_put(coap_resource_t* resource, coap_session_t
     coap_pdu_set_code(response, BO_COAP_CODE_204_CHANGED);
 }
 
-COAP_RESOURCE_DEFINE("borneo/lyfi/color", false, coap_hnd_color_get, NULL, coap_hnd_color_put, NULL);
+COAP_RESOURCE_DEFINE(LYFI_COAP_PATH_LED_COLOR, true, coap_hnd_color_get, NULL, coap_hnd_color_put, NULL);
+BO_RPC_METHOD_DEFINE(LYFI_COAP_PATH_LED_COLOR, bo_rpc_borneo_lyfi_color_get);
+
+COAP_RESOURCE_DEFINE(LYFI_COAP_PATH_LED_COLOR_STREAM, false, coap_hnd_color_stream_get, NULL,
+                     coap_hnd_color_stream_put, NULL);
+BO_RPC_METHOD_DEFINE(LYFI_COAP_PATH_LED_COLOR_STREAM, bo_rpc_borneo_lyfi_color_stream_get);
+
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+COAP_RESOURCE_DEFINE(LYFI_COAP_PATH_LED_GROUP_COMMAND, false, NULL, coap_hnd_group_command_post, NULL, NULL);
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
 
-COAP_RESOURCE_DEFINE("borneo/lyfi/schedule", false, coap_hnd_schedule_get, NULL, coap_hnd_schedule_put, NULL);
+COAP_RESOURCE_DEFINE_VERSIONED("borneo/lyfi/schedule", led_get_settings_generation, coap_hnd_schedule_get, NULL,
+                               coap_hnd_schedule_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/schedule", bo_rpc_borneo_lyfi_schedule_get);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/schedule?compact", bo_rpc_borneo_lyfi_schedule_get_compact);
 
-COAP_RESOURCE_DEFINE("borneo/lyfi/info", false, coap_hnd_info_get, NULL, NULL, NULL);
+COAP_RESOURCE_DEFINE_VERSIONED("borneo/lyfi/info", lyfi_info_generation, coap_hnd_info_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/info", bo_rpc_borneo_lyfi_info_get);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/info?compact", bo_rpc_borneo_lyfi_info_get_compact);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/status", false, coap_hnd_status_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/status", bo_rpc_borneo_lyfi_status_get);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/status?compact", bo_rpc_borneo_lyfi_status_get_compact);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/temperature", true, coap_hnd_temp_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/temperature", bo_rpc_borneo_lyfi_temp_get);
+
+COAP_RESOURCE_DEFINE("borneo/lyfi/channels/current", false, coap_hnd_channel_current_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/channels/current", bo_rpc_borneo_lyfi_channel_current_get);
+
+COAP_RESOURCE_DEFINE("borneo/lyfi/channels/aging", false, coap_hnd_channel_aging_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/channels/aging", bo_rpc_borneo_lyfi_channel_aging_get);
 
 COAP_RESOURCE_DEFINE(LYFI_COAP_PATH_LED_STATE, true, coap_hnd_state_get, NULL, coap_hnd_state_put, NULL);
+BO_RPC_METHOD_DEFINE(LYFI_COAP_PATH_LED_STATE, bo_rpc_borneo_lyfi_state_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/correction-method", false, coap_hnd_correction_method_get, NULL,
                      coap_hnd_correction_method_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/correction-method", bo_rpc_borneo_lyfi_correction_method_get);
 
 COAP_RESOURCE_DEFINE(LYFI_COAP_PATH_LED_MODE, true, coap_hnd_mode_get, NULL, coap_hnd_mode_put, NULL);
+BO_RPC_METHOD_DEFINE(LYFI_COAP_PATH_LED_MODE, bo_rpc_borneo_lyfi_mode_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/temporary-duration", false, coap_hnd_temporary_duration_get, NULL,
                      coap_hnd_temporary_duration_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/temporary-duration", bo_rpc_borneo_lyfi_temporary_duration_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/geo-location", false, coap_hnd_geo_location_get, NULL, coap_hnd_geo_location_put,
                      NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/geo-location", bo_rpc_borneo_lyfi_geo_location_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/tz/enabled", false, coap_hnd_tz_enabled_get, NULL, coap_hnd_tz_enabled_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/tz/enabled", bo_rpc_borneo_lyfi_tz_enabled_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/tz/offset", false, coap_hnd_tz_offset_get, NULL, coap_hnd_tz_offset_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/tz/offset", bo_rpc_borneo_lyfi_tz_offset_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/cloud/enabled", false, coap_hnd_cloud_enabled_get, NULL, coap_hnd_cloud_enabled_put,
                      NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/cloud/enabled", bo_rpc_borneo_lyfi_cloud_enabled_get);
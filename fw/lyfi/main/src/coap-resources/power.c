@@ -10,6 +10,7 @@
 #include <borneo/common.h>
 #include <borneo/system.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 #include <borneo/power.h>
 #include "../rpc/rpc.h"
 
@@ -19,17 +20,8 @@
 static void coap_hnd_power_meas_power_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                           const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[32] = { 0 };
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-    BO_COAP_TRY(bo_rpc_lyfi_power_mw_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    return;
+    bo_coap_respond_cbor(request, response, bo_rpc_lyfi_power_mw_get, NULL);
 }
 COAP_RESOURCE_DEFINE("lyfi/power/meas/power", false, coap_hnd_power_meas_power_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("lyfi/power/meas/power", bo_rpc_lyfi_power_mw_get);
 #endif // CONFIG_BORNEO_MEAS_VOLTAGE_SUPPORT && CONFIG_LYFI_MEAS_CURRENT_SUPPORT
\ No newline at end of file
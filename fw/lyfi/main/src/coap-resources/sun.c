@@ -12,6 +12,7 @@
 
 #include <borneo/system.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 #include <borneo/rtc.h>
 
 #include "../led/led.h"
@@ -23,17 +24,7 @@
 static void coap_hnd_sun_schedule_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                       const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_sun_schedule_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_sun_schedule_get, NULL);
 }
 
 static void coap_hnd_sun_curve_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -65,5 +56,6 @@ static void coap_hnd_sun_curve_get(coap_resource_t* resource, coap_session_t* se
 }
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/sun/schedule", false, coap_hnd_sun_schedule_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/sun/schedule", bo_rpc_borneo_lyfi_sun_schedule_get);
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/sun/curve", false, coap_hnd_sun_curve_get, NULL, NULL, NULL);
\ No newline at end of file
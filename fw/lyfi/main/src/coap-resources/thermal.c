@@ -8,6 +8,7 @@
 
 #include <borneo/common.h>
 #include <borneo/coap.h>
+#include <borneo/rpc/registry.h>
 #include "../thermal.h"
 #include "../protect.h"
 #include "../rpc/rpc.h"
@@ -39,50 +40,19 @@ static void _coap_hnd_thermal_current_temp_get(coap_resource_t* resource, coap_s
 static void _coap_hnd_thermal_keep_temp_get(coap_resource_t* resource, coap_session_t* session,
                                             const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-    uint8_t buf[32];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_thermal_keep_temp_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_thermal_keep_temp_get, NULL);
 }
 
 static void _coap_hnd_thermal_settings_get(coap_resource_t* resource, coap_session_t* session,
                                            const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response)
 {
-    size_t encoded_size = 0;
-    uint8_t buf[1024];
-
-    CborEncoder encoder;
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_thermal_settings_get(NULL, &encoder), response);
-
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_thermal_settings_get, NULL);
 }
 
 static void _coap_hnd_fan_mode_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                    const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-
-    uint8_t buf[64];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_thermal_fan_mode_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_thermal_fan_mode_get, NULL);
 }
 
 static void _coap_hnd_fan_mode_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -106,18 +76,7 @@ static void _coap_hnd_fan_mode_put(coap_resource_t* resource, coap_session_t* se
 static void _coap_hnd_manual_fan_get(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
                                      const coap_string_t* query, coap_pdu_t* response)
 {
-    CborEncoder encoder;
-    size_t encoded_size = 0;
-
-    uint8_t buf[32];
-
-    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
-
-    BO_COAP_TRY(bo_rpc_borneo_lyfi_thermal_manual_fan_get(NULL, &encoder), response);
-    encoded_size = cbor_encoder_get_buffer_size(&encoder, buf);
-
-    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0, encoded_size, buf);
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    bo_coap_respond_cbor(request, response, bo_rpc_borneo_lyfi_thermal_manual_fan_get, NULL);
 }
 
 static void _coap_hnd_manual_fan_put(coap_resource_t* resource, coap_session_t* session, const coap_pdu_t* request,
@@ -140,9 +99,13 @@ static void _coap_hnd_manual_fan_put(coap_resource_t* resource, coap_session_t*
 
 COAP_RESOURCE_DEFINE("borneo/lyfi/thermal/temp/current", true, _coap_hnd_thermal_current_temp_get, NULL, NULL, NULL);
 COAP_RESOURCE_DEFINE("borneo/lyfi/thermal/temp/keep", false, _coap_hnd_thermal_keep_temp_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/thermal/temp/keep", bo_rpc_borneo_lyfi_thermal_keep_temp_get);
 COAP_RESOURCE_DEFINE("borneo/lyfi/thermal/settings", false, _coap_hnd_thermal_settings_get, NULL, NULL, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/thermal/settings", bo_rpc_borneo_lyfi_thermal_settings_get);
 COAP_RESOURCE_DEFINE("borneo/lyfi/thermal/fan/mode", false, _coap_hnd_fan_mode_get, NULL, _coap_hnd_fan_mode_put, NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/thermal/fan/mode", bo_rpc_borneo_lyfi_thermal_fan_mode_get);
 COAP_RESOURCE_DEFINE("borneo/lyfi/thermal/fan/manual", false, _coap_hnd_manual_fan_get, NULL, _coap_hnd_manual_fan_put,
                      NULL);
+BO_RPC_METHOD_DEFINE("borneo/lyfi/thermal/fan/manual", bo_rpc_borneo_lyfi_thermal_manual_fan_get);
 
 #endif // CONFIG_LYFI_THERMAL_ENABLED
\ No newline at end of file
@@ -22,6 +22,13 @@ __SYSCALL int fpwm_set_duty(const struct drvfx_device* dev, uint8_t duty)
     return api->set_duty(dev, duty);
 }
 
+#if CONFIG_LYFI_FAN_CTRL_PWM_DEVICE_RMTPWM
+DRVFX_DEVICE_DECLARE(fpwm);
+#define FPWM_DEVICE DRVFX_DEVICE_GET(fpwm)
+#else
+#define FPWM_DEVICE NULL ///< The selected PWM fan device has no driver
+#endif
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
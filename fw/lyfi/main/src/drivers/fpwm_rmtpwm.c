@@ -69,6 +69,7 @@ const static struct fpwm_driver_api s_api = {
 
 static rmtpwm_generator_t s_rmtpwm = { 0 };
 
-DRVFX_DEVICE_DEFINE("fpwm", _fpwm_init, &s_rmtpwm, NULL, DRVFX_INIT_POST_KERNEL_DEFAULT_PRIORITY, &s_api);
+DRVFX_NAMED_DEVICE_DEFINE(fpwm, "fpwm", _fpwm_init, &s_rmtpwm, NULL, DRVFX_INIT_POST_KERNEL_DEFAULT_PRIORITY,
+                          &s_api);
 
 #endif // CONFIG_LYFI_FAN_CTRL_PWM_DEVICE_RMTPWM
\ No newline at end of file
@@ -41,7 +41,8 @@
 struct sensor_current_data {
     const struct drvfx_device* adc_dev;
     int32_t current_ma;
-    int32_t filtered_current;
+    struct median_filter median;
+    struct ema_filter ema;
 };
 
 struct power_meas_factory_settings {
@@ -93,7 +94,7 @@ static int _fetch_sample(const struct drvfx_device* dev)
         adc_mv = 0;
     }
     int32_t raw_ma = (adc_mv * 1000 + (CONFIG_LYFI_MEAS_CURRENT_FACTOR / 2)) / CONFIG_LYFI_MEAS_CURRENT_FACTOR;
-    data->current_ma = ema_filter(raw_ma, &data->filtered_current, 1, 10);
+    data->current_ma = ema_filter_update(&data->ema, median_filter_update(&data->median, raw_ma));
     return 0;
 }
 
@@ -127,6 +128,9 @@ static int sensor_current_init(const struct drvfx_device* dev)
         ESP_LOGE(TAG, "Failed to get device 'adc'");
     }
 
+    BO_TRY(median_filter_init(&data->median, BO_ADC_WINDOW_SIZE));
+    BO_TRY(ema_filter_init(&data->ema, 1, 10));
+
     BO_TRY(_fetch_sample(dev));
 
     return 0;
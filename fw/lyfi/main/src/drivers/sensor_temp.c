@@ -26,11 +26,12 @@
 
 struct ntc_data {
     const struct drvfx_device* adc_dev;
-    int8_t temp_value;
-    int32_t filtered_temp;
+    int32_t temp_value; ///< Filtered temperature in 0.1 ℃
+    struct median_filter median;
+    struct ema_filter ema;
 };
 
-static int8_t ntc_table_lookup(int r);
+static int32_t ntc_table_interpolate(int32_t value);
 
 #define NTC_SAMPLING_TIMES 8
 #define NTC_TEMP_BUF_SIZE 16
@@ -39,7 +40,7 @@ static int8_t ntc_table_lookup(int r);
 
 enum {
     NTC_SAMPLING_INTERVAL = 100,
-    NTC_BAD_TEMPERATURE = -127,
+    NTC_BAD_TEMPERATURE = -127 * SENSOR_TEMP_SCALE,
 };
 
 // clang-format off
@@ -86,35 +87,41 @@ enum {
     NTC_MAPPING_TABLE_SIZE = sizeof(NTC_MAPPING_TABLE) / sizeof(NTC_MAPPING_TABLE[0]),
 };
 
-static int8_t ntc_table_lookup(int value)
+/**
+ * @brief Converts the NTC divider voltage to temperature in 0.1 ℃.
+ *
+ * The table holds one entry per whole degree in descending voltage order, so the result is linearly interpolated
+ * between the two neighbouring entries. A voltage above the first entry means the NTC is open or disconnected and
+ * yields `NTC_BAD_TEMPERATURE`, a voltage below the last entry is clamped to its last degree.
+ */
+static int32_t ntc_table_interpolate(int32_t value)
 {
+    if (value > NTC_MAPPING_TABLE[0]) {
+        return NTC_BAD_TEMPERATURE;
+    }
+    if (value == NTC_MAPPING_TABLE[0]) {
+        return 0;
+    }
+    if (value <= NTC_MAPPING_TABLE[NTC_MAPPING_TABLE_SIZE - 1]) {
+        return (NTC_MAPPING_TABLE_SIZE - 1) * SENSOR_TEMP_SCALE;
+    }
 
+    // Invariant: NTC_MAPPING_TABLE[left] > value >= NTC_MAPPING_TABLE[right]
     int left = 0;
     int right = NTC_MAPPING_TABLE_SIZE - 1;
-    int closest_index = NTC_BAD_TEMPERATURE;
-    int min_diff = abs(NTC_MAPPING_TABLE[0] - value);
-
-    while (left <= right) {
+    while (right - left > 1) {
         int mid = left + (right - left) / 2;
-        int difference = abs(NTC_MAPPING_TABLE[mid] - value);
-
-        if (difference < min_diff) {
-            min_diff = difference;
-            closest_index = mid;
-        }
-
-        if (NTC_MAPPING_TABLE[mid] == value) {
-            return mid;
-        }
-        else if (NTC_MAPPING_TABLE[mid] > value) {
-            left = mid + 1;
+        if (NTC_MAPPING_TABLE[mid] > value) {
+            left = mid;
         }
         else {
-            right = mid - 1;
+            right = mid;
         }
     }
 
-    return closest_index;
+    int32_t span = NTC_MAPPING_TABLE[left] - NTC_MAPPING_TABLE[right];
+    int32_t frac = ((NTC_MAPPING_TABLE[left] - value) * SENSOR_TEMP_SCALE + (span / 2)) / span;
+    return left * SENSOR_TEMP_SCALE + frac;
 }
 
 static int _fetch_sample(const struct drvfx_device* dev)
@@ -134,12 +141,12 @@ static int _fetch_sample(const struct drvfx_device* dev)
         return -EIO;
     }
 
-    int value = ntc_table_lookup(adc_mv);
+    int32_t value = ntc_table_interpolate(median_filter_update(&data->median, adc_mv));
     if (value == NTC_BAD_TEMPERATURE) {
         ESP_LOGE(TAG, "Bad temperature!");
         return -EIO;
     }
-    data->temp_value = (int8_t)ema_filter((int32_t)value, &data->filtered_temp, 1, 10);
+    data->temp_value = ema_filter_update(&data->ema, value);
     return 0;
 }
 
@@ -173,6 +180,9 @@ static int ntc_init(const struct drvfx_device* dev)
         ESP_LOGE(TAG, "Failed to get device 'adc'");
     }
 
+    BO_TRY(median_filter_init(&data->median, ADC_WINDOW_SIZE));
+    BO_TRY(ema_filter_init(&data->ema, 1, 10));
+
     BO_TRY(_fetch_sample(dev));
 
     return 0;
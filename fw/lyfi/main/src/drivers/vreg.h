@@ -19,6 +19,13 @@ __SYSCALL int vreg_set_output(const struct drvfx_device* dev, uint8_t percent)
     return api->set_output(dev, percent);
 }
 
+#if CONFIG_LYFI_FAN_CTRL_VREG_DEVICE_RMTPWM || CONFIG_LYFI_FAN_CTRL_VREG_DEVICE_DAC
+DRVFX_DEVICE_DECLARE(vreg);
+#define VREG_DEVICE DRVFX_DEVICE_GET(vreg)
+#else
+#define VREG_DEVICE NULL ///< The selected regulator device has no driver
+#endif
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -85,6 +85,7 @@ const static struct vreg_driver_api s_api = {
 
 static struct dac_data s_data = { 0 };
 
-DRVFX_DEVICE_DEFINE("vreg", _vreg_init, &s_data, NULL, DRVFX_INIT_POST_KERNEL_DEFAULT_PRIORITY, &s_api);
+DRVFX_NAMED_DEVICE_DEFINE(vreg, "vreg", _vreg_init, &s_data, NULL, DRVFX_INIT_POST_KERNEL_DEFAULT_PRIORITY,
+                          &s_api);
 
 #endif // CONFIG_LYFI_FAN_CTRL_VREG_DEVICE_DAC
\ No newline at end of file
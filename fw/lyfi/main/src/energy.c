@@ -0,0 +1,370 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <esp_system.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_event.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+
+#include <drvfx/drvfx.h>
+#include <borneo/system.h>
+#include <borneo/common.h>
+#include <borneo/devices/sensor.h>
+#include <borneo/nvs.h>
+
+#include "led/led.h"
+#include "energy.h"
+
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+
+/*
+ * Energy meter.
+ *
+ * The measured LED supply power is integrated once per second in nanojoule fixed point (mW * us), and only whole
+ * millijoules are moved into the counters so no energy is lost to rounding. The per-channel counters are a model:
+ * each sample of the measured power is split by the estimated channel currents, or by the duty cycles when no
+ * estimate is available.
+ *
+ * Lifetime counters go to NVS as a single blob, at most every `CONFIG_LYFI_ENERGY_FLUSH_INTERVAL` minutes and only
+ * when at least 1 mWh has accumulated, plus once on shutdown and reboot, when the system event handler wakes the task
+ * to sample and flush right away. The histograms stay in RAM.
+ */
+
+#define TAG "energy"
+
+#define TASK_PRIORITY 4
+#define ENERGY_SAMPLE_PERIOD_MS 1000
+#define ENERGY_MAX_SAMPLE_GAP_US (10 * 1000 * 1000) ///< Longer gaps are clamped, e.g. after a debugger halt
+
+#define ENERGY_NVS_NS "energy"
+#define ENERGY_NVS_KEY_RECORD "rec"
+#define ENERGY_RECORD_VERSION 1
+
+#define SECS_PER_HOUR 3600
+#define SECS_PER_DAY 86400
+#define NJ_PER_MJ 1000000ULL
+#define ENERGY_FLUSH_MIN_MJ ENERGY_MJ_PER_MWH ///< Do not spend a flash write on less than 1 mWh
+
+struct energy_record {
+    uint8_t version;
+    uint8_t channel_count;
+    uint16_t reserved;
+    uint64_t total_mj;
+    uint64_t channels_mj[CONFIG_LYFI_LED_CHANNEL_COUNT];
+};
+
+struct energy_meter {
+    struct energy_stats stats;
+    uint64_t hour_mj; ///< Energy of the current hour bucket
+    uint64_t day_mj; ///< Energy of the current day bucket
+    uint64_t total_nj; ///< Sub-millijoule residual of the total counter
+    uint64_t channels_nj[CONFIG_LYFI_LED_CHANNEL_COUNT];
+    uint64_t flushed_total_mj; ///< `total_mj` at the last NVS commit
+    bool reset_unsaved; ///< The cleared counters are not in NVS yet, write them even if nothing accumulated since
+    SemaphoreHandle_t save_lock; ///< Serializes NVS writes and the bookkeeping of `flushed_total_mj`
+    int64_t last_sample_us;
+    int64_t last_flush_us;
+    TaskHandle_t task;
+    const struct drvfx_device* power_dev;
+};
+
+static void energy_task();
+static void energy_sample();
+static void energy_roll_buckets(int64_t now);
+static int energy_load();
+static int energy_save(bool force);
+static int energy_write_record(struct energy_record* record);
+static void system_events_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
+
+static struct energy_meter _meter = { 0 };
+static portMUX_TYPE _meter_lock = portMUX_INITIALIZER_UNLOCKED;
+
+int energy_init()
+{
+    ESP_LOGI(TAG, "Initializing energy meter...");
+
+    _meter.power_dev = k_device_get_binding("sensor.led_power");
+    if (_meter.power_dev == NULL) {
+        return -ENODEV;
+    }
+
+    _meter.save_lock = xSemaphoreCreateMutex();
+    if (_meter.save_lock == NULL) {
+        return -ENOMEM;
+    }
+
+    BO_TRY(energy_load());
+
+    _meter.last_sample_us = esp_timer_get_time();
+    _meter.last_flush_us = _meter.last_sample_us;
+
+    BO_TRY_ESP(esp_event_handler_register(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, system_events_handler, NULL));
+
+    if (xTaskCreate(&energy_task, "energy_task", 3 * 1024, NULL, TASK_PRIORITY, &_meter.task) != pdPASS) {
+        return -ENOMEM;
+    }
+
+    ESP_LOGI(TAG, "Energy meter started, total=%llu mWh", _meter.stats.total_mj / ENERGY_MJ_PER_MWH);
+    return 0;
+}
+
+void energy_get_stats(struct energy_stats* stats)
+{
+    portENTER_CRITICAL(&_meter_lock);
+    memcpy(stats, &_meter.stats, sizeof(*stats));
+    portEXIT_CRITICAL(&_meter_lock);
+}
+
+/**
+ * @brief Clears all counters and commits the cleared record.
+ *
+ * The counters are cleared in RAM even if the commit fails; the next flush of the task then writes them, so the old
+ * totals do not come back after a reboot unless it happens before that.
+ */
+int energy_reset()
+{
+    xSemaphoreTake(_meter.save_lock, portMAX_DELAY);
+    BO_SEM_AUTO_RELEASE(_meter.save_lock);
+
+    portENTER_CRITICAL(&_meter_lock);
+    memset(&_meter.stats, 0, sizeof(_meter.stats));
+    _meter.hour_mj = 0;
+    _meter.day_mj = 0;
+    _meter.total_nj = 0;
+    memset(_meter.channels_nj, 0, sizeof(_meter.channels_nj));
+    portEXIT_CRITICAL(&_meter_lock);
+
+    _meter.flushed_total_mj = 0;
+    _meter.reset_unsaved = true;
+    ESP_LOGI(TAG, "Energy counters cleared");
+
+    struct energy_record record = { 0 };
+    BO_TRY(energy_write_record(&record));
+    _meter.reset_unsaved = false;
+    return 0;
+}
+
+static void energy_task()
+{
+    const int64_t flush_interval_us = (int64_t)CONFIG_LYFI_ENERGY_FLUSH_INTERVAL * 60 * 1000 * 1000;
+
+    for (;;) {
+        // A notification means shutdown or reboot is imminent: sample what we have and flush right away
+        bool urgent = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ENERGY_SAMPLE_PERIOD_MS)) > 0;
+
+        energy_sample();
+
+        if (urgent || esp_timer_get_time() - _meter.last_flush_us >= flush_interval_us) {
+            int rc = energy_save(urgent);
+            if (rc) {
+                ESP_LOGE(TAG, "Failed to save energy counters, errcode=%d", rc);
+            }
+        }
+    }
+}
+
+static void energy_sample()
+{
+    const int64_t now_us = esp_timer_get_time();
+    int64_t dt_us = now_us - _meter.last_sample_us;
+    _meter.last_sample_us = now_us;
+    if (dt_us <= 0) {
+        return;
+    }
+    if (dt_us > ENERGY_MAX_SAMPLE_GAP_US) {
+        dt_us = ENERGY_MAX_SAMPLE_GAP_US;
+    }
+
+    int32_t power_mw;
+    if (sensor_get_value(_meter.power_dev, &power_mw) != 0 || power_mw <= 0) {
+        portENTER_CRITICAL(&_meter_lock);
+        energy_roll_buckets(time(NULL));
+        portEXIT_CRITICAL(&_meter_lock);
+        return;
+    }
+
+    // Weights used to split the measured power across channels
+    uint32_t weights[CONFIG_LYFI_LED_CHANNEL_COUNT] = { 0 };
+    uint64_t weight_sum = 0;
+#if CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+    {
+        int32_t currents[CONFIG_LYFI_LED_CHANNEL_COUNT];
+        if (led_current_get_channels(currents) == 0) {
+            for (size_t ch = 0; ch < led_channel_count(); ch++) {
+                weights[ch] = currents[ch] > 0 ? (uint32_t)currents[ch] : 0;
+                weight_sum += weights[ch];
+            }
+        }
+    }
+#endif // CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+    if (weight_sum == 0) {
+        led_duty_t duties[CONFIG_LYFI_LED_CHANNEL_COUNT];
+        if (led_get_duties(duties) == 0) {
+            for (size_t ch = 0; ch < led_channel_count(); ch++) {
+                weights[ch] = duties[ch];
+                weight_sum += weights[ch];
+            }
+        }
+    }
+
+    const uint64_t energy_nj = (uint64_t)power_mw * (uint64_t)dt_us;
+
+    portENTER_CRITICAL(&_meter_lock);
+
+    energy_roll_buckets(time(NULL));
+
+    _meter.total_nj += energy_nj;
+    const uint64_t delta_mj = _meter.total_nj / NJ_PER_MJ;
+    _meter.total_nj %= NJ_PER_MJ;
+    _meter.stats.total_mj += delta_mj;
+
+    if (weight_sum > 0) {
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            _meter.channels_nj[ch] += energy_nj * weights[ch] / weight_sum;
+            _meter.stats.channels_mj[ch] += _meter.channels_nj[ch] / NJ_PER_MJ;
+            _meter.channels_nj[ch] %= NJ_PER_MJ;
+        }
+    }
+
+    _meter.hour_mj += delta_mj;
+    _meter.day_mj += delta_mj;
+    _meter.stats.hourly_mwh[0] = (uint32_t)(_meter.hour_mj / ENERGY_MJ_PER_MWH);
+    _meter.stats.daily_mwh[0] = (uint32_t)(_meter.day_mj / ENERGY_MJ_PER_MWH);
+
+    portEXIT_CRITICAL(&_meter_lock);
+}
+
+// Must be called with `_meter_lock` held
+static void energy_roll_buckets(int64_t now)
+{
+    struct energy_stats* stats = &_meter.stats;
+
+    const int64_t hour_start = now - now % SECS_PER_HOUR;
+    if (hour_start != stats->hour_start) {
+        int64_t steps = (hour_start - stats->hour_start) / SECS_PER_HOUR;
+        // Clock set backwards, jumped by SNTP, or the history is simply stale
+        if (steps <= 0 || steps >= ENERGY_HOURLY_BUCKETS) {
+            memset(stats->hourly_mwh, 0, sizeof(stats->hourly_mwh));
+        }
+        else {
+            memmove(&stats->hourly_mwh[steps], &stats->hourly_mwh[0],
+                    (ENERGY_HOURLY_BUCKETS - steps) * sizeof(stats->hourly_mwh[0]));
+            memset(stats->hourly_mwh, 0, steps * sizeof(stats->hourly_mwh[0]));
+        }
+        stats->hour_start = hour_start;
+        _meter.hour_mj = 0;
+    }
+
+    const int64_t day_start = now - now % SECS_PER_DAY;
+    if (day_start != stats->day_start) {
+        int64_t steps = (day_start - stats->day_start) / SECS_PER_DAY;
+        if (steps <= 0 || steps >= ENERGY_DAILY_BUCKETS) {
+            memset(stats->daily_mwh, 0, sizeof(stats->daily_mwh));
+        }
+        else {
+            memmove(&stats->daily_mwh[steps], &stats->daily_mwh[0],
+                    (ENERGY_DAILY_BUCKETS - steps) * sizeof(stats->daily_mwh[0]));
+            memset(stats->daily_mwh, 0, steps * sizeof(stats->daily_mwh[0]));
+        }
+        stats->day_start = day_start;
+        _meter.day_mj = 0;
+    }
+}
+
+static int energy_load()
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(ENERGY_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    struct energy_record record;
+    size_t size = sizeof(record);
+    int rc = nvs_get_blob(handle, ENERGY_NVS_KEY_RECORD, &record, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND) {
+        return 0;
+    }
+    BO_TRY(rc);
+
+    if (size != sizeof(record) || record.version != ENERGY_RECORD_VERSION
+        || record.channel_count != CONFIG_LYFI_LED_CHANNEL_COUNT) {
+        ESP_LOGW(TAG, "Incompatible energy record (size=%u, version=%u), starting over", size, record.version);
+        return 0;
+    }
+
+    _meter.stats.total_mj = record.total_mj;
+    memcpy(_meter.stats.channels_mj, record.channels_mj, sizeof(record.channels_mj));
+    _meter.flushed_total_mj = record.total_mj;
+    return 0;
+}
+
+static int energy_save(bool force)
+{
+    xSemaphoreTake(_meter.save_lock, portMAX_DELAY);
+    BO_SEM_AUTO_RELEASE(_meter.save_lock);
+
+    struct energy_record record = { 0 };
+
+    portENTER_CRITICAL(&_meter_lock);
+    record.total_mj = _meter.stats.total_mj;
+    memcpy(record.channels_mj, _meter.stats.channels_mj, sizeof(record.channels_mj));
+    portEXIT_CRITICAL(&_meter_lock);
+
+    _meter.last_flush_us = esp_timer_get_time();
+
+    // Skip the write when nothing worth a flash page has accumulated
+    const uint64_t pending_mj = record.total_mj - _meter.flushed_total_mj;
+    if (!_meter.reset_unsaved
+        && (record.total_mj == _meter.flushed_total_mj || (!force && pending_mj < ENERGY_FLUSH_MIN_MJ))) {
+        return 0;
+    }
+
+    BO_TRY(energy_write_record(&record));
+    _meter.reset_unsaved = false;
+    return 0;
+}
+
+// Must be called with `save_lock` held
+static int energy_write_record(struct energy_record* record)
+{
+    record->version = ENERGY_RECORD_VERSION;
+    record->channel_count = CONFIG_LYFI_LED_CHANNEL_COUNT;
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(ENERGY_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+    BO_TRY(nvs_set_blob(handle, ENERGY_NVS_KEY_RECORD, record, sizeof(*record)));
+    BO_TRY(nvs_commit(handle));
+
+    _meter.flushed_total_mj = record->total_mj;
+    portENTER_CRITICAL(&_meter_lock);
+    _meter.stats.flush_count++;
+    portEXIT_CRITICAL(&_meter_lock);
+    return 0;
+}
+
+static void system_events_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data)
+{
+    switch (event_id) {
+    case BO_EVENT_SHUTDOWN_SCHEDULED:
+    case BO_EVENT_SHUTDOWN_FAULT:
+    case BO_EVENT_REBOOTING:
+    case BO_EVENT_FATAL_ERROR: {
+        if (_meter.task != NULL) {
+            xTaskNotifyGive(_meter.task);
+        }
+    } break;
+
+    default:
+        break;
+    }
+}
+
+#endif // CONFIG_LYFI_ENERGY_METER_ENABLED
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+
+#define ENERGY_HOURLY_BUCKETS 24
+#define ENERGY_DAILY_BUCKETS 30
+
+#define ENERGY_MJ_PER_MWH 3600
+
+/**
+ * @brief Snapshot of the energy counters.
+ *
+ * Lifetime counters are in millijoules. Histogram buckets are in mWh; index 0 is the current (partial) hour/day and
+ * higher indices go back in time.
+ */
+struct energy_stats {
+    uint64_t total_mj; ///< Measured energy at the LED supply
+    uint64_t channels_mj[CONFIG_LYFI_LED_CHANNEL_COUNT]; ///< Modelled per-channel share of `total_mj`
+    uint32_t hourly_mwh[ENERGY_HOURLY_BUCKETS];
+    uint32_t daily_mwh[ENERGY_DAILY_BUCKETS];
+    int64_t hour_start; ///< UTC timestamp of the start of `hourly_mwh[0]`
+    int64_t day_start; ///< UTC timestamp of the start of `daily_mwh[0]`
+    uint32_t flush_count; ///< NVS commits since boot
+};
+
+int energy_init();
+void energy_get_stats(struct energy_stats* stats);
+int energy_reset();
+
+#endif // CONFIG_LYFI_ENERGY_METER_ENABLED
+
+#ifdef __cplusplus
+}
+#endif
@@ -68,8 +68,8 @@ int fan_set_power(uint8_t value)
 
 #if CONFIG_LYFI_FAN_CTRL_PWM_SUPPORT
     if (_factory_settings.flags & FAN_FLAG_PWM_ENABLED) {
-        const struct drvfx_device* fpwm = k_device_get_binding("fpwm");
-        if (fpwm == NULL) {
+        const struct drvfx_device* fpwm = FPWM_DEVICE;
+        if (fpwm == NULL || !k_device_is_ready(fpwm)) {
             return -ENODEV;
         }
         uint8_t duty = (value * 0xFF + FAN_POWER_MAX / 2) / FAN_POWER_MAX;
@@ -80,8 +80,8 @@ int fan_set_power(uint8_t value)
 
 #if CONFIG_LYFI_FAN_CTRL_VREG_SUPPORT
     if (_factory_settings.flags & FAN_FLAG_VREG_ENABLED) {
-        const struct drvfx_device* vreg = k_device_get_binding("vreg");
-        if (vreg == NULL) {
+        const struct drvfx_device* vreg = VREG_DEVICE;
+        if (vreg == NULL || !k_device_is_ready(vreg)) {
             return -ENODEV;
         }
         BO_TRY(vreg_set_output(vreg, value));
@@ -14,23 +14,36 @@
 #include "led/led.h"
 #include "thermal.h"
 #include "button.h"
+#include "energy.h"
 
 #define TAG "lyfi_init"
 
-static int _lyfi_init(const struct drvfx_device* dev)
+#if CONFIG_LYFI_THERMAL_ENABLED || CONFIG_LYFI_PROTECTION_ENABLED
+// Started early so filling the temperature window overlaps the other entries, the LED still waits for it
+static int _lyfi_thermal_init(const struct drvfx_device* dev)
 {
 #if CONFIG_LYFI_THERMAL_ENABLED
-    BO_TRY(thermal_init());
+    BO_TRY(K_INIT_STEP("thermal", thermal_init()));
 #endif
 
 #if CONFIG_LYFI_PROTECTION_ENABLED
-    BO_TRY(bo_protect_init());
+    // The protection reads the temperature
+    BO_TRY(K_INIT_STEP("protect", bo_protect_init()));
 #endif
+    return 0;
+}
+#endif
+
+static int _lyfi_init(const struct drvfx_device* dev)
+{
+    BO_TRY(K_INIT_STEP("led", led_init()));
 
-    BO_TRY(led_init());
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+    BO_TRY(K_INIT_STEP("energy", energy_init()));
+#endif
 
 #if CONFIG_LYFI_PRESS_BUTTON_ENABLED
-    BO_TRY(button_init());
+    BO_TRY(K_INIT_STEP("button", button_init()));
 #endif
 
     ESP_LOGI(TAG, "Borneo LyFi has been initialized successfully.");
@@ -43,5 +56,15 @@ static int _app_init()
     return 0;
 }
 
+#if CONFIG_LYFI_THERMAL_ENABLED || CONFIG_LYFI_PROTECTION_ENABLED
+#if CONFIG_LYFI_FAN_CTRL_SUPPORT
+DRVFX_SYS_INIT_ASYNC(_lyfi_thermal_init, DRVFX_INIT_APP_HIGH_PRIORITY, DRVFX_INIT_DEPS("fan_init"));
+#else
+DRVFX_SYS_INIT_ASYNC(_lyfi_thermal_init, DRVFX_INIT_APP_HIGH_PRIORITY, NULL);
+#endif
+// The LED must not light before the over-temperature and over-power protection run, nor age on an empty window
+DRVFX_SYS_INIT_EX(_lyfi_init, APPLICATION, DRVFX_INIT_APP_DEFAULT_PRIORITY, 0, DRVFX_INIT_DEPS("_lyfi_thermal_init"));
+#else
 DRVFX_SYS_INIT(_lyfi_init, APPLICATION, DRVFX_INIT_APP_DEFAULT_PRIORITY);
+#endif
 DRVFX_SYS_INIT(_app_init, APPLICATION, DRVFX_INIT_APP_LOWEST_PRIORITY);
\ No newline at end of file
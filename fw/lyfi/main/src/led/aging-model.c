@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include <math.h>
+
+#include "aging-model.h"
+
+#define BOLTZMANN_MEV_PER_K 0.08617333f
+#define KELVIN_OFFSET_DECI 2732 ///< 273.2 °C in 0.1 °C
+#define AF_MAX (1000UL << LED_AGING_AF_Q)
+
+uint32_t led_aging_acceleration(int32_t temp, int32_t ref_temp, uint32_t ea_mev)
+{
+    const float t_k = (float)(temp + KELVIN_OFFSET_DECI) / 10.0f;
+    const float ref_k = (float)(ref_temp + KELVIN_OFFSET_DECI) / 10.0f;
+    if (t_k <= 0.0f || ref_k <= 0.0f) {
+        return 1UL << LED_AGING_AF_Q;
+    }
+
+    const float af = expf((float)ea_mev / BOLTZMANN_MEV_PER_K * (1.0f / ref_k - 1.0f / t_k));
+    const float af_q = af * (float)(1UL << LED_AGING_AF_Q);
+    if (af_q >= (float)AF_MAX) {
+        return AF_MAX;
+    }
+    return (uint32_t)lroundf(af_q);
+}
+
+uint64_t led_aging_stress_increment(uint32_t dt_ms, uint32_t duty, uint32_t max_duty, uint32_t af,
+                                    uint64_t* residual)
+{
+    if (max_duty == 0) {
+        return 0;
+    }
+    // dt_ms * duty * af stays well below 2^64 for any sane sampling interval
+    const uint64_t denom = (uint64_t)max_duty << LED_AGING_AF_Q;
+    const uint64_t scaled = (uint64_t)dt_ms * duty * af + *residual;
+    *residual = scaled % denom;
+    return scaled / denom;
+}
+
+uint32_t led_aging_gain(uint64_t stress_ms, uint32_t l70_hours, uint32_t max_gain_permille)
+{
+    if (l70_hours == 0 || max_gain_permille <= 1000) {
+        return LED_AGING_GAIN_ONE;
+    }
+
+    // L(t) = exp(-a * t) with L(L70) = 0.7, compensation is 1 / L(t)
+    const double alpha = -log(0.7) / ((double)l70_hours * 3600.0 * 1000.0);
+    const double gain = exp(alpha * (double)stress_ms);
+    const double max_gain = (double)max_gain_permille / 1000.0;
+    return (uint32_t)lround((gain < max_gain ? gain : max_gain) * (double)LED_AGING_GAIN_ONE);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pure LED aging model, free of any ESP-IDF dependency so it can be compiled and exercised on a host.
+ *
+ * Stress is measured in "equivalent milliseconds": time at full duty with the heatsink at the reference
+ * temperature. Lumen maintenance follows the TM-21 exponential form L(t) = exp(-a * t), with `a` derived from the
+ * rated L70 lifetime at the reference temperature.
+ */
+
+#define LED_AGING_AF_Q 8 ///< Fraction bits of the acceleration factor
+#define LED_AGING_GAIN_Q 16 ///< Fraction bits of the compensation gain
+#define LED_AGING_GAIN_ONE (1UL << LED_AGING_GAIN_Q)
+
+/** @brief Arrhenius acceleration factor of `temp` relative to `ref_temp`.
+ *
+ * @param temp Heatsink temperature in 0.1 °C
+ * @param ref_temp Reference temperature in 0.1 °C
+ * @param ea_mev Activation energy in meV
+ * @return Acceleration factor in Q`LED_AGING_AF_Q`
+ */
+uint32_t led_aging_acceleration(int32_t temp, int32_t ref_temp, uint32_t ea_mev);
+
+/** @brief Stress accumulated by running at `duty` for `dt_ms` with acceleration factor `af`.
+ *
+ * `residual` carries the sub-millisecond remainder between calls, so no stress is lost to truncation.
+ */
+uint64_t led_aging_stress_increment(uint32_t dt_ms, uint32_t duty, uint32_t max_duty, uint32_t af,
+                                    uint64_t* residual);
+
+/** @brief Brightness compensation gain for an accumulated stress.
+ *
+ * @param stress_ms Accumulated stress in equivalent milliseconds
+ * @param l70_hours Rated hours until 70% lumen maintenance at the reference temperature
+ * @param max_gain_permille Upper bound of the gain, e.g. 1200 for +20%
+ * @return Gain in Q`LED_AGING_GAIN_Q`, at least 1.0
+ */
+uint32_t led_aging_gain(uint64_t stress_ms, uint32_t l70_hours, uint32_t max_gain_permille);
+
+#ifdef __cplusplus
+}
+#endif
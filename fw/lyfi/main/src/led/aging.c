@@ -0,0 +1,227 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_system.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_event.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+#include <driver/ledc.h>
+
+#include <drvfx/drvfx.h>
+#include <borneo/system.h>
+#include <borneo/common.h>
+#include <borneo/devices/sensor.h>
+#include <borneo/nvs.h>
+
+#include "../thermal.h"
+#include "led.h"
+#include "aging-model.h"
+
+#if CONFIG_LYFI_LED_AGING_ENABLED
+
+/*
+ * LED aging accumulator.
+ *
+ * Every few seconds the duties produced by the render task are weighted by the Arrhenius acceleration factor of the
+ * heatsink temperature and added to a per-channel stress counter. The counters drive a lumen-depreciation gain that
+ * `led_aging_compensate()` applies on top of the brightness correction curve.
+ *
+ * Stress moves slowly, so the counters are committed to NVS once an hour and on shutdown.
+ */
+
+#define TAG "led.aging"
+
+#define TASK_PRIORITY 3
+#define AGING_SAMPLE_PERIOD_MS 10000
+#define AGING_FLUSH_INTERVAL_US (60LL * 60 * 1000 * 1000)
+
+#define AGING_NVS_NS "aging"
+#define AGING_NVS_KEY_RECORD "rec"
+#define AGING_RECORD_VERSION 1
+
+struct aging_record {
+    uint8_t version;
+    uint8_t channel_count;
+    uint16_t reserved;
+    uint64_t stress_ms[CONFIG_LYFI_LED_CHANNEL_COUNT];
+};
+
+struct led_aging {
+    uint64_t stress_ms[CONFIG_LYFI_LED_CHANNEL_COUNT]; ///< Equivalent full-duty milliseconds at reference temperature
+    uint64_t residual[CONFIG_LYFI_LED_CHANNEL_COUNT];
+    volatile uint32_t gain[CONFIG_LYFI_LED_CHANNEL_COUNT]; ///< Compensation gain in Q`LED_AGING_GAIN_Q`
+    bool dirty;
+    int64_t last_flush_us;
+    TaskHandle_t task;
+};
+
+static void aging_task();
+static void aging_update_gains();
+static int aging_load();
+static int aging_save();
+static void system_events_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
+
+static struct led_aging _aging = { 0 };
+
+int led_aging_init()
+{
+    ESP_LOGI(TAG, "Initializing LED aging accumulator...");
+
+    BO_TRY(aging_load());
+    aging_update_gains();
+    _aging.last_flush_us = esp_timer_get_time();
+
+    BO_TRY_ESP(esp_event_handler_register(BO_SYSTEM_EVENTS, ESP_EVENT_ANY_ID, system_events_handler, NULL));
+
+    if (xTaskCreate(&aging_task, "led_aging", 3 * 1024, NULL, TASK_PRIORITY, &_aging.task) != pdPASS) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+led_duty_t led_aging_compensate(uint8_t ch, led_duty_t duty)
+{
+#if CONFIG_LYFI_LED_AGING_COMPENSATION
+    uint32_t compensated = (uint32_t)(((uint64_t)duty * _aging.gain[ch] + (LED_AGING_GAIN_ONE / 2)) >> LED_AGING_GAIN_Q);
+    return compensated > LED_MAX_DUTY ? LED_MAX_DUTY : (led_duty_t)compensated;
+#else
+    (void)ch;
+    return duty;
+#endif // CONFIG_LYFI_LED_AGING_COMPENSATION
+}
+
+uint32_t led_aging_get_hours(uint8_t ch)
+{
+    if (ch >= led_channel_count()) {
+        return 0;
+    }
+    return (uint32_t)(_aging.stress_ms[ch] / (3600ULL * 1000ULL));
+}
+
+uint32_t led_aging_get_gain(uint8_t ch)
+{
+    if (ch >= led_channel_count()) {
+        return LED_AGING_GAIN_ONE;
+    }
+    return _aging.gain[ch];
+}
+
+static void aging_task()
+{
+    int64_t last_sample_us = esp_timer_get_time();
+
+    for (;;) {
+        bool urgent = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AGING_SAMPLE_PERIOD_MS)) > 0;
+
+        const int64_t now_us = esp_timer_get_time();
+        const uint32_t dt_ms = (uint32_t)((now_us - last_sample_us) / 1000);
+        last_sample_us = now_us;
+
+        int32_t temp = CONFIG_LYFI_LED_AGING_REF_TEMP * SENSOR_TEMP_SCALE;
+#if CONFIG_LYFI_THERMAL_ENABLED && CONFIG_LYFI_NTC_SUPPORT
+        temp = thermal_get_current_temp_fixed();
+#endif
+        const uint32_t af = led_aging_acceleration(temp, CONFIG_LYFI_LED_AGING_REF_TEMP * SENSOR_TEMP_SCALE,
+                                                   CONFIG_LYFI_LED_AGING_ACTIVATION_ENERGY);
+
+        led_duty_t duties[CONFIG_LYFI_LED_CHANNEL_COUNT];
+        if (dt_ms > 0 && led_get_duties(duties) == 0) {
+            for (size_t ch = 0; ch < led_channel_count(); ch++) {
+                if (duties[ch] == 0) {
+                    continue;
+                }
+                _aging.stress_ms[ch]
+                    += led_aging_stress_increment(dt_ms, duties[ch], LED_MAX_DUTY, af, &_aging.residual[ch]);
+                _aging.dirty = true;
+            }
+            aging_update_gains();
+        }
+
+        if (_aging.dirty && (urgent || now_us - _aging.last_flush_us >= AGING_FLUSH_INTERVAL_US)) {
+            int rc = aging_save();
+            if (rc) {
+                ESP_LOGE(TAG, "Failed to save aging counters, errcode=%d", rc);
+            }
+        }
+    }
+}
+
+static void aging_update_gains()
+{
+    for (size_t ch = 0; ch < led_channel_count(); ch++) {
+#if CONFIG_LYFI_LED_AGING_COMPENSATION
+        _aging.gain[ch] = led_aging_gain(_aging.stress_ms[ch], CONFIG_LYFI_LED_AGING_L70_HOURS,
+                                         CONFIG_LYFI_LED_AGING_MAX_GAIN * 10);
+#else
+        _aging.gain[ch] = LED_AGING_GAIN_ONE;
+#endif // CONFIG_LYFI_LED_AGING_COMPENSATION
+    }
+}
+
+static int aging_load()
+{
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(AGING_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    struct aging_record record;
+    size_t size = sizeof(record);
+    int rc = nvs_get_blob(handle, AGING_NVS_KEY_RECORD, &record, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND) {
+        return 0;
+    }
+    BO_TRY(rc);
+
+    if (size != sizeof(record) || record.version != AGING_RECORD_VERSION
+        || record.channel_count != CONFIG_LYFI_LED_CHANNEL_COUNT) {
+        ESP_LOGW(TAG, "Incompatible aging record (size=%u, version=%u), starting over", size, record.version);
+        return 0;
+    }
+
+    memcpy(_aging.stress_ms, record.stress_ms, sizeof(_aging.stress_ms));
+    return 0;
+}
+
+static int aging_save()
+{
+    struct aging_record record = {
+        .version = AGING_RECORD_VERSION,
+        .channel_count = CONFIG_LYFI_LED_CHANNEL_COUNT,
+    };
+    memcpy(record.stress_ms, _aging.stress_ms, sizeof(record.stress_ms));
+
+    _aging.last_flush_us = esp_timer_get_time();
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(AGING_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+    BO_TRY(nvs_set_blob(handle, AGING_NVS_KEY_RECORD, &record, sizeof(record)));
+    BO_TRY(nvs_commit(handle));
+
+    _aging.dirty = false;
+    return 0;
+}
+
+static void system_events_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data)
+{
+    switch (event_id) {
+    case BO_EVENT_SHUTDOWN_SCHEDULED:
+    case BO_EVENT_SHUTDOWN_FAULT:
+    case BO_EVENT_REBOOTING: {
+        if (_aging.task != NULL) {
+            xTaskNotifyGive(_aging.task);
+        }
+    } break;
+
+    default:
+        break;
+    }
+}
+
+#endif // CONFIG_LYFI_LED_AGING_ENABLED
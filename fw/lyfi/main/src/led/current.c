@@ -0,0 +1,243 @@
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <esp_system.h>
+#include <esp_event.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/ledc.h>
+
+#include <drvfx/drvfx.h>
+
+#include <borneo/common.h>
+#include <borneo/system.h>
+#include <borneo/devices/sensor.h>
+
+#include "led.h"
+
+#if CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+
+/*
+ * Per-channel current estimation.
+ *
+ * The LEDC channels are phase-staggered (`hpoint`), and the current sense amplifier feeds an RC-averaged ADC input
+ * that is sampled far slower than the PWM period. What the ADC sees is therefore the PWM-averaged total current:
+ *
+ *     I_total = I_bias + sum(I_full[ch] * duty[ch] / LED_MAX_DUTY)
+ *
+ * Every sample pairs the measured total with the duty vector that produced it, and a recursive least-squares (RLS)
+ * estimator solves for the full-duty current of each channel while all channels keep running. Schedules, sunrise
+ * ramps and user dimming provide the excitation; samples that carry no new information are skipped so the
+ * covariance does not wind up while the color is constant.
+ */
+
+#define TAG "led.current"
+
+#define CURRENT_TASK_PRIORITY 5
+#define CURRENT_SAMPLE_PERIOD_MS 200
+#define CURRENT_PARAM_COUNT (CONFIG_LYFI_LED_CHANNEL_COUNT + 1) ///< Channels plus the bias term
+
+// RLS tuning
+#define RLS_LAMBDA 0.995f ///< Forgetting factor, ~200 informative samples of memory
+#define RLS_P_INIT 1.0e6f ///< Initial covariance, (1000 mA)^2
+#define RLS_P_MAX 1.0e7f ///< Stop forgetting once a diagonal covariance term exceeds this
+#define RLS_EXCITATION_MIN 1.0e-4f ///< Minimum squared change of the duty vector to accept a sample
+#define RLS_ERROR_GATE_MA 30.0f ///< Always accept samples whose prediction error exceeds this
+
+// A channel estimate is trusted once its variance is below (50 mA)^2
+#define CURRENT_CONFIDENT_VARIANCE 2500.0f
+
+// The sensor applies an EMA with alpha = 1/10; the duty vector is filtered identically so both sides line up
+#define DUTY_EMA_ALPHA 0.1f
+
+struct led_current_estimator {
+    float theta[CURRENT_PARAM_COUNT]; ///< Full-duty current per channel in mA, last entry is the bias
+    float p[CURRENT_PARAM_COUNT][CURRENT_PARAM_COUNT]; ///< Estimate covariance
+    float last_phi[CURRENT_PARAM_COUNT]; ///< Regressor of the last accepted sample
+    float duty[CONFIG_LYFI_LED_CHANNEL_COUNT]; ///< Filtered duty fraction [0, 1]
+    bool duty_initialized;
+    uint32_t updates; ///< Number of accepted samples
+    const struct drvfx_device* sensor_dev;
+};
+
+static void led_current_task();
+static void led_current_rls_update(const float* phi, float y);
+
+static struct led_current_estimator _est;
+static portMUX_TYPE _est_lock = portMUX_INITIALIZER_UNLOCKED;
+
+int led_current_init()
+{
+    ESP_LOGI(TAG, "Initializing per-channel current estimator...");
+
+    memset(&_est, 0, sizeof(_est));
+    _est.sensor_dev = k_device_get_binding("sensor.led_current");
+    if (_est.sensor_dev == NULL) {
+        ESP_LOGW(TAG, "Current sensor not available, per-channel estimation disabled");
+        return 0;
+    }
+
+    for (size_t i = 0; i < CURRENT_PARAM_COUNT; i++) {
+        _est.p[i][i] = RLS_P_INIT;
+    }
+
+    BaseType_t rc = xTaskCreate(&led_current_task, "led_current", 3 * 1024, NULL, CURRENT_TASK_PRIORITY, NULL);
+    if (rc != pdPASS) {
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static void led_current_task()
+{
+    float phi[CURRENT_PARAM_COUNT];
+    led_duty_t duties[CONFIG_LYFI_LED_CHANNEL_COUNT];
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(CURRENT_SAMPLE_PERIOD_MS));
+
+        int32_t total_ma;
+        if (sensor_get_value(_est.sensor_dev, &total_ma) != 0) {
+            continue;
+        }
+        if (led_get_duties(duties) != 0) {
+            continue;
+        }
+
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            float d = (float)duties[ch] / (float)LED_MAX_DUTY;
+            _est.duty[ch] = _est.duty_initialized ? _est.duty[ch] + DUTY_EMA_ALPHA * (d - _est.duty[ch]) : d;
+            phi[ch] = _est.duty[ch];
+        }
+        _est.duty_initialized = true;
+        phi[CURRENT_PARAM_COUNT - 1] = 1.0f;
+
+        led_current_rls_update(phi, (float)total_ma);
+    }
+}
+
+static void led_current_rls_update(const float* phi, float y)
+{
+    const size_t n = CURRENT_PARAM_COUNT;
+
+    float prediction = 0.0f;
+    float change = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        prediction += _est.theta[i] * phi[i];
+        float d = phi[i] - _est.last_phi[i];
+        change += d * d;
+    }
+    float error = y - prediction;
+
+    // A repeated regressor with a small residual adds nothing but covariance wind-up
+    if (_est.updates > 0 && change < RLS_EXCITATION_MIN && fabsf(error) < RLS_ERROR_GATE_MA) {
+        return;
+    }
+
+    float p_phi[CURRENT_PARAM_COUNT];
+    float denom = RLS_LAMBDA;
+    for (size_t i = 0; i < n; i++) {
+        float acc = 0.0f;
+        for (size_t j = 0; j < n; j++) {
+            acc += _est.p[i][j] * phi[j];
+        }
+        p_phi[i] = acc;
+        denom += phi[i] * acc;
+    }
+
+    bool forget = true;
+    for (size_t i = 0; i < n; i++) {
+        if (_est.p[i][i] > RLS_P_MAX) {
+            forget = false;
+            break;
+        }
+    }
+    const float inv_lambda = forget ? 1.0f / RLS_LAMBDA : 1.0f;
+    const float inv_denom = 1.0f / denom;
+
+    // `led_current_get_channel_fault()` reads the covariance too
+    portENTER_CRITICAL(&_est_lock);
+    for (size_t i = 0; i < n; i++) {
+        _est.theta[i] += p_phi[i] * inv_denom * error;
+    }
+
+    // P = (P - K * (P * phi)^T) / lambda, kept symmetric
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i; j < n; j++) {
+            float v = (_est.p[i][j] - p_phi[i] * p_phi[j] * inv_denom) * inv_lambda;
+            _est.p[i][j] = v;
+            _est.p[j][i] = v;
+        }
+    }
+    portEXIT_CRITICAL(&_est_lock);
+
+    memcpy(_est.last_phi, phi, sizeof(_est.last_phi));
+    _est.updates++;
+}
+
+int led_current_get_full_scale(uint8_t ch, int32_t* current_ma)
+{
+    if (ch >= led_channel_count() || current_ma == NULL) {
+        return -EINVAL;
+    }
+    if (_est.sensor_dev == NULL) {
+        return -ENODEV;
+    }
+    portENTER_CRITICAL(&_est_lock);
+    float value = _est.theta[ch];
+    portEXIT_CRITICAL(&_est_lock);
+    *current_ma = (int32_t)lroundf(value > 0.0f ? value : 0.0f);
+    return 0;
+}
+
+int led_current_get_channels(int32_t* currents_ma)
+{
+    if (currents_ma == NULL) {
+        return -EINVAL;
+    }
+    if (_est.sensor_dev == NULL) {
+        return -ENODEV;
+    }
+
+    led_duty_t duties[CONFIG_LYFI_LED_CHANNEL_COUNT];
+    BO_TRY(led_get_duties(duties));
+
+    portENTER_CRITICAL(&_est_lock);
+    for (size_t ch = 0; ch < led_channel_count(); ch++) {
+        float ma = _est.theta[ch] * (float)duties[ch] / (float)LED_MAX_DUTY;
+        currents_ma[ch] = (int32_t)lroundf(ma > 0.0f ? ma : 0.0f);
+    }
+    portEXIT_CRITICAL(&_est_lock);
+    return 0;
+}
+
+uint8_t led_current_get_channel_fault(uint8_t ch)
+{
+    if (ch >= led_channel_count() || _est.sensor_dev == NULL) {
+        return LED_CHANNEL_FAULT_UNKNOWN;
+    }
+
+    portENTER_CRITICAL(&_est_lock);
+    float full_scale = _est.theta[ch];
+    float variance = _est.p[ch][ch];
+    portEXIT_CRITICAL(&_est_lock);
+
+    // Not enough excitation on this channel yet to tell anything
+    if (variance > CURRENT_CONFIDENT_VARIANCE) {
+        return LED_CHANNEL_FAULT_UNKNOWN;
+    }
+
+    if (full_scale < (float)CONFIG_LYFI_MEAS_CHANNEL_OPEN_THRESHOLD) {
+        return LED_CHANNEL_FAULT_OPEN;
+    }
+
+    if (CONFIG_LYFI_MEAS_CHANNEL_SHORT_THRESHOLD > 0 && full_scale > (float)CONFIG_LYFI_MEAS_CHANNEL_SHORT_THRESHOLD) {
+        return LED_CHANNEL_FAULT_SHORT;
+    }
+
+    return LED_CHANNEL_FAULT_NONE;
+}
+
+#endif // CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
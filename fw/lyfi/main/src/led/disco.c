@@ -1,5 +1,6 @@
 #include <math.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -8,7 +9,7 @@
 #include <esp_timer.h>
 #include <esp_log.h>
 
-#include <borneo/timer.h>
+#include <borneo/clock-sync.h>
 
 #include "led.h"
 
@@ -39,19 +40,29 @@ enum disco_effect_type {
     DISCO_EFFECT_COUNT,
 };
 
+// Length of an epoch of the effect sequence (in milliseconds)
+#define DISCO_EPOCH_MS 60000
+
 // ========== Private Runtime State ==========
 
+/*
+ * The effect sequence is a pure function of the fleet time and the shared seed (`borneo/clock-sync.h`), so all
+ * fixtures of a synchronized group render the same effect at the same instant. Each epoch starts from a seed derived
+ * from its index; a fixture entering disco mode mid-epoch replays the epoch's sequence up to the current time.
+ *
+ * Every segment is a crossfade of `DISCO_TRANSITION_DURATION_MS` followed by an effect of a random duration.
+ */
 static struct {
-    uint32_t effect_start_ms; // Current effect start time
+    bool valid; // Whether the state below belongs to `epoch`
+    int64_t epoch; // Fleet-time epoch the sequence was generated for
+    int64_t segment_start_ms; // Fleet time the current segment (crossfade + effect) started
     uint32_t effect_duration_ms; // Current effect duration
     uint8_t current_effect; // Current effect type
     uint32_t random_seed; // Random number seed
 
-    // Transition state
-    bool in_transition; // Whether currently transitioning
-    uint32_t transition_start_ms; // Transition start time
     led_color_t prev_color; // Previous effect's final color
     led_color_t next_color; // Next effect's initial color
+    led_color_t last_color; // Last rendered color, the crossfade source at an epoch boundary
 } disco_runtime = { 0 };
 
 // ========== Effect Function Declarations ==========
@@ -80,97 +91,92 @@ static uint32_t disco_next_random(uint32_t* seed)
     return (*seed / 65536) % 32768;
 }
 
-// ========== Public Interface ==========
+// ========== Sequence ==========
 
-int led_disco_init()
+static void disco_start_segment(int64_t start_ms)
 {
-    // Initialize random seed from high-resolution timer
-    disco_runtime.random_seed = (uint32_t)(esp_timer_get_time() & 0xFFFFFFFF);
-    disco_runtime.effect_start_ms = bo_timer_uptime_ms();
-
-    // Randomly select first effect
+    disco_runtime.segment_start_ms = start_ms;
     disco_runtime.current_effect = disco_next_random(&disco_runtime.random_seed) % DISCO_EFFECT_COUNT;
-
-    // Randomly select effect duration
     uint32_t rand = disco_next_random(&disco_runtime.random_seed);
     disco_runtime.effect_duration_ms
         = DISCO_EFFECT_MIN_DURATION_MS + (rand % (DISCO_EFFECT_MAX_DURATION_MS - DISCO_EFFECT_MIN_DURATION_MS));
 
-    // Not in transition initially
-    disco_runtime.in_transition = false;
+    // Calculate next effect's initial color
+    DISCO_EFFECTS[disco_runtime.current_effect](disco_runtime.next_color, 0,
+                                                DISCO_EFFECT_MIN_DURATION_MS // Any duration works for initial frame
+    );
+}
 
-    ESP_LOGI(TAG, "Disco mode initialized. First effect: %u, duration: %u ms", disco_runtime.current_effect,
-             disco_runtime.effect_duration_ms);
+static void disco_start_epoch(int64_t epoch)
+{
+    disco_runtime.valid = true;
+    disco_runtime.epoch = epoch;
+    disco_runtime.random_seed = bo_clock_sync_seed() ^ ((uint32_t)epoch * 2654435761U);
+    memcpy(disco_runtime.prev_color, disco_runtime.last_color, sizeof(led_color_t));
+    disco_start_segment(epoch * DISCO_EPOCH_MS);
+}
 
-    return 0;
+static inline int64_t disco_segment_end_ms()
+{
+    return disco_runtime.segment_start_ms + DISCO_TRANSITION_DURATION_MS + disco_runtime.effect_duration_ms;
 }
 
-void led_disco_drive(time_t utc_now, led_color_t color)
+// ========== Public Interface ==========
+
+int led_disco_init()
 {
-    (void)utc_now; // Unused, disco mode uses uptime instead of wall time
+    // Rebuild the sequence on the first frame; the crossfade starts from whatever is currently shown
+    disco_runtime.valid = false;
+    led_get_color(disco_runtime.last_color);
 
-    uint32_t now_ms = bo_timer_uptime_ms();
+    ESP_LOGI(TAG, "Disco mode initialized, seed: %08" PRIx32, bo_clock_sync_seed());
 
-    // Handle transition state
-    if (disco_runtime.in_transition) {
-        uint32_t transition_elapsed = now_ms - disco_runtime.transition_start_ms;
+    return 0;
+}
 
-        if (transition_elapsed >= DISCO_TRANSITION_DURATION_MS) {
-            // Transition complete, start new effect
-            disco_runtime.in_transition = false;
-            disco_runtime.effect_start_ms = now_ms;
+void led_disco_drive(time_t utc_now, led_color_t color)
+{
+    (void)utc_now; // Unused, disco mode runs on fleet time instead of wall time
 
-            ESP_LOGI(TAG, "Transition complete, now rendering effect %u", disco_runtime.current_effect);
-        }
-        else {
-            // Perform linear crossfade interpolation
-            float t = (float)transition_elapsed / (float)DISCO_TRANSITION_DURATION_MS;
-
-            for (size_t ch = 0; ch < led_channel_count(); ch++) {
-                float blended
-                    = (float)disco_runtime.prev_color[ch] * (1.0f - t) + (float)disco_runtime.next_color[ch] * t;
-                color[ch] = (led_brightness_t)blended;
-            }
-            return;
-        }
-    }
+    int64_t now_ms = bo_clock_sync_time_ms();
+    int64_t epoch = now_ms / DISCO_EPOCH_MS;
 
-    // Check if current effect has finished
-    uint32_t effect_elapsed = now_ms - disco_runtime.effect_start_ms;
+    // A new epoch, or the fleet clock stepped backwards when it locked to a master
+    if (!disco_runtime.valid || epoch != disco_runtime.epoch || now_ms < disco_runtime.segment_start_ms) {
+        disco_start_epoch(epoch);
+    }
 
-    if (effect_elapsed >= disco_runtime.effect_duration_ms) {
+    // Advance to the segment containing `now_ms`; more than one step only right after (re)entering an epoch
+    bool switched = false;
+    while (now_ms >= disco_segment_end_ms()) {
         // Save current effect's final color
         DISCO_EFFECTS[disco_runtime.current_effect](disco_runtime.prev_color, disco_runtime.effect_duration_ms,
                                                     disco_runtime.effect_duration_ms);
-
-        // Select next effect
-        uint8_t next_effect = disco_next_random(&disco_runtime.random_seed) % DISCO_EFFECT_COUNT;
-
-        // Calculate next effect's initial color
-        DISCO_EFFECTS[next_effect](disco_runtime.next_color, 0,
-                                   DISCO_EFFECT_MIN_DURATION_MS // Any duration works for initial frame
-        );
-
-        // Update effect and duration
-        disco_runtime.current_effect = next_effect;
-        uint32_t rand = disco_next_random(&disco_runtime.random_seed);
-        disco_runtime.effect_duration_ms
-            = DISCO_EFFECT_MIN_DURATION_MS + (rand % (DISCO_EFFECT_MAX_DURATION_MS - DISCO_EFFECT_MIN_DURATION_MS));
-
-        // Start transition
-        disco_runtime.in_transition = true;
-        disco_runtime.transition_start_ms = now_ms;
-
-        ESP_LOGI(TAG, "Effect switch: -> effect %u, duration: %u ms (transition %u ms)", next_effect,
+        disco_start_segment(disco_segment_end_ms());
+        switched = true;
+    }
+    if (switched) {
+        ESP_LOGI(TAG, "Effect switch: -> effect %u, duration: %u ms (transition %u ms)", disco_runtime.current_effect,
                  disco_runtime.effect_duration_ms, DISCO_TRANSITION_DURATION_MS);
+    }
+
+    uint32_t segment_elapsed = (uint32_t)(now_ms - disco_runtime.segment_start_ms);
+    if (segment_elapsed < DISCO_TRANSITION_DURATION_MS) {
+        // Perform linear crossfade interpolation
+        float t = (float)segment_elapsed / (float)DISCO_TRANSITION_DURATION_MS;
 
-        // Render first frame of crossfade (t=0, so prev_color)
-        memcpy(color, disco_runtime.prev_color, sizeof(led_color_t));
-        return;
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            float blended = (float)disco_runtime.prev_color[ch] * (1.0f - t) + (float)disco_runtime.next_color[ch] * t;
+            color[ch] = (led_brightness_t)blended;
+        }
+    }
+    else {
+        // Render current effect normally
+        DISCO_EFFECTS[disco_runtime.current_effect](color, segment_elapsed - DISCO_TRANSITION_DURATION_MS,
+                                                    disco_runtime.effect_duration_ms);
     }
 
-    // Render current effect normally
-    DISCO_EFFECTS[disco_runtime.current_effect](color, effect_elapsed, disco_runtime.effect_duration_ms);
+    memcpy(disco_runtime.last_color, color, sizeof(led_color_t));
 }
 
 // ========== Effect Implementations ==========
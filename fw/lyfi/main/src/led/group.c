@@ -0,0 +1,106 @@
+#include <string.h>
+#include <errno.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+
+#include <drvfx/drvfx.h>
+
+#include <borneo/power.h>
+#include <borneo/rtc.h>
+
+#include "led.h"
+
+#define TAG "led.group"
+
+#define LED_GROUP_COMMAND_MAX_DELAY_MS 10000 ///< Group commands scheduled further ahead are rejected
+#define LED_GROUP_COMMAND_MAX_LATE_MS 2000 ///< Longer than multicast waits for a DTIM beacon, older ones are rejected
+
+/**
+ * @brief Schedules a group command for the render frame at its apply time.
+ *
+ * Fixtures of a group receive the same command with the same wall-clock apply time, so with SNTP-synchronized clocks
+ * they all switch within one render frame of each other instead of whenever the multicast datagram happened to arrive.
+ * A command that is slightly late is applied on the next frame; a newer command replaces one that is still pending.
+ *
+ * A color is only taken together with the dimming state, the only one whose color can be set: the fixtures of a group
+ * may be in different states when the command arrives, so a color on its own would apply on some of them only.
+ *
+ * @return 0 on success, -EINVAL if the command is malformed, too far in the future or too late
+ */
+int led_schedule_group_command(const struct led_group_command* command)
+{
+    if (command == NULL || (!command->has_state && !command->has_color)) {
+        return -EINVAL;
+    }
+
+    if (k_get_mode() != KERNEL_MODE_NORMAL || !bo_power_is_on()) {
+        return -EINVAL;
+    }
+
+    if (command->has_state && command->state >= LED_STATE_COUNT) {
+        return -EINVAL;
+    }
+
+    if (command->has_color) {
+        if (!command->has_state || command->state != LED_STATE_DIMMING) {
+            return -EINVAL;
+        }
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            if (command->color[ch] > LED_BRIGHTNESS_MAX) {
+                return -EINVAL;
+            }
+        }
+    }
+
+    int64_t now_ms = bo_rtc_get_timestamp_us() / 1000LL;
+    if (command->apply_at_ms - now_ms > LED_GROUP_COMMAND_MAX_DELAY_MS
+        || now_ms - command->apply_at_ms > LED_GROUP_COMMAND_MAX_LATE_MS) {
+        return -EINVAL;
+    }
+
+    portENTER_CRITICAL(&g_led_spinlock);
+    _led.group_command = *command;
+    _led.group_command.pending = true;
+    portEXIT_CRITICAL(&g_led_spinlock);
+
+    return 0;
+}
+
+/**
+ * @brief Applies the pending group command once its apply time has come, called by the render task every frame.
+ */
+void led_group_command_poll()
+{
+    int64_t now_ms = bo_rtc_get_timestamp_us() / 1000LL;
+    struct led_group_command command;
+    bool due;
+    portENTER_CRITICAL(&g_led_spinlock);
+    due = _led.group_command.pending && now_ms >= _led.group_command.apply_at_ms;
+    if (due) {
+        command = _led.group_command;
+        _led.group_command.pending = false;
+    }
+    portEXIT_CRITICAL(&g_led_spinlock);
+
+    if (!due) {
+        return;
+    }
+
+    int rc;
+    if (command.has_state && led_get_state() != command.state) {
+        rc = led_switch_state(command.state);
+        if (rc) {
+            ESP_LOGW(TAG, "Failed to apply group state %u, errcode=%d", command.state, rc);
+            return;
+        }
+    }
+
+    if (command.has_color) {
+        rc = led_set_color(command.color);
+        if (rc) {
+            ESP_LOGW(TAG, "Failed to apply group color, errcode=%d", rc);
+        }
+    }
+}
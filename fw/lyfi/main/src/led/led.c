@@ -24,6 +24,7 @@
 #include <borneo/algo/astronomy.h>
 #include <borneo/wifi.h>
 #include <borneo/timer.h>
+#include <borneo/rtc.h>
 
 #if CONFIG_LYFI_PROTECTION_OVERPOWER_SUPPORT
 #include <borneo/devices/sensor.h>
@@ -63,18 +64,19 @@ static void dimming_state_run();
 static void dimming_state_exit();
 
 static inline void led_dimming_reset_timeout();
+static void led_color_notify_poll(bool color_changed, int64_t now_us);
 
 #define TAG "lyfi-ledc"
 
 #define TASK_PRIORITY 15
 #define SECS_PER_DAY 86400
-#define LED_MAX_DUTY ((1 << LEDC_TIMER_12_BIT) - 1)
 #define LED_DUTY_RES LEDC_TIMER_12_BIT
 
 #define LED_UPDATE_PERIOD_US 10000 // 10ms
 #define LED_UPDATE_PERIOD_TICKS (pdMS_TO_TICKS(10)) // Ticks in 10ms
 #define TEMPORARY_FADE_PERIOD_MS 7000
 #define LED_CHANNEL_SELF_TEST_WAIT_MS 500
+#define LED_STREAM_IDLE_RESET_MS 2000 ///< A stream silent for this long may restart with any sequence number
 
 static inline led_duty_t channel_brightness_to_duty(led_brightness_t power);
 static inline void color_to_duties(const led_color_t color, led_duty_t* duties);
@@ -256,12 +258,20 @@ int led_init()
 
     BO_TRY(led_moon_init());
 
+#if CONFIG_LYFI_LED_AGING_ENABLED
+    BO_TRY(led_aging_init());
+#endif
+
 #if CONFIG_LYFI_PROTECTION_OVERPOWER_SUPPORT
     // Perform LED channel self-test
     BO_TRY(led_channel_self_test());
 #endif
 
     xTaskCreate(&led_render_task, "led_render_task", 8 * 1024, NULL, TASK_PRIORITY, NULL);
+
+#if CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+    BO_TRY(led_current_init());
+#endif
     ESP_LOGI(TAG, "LED Controller module has been initialized successfully.");
     return 0;
 }
@@ -373,6 +383,52 @@ int led_set_color(const led_color_t color)
     return 0;
 }
 
+/**
+ * @brief Queues a streamed color for the next render frame.
+ *
+ * Only the newest frame is kept: frames whose sequence number is not ahead of the last accepted one (with
+ * wrap-around) are dropped, and a frame that arrives before the previous one was rendered simply replaces it.
+ *
+ * @return 0 if the frame was accepted, -EAGAIN if it was stale, -EINVAL if not in dimming state or out of range
+ */
+int led_stream_color(uint32_t seq, const led_color_t color)
+{
+    if (k_get_mode() != KERNEL_MODE_NORMAL) {
+        return -EINVAL;
+    }
+
+    if (!(bo_power_is_on() && led_get_state() == LED_STATE_DIMMING)) {
+        return -EINVAL;
+    }
+
+    for (size_t ch = 0; ch < led_channel_count(); ch++) {
+        if (color[ch] > LED_BRIGHTNESS_MAX) {
+            return -EINVAL;
+        }
+    }
+
+    int rc = 0;
+    int64_t now_ms = bo_timer_uptime_ms();
+
+    portENTER_CRITICAL(&g_led_spinlock);
+    struct led_color_stream* stream = &_led.stream;
+    bool restarted = stream->accepted == 0 || now_ms - stream->last_ms >= LED_STREAM_IDLE_RESET_MS;
+    if (!restarted && (int32_t)(seq - stream->seq) <= 0) {
+        stream->dropped++;
+        rc = -EAGAIN;
+    }
+    else {
+        memcpy(stream->color, color, sizeof(led_color_t));
+        stream->seq = seq;
+        stream->last_ms = now_ms;
+        stream->pending = true;
+        stream->accepted++;
+    }
+    portEXIT_CRITICAL(&g_led_spinlock);
+
+    return rc;
+}
+
 int led_get_color(led_color_t color)
 {
     portENTER_CRITICAL(&g_led_spinlock);
@@ -420,6 +476,9 @@ inline void color_to_duties(const led_color_t color, led_duty_t* duties)
 {
     for (size_t ch = 0; ch < led_channel_count(); ch++) {
         duties[ch] = channel_brightness_to_duty(color[ch]);
+#if CONFIG_LYFI_LED_AGING_ENABLED
+        duties[ch] = led_aging_compensate(ch, duties[ch]);
+#endif
     }
 }
 
@@ -467,6 +526,9 @@ int led_set_channel_brightness(uint8_t ch, led_brightness_t brightness)
         return -EINVAL;
     }
     led_duty_t duty = channel_brightness_to_duty(brightness);
+#if CONFIG_LYFI_LED_AGING_ENABLED
+    duty = led_aging_compensate(ch, duty);
+#endif
     BO_TRY_ESP(led_set_channel_duty(ch, duty));
     return 0;
 }
@@ -528,6 +590,7 @@ int led_set_schedule(const struct led_scheduler_item* items, size_t count)
         memset(&_led.settings.scheduler, 0, sizeof(_led.settings.scheduler));
     }
     portEXIT_CRITICAL(&g_led_spinlock);
+    atomic_fetch_add(&_led.settings_generation, 1);
 
     return 0;
 }
@@ -536,6 +599,8 @@ const struct led_scheduler* led_get_schedule() { return &_led.settings.scheduler
 
 const struct led_user_settings* led_get_settings() { return &_led.settings; }
 
+uint32_t led_get_settings_generation() { return atomic_load(&_led.settings_generation); }
+
 const struct led_status* led_get_status() { return &_led; }
 
 bool led_is_blank()
@@ -711,6 +776,9 @@ void led_render_task()
 
         int64_t frame_start_us = esp_timer_get_time();
 
+        // Before the state machine runs, so a due command reaches the hardware in this very frame
+        led_group_command_poll();
+
         int smf_ret = smf_run_state(SMF_CTX(&_led));
         if (smf_ret) {
             bo_panic();
@@ -739,6 +807,7 @@ void led_render_task()
                     }
                 }
             }
+            led_color_notify_poll(color_changed, frame_start_us);
         }
         else {
             int64_t over_us = (esp_timer_get_time() - frame_start_us) - LED_UPDATE_PERIOD_US;
@@ -753,6 +822,28 @@ void led_render_task()
     }
 }
 
+/**
+ * @brief Coalesces color changes into at most one `LYFI_EVENT_LED_COLOR_CHANGED` per notify interval.
+ *
+ * Runs in the render task, so it piggybacks on the existing frame cadence instead of adding timers or wakeups.
+ */
+static void led_color_notify_poll(bool color_changed, int64_t now_us)
+{
+    static bool dirty = false;
+    static int64_t last_notify_us = 0;
+
+    dirty |= color_changed;
+    if (!dirty || now_us - last_notify_us < CONFIG_LYFI_COLOR_NOTIFY_INTERVAL * 1000LL) {
+        return;
+    }
+
+    // Never block the render task; if the event loop is congested retry on the next frame
+    if (esp_event_post(LYFI_EVENTS, LYFI_EVENT_LED_COLOR_CHANGED, NULL, 0, 0) == ESP_OK) {
+        dirty = false;
+        last_notify_us = now_us;
+    }
+}
+
 int led_switch_state(uint8_t state)
 {
     if (state >= LED_STATE_COUNT) {
@@ -996,6 +1087,26 @@ void dimming_state_entry()
 
 void dimming_state_run()
 {
+    // Apply the newest streamed frame, if any; older ones were already overwritten
+    {
+        led_color_t color;
+        bool pending;
+        portENTER_CRITICAL(&g_led_spinlock);
+        pending = _led.stream.pending;
+        if (pending) {
+            memcpy(color, _led.stream.color, sizeof(led_color_t));
+            _led.stream.pending = false;
+        }
+        portEXIT_CRITICAL(&g_led_spinlock);
+
+        if (pending) {
+            int rc = led_set_color(color);
+            if (rc) {
+                ESP_LOGW(TAG, "Failed to apply streamed color, errcode=%d", rc);
+            }
+        }
+    }
+
     if (CONFIG_LYFI_DIMMING_TIMEOUT > 0) {
         int64_t now_ms = bo_timer_uptime_ms();
         int64_t deadline_ms;
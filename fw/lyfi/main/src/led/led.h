@@ -8,6 +8,7 @@
 
 #include <borneo/algo/astronomy.h>
 #include <freertos/portmacro.h>
+#include <driver/ledc.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,6 +23,7 @@ typedef led_duty_t led_duties_t[CONFIG_LYFI_LED_CHANNEL_COUNT];
 
 #define LED_BRIGHTNESS_MIN ((led_brightness_t)0)
 #define LED_BRIGHTNESS_MAX ((led_brightness_t)4095)
+#define LED_MAX_DUTY ((1 << LEDC_TIMER_12_BIT) - 1)
 
 #define LED_ACCLIMATION_DAYS_MAX 100
 #define LED_ACCLIMATION_DAYS_MIN 5
@@ -54,6 +56,13 @@ enum led_running_modes {
     LED_MODE_COUNT,
 };
 
+enum led_channel_faults {
+    LED_CHANNEL_FAULT_NONE = 0,
+    LED_CHANNEL_FAULT_UNKNOWN = 1, ///< Not enough data to judge the channel yet
+    LED_CHANNEL_FAULT_OPEN = 2, ///< The string draws (almost) no current while driven
+    LED_CHANNEL_FAULT_SHORT = 3, ///< The string draws more than the configured limit
+};
+
 enum led_option_flags {
     LED_OPTION_MOON_ENABLED = 1,
     LED_OPTION_HAS_GEO_LOCATION = 2,
@@ -109,6 +118,26 @@ struct led_user_settings {
     uint32_t flags; ///< The option flags
 };
 
+/** @brief Latest frame received from the streaming color endpoint. */
+struct led_color_stream {
+    led_color_t color; ///< Latest accepted color, applied by the render task on its next frame
+    uint32_t seq; ///< Sequence number of the latest accepted frame
+    int64_t last_ms; ///< Uptime of the latest accepted frame
+    bool pending; ///< Set when `color` has not been applied yet
+    uint32_t accepted; ///< Frames accepted since boot
+    uint32_t dropped; ///< Stale or out-of-order frames dropped since boot
+};
+
+/** @brief A group command waiting for its apply time, see `led_schedule_group_command()`. */
+struct led_group_command {
+    int64_t apply_at_ms; ///< Wall-clock time in milliseconds since the Unix epoch
+    bool has_state;
+    uint8_t state;
+    bool has_color;
+    led_color_t color;
+    bool pending;
+};
+
 struct led_status {
     struct smf_ctx ctx; ///< SMF context, must be the first member
 
@@ -133,17 +162,20 @@ struct led_status {
 
     struct led_user_settings settings;
     SemaphoreHandle_t settings_lock;
+    atomic_uint settings_generation; ///< Bumped on every change of `settings`, used as the CoAP ETag
 
     bool acclimation_activated;
 
     // Cloud overlay (micro cloud shadow) runtime state
     bool cloud_activated; ///< Whether cloud event is currently active
-    uint32_t cloud_start_ms;
+    int64_t cloud_start_ms; ///< Fleet time the current cloud started
     uint32_t cloud_duration_ms;
-    uint32_t cloud_next_fire_ms;
     uint16_t cloud_drop_bp; ///< Drop in basis points (1% = 100 bp)
 
     int64_t dimming_timeout_deadline_ms; ///< Deadline timestamp for DIMMING mode timeout
+
+    struct led_color_stream stream;
+    struct led_group_command group_command;
 };
 
 extern struct led_status _led;
@@ -164,6 +196,11 @@ int led_set_color(const led_color_t color);
 
 int led_get_color(led_color_t color);
 
+int led_stream_color(uint32_t seq, const led_color_t color);
+
+int led_schedule_group_command(const struct led_group_command* command);
+void led_group_command_poll();
+
 int led_get_duties(led_duty_t* duties);
 
 led_brightness_t led_get_channel_power(uint8_t ch);
@@ -176,6 +213,7 @@ int led_set_schedule(const struct led_scheduler_item* items, size_t count);
 const struct led_scheduler* led_get_schedule();
 
 const struct led_user_settings* led_get_settings();
+uint32_t led_get_settings_generation();
 const struct led_factory_settings* led_get_factory_settings();
 const char* led_get_channel_name(uint8_t ch);
 const char* led_get_channel_color(uint8_t ch);
@@ -216,6 +254,7 @@ int led_tz_set_offset(int32_t offset);
 
 int led_load_factory_settings();
 int led_load_user_settings();
+/// Marks the user settings changed, the persistence task writes them after a quiet period, see `borneo/persist.h`
 int led_save_user_settings();
 
 void led_sch_compute_color(const struct led_scheduler* sch, const struct tm* local_tm, led_color_t color);
@@ -251,6 +290,20 @@ void led_cloud_drive(led_color_t color);
 int led_disco_init();
 void led_disco_drive(time_t utc_now, led_color_t color);
 
+#if CONFIG_LYFI_LED_AGING_ENABLED
+int led_aging_init();
+led_duty_t led_aging_compensate(uint8_t ch, led_duty_t duty);
+uint32_t led_aging_get_hours(uint8_t ch);
+uint32_t led_aging_get_gain(uint8_t ch);
+#endif // CONFIG_LYFI_LED_AGING_ENABLED
+
+#if CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+int led_current_init();
+int led_current_get_channels(int32_t* currents_ma);
+int led_current_get_full_scale(uint8_t ch, int32_t* current_ma);
+uint8_t led_current_get_channel_fault(uint8_t ch);
+#endif // CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
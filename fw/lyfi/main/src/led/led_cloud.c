@@ -3,14 +3,13 @@
 
 #include <esp_system.h>
 #include <esp_log.h>
-#include <esp_random.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 #include <drvfx/drvfx.h>
 
-#include <borneo/timer.h>
+#include <borneo/clock-sync.h>
 
 #include "led.h"
 
@@ -24,15 +23,48 @@
 #define CLOUD_INTERVAL_MIN_MS 300000 // 5 minutes
 #define CLOUD_INTERVAL_MAX_MS 1800000 // 30 minutes
 
+#define CLOUD_SLOT_MS ((CLOUD_INTERVAL_MIN_MS + CLOUD_INTERVAL_MAX_MS) / 2)
+
+/*
+ * Clouds are a pure function of the fleet time and the shared seed (`borneo/clock-sync.h`): the timeline is cut into
+ * slots of `CLOUD_SLOT_MS` and every slot holds exactly one cloud at a seed-derived position. Fixtures of a
+ * synchronized group therefore shade in phase, and a fixture that just enabled clouds joins the shadow its neighbours
+ * are already rendering.
+ */
+
+/**
+ * @brief Mixes a value into a hash (MurmurHash3 finalizer), good enough to spread consecutive slot numbers.
+ */
+static inline uint32_t _mix32(uint32_t h, uint32_t value)
+{
+    h ^= value + 0x9E3779B9U + (h << 6) + (h >> 2);
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
+
 /**
- * @brief Generate random value in range [min, max] inclusive.
+ * @brief Maps a hash to the range [min, max] inclusive.
  */
-static inline uint32_t _rand_range(uint32_t min, uint32_t max)
+static inline uint32_t _hash_range(uint32_t hash, uint32_t min, uint32_t max)
 {
     if (max <= min) {
         return min;
     }
-    return min + (esp_random() % (max - min + 1));
+    return min + (hash % (max - min + 1));
+}
+
+static void cloud_for_slot(uint32_t seed, int64_t slot, int64_t* start_ms, uint32_t* duration_ms, uint16_t* drop_bp)
+{
+    uint32_t h = _mix32(_mix32(seed, (uint32_t)slot), (uint32_t)((uint64_t)slot >> 32));
+    *duration_ms = _hash_range(h, CLOUD_DURATION_MIN_MS, CLOUD_DURATION_MAX_MS);
+    h = _mix32(h, 1);
+    *drop_bp = (uint16_t)_hash_range(h, CLOUD_DROP_MIN_BP, CLOUD_DROP_MAX_BP);
+    h = _mix32(h, 2);
+    *start_ms = slot * CLOUD_SLOT_MS + _hash_range(h, 0, CLOUD_SLOT_MS - *duration_ms);
 }
 
 int led_cloud_init()
@@ -68,55 +100,39 @@ void led_cloud_drive(led_color_t color)
         return;
     }
 
-    uint32_t now_ms = (uint32_t)bo_timer_uptime_ms();
+    int64_t now_ms = bo_clock_sync_time_ms();
+    uint32_t seed = bo_clock_sync_seed();
+    int64_t slot = now_ms / CLOUD_SLOT_MS;
 
-    bool active;
-    uint32_t start_ms;
+    int64_t start_ms;
     uint32_t duration_ms;
     uint16_t drop_bp;
-    bool just_activated = false;
-    uint32_t log_duration_ms = 0;
-    uint16_t log_drop_bp = 0;
-    uint32_t log_next_in_ms = 0;
+    cloud_for_slot(seed, slot, &start_ms, &duration_ms, &drop_bp);
+    bool active = now_ms >= start_ms && now_ms - start_ms < duration_ms;
 
-    // Update/arm cloud state once per frame under lock
+    bool just_activated;
     portENTER_CRITICAL(led_get_lock());
-    if (!_led.cloud_activated && now_ms >= _led.cloud_next_fire_ms) {
-        _led.cloud_drop_bp = (uint16_t)_rand_range(CLOUD_DROP_MIN_BP, CLOUD_DROP_MAX_BP);
-        _led.cloud_duration_ms = _rand_range(CLOUD_DURATION_MIN_MS, CLOUD_DURATION_MAX_MS);
-        _led.cloud_start_ms = now_ms;
-        _led.cloud_activated = true;
-        _led.cloud_next_fire_ms = now_ms + _rand_range(CLOUD_INTERVAL_MIN_MS, CLOUD_INTERVAL_MAX_MS);
-
-        // Prepare log details to print outside the critical section
-        just_activated = true;
-        log_duration_ms = _led.cloud_duration_ms;
-        log_drop_bp = _led.cloud_drop_bp;
-        log_next_in_ms = (_led.cloud_next_fire_ms > now_ms) ? (_led.cloud_next_fire_ms - now_ms) : 0;
-    }
-
-    active = _led.cloud_activated;
-    start_ms = _led.cloud_start_ms;
-    duration_ms = _led.cloud_duration_ms;
-    drop_bp = _led.cloud_drop_bp;
-
-    // If expired, clear active flag immediately
-    if (active && duration_ms > 0 && now_ms - start_ms >= duration_ms) {
-        _led.cloud_activated = false;
-        active = false;
-    }
+    just_activated = active && (!_led.cloud_activated || _led.cloud_start_ms != start_ms);
+    _led.cloud_activated = active;
+    _led.cloud_start_ms = start_ms;
+    _led.cloud_duration_ms = duration_ms;
+    _led.cloud_drop_bp = drop_bp;
     portEXIT_CRITICAL(led_get_lock());
 
     if (just_activated) {
-        ESP_LOGI(TAG, "Cloud activated: duration=%u ms, drop=%u bp, next_fire_in=%u ms", (unsigned)log_duration_ms,
-                 (unsigned)log_drop_bp, (unsigned)log_next_in_ms);
+        int64_t next_start_ms;
+        uint32_t next_duration_ms;
+        uint16_t next_drop_bp;
+        cloud_for_slot(seed, slot + 1, &next_start_ms, &next_duration_ms, &next_drop_bp);
+        ESP_LOGI(TAG, "Cloud activated: duration=%u ms, drop=%u bp, next_fire_in=%lld ms", (unsigned)duration_ms,
+                 (unsigned)drop_bp, next_start_ms - now_ms);
     }
 
     if (!active || duration_ms == 0) {
         return;
     }
 
-    uint32_t elapsed = now_ms - start_ms;
+    uint32_t elapsed = (uint32_t)(now_ms - start_ms);
     if (elapsed > duration_ms) {
         elapsed = duration_ms;
     }
@@ -1,4 +1,6 @@
 #include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <time.h>
 #include <errno.h>
 #include <math.h>
@@ -16,11 +18,13 @@
 #include <esp_log.h>
 #include <nvs_flash.h>
 #include <esp_rom_md5.h>
+#include <esp_rom_crc.h>
 
 #include <borneo/common.h>
 #include <borneo/system.h>
 #include <borneo/power.h>
 #include <borneo/nvs.h>
+#include <borneo/persist.h>
 
 #include "../lyfi-events.h"
 #include "led.h"
@@ -44,9 +48,54 @@
 #define LED_NVS_KEY_ACCLIMATION_START_PERCENT "acc.pc"
 #define LED_NVS_KEY_CLOUD_ENABLED "cloud.en"
 #define LED_NVS_KEY_MOON_ENABLED "moon.en"
+#define LED_NVS_KEY_IMAGE "image"
 
 #define TAG "led.settings"
 
+/*
+ * Settings image: every user setting in one blob, so loading them is a single NVS lookup instead of one per field.
+ * The header carries the layout version, the size and a CRC-32.
+ *
+ * Version 1: the CRC covers the payload only.
+ * Version 2: the CRC also covers the header fields before it, so a flipped version or channel count is caught.
+ *
+ * The key-per-field layout before the image is read once and migrated. Its keys stay in place, so a downgrade to a
+ * firmware from before the image boots with the settings as they were at the migration instead of the defaults, and
+ * a damaged image falls back to them as well. Changes made after the migration only go to the image.
+ */
+#define LED_SETTINGS_IMAGE_VERSION 2
+
+struct led_settings_image_header {
+    uint16_t version;
+    uint16_t size; ///< Of the whole image
+    uint8_t channel_count;
+    uint8_t reserved[3];
+    uint32_t crc32;
+} __attribute__((packed));
+
+struct led_settings_image {
+    struct led_settings_image_header header;
+    uint8_t mode;
+    uint8_t correction_method;
+    uint8_t acclimation_duration;
+    uint8_t acclimation_start_percent;
+    uint32_t flags;
+    uint32_t temporary_duration;
+    int32_t tz_offset;
+    int64_t acclimation_start_utc;
+    struct geo_location location;
+    led_color_t manual_color;
+    led_color_t sun_color;
+    led_color_t moon_color;
+    uint32_t scheduler_item_count;
+    struct led_scheduler_item scheduler_items[LYFI_LEDC_SCHEDULER_ITEMS_CAPACITY];
+} __attribute__((packed));
+
+static struct led_settings_image _saved_image; ///< As last written to NVS
+static int _persist_section = -1;
+
+static int led_flush_user_settings(void* ctx);
+
 static const struct led_user_settings LED_DEFAULT_SETTINGS = {
     .mode = LED_MODE_MANUAL,
     .temporary_duration = 20,
@@ -232,15 +281,12 @@ int led_load_factory_settings()
     return 0;
 }
 
-int led_load_user_settings()
+/**
+ * @brief Reads the key-per-field layout used before the settings image, missing keys get their defaults.
+ */
+static int led_load_legacy_settings(nvs_handle_t handle, struct led_user_settings* settings)
 {
-    struct led_user_settings* settings = &_led.settings;
     size_t size;
-
-    nvs_handle_t handle;
-    BO_TRY(bo_nvs_user_open(LED_NVS_NS, NVS_READWRITE, &handle));
-    BO_NVS_AUTO_CLOSE(handle);
-
     int rc;
 
     {
@@ -468,50 +514,252 @@ int led_load_user_settings()
         }
     }
 
+    return rc;
+}
+
+static uint32_t led_image_crc32(const uint8_t* blob, size_t size, uint16_t version)
+{
+    const struct led_settings_image_header* header = (const struct led_settings_image_header*)blob;
+    uint32_t crc = 0;
+    if (version >= 2) {
+        crc = esp_rom_crc32_le(crc, blob, offsetof(struct led_settings_image_header, crc32));
+    }
+    return esp_rom_crc32_le(crc, blob + sizeof(*header), size - sizeof(*header));
+}
+
+static void led_image_pack(const struct led_user_settings* settings, struct led_settings_image* image)
+{
+    memset(image, 0, sizeof(*image));
+    image->header.version = LED_SETTINGS_IMAGE_VERSION;
+    image->header.size = sizeof(*image);
+    image->header.channel_count = CONFIG_LYFI_LED_CHANNEL_COUNT;
+
+    image->mode = settings->mode;
+    image->correction_method = settings->correction_method;
+    image->acclimation_duration = settings->acclimation.duration;
+    image->acclimation_start_percent = settings->acclimation.start_percent;
+    image->flags = settings->flags;
+    image->temporary_duration = settings->temporary_duration;
+    image->tz_offset = settings->tz_offset;
+    image->acclimation_start_utc = settings->acclimation.start_utc;
+    image->location = settings->location;
+    memcpy(image->manual_color, settings->manual_color, sizeof(led_color_t));
+    memcpy(image->sun_color, settings->sun_color, sizeof(led_color_t));
+    memcpy(image->moon_color, settings->moon_color, sizeof(led_color_t));
+    image->scheduler_item_count = (uint32_t)settings->scheduler.item_count;
+    memcpy(image->scheduler_items, settings->scheduler.items, sizeof(image->scheduler_items));
+
+    image->header.crc32 = led_image_crc32((const uint8_t*)image, sizeof(*image), LED_SETTINGS_IMAGE_VERSION);
+}
+
+static void led_image_unpack(const struct led_settings_image* image, struct led_user_settings* settings)
+{
+    settings->mode = image->mode;
+    settings->correction_method = image->correction_method;
+    settings->acclimation.duration = image->acclimation_duration;
+    settings->acclimation.start_percent = image->acclimation_start_percent;
+    settings->flags = image->flags;
+    settings->temporary_duration = image->temporary_duration;
+    settings->tz_offset = image->tz_offset;
+    settings->acclimation.start_utc = image->acclimation_start_utc;
+    settings->location = image->location;
+    memcpy(settings->manual_color, image->manual_color, sizeof(led_color_t));
+    memcpy(settings->sun_color, image->sun_color, sizeof(led_color_t));
+    memcpy(settings->moon_color, image->moon_color, sizeof(led_color_t));
+    settings->scheduler.item_count = image->scheduler_item_count;
+    memcpy(settings->scheduler.items, image->scheduler_items, sizeof(image->scheduler_items));
+
+    if (settings->scheduler.item_count > LYFI_LEDC_SCHEDULER_ITEMS_CAPACITY) {
+        settings->scheduler.item_count = 0;
+    }
+    if (settings->acclimation.duration < LED_ACCLIMATION_DAYS_MIN
+        || settings->acclimation.duration > LED_ACCLIMATION_DAYS_MAX) {
+        settings->acclimation.duration = LED_DEFAULT_SETTINGS.acclimation.duration;
+    }
+    if (settings->acclimation.start_percent < 10 || settings->acclimation.start_percent > 90) {
+        settings->acclimation.start_percent = LED_DEFAULT_SETTINGS.acclimation.start_percent;
+    }
+}
+
+/**
+ * @brief Turns a version N image into version N + 1 in place.
+ * @param size In: the size of the version N image, out: the size of the version N + 1 one
+ * @param capacity Of `blob`, at least the size of the current layout
+ */
+typedef int (*led_image_upgrade_fn)(uint8_t* blob, size_t* size, size_t capacity);
+
+static int led_image_upgrade_v1(uint8_t* blob, size_t* size, size_t capacity)
+{
+    // Same fields, only the CRC changed
+    return 0;
+}
+
+/// Indexed by the version an upgrade starts from, minus one
+static const led_image_upgrade_fn LED_IMAGE_UPGRADES[LED_SETTINGS_IMAGE_VERSION - 1] = {
+    led_image_upgrade_v1,
+};
+
+/**
+ * @brief Brings an image of any version to the current layout.
+ *
+ * Versions only ever append fields, so an image written by a newer firmware is read through the prefix this one
+ * knows, and an older one is upgraded one version at a time by `LED_IMAGE_UPGRADES`.
+ *
+ * @param blob Holds the image as read, `capacity` bytes large
+ * @param version Set to the version of the image as read
+ * @return 0, or -EINVAL if the image is damaged or was written for another channel count
+ */
+static int led_image_migrate(uint8_t* blob, size_t blob_size, size_t capacity, struct led_settings_image* image,
+                             uint16_t* version)
+{
+    struct led_settings_image_header* header = (struct led_settings_image_header*)blob;
+    if (blob_size < sizeof(*header) || header->size != blob_size || header->version == 0
+        || header->channel_count != CONFIG_LYFI_LED_CHANNEL_COUNT) {
+        return -EINVAL;
+    }
+    if (led_image_crc32(blob, blob_size, header->version) != header->crc32) {
+        return -EINVAL;
+    }
+    *version = header->version;
+
+    size_t size = blob_size;
+    for (uint16_t from = header->version; from < LED_SETTINGS_IMAGE_VERSION; from++) {
+        BO_TRY(LED_IMAGE_UPGRADES[from - 1](blob, &size, capacity));
+        header->version = from + 1;
+        header->size = size;
+    }
+    if (size < sizeof(*image)) {
+        return -EINVAL;
+    }
+
+    if ((uint8_t*)image != blob) {
+        memcpy(image, blob, sizeof(*image));
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the settings image.
+ * @param version Set to the version it was stored with
+ * @return 0, -ENOENT if there is none, or -EINVAL if it cannot be used
+ */
+static int led_image_load(nvs_handle_t handle, struct led_settings_image* image, uint16_t* version)
+{
+    size_t size = sizeof(*image);
+    int rc = nvs_get_blob(handle, LED_NVS_KEY_IMAGE, image, &size);
+    if (rc == ESP_ERR_NVS_NOT_FOUND) {
+        return -ENOENT;
+    }
+    if (rc == ESP_OK) {
+        return led_image_migrate((uint8_t*)image, size, sizeof(*image), image, version);
+    }
+    if (rc != ESP_ERR_NVS_INVALID_LENGTH) {
+        return rc;
+    }
+
+    // Written by a newer firmware with more fields
+    BO_TRY(nvs_get_blob(handle, LED_NVS_KEY_IMAGE, NULL, &size));
+    uint8_t* blob = malloc(size);
+    if (blob == NULL) {
+        return -ENOMEM;
+    }
+    rc = nvs_get_blob(handle, LED_NVS_KEY_IMAGE, blob, &size);
+    if (rc == ESP_OK) {
+        rc = led_image_migrate(blob, size, size, image, version);
+    }
+    free(blob);
+    return rc;
+}
+
+int led_load_user_settings()
+{
+    struct led_user_settings* settings = &_led.settings;
+    int64_t begin_us = esp_timer_get_time();
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(LED_NVS_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    uint16_t version = 0;
+    int rc = led_image_load(handle, &_saved_image, &version);
+    if (rc == 0) {
+        led_image_unpack(&_saved_image, settings);
+        ESP_LOGI(TAG, "User settings loaded from image version %u in %lld us", version,
+                 esp_timer_get_time() - begin_us);
+        if (version < LED_SETTINGS_IMAGE_VERSION) {
+            led_image_pack(settings, &_saved_image);
+            BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_IMAGE, &_saved_image, sizeof(_saved_image)));
+            BO_TRY(nvs_commit(handle));
+            ESP_LOGI(TAG, "Settings image upgraded from version %u to %u", version, LED_SETTINGS_IMAGE_VERSION);
+        }
+    }
+    else if (rc == -ENOENT || rc == -EINVAL) {
+        if (rc == -EINVAL) {
+            ESP_LOGW(TAG, "Settings image unusable, falling back to the per-key settings");
+        }
+        // Missing keys get their defaults, a device set up after the image was introduced has none of them
+        BO_TRY(led_load_legacy_settings(handle, settings));
+        ESP_LOGI(TAG, "User settings loaded from per-field keys in %lld us", esp_timer_get_time() - begin_us);
+
+        // The per-field keys are kept for a downgrade, the image wins from the next boot on
+        led_image_pack(settings, &_saved_image);
+        BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_IMAGE, &_saved_image, sizeof(_saved_image)));
+        BO_TRY(nvs_commit(handle));
+        ESP_LOGI(TAG, "User settings migrated to image version %u", LED_SETTINGS_IMAGE_VERSION);
+    }
+    else {
+        return rc;
+    }
+
     // TODO
     // Loading the brightness and power settings...
     // #ifdef CONFIG_LYFI_STANDALONE_CONTROLLER
     // #endif // CONFIG_LYFI_STANDALONE_CONTROLLER
 
-    return rc;
+    if (_persist_section < 0) {
+        _persist_section = bo_persist_register("led", led_flush_user_settings, NULL);
+        if (_persist_section < 0) {
+            return _persist_section;
+        }
+    }
+
+    return 0;
 }
 
-int led_save_user_settings()
+/**
+ * @brief Writes the settings image if it differs from `_saved_image`, the persistence task calls it.
+ * @return Number of keys written
+ */
+static int led_flush_user_settings(void* ctx)
 {
     xSemaphoreTake(_led.settings_lock, portMAX_DELAY);
     BO_SEM_AUTO_RELEASE(_led.settings_lock);
 
-    ESP_LOGI(TAG, "Saving dimming settings...");
+    static struct led_user_settings settings; // Too large for the stack of the persistence task
+    static struct led_settings_image image;
+    portENTER_CRITICAL(&g_led_spinlock);
+    settings = _led.settings;
+    portEXIT_CRITICAL(&g_led_spinlock);
+
+    led_image_pack(&settings, &image);
+    if (memcmp(&image, &_saved_image, sizeof(image)) == 0) {
+        return 0;
+    }
 
-    const struct led_user_settings* settings = &_led.settings;
     nvs_handle_t handle;
     BO_TRY(bo_nvs_user_open(LED_NVS_NS, NVS_READWRITE, &handle));
     BO_NVS_AUTO_CLOSE(handle);
 
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_RUNNING_MODE, settings->mode));
-    BO_TRY(nvs_set_u32(handle, LED_NVS_KEY_TEMPORARY_DURATION, settings->temporary_duration));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_CORRECTION_METHOD, settings->correction_method));
-    BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_SCHEDULER, &settings->scheduler, sizeof(struct led_scheduler)));
-    BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_MANUAL_COLOR, settings->manual_color, sizeof(led_color_t)));
-    BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_SUN_COLOR, settings->sun_color, sizeof(led_color_t)));
-    BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_MOON_COLOR, settings->moon_color, sizeof(led_color_t)));
-
-    if (led_has_geo_location()) {
-        BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_LOC, &settings->location, sizeof(struct geo_location)));
-    }
-
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_TZ_ENABLED, (uint8_t)(settings->flags & LED_OPTION_TZ_ENABLED)));
-    BO_TRY(nvs_set_i32(handle, LED_NVS_KEY_TZ_OFFSET, settings->tz_offset));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_ACCLIMATION_ENABLED, (uint8_t)led_acclimation_is_enabled()));
-    BO_TRY(nvs_set_i64(handle, LED_NVS_KEY_ACCLIMATION_START, settings->acclimation.start_utc));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_ACCLIMATION_DURATION, settings->acclimation.duration));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_ACCLIMATION_START_PERCENT, settings->acclimation.start_percent));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_CLOUD_ENABLED, (uint8_t)(settings->flags & LED_OPTION_CLOUD_ENABLED)));
-    BO_TRY(nvs_set_u8(handle, LED_NVS_KEY_MOON_ENABLED, (uint8_t)(settings->flags & LED_OPTION_MOON_ENABLED)));
-
+    BO_TRY(nvs_set_blob(handle, LED_NVS_KEY_IMAGE, &image, sizeof(image)));
     BO_TRY(nvs_commit(handle));
-    ESP_LOGI(TAG, "Dimming settings updated.");
+    _saved_image = image;
+    return 1;
+}
 
+int led_save_user_settings()
+{
+    atomic_fetch_add(&_led.settings_generation, 1);
+    bo_persist_mark_dirty(_persist_section);
     return 0;
 }
 
@@ -10,6 +10,7 @@ enum {
     LYFI_EVENT_LED_STATE_CHANGED,
     LYFI_EVENT_LED_MODE_CHANGED,
     LYFI_EVENT_LED_NOTIFY_TEMPORARY_STATE,
+    LYFI_EVENT_LED_COLOR_CHANGED, ///< Rate-limited by `CONFIG_LYFI_COLOR_NOTIFY_INTERVAL`
 };
 
 #ifdef __cplusplus
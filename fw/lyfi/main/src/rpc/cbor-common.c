@@ -30,6 +30,22 @@ int cbor_encode_led_sch_item(CborEncoder* encoder, const struct led_scheduler_it
     return 0;
 }
 
+int cbor_encode_led_sch_item_compact(CborEncoder* encoder, const struct led_scheduler_item* sch_item)
+{
+    CborEncoder item_map;
+    BO_TRY(cbor_encoder_create_map(encoder, &item_map, LYFI_SCH_ITEM_KEY_COUNT));
+
+    BO_TRY(cbor_encode_uint(&item_map, LYFI_SCH_ITEM_KEY_INSTANT));
+    BO_TRY(cbor_encode_uint(&item_map, sch_item->instant));
+
+    BO_TRY(cbor_encode_uint(&item_map, LYFI_SCH_ITEM_KEY_COLOR));
+    BO_TRY(cbor_encode_color_packed(&item_map, sch_item->color));
+
+    BO_TRY(cbor_encoder_close_container(encoder, &item_map));
+
+    return 0;
+}
+
 int cbor_encode_color(CborEncoder* encoder, const led_color_t color)
 {
     CborEncoder ch_array;
@@ -41,6 +57,27 @@ int cbor_encode_color(CborEncoder* encoder, const led_color_t color)
     return 0;
 }
 
+int cbor_encode_color_packed(CborEncoder* encoder, const led_color_t color)
+{
+    uint8_t buf[sizeof(led_color_t)];
+    for (size_t ch = 0; ch < led_channel_count(); ch++) {
+        buf[ch * 2] = (uint8_t)(color[ch] >> 8);
+        buf[ch * 2 + 1] = (uint8_t)(color[ch] & 0xFF);
+    }
+    BO_TRY(cbor_encode_byte_string(encoder, buf, led_channel_count() * 2));
+    return 0;
+}
+
+int cbor_encode_color_as(CborEncoder* encoder, bool compact, const led_color_t color)
+{
+    return compact ? cbor_encode_color_packed(encoder, color) : cbor_encode_color(encoder, color);
+}
+
+int cbor_encode_key(CborEncoder* map, bool compact, uint8_t key, const char* name)
+{
+    return compact ? cbor_encode_uint(map, key) : cbor_encode_text_stringz(map, name);
+}
+
 int cbor_value_get_led_color(CborValue* value, led_color_t color)
 {
     CborValue array;
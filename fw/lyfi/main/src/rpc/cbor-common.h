@@ -4,8 +4,80 @@
 extern "C" {
 #endif
 
+/*
+ * Compact wire schema, requested with the `compact` CoAP query option: definite-length maps keyed by the small
+ * integers below instead of text, and colors packed into a byte string of big-endian 16-bit brightnesses. Keys are
+ * part of the protocol, never renumber them.
+ */
+
+enum lyfi_status_keys {
+    LYFI_STATUS_KEY_STATE = 0,
+    LYFI_STATUS_KEY_MODE = 1,
+    LYFI_STATUS_KEY_UNSCHEDULED = 2,
+    LYFI_STATUS_KEY_TEMPERATURE = 3,
+    LYFI_STATUS_KEY_POWER_CURRENT = 4,
+    LYFI_STATUS_KEY_TEMP_REMAIN = 5,
+    LYFI_STATUS_KEY_FAN_POWER = 6,
+    LYFI_STATUS_KEY_CURRENT_COLOR = 7,
+    LYFI_STATUS_KEY_MANUAL_COLOR = 8,
+    LYFI_STATUS_KEY_SUN_COLOR = 9,
+    LYFI_STATUS_KEY_ACCLIMATION_ENABLED = 10,
+    LYFI_STATUS_KEY_ACCLIMATION_ACTIVATED = 11,
+    LYFI_STATUS_KEY_CLOUD_ENABLED = 12,
+    LYFI_STATUS_KEY_CLOUD_ACTIVATED = 13,
+};
+
+#if CONFIG_LYFI_NTC_SUPPORT
+#define _LYFI_STATUS_HAS_TEMPERATURE 1
+#else
+#define _LYFI_STATUS_HAS_TEMPERATURE 0
+#endif
+
+#if CONFIG_LYFI_MEAS_CURRENT_SUPPORT
+#define _LYFI_STATUS_HAS_POWER_CURRENT 1
+#else
+#define _LYFI_STATUS_HAS_POWER_CURRENT 0
+#endif
+
+#if CONFIG_LYFI_FAN_CTRL_SUPPORT
+#define _LYFI_STATUS_HAS_FAN_POWER 1
+#else
+#define _LYFI_STATUS_HAS_FAN_POWER 0
+#endif
+
+/// Number of entries in the compact status map of this build
+#define LYFI_STATUS_KEY_COUNT                                                                                          \
+    (11 + _LYFI_STATUS_HAS_TEMPERATURE + _LYFI_STATUS_HAS_POWER_CURRENT + _LYFI_STATUS_HAS_FAN_POWER)
+
+enum lyfi_info_keys {
+    LYFI_INFO_KEY_NOMINAL_POWER = 0,
+    LYFI_INFO_KEY_CHANNEL_COUNT_MAX = 1,
+    LYFI_INFO_KEY_CHANNEL_COUNT = 2,
+    LYFI_INFO_KEY_CHANNELS = 3,
+};
+
+#define LYFI_INFO_KEY_COUNT (3 + (CONFIG_LYFI_LED_NOMINAL_POWER ? 1 : 0))
+
+enum lyfi_channel_keys {
+    LYFI_CHANNEL_KEY_NAME = 0,
+    LYFI_CHANNEL_KEY_COLOR = 1,
+    LYFI_CHANNEL_KEY_WAVELENGTH = 2,
+    LYFI_CHANNEL_KEY_BRIGHTNESS_PERCENT = 3,
+    LYFI_CHANNEL_KEY_COUNT,
+};
+
+enum lyfi_sch_item_keys {
+    LYFI_SCH_ITEM_KEY_INSTANT = 0,
+    LYFI_SCH_ITEM_KEY_COLOR = 1,
+    LYFI_SCH_ITEM_KEY_COUNT,
+};
+
 int cbor_encode_led_sch_item(CborEncoder* encoder, const struct led_scheduler_item* sch_item);
+int cbor_encode_led_sch_item_compact(CborEncoder* encoder, const struct led_scheduler_item* sch_item);
 int cbor_encode_color(CborEncoder* encoder, const led_color_t color);
+int cbor_encode_color_packed(CborEncoder* encoder, const led_color_t color);
+int cbor_encode_color_as(CborEncoder* encoder, bool compact, const led_color_t color);
+int cbor_encode_key(CborEncoder* map, bool compact, uint8_t key, const char* name);
 int cbor_value_get_led_color(CborValue* value, led_color_t color);
 
 #ifdef __cplusplus
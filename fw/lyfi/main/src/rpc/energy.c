@@ -0,0 +1,79 @@
+#include <esp_system.h>
+#include <esp_event.h>
+#include <esp_log.h>
+
+#include <cbor.h>
+
+#include <drvfx/drvfx.h>
+#include <borneo/system.h>
+#include <borneo/common.h>
+
+#include "../energy.h"
+#include "rpc.h"
+
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+
+#define TAG "lyfi-rpc-energy"
+
+static int _encode_u32_array(CborEncoder* parent, const char* key, const uint32_t* values, size_t count)
+{
+    CborEncoder array;
+    BO_TRY(cbor_encode_text_stringz(parent, key));
+    BO_TRY(cbor_encoder_create_array(parent, &array, count));
+    for (size_t i = 0; i < count; i++) {
+        BO_TRY(cbor_encode_uint(&array, values[i]));
+    }
+    BO_TRY(cbor_encoder_close_container(parent, &array));
+    return 0;
+}
+
+int bo_rpc_borneo_lyfi_energy_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+
+    struct energy_stats stats;
+    energy_get_stats(&stats);
+
+    CborEncoder root_map;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    {
+        BO_TRY(cbor_encode_text_stringz(&root_map, "total"));
+        BO_TRY(cbor_encode_uint(&root_map, stats.total_mj / ENERGY_MJ_PER_MWH));
+    }
+
+    {
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "channels"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, CONFIG_LYFI_LED_CHANNEL_COUNT));
+        for (size_t ch = 0; ch < CONFIG_LYFI_LED_CHANNEL_COUNT; ch++) {
+            BO_TRY(cbor_encode_uint(&array, stats.channels_mj[ch] / ENERGY_MJ_PER_MWH));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    {
+        BO_TRY(cbor_encode_text_stringz(&root_map, "hourStart"));
+        BO_TRY(cbor_encode_int(&root_map, stats.hour_start));
+        BO_TRY(_encode_u32_array(&root_map, "hourly", stats.hourly_mwh, ENERGY_HOURLY_BUCKETS));
+    }
+
+    {
+        BO_TRY(cbor_encode_text_stringz(&root_map, "dayStart"));
+        BO_TRY(cbor_encode_int(&root_map, stats.day_start));
+        BO_TRY(_encode_u32_array(&root_map, "daily", stats.daily_mwh, ENERGY_DAILY_BUCKETS));
+    }
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+    return 0;
+}
+
+int bo_rpc_borneo_lyfi_energy_delete(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    (void)retvals;
+    BO_TRY(energy_reset());
+    return 0;
+}
+
+#endif // CONFIG_LYFI_ENERGY_METER_ENABLED
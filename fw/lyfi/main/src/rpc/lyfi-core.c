@@ -13,6 +13,7 @@
 #include <borneo/system.h>
 #include <borneo/common.h>
 #include <borneo/devices/sensor.h>
+#include <borneo/coap.h>
 
 #include "../fan.h"
 #include "../led/led.h"
@@ -23,21 +24,21 @@
 #define TAG "lyfi-core-rpc"
 
 static int _encode_channel_info_entry(CborEncoder* parent, const struct led_channel_settings* channel,
-                                      uint32_t brightness_percent, uint32_t power)
+                                      uint32_t brightness_percent, uint32_t power, bool compact)
 {
     CborEncoder ch_map;
-    BO_TRY(cbor_encoder_create_map(parent, &ch_map, CborIndefiniteLength));
+    BO_TRY(cbor_encoder_create_map(parent, &ch_map, compact ? LYFI_CHANNEL_KEY_COUNT : CborIndefiniteLength));
 
-    BO_TRY(cbor_encode_text_stringz(&ch_map, "name"));
+    BO_TRY(cbor_encode_key(&ch_map, compact, LYFI_CHANNEL_KEY_NAME, "name"));
     BO_TRY(cbor_encode_text_stringz(&ch_map, channel->name));
 
-    BO_TRY(cbor_encode_text_stringz(&ch_map, "color"));
+    BO_TRY(cbor_encode_key(&ch_map, compact, LYFI_CHANNEL_KEY_COLOR, "color"));
     BO_TRY(cbor_encode_text_stringz(&ch_map, channel->color));
 
-    BO_TRY(cbor_encode_text_stringz(&ch_map, "wavelength"));
+    BO_TRY(cbor_encode_key(&ch_map, compact, LYFI_CHANNEL_KEY_WAVELENGTH, "wavelength"));
     BO_TRY(cbor_encode_int(&ch_map, channel->wavelength));
 
-    BO_TRY(cbor_encode_text_stringz(&ch_map, "brightnessPercent"));
+    BO_TRY(cbor_encode_key(&ch_map, compact, LYFI_CHANNEL_KEY_BRIGHTNESS_PERCENT, "brightnessPercent"));
     BO_TRY(cbor_encode_uint(&ch_map, brightness_percent));
 
     BO_TRY(cbor_encoder_close_container(parent, &ch_map));
@@ -45,7 +46,7 @@ static int _encode_channel_info_entry(CborEncoder* parent, const struct led_chan
     return 0;
 }
 
-static int _encode_channel_info_array(CborEncoder* parent)
+static int _encode_channel_info_array(CborEncoder* parent, bool compact)
 {
     size_t chcount = led_channel_count();
     CborEncoder channels_array;
@@ -57,7 +58,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH0_ENABLED
     if (chcount >= 1) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[0],
-                                          CONFIG_LYFI_LED_CH0_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH0_POWER));
+                                          CONFIG_LYFI_LED_CH0_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH0_POWER,
+                                          compact));
     }
 #endif
 
@@ -65,7 +67,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH1_ENABLED
     if (chcount >= 2) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[1],
-                                          CONFIG_LYFI_LED_CH1_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH1_POWER));
+                                          CONFIG_LYFI_LED_CH1_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH1_POWER,
+                                          compact));
     }
 #endif
 
@@ -73,7 +76,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH2_ENABLED
     if (chcount >= 3) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[2],
-                                          CONFIG_LYFI_LED_CH2_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH2_POWER));
+                                          CONFIG_LYFI_LED_CH2_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH2_POWER,
+                                          compact));
     }
 #endif
 
@@ -81,7 +85,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH3_ENABLED
     if (chcount >= 4) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[3],
-                                          CONFIG_LYFI_LED_CH3_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH3_POWER));
+                                          CONFIG_LYFI_LED_CH3_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH3_POWER,
+                                          compact));
     }
 #endif
 
@@ -89,7 +94,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH4_ENABLED
     if (chcount >= 5) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[4],
-                                          CONFIG_LYFI_LED_CH4_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH4_POWER));
+                                          CONFIG_LYFI_LED_CH4_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH4_POWER,
+                                          compact));
     }
 #endif
 
@@ -97,7 +103,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH5_ENABLED
     if (chcount >= 6) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[5],
-                                          CONFIG_LYFI_LED_CH5_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH5_POWER));
+                                          CONFIG_LYFI_LED_CH5_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH5_POWER,
+                                          compact));
     }
 #endif
 
@@ -105,7 +112,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH6_ENABLED
     if (chcount >= 7) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[6],
-                                          CONFIG_LYFI_LED_CH6_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH6_POWER));
+                                          CONFIG_LYFI_LED_CH6_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH6_POWER,
+                                          compact));
     }
 #endif
 
@@ -113,7 +121,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH7_ENABLED
     if (chcount >= 8) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[7],
-                                          CONFIG_LYFI_LED_CH7_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH7_POWER));
+                                          CONFIG_LYFI_LED_CH7_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH7_POWER,
+                                          compact));
     }
 #endif
 
@@ -121,7 +130,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH8_ENABLED
     if (chcount >= 9) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[8],
-                                          CONFIG_LYFI_LED_CH0_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH0_POWER));
+                                          CONFIG_LYFI_LED_CH0_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH0_POWER,
+                                          compact));
     }
 #endif
 
@@ -129,7 +139,8 @@ static int _encode_channel_info_array(CborEncoder* parent)
 #if CONFIG_LYFI_LED_CH9_ENABLED
     if (chcount >= 10) {
         BO_TRY(_encode_channel_info_entry(&channels_array, &factory->channels[9],
-                                          CONFIG_LYFI_LED_CH8_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH8_POWER));
+                                          CONFIG_LYFI_LED_CH8_BRIGHTNESS_PERCENT, CONFIG_LYFI_LED_CH8_POWER,
+                                          compact));
     }
 #endif
 
@@ -158,6 +169,88 @@ int bo_rpc_borneo_lyfi_color_put(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
+#if CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+/**
+ * @brief Schedules a synchronized group command.
+ *
+ * Args: `{"group": uint, "at": Unix time in ms, "state"?: uint, "color"?: [uint...]}`. A color needs `state` to be
+ * dimming, see `led_schedule_group_command()`.
+ *
+ * @return -ENOENT if this device is not a member of the group, -EINVAL if the command cannot be applied
+ */
+int bo_rpc_borneo_lyfi_group_command_post(const CborValue* args, CborEncoder* retvals)
+{
+    (void)retvals;
+    if (!cbor_value_is_map(args)) {
+        return -EINVAL;
+    }
+
+    CborValue value;
+    uint64_t group;
+    BO_TRY(cbor_value_map_find_value(args, "group", &value));
+    if (!cbor_value_is_unsigned_integer(&value)) {
+        return -EINVAL;
+    }
+    BO_TRY(cbor_value_get_uint64(&value, &group));
+    if (group > UINT16_MAX) {
+        return -EINVAL;
+    }
+    if (!bo_coap_group_is_member((uint16_t)group)) {
+        return -ENOENT;
+    }
+
+    struct led_group_command command = { 0 };
+    BO_TRY(cbor_value_map_find_value(args, "at", &value));
+    if (!cbor_value_is_integer(&value)) {
+        return -EINVAL;
+    }
+    BO_TRY(cbor_value_get_int64_checked(&value, &command.apply_at_ms));
+
+    BO_TRY(cbor_value_map_find_value(args, "state", &value));
+    if (cbor_value_is_valid(&value)) {
+        int state;
+        BO_TRY(cbor_value_get_int_checked(&value, &state));
+        if (state < 0 || state >= LED_STATE_COUNT) {
+            return -EINVAL;
+        }
+        command.has_state = true;
+        command.state = (uint8_t)state;
+    }
+
+    BO_TRY(cbor_value_map_find_value(args, "color", &value));
+    if (cbor_value_is_valid(&value)) {
+        BO_TRY(cbor_value_get_led_color(&value, command.color));
+        command.has_color = true;
+    }
+
+    BO_TRY(led_schedule_group_command(&command));
+    return 0;
+}
+
+#endif // CONFIG_BORNEO_COAP_MULTICAST_ENABLED
+
+int bo_rpc_borneo_lyfi_color_stream_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    const struct led_color_stream* stream = &led_get_status()->stream;
+
+    CborEncoder root_map;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "seq"));
+    BO_TRY(cbor_encode_uint(&root_map, stream->seq));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "accepted"));
+    BO_TRY(cbor_encode_uint(&root_map, stream->accepted));
+
+    BO_TRY(cbor_encode_text_stringz(&root_map, "dropped"));
+    BO_TRY(cbor_encode_uint(&root_map, stream->dropped));
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+    return 0;
+}
+
 int bo_rpc_borneo_lyfi_schedule_get(const CborValue* args, CborEncoder* retvals)
 {
     (void)args;
@@ -173,6 +266,20 @@ int bo_rpc_borneo_lyfi_schedule_get(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
+int bo_rpc_borneo_lyfi_schedule_get_compact(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    const struct led_scheduler* sch = led_get_schedule();
+    CborEncoder root_array;
+    BO_TRY(cbor_encoder_create_array(retvals, &root_array, sch->item_count));
+    for (size_t i = 0; i < sch->item_count; i++) {
+        BO_TRY(cbor_encode_led_sch_item_compact(&root_array, &sch->items[i]));
+    }
+    BO_TRY(cbor_encoder_close_container(retvals, &root_array));
+
+    return 0;
+}
+
 int bo_rpc_borneo_lyfi_schedule_put(const CborValue* args, CborEncoder* retvals)
 {
     if (!cbor_value_is_container(args)) {
@@ -212,33 +319,31 @@ int bo_rpc_borneo_lyfi_schedule_put(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
-int bo_rpc_borneo_lyfi_info_get(const CborValue* args, CborEncoder* retvals)
+static int _encode_info(CborEncoder* retvals, bool compact)
 {
-    (void)args;
-
     CborEncoder root_map;
-    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, compact ? LYFI_INFO_KEY_COUNT : CborIndefiniteLength));
 
 #if CONFIG_LYFI_LED_NOMINAL_POWER
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "nominalPower"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_INFO_KEY_NOMINAL_POWER, "nominalPower"));
         BO_TRY(cbor_encode_uint(&root_map, CONFIG_LYFI_LED_NOMINAL_POWER));
     }
 #endif // CONFIG_LYFI_LED_NOMINAL_POWER
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "channelCountMax"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_INFO_KEY_CHANNEL_COUNT_MAX, "channelCountMax"));
         BO_TRY(cbor_encode_uint(&root_map, CONFIG_LYFI_LED_CHANNEL_COUNT));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "channelCount"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_INFO_KEY_CHANNEL_COUNT, "channelCount"));
         BO_TRY(cbor_encode_uint(&root_map, led_channel_count()));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "channels"));
-        BO_TRY(_encode_channel_info_array(&root_map));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_INFO_KEY_CHANNELS, "channels"));
+        BO_TRY(_encode_channel_info_array(&root_map, compact));
     }
 
     BO_TRY(cbor_encoder_close_container(retvals, &root_map));
@@ -246,32 +351,43 @@ int bo_rpc_borneo_lyfi_info_get(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
-int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
+int bo_rpc_borneo_lyfi_info_get(const CborValue* args, CborEncoder* retvals)
 {
     (void)args;
+    return _encode_info(retvals, false);
+}
+
+int bo_rpc_borneo_lyfi_info_get_compact(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    return _encode_info(retvals, true);
+}
+
+static int _encode_status(CborEncoder* retvals, bool compact)
+{
     CborEncoder root_map;
-    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, compact ? LYFI_STATUS_KEY_COUNT : CborIndefiniteLength));
 
     const struct led_user_settings* led_settings = led_get_settings();
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "state"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_STATE, "state"));
         BO_TRY(cbor_encode_uint(&root_map, led_get_state()));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "mode"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_MODE, "mode"));
         BO_TRY(cbor_encode_uint(&root_map, led_settings->mode));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "unscheduled"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_UNSCHEDULED, "unscheduled"));
         BO_TRY(cbor_encode_boolean(&root_map, led_get_state() == LED_STATE_TEMPORARY));
     }
 
 #if CONFIG_LYFI_NTC_SUPPORT
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "temperature"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_TEMPERATURE, "temperature"));
         int32_t temp;
         const struct drvfx_device* temp_dev = k_device_get_binding("sensor.temp");
         int rc = sensor_get_value(temp_dev, &temp);
@@ -279,14 +395,14 @@ int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
             BO_TRY(cbor_encode_null(&root_map));
         }
         else {
-            BO_TRY(cbor_encode_int(&root_map, temp));
+            BO_TRY(cbor_encode_int(&root_map, sensor_temp_to_celsius(temp)));
         }
     }
 #endif // CONFIG_LYFI_NTC_SUPPORT
 
 #if CONFIG_LYFI_MEAS_CURRENT_SUPPORT
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "powerCurrent"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_POWER_CURRENT, "powerCurrent"));
         int32_t ma;
         const struct drvfx_device* sensor_dev = k_device_get_binding("sensor.led_current");
         int rc = sensor_get_value(sensor_dev, &ma);
@@ -300,7 +416,7 @@ int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
 #endif // CONFIG_LYFI_MEAS_CURRENT_SUPPORT
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "tempRemain"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_TEMP_REMAIN, "tempRemain"));
         int32_t remaining = led_get_temporary_remaining();
         if (remaining < 0) {
             remaining = 0;
@@ -310,46 +426,46 @@ int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
 
 #if CONFIG_LYFI_FAN_CTRL_SUPPORT
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "fanPower"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_FAN_POWER, "fanPower"));
         const struct fan_status fs = fan_get_status();
         BO_TRY(cbor_encode_uint(&root_map, fs.power));
     }
 #endif // CONFIG_LYFI_FAN_CTRL_SUPPORT
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "currentColor"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_CURRENT_COLOR, "currentColor"));
         led_color_t color;
         BO_TRY(led_get_color(color));
-        BO_TRY(cbor_encode_color(&root_map, color));
+        BO_TRY(cbor_encode_color_as(&root_map, compact, color));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "manualColor"));
-        BO_TRY(cbor_encode_color(&root_map, led_get_settings()->manual_color));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_MANUAL_COLOR, "manualColor"));
+        BO_TRY(cbor_encode_color_as(&root_map, compact, led_get_settings()->manual_color));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "sunColor"));
-        BO_TRY(cbor_encode_color(&root_map, led_get_settings()->sun_color));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_SUN_COLOR, "sunColor"));
+        BO_TRY(cbor_encode_color_as(&root_map, compact, led_get_settings()->sun_color));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "acclimationEnabled"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_ACCLIMATION_ENABLED, "acclimationEnabled"));
         BO_TRY(cbor_encode_boolean(&root_map, led_acclimation_is_enabled()));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "acclimationActivated"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_ACCLIMATION_ACTIVATED, "acclimationActivated"));
         BO_TRY(cbor_encode_boolean(&root_map, led_acclimation_is_activated()));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "cloudEnabled"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_CLOUD_ENABLED, "cloudEnabled"));
         BO_TRY(cbor_encode_boolean(&root_map, led_cloud_is_enabled()));
     }
 
     {
-        BO_TRY(cbor_encode_text_stringz(&root_map, "cloudActivated"));
+        BO_TRY(cbor_encode_key(&root_map, compact, LYFI_STATUS_KEY_CLOUD_ACTIVATED, "cloudActivated"));
         BO_TRY(cbor_encode_boolean(&root_map, led_cloud_is_activated()));
     }
 
@@ -358,6 +474,18 @@ int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
+int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    return _encode_status(retvals, false);
+}
+
+int bo_rpc_borneo_lyfi_status_get_compact(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+    return _encode_status(retvals, true);
+}
+
 int bo_rpc_borneo_lyfi_temp_get(const CborValue* args, CborEncoder* retvals)
 {
     (void)args;
@@ -365,8 +493,8 @@ int bo_rpc_borneo_lyfi_temp_get(const CborValue* args, CborEncoder* retvals)
     int32_t temp;
     const struct drvfx_device* temp_dev = k_device_get_binding("sensor.temp");
     int rc = sensor_get_value(temp_dev, &temp);
-    if (rc != 0) {
-        BO_TRY(cbor_encode_int(retvals, temp));
+    if (rc == 0) {
+        BO_TRY(cbor_encode_int(retvals, sensor_temp_to_celsius(temp)));
     }
     else {
         BO_TRY(cbor_encode_null(retvals));
@@ -378,6 +506,95 @@ int bo_rpc_borneo_lyfi_temp_get(const CborValue* args, CborEncoder* retvals)
     return 0;
 }
 
+int bo_rpc_borneo_lyfi_channel_current_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+#if CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+    int32_t currents[CONFIG_LYFI_LED_CHANNEL_COUNT];
+    if (led_current_get_channels(currents) != 0) {
+        BO_TRY(cbor_encode_null(retvals));
+        return 0;
+    }
+
+    CborEncoder root_map;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    {
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "current"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, led_channel_count()));
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            BO_TRY(cbor_encode_int(&array, currents[ch]));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    {
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "fullScale"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, led_channel_count()));
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            int32_t full_scale;
+            BO_TRY(led_current_get_full_scale(ch, &full_scale));
+            BO_TRY(cbor_encode_int(&array, full_scale));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    {
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "fault"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, led_channel_count()));
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            BO_TRY(cbor_encode_uint(&array, led_current_get_channel_fault(ch)));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+#else
+    BO_TRY(cbor_encode_null(retvals));
+#endif // CONFIG_LYFI_MEAS_CHANNEL_CURRENT_SUPPORT
+
+    return 0;
+}
+
+int bo_rpc_borneo_lyfi_channel_aging_get(const CborValue* args, CborEncoder* retvals)
+{
+    (void)args;
+#if CONFIG_LYFI_LED_AGING_ENABLED
+    CborEncoder root_map;
+    BO_TRY(cbor_encoder_create_map(retvals, &root_map, CborIndefiniteLength));
+
+    {
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "hours"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, led_channel_count()));
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            BO_TRY(cbor_encode_uint(&array, led_aging_get_hours(ch)));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    {
+        // Q16 gain applied by the lumen maintenance compensation, 65536 means no compensation
+        CborEncoder array;
+        BO_TRY(cbor_encode_text_stringz(&root_map, "gain"));
+        BO_TRY(cbor_encoder_create_array(&root_map, &array, led_channel_count()));
+        for (size_t ch = 0; ch < led_channel_count(); ch++) {
+            BO_TRY(cbor_encode_uint(&array, led_aging_get_gain(ch)));
+        }
+        BO_TRY(cbor_encoder_close_container(&root_map, &array));
+    }
+
+    BO_TRY(cbor_encoder_close_container(retvals, &root_map));
+#else
+    BO_TRY(cbor_encode_null(retvals));
+#endif // CONFIG_LYFI_LED_AGING_ENABLED
+
+    return 0;
+}
+
 int bo_rpc_borneo_lyfi_state_get(const CborValue* args, CborEncoder* retvals)
 {
     (void)args;
@@ -11,6 +11,14 @@ int bo_rpc_lyfi_power_mw_get(const CborValue* args, CborEncoder* retvals);
 
 #endif // CONFIG_BORNEO_MEAS_VOLTAGE_SUPPORT && CONFIG_LYFI_MEAS_CURRENT_SUPPORT
 
+#if CONFIG_LYFI_ENERGY_METER_ENABLED
+
+// RPC function declarations for LyFi energy meter CBOR operations
+int bo_rpc_borneo_lyfi_energy_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_energy_delete(const CborValue* args, CborEncoder* retvals);
+
+#endif // CONFIG_LYFI_ENERGY_METER_ENABLED
+
 // RPC function declarations for LyFi fan CBOR operations
 int bo_rpc_borneo_lyfi_fan_power_get(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_fan_power_put(const CborValue* args, CborEncoder* retvals);
@@ -54,11 +62,18 @@ int bo_rpc_borneo_lyfi_acclimation_delete(const CborValue* args, CborEncoder* re
 // RPC function declarations for LyFi core CBOR operations
 int bo_rpc_borneo_lyfi_color_get(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_color_put(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_color_stream_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_group_command_post(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_schedule_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_schedule_get_compact(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_schedule_put(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_info_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_info_get_compact(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_status_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_status_get_compact(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_temp_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_channel_current_get(const CborValue* args, CborEncoder* retvals);
+int bo_rpc_borneo_lyfi_channel_aging_get(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_state_get(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_state_put(const CborValue* args, CborEncoder* retvals);
 int bo_rpc_borneo_lyfi_correction_method_get(const CborValue* args, CborEncoder* retvals);
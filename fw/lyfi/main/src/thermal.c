@@ -2,6 +2,7 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include <esp_system.h>
 #include <esp_event.h>
@@ -17,12 +18,14 @@
 #include <borneo/devices/sensor.h>
 #include <borneo/power.h>
 #include <borneo/nvs.h>
+#include <borneo/persist.h>
 
 #include "fan.h"
 #include "protect.h"
 #include "thermal.h"
 
 #define TEMP_WINDOW_SIZE 8
+#define TEMP_INVALID INT16_MIN
 
 #if CONFIG_LYFI_THERMAL_ENABLED
 
@@ -36,19 +39,20 @@ struct thermal_state {
     const struct drvfx_device* temp_dev;
     esp_timer_handle_t timer;
     struct pid pid;
-    int current_temp;
-    int8_t temp_window[TEMP_WINDOW_SIZE];
+    int32_t current_temp; ///< Averaged temperature in 1/SENSOR_TEMP_SCALE ℃
+    int16_t temp_window[TEMP_WINDOW_SIZE];
     uint8_t temp_window_index;
 };
 
 static int load_factory_settings();
 static int load_user_settings();
+static int flush_user_settings(void* ctx);
 static void thermal_timer_callback(void* args);
 static int thermal_reinit();
 
 #if CONFIG_LYFI_NTC_SUPPORT
 static uint8_t thermal_pid_step(int32_t current_temp);
-static int update_temp_average(int new_sample);
+static int update_temp_average(int32_t new_sample);
 #endif
 
 #if CONFIG_LYFI_NTC_SUPPORT
@@ -77,6 +81,9 @@ static void _timer_callback_pid(void* args);
 #define PID_INTEGRAL_MAX 10000
 #define PID_INTEGRAL_MIN -10000
 
+// Dead zone around the target temperature, in 1/SENSOR_TEMP_SCALE ℃ (±1 ℃)
+#define PID_DEAD_ZONE (1 * SENSOR_TEMP_SCALE)
+
 #define OUTPUT_MIN 10
 #define OUTPUT_MAX 100
 
@@ -96,7 +103,9 @@ const struct thermal_settings THERMAL_DEFAULT_SETTINGS = {
 };
 
 static struct thermal_settings _settings = { 0 };
+static struct thermal_settings _saved_settings = { 0 }; ///< User settings as last written to NVS
 static struct thermal_state _thermal = { 0 };
+static int _persist_section = -1;
 
 static int thermal_reinit()
 {
@@ -125,11 +134,11 @@ int thermal_init()
             int32_t temp;
             int rc = sensor_get_value(_thermal.temp_dev, &temp);
             if (rc == 0) {
-                _thermal.temp_window[ti] = temp;
+                _thermal.temp_window[ti] = (int16_t)temp;
                 _thermal.current_temp = temp;
             }
             else {
-                _thermal.temp_window[ti] = -1;
+                _thermal.temp_window[ti] = TEMP_INVALID;
             }
             vTaskDelay(pdMS_TO_TICKS(10));
         }
@@ -204,9 +213,44 @@ int load_user_settings()
     if (changed) {
         BO_TRY(nvs_commit(handle));
     }
+
+    _saved_settings = _settings;
+    if (_persist_section < 0) {
+        _persist_section = bo_persist_register("thermal", flush_user_settings, NULL);
+        if (_persist_section < 0) {
+            return _persist_section;
+        }
+    }
     return 0;
 }
 
+static int flush_user_settings(void* ctx)
+{
+    uint8_t fan_mode = _settings.fan_mode;
+    uint8_t fan_manual_power = _settings.fan_manual_power;
+    int written = 0;
+
+    nvs_handle_t handle;
+    BO_TRY(bo_nvs_user_open(THERMAL_NVS_USER_NS, NVS_READWRITE, &handle));
+    BO_NVS_AUTO_CLOSE(handle);
+
+    if (fan_mode != _saved_settings.fan_mode) {
+        BO_TRY(nvs_set_u8(handle, THERMAL_NVS_KEY_FAN_MODE, fan_mode));
+        written++;
+    }
+    if (fan_manual_power != _saved_settings.fan_manual_power) {
+        BO_TRY(nvs_set_u8(handle, THERMAL_NVS_KEY_FAN_MANUAL_POWER, fan_manual_power));
+        written++;
+    }
+
+    if (written > 0) {
+        BO_TRY(nvs_commit(handle));
+    }
+    _saved_settings.fan_mode = fan_mode;
+    _saved_settings.fan_manual_power = fan_manual_power;
+    return written;
+}
+
 static void thermal_timer_callback(void* args)
 {
 
@@ -250,7 +294,9 @@ int thermal_set_pid(int32_t kp, int32_t ki, int32_t kd)
 
 #if CONFIG_LYFI_NTC_SUPPORT
 
-int thermal_get_current_temp() { return _thermal.current_temp; }
+int thermal_get_current_temp() { return sensor_temp_to_celsius(_thermal.current_temp); }
+
+int32_t thermal_get_current_temp_fixed() { return _thermal.current_temp; }
 
 static void _timer_callback_pid(void* args)
 {
@@ -272,7 +318,7 @@ static void _timer_callback_pid(void* args)
     uint8_t fan_power_to_set = OUTPUT_MAX;
 
     // If the device has been shut down and the temperature is suitable, turn off the fan.
-    if (_thermal.current_temp <= _settings.keep_temp && !bo_power_is_on()) {
+    if (_thermal.current_temp <= _settings.keep_temp * SENSOR_TEMP_SCALE && !bo_power_is_on()) {
         if (fan_get_power() > 0) {
             fan_set_power(0);
             // pid_clear(&_pid);
@@ -286,20 +332,21 @@ static void _timer_callback_pid(void* args)
 
     if (fan_power_to_set != fan_get_power()) {
         fan_set_power(fan_power_to_set);
-        ESP_LOGI(TAG, "Changing fan power: temp=%d, keep_temp=%d, fan=%u%%\t", _thermal.current_temp,
+        ESP_LOGI(TAG, "Changing fan power: temp=%ld.%ld, keep_temp=%d, fan=%u%%\t",
+                 _thermal.current_temp / SENSOR_TEMP_SCALE, labs(_thermal.current_temp % SENSOR_TEMP_SCALE),
                  _settings.keep_temp, fan_power_to_set);
     }
 }
 
-int update_temp_average(int new_sample)
+int update_temp_average(int32_t new_sample)
 {
-    _thermal.temp_window[_thermal.temp_window_index % TEMP_WINDOW_SIZE] = new_sample;
+    _thermal.temp_window[_thermal.temp_window_index % TEMP_WINDOW_SIZE] = (int16_t)new_sample;
     _thermal.temp_window_index++;
 
-    int sum = 0;
-    int n = 0;
+    int32_t sum = 0;
+    int32_t n = 0;
     for (size_t i = 0; i < TEMP_WINDOW_SIZE; i++) {
-        if (_thermal.temp_window[i] >= 0) {
+        if (_thermal.temp_window[i] != TEMP_INVALID) {
             sum += _thermal.temp_window[i];
             n++;
         }
@@ -307,19 +354,25 @@ int update_temp_average(int new_sample)
     if (n == 0) {
         return -1;
     }
-    _thermal.current_temp = (int)((sum + (n / 2)) / n);
+    _thermal.current_temp = sum >= 0 ? (sum + (n / 2)) / n : (sum - (n / 2)) / n;
     return 0;
 }
 
+/**
+ * @brief One PID iteration.
+ *
+ * `current_temp` and the error are in 1/SENSOR_TEMP_SCALE ℃. The gains keep their per-degree meaning, so the P/I/D
+ * terms are accumulated in the `PID_Q * SENSOR_TEMP_SCALE` domain and scaled down once before quantization.
+ */
 uint8_t thermal_pid_step(int32_t current_temp)
 {
     struct pid* pid = &_thermal.pid;
 
-    int32_t error = current_temp - _settings.keep_temp;
+    int32_t error = current_temp - (int32_t)_settings.keep_temp * SENSOR_TEMP_SCALE;
 
     // Dead zone: Keep the last output within ±1°C and gently release the integral to avoid long-term historical error
     // residue
-    if (abs(error) <= 1) {
+    if (abs(error) <= PID_DEAD_ZONE) {
         pid->integral -= pid->integral / 8;
         return (uint8_t)(pid->last_output);
     }
@@ -329,7 +382,7 @@ uint8_t thermal_pid_step(int32_t current_temp)
     const int32_t ki_eff = (int32_t)((int64_t)_settings.ki * dt_ms / 1000); // Ki * dt
     const int32_t kd_eff = (int32_t)((int64_t)_settings.kd * 1000 / dt_ms); // Kd / dt
 
-    // Calculate each term (still in PID_Q amplified domain)
+    // Calculate each term (in PID_Q * SENSOR_TEMP_SCALE amplified domain)
     int32_t p_term = _settings.kp * error;
     int32_t d_term = kd_eff * (error - pid->prev_error);
 
@@ -337,8 +390,8 @@ uint8_t thermal_pid_step(int32_t current_temp)
     int32_t out_unsat = p_term + pid->integral + d_term;
 
     // Saturation boundaries (Q domain)
-    const int32_t hi_q = OUTPUT_MAX * PID_Q;
-    const int32_t lo_q = OUTPUT_MIN * PID_Q;
+    const int32_t hi_q = OUTPUT_MAX * PID_Q * SENSOR_TEMP_SCALE;
+    const int32_t lo_q = OUTPUT_MIN * PID_Q * SENSOR_TEMP_SCALE;
     // Below this threshold, the fan is considered off
 
     bool sat_hi = out_unsat > hi_q;
@@ -354,12 +407,12 @@ uint8_t thermal_pid_step(int32_t current_temp)
     if (sat_lo && error < 0)
         allow_i = false;
 
-    if (abs(error) > 1 && allow_i) {
+    if (allow_i) {
         int64_t new_i = (int64_t)pid->integral + (int64_t)ki_eff * error;
-        if (new_i > PID_INTEGRAL_MAX)
-            new_i = PID_INTEGRAL_MAX;
-        if (new_i < PID_INTEGRAL_MIN)
-            new_i = PID_INTEGRAL_MIN;
+        if (new_i > PID_INTEGRAL_MAX * SENSOR_TEMP_SCALE)
+            new_i = PID_INTEGRAL_MAX * SENSOR_TEMP_SCALE;
+        if (new_i < PID_INTEGRAL_MIN * SENSOR_TEMP_SCALE)
+            new_i = PID_INTEGRAL_MIN * SENSOR_TEMP_SCALE;
         pid->integral = (int32_t)new_i;
     }
 
@@ -376,7 +429,7 @@ uint8_t thermal_pid_step(int32_t current_temp)
         out = OUTPUT_MAX;
     }
     else {
-        out = (uint8_t)(out_q / PID_Q);
+        out = (uint8_t)(out_q / (PID_Q * SENSOR_TEMP_SCALE));
     }
 
     int32_t delta = (int32_t)out - pid->last_output;
@@ -402,14 +455,9 @@ int thermal_set_fan_mode(int fan_mode)
         return 0;
     }
 
-    nvs_handle_t handle;
-    BO_TRY(bo_nvs_user_open(THERMAL_NVS_USER_NS, NVS_READWRITE, &handle));
-    BO_NVS_AUTO_CLOSE(handle);
-
-    BO_TRY(nvs_set_u8(handle, THERMAL_NVS_KEY_FAN_MODE, fan_mode));
     _settings.fan_mode = fan_mode;
+    bo_persist_mark_dirty(_persist_section);
 
-    BO_TRY(nvs_commit(handle));
     BO_TRY(thermal_reinit());
     return 0;
 }
@@ -424,14 +472,8 @@ int thermal_set_manual_fan_power(uint8_t power)
         return 0;
     }
 
-    nvs_handle_t handle;
-    BO_TRY(bo_nvs_user_open(THERMAL_NVS_USER_NS, NVS_READWRITE, &handle));
-    BO_NVS_AUTO_CLOSE(handle);
-
-    BO_TRY(nvs_set_u8(handle, THERMAL_NVS_KEY_FAN_MANUAL_POWER, power));
     _settings.fan_manual_power = power;
-
-    BO_TRY(nvs_commit(handle));
+    bo_persist_mark_dirty(_persist_section);
     return 0;
 }
 
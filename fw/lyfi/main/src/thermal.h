@@ -30,6 +30,7 @@ int thermal_set_manual_fan_power(uint8_t power);
 
 #if CONFIG_LYFI_NTC_SUPPORT
 int thermal_get_current_temp();
+int32_t thermal_get_current_temp_fixed();
 #endif
 
 int thermal_set_fan_mode(int fan_mode);
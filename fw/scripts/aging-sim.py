@@ -0,0 +1,216 @@
+"""Multi-year simulation of the LED aging model (`lyfi/main/src/led/aging-model.h`).
+
+Compiles the firmware's `aging-model.c` for the host and drives it the way the aging task does: a sample every
+10 seconds with a little tick jitter, the duty of a daily photoperiod with sunrise/sunset ramps, and a heatsink
+temperature that follows the duty and a seasonal ambient. Next to it a double precision reference integrates the
+same profile.
+
+Checks:
+   - the accumulated stress matches the reference fed with the same Q8 acceleration factors to the millisecond, i.e.
+     the residual carry loses nothing over years of 10 s increments
+   - against the unquantized Arrhenius factor the stress stays within `--tolerance` percent
+   - the compensation gain never decreases, never exceeds the configured maximum and matches 1 / exp(-a * t)
+   - a channel held at full duty and reference temperature reaches L70 at the rated hours
+
+Prints a yearly table of equivalent hours, modelled lumen maintenance and gain per channel.
+
+Usage:
+    python aging-sim.py --years 10 --l70 50000 --ref-temp 55 --ea 400 --max-gain 120
+"""
+
+import argparse
+
+from host_build import LYFI_DIR, HostBuild, run
+
+HARNESS = r'''
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "aging-model.h"
+
+#define CHANNELS 3
+#define MAX_DUTY 4095
+#define SAMPLE_MS 10000
+#define DAY_MS (24LL * 3600 * 1000)
+#define YEAR_MS (365LL * DAY_MS)
+#define BOLTZMANN_MEV_PER_K 0.08617333
+
+static int s_failures;
+
+static void check(const char* name, bool ok, const char* detail)
+{
+    printf("%-58s %-6s %s\n", name, ok ? "ok" : "FAILED", detail);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static uint32_t s_rng = 12345;
+
+static int32_t rnd(int32_t lo, int32_t hi)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return lo + (int32_t)((s_rng >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+// Photoperiod from 10:00 to 20:00 with one hour ramps, channel peaks at 100%, 60% and 25%
+static uint32_t profile_duty(int ch, int64_t t_ms)
+{
+    static const uint32_t peaks[CHANNELS] = { MAX_DUTY, MAX_DUTY * 6 / 10, MAX_DUTY / 4 };
+    const double h = (double)(t_ms % DAY_MS) / 3600000.0;
+    double level;
+    if (h < 10.0 || h >= 20.0) {
+        level = 0.0;
+    }
+    else if (h < 11.0) {
+        level = h - 10.0;
+    }
+    else if (h >= 19.0) {
+        level = 20.0 - h;
+    }
+    else {
+        level = 1.0;
+    }
+    return (uint32_t)lround(level * peaks[ch]);
+}
+
+// Heatsink in 0.1 °C: seasonal ambient of 22..30 °C plus up to 35 °C of rise with the total duty
+static int32_t profile_temp(int64_t t_ms, const uint32_t* duties)
+{
+    const double season = sin(2.0 * M_PI * (double)(t_ms % YEAR_MS) / (double)YEAR_MS);
+    double load = 0.0;
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        load += (double)duties[ch] / MAX_DUTY;
+    }
+    return (int32_t)lround((26.0 + 4.0 * season + 35.0 * load / 1.85) * 10.0);
+}
+
+static double af_ref(int32_t temp, int32_t ref_temp, uint32_t ea)
+{
+    const double t_k = (temp + 2732) / 10.0, ref_k = (ref_temp + 2732) / 10.0;
+    return exp(ea / BOLTZMANN_MEV_PER_K * (1.0 / ref_k - 1.0 / t_k));
+}
+
+int main(int argc, char** argv)
+{
+    const int years = atoi(argv[1]);
+    const uint32_t l70 = (uint32_t)atol(argv[2]);
+    const int32_t ref_temp = atoi(argv[3]) * 10;
+    const uint32_t ea = (uint32_t)atol(argv[4]);
+    const uint32_t max_gain = (uint32_t)atol(argv[5]) * 10;
+    const double tolerance = atof(argv[6]);
+
+    uint64_t stress[CHANNELS] = { 0 }, residual[CHANNELS] = { 0 };
+    double ref_q8[CHANNELS] = { 0 }, ref_exact[CHANNELS] = { 0 };
+    uint32_t gain[CHANNELS], gain_prev[CHANNELS];
+    bool monotonic = true, bounded = true;
+    double worst_gain_err = 0.0;
+    const double alpha = -log(0.7) / ((double)l70 * 3600.0 * 1000.0);
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        gain_prev[ch] = LED_AGING_GAIN_ONE;
+    }
+
+    printf("%-5s", "year");
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        printf(" %9s%d %8s%d %8s%d", "hours", ch, "lumen", ch, "gain", ch);
+    }
+    printf("\n");
+
+    int64_t t_ms = 0;
+    int next_year = 1;
+    while (next_year <= years) {
+        const uint32_t dt_ms = (uint32_t)(SAMPLE_MS + rnd(-20, 20));
+        t_ms += dt_ms;
+
+        uint32_t duties[CHANNELS];
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            duties[ch] = profile_duty(ch, t_ms);
+        }
+        const int32_t temp = profile_temp(t_ms, duties);
+        const uint32_t af = led_aging_acceleration(temp, ref_temp, ea);
+        const double af_exact = af_ref(temp, ref_temp, ea);
+
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            if (duties[ch] != 0) {
+                stress[ch] += led_aging_stress_increment(dt_ms, duties[ch], MAX_DUTY, af, &residual[ch]);
+                ref_q8[ch] += (double)dt_ms * duties[ch] / MAX_DUTY * af / (1 << LED_AGING_AF_Q);
+                ref_exact[ch] += (double)dt_ms * duties[ch] / MAX_DUTY * af_exact;
+            }
+            gain[ch] = led_aging_gain(stress[ch], l70, max_gain);
+            monotonic = monotonic && gain[ch] >= gain_prev[ch];
+            bounded = bounded && gain[ch] >= LED_AGING_GAIN_ONE
+                      && gain[ch] <= (uint32_t)lround(max_gain / 1000.0 * LED_AGING_GAIN_ONE);
+            gain_prev[ch] = gain[ch];
+        }
+
+        if (t_ms >= next_year * YEAR_MS) {
+            printf("%-5d", next_year);
+            for (int ch = 0; ch < CHANNELS; ch++) {
+                const double expected = fmin(exp(alpha * (double)stress[ch]), max_gain / 1000.0);
+                const double err = fabs((double)gain[ch] / LED_AGING_GAIN_ONE - expected);
+                worst_gain_err = err > worst_gain_err ? err : worst_gain_err;
+                printf(" %10llu %8.1f%% %9.4f", (unsigned long long)(stress[ch] / 3600000ULL),
+                       100.0 * exp(-alpha * (double)stress[ch]), (double)gain[ch] / LED_AGING_GAIN_ONE);
+            }
+            printf("\n");
+            next_year++;
+        }
+    }
+    printf("\n");
+
+    char detail[160];
+    double worst_carry = 0.0, worst_model = 0.0;
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        const double carry = fabs((double)stress[ch] - ref_q8[ch]);
+        const double model = 100.0 * fabs((double)stress[ch] - ref_exact[ch]) / ref_exact[ch];
+        worst_carry = carry > worst_carry ? carry : worst_carry;
+        worst_model = model > worst_model ? model : worst_model;
+    }
+    snprintf(detail, sizeof(detail), "worst %.3f ms over %d years", worst_carry, years);
+    check("stress matches the Q8 reference", worst_carry <= 1.0, detail);
+    snprintf(detail, sizeof(detail), "worst %.3f%%", worst_model);
+    check("stress within tolerance of the exact Arrhenius factor", worst_model <= tolerance, detail);
+    check("gain never decreases", monotonic, "");
+    check("gain stays within [1, max]", bounded, "");
+    snprintf(detail, sizeof(detail), "worst %.6f", worst_gain_err);
+    check("gain matches 1 / exp(-a * t)", worst_gain_err <= 2.0 / LED_AGING_GAIN_ONE, detail);
+
+    // Full duty at the reference temperature ages one equivalent hour per hour
+    uint64_t full = 0, full_residual = 0;
+    const uint32_t af_one = led_aging_acceleration(ref_temp, ref_temp, ea);
+    for (uint64_t h = 0; h < l70; h++) {
+        for (int s = 0; s < 360; s++) {
+            full += led_aging_stress_increment(SAMPLE_MS, MAX_DUTY, MAX_DUTY, af_one, &full_residual);
+        }
+    }
+    const double lumen = exp(-alpha * (double)full);
+    snprintf(detail, sizeof(detail), "%llu h, lumen %.4f", (unsigned long long)(full / 3600000ULL), lumen);
+    check("full duty at reference temperature reaches L70 on time", full / 3600000ULL == l70
+          && fabs(lumen - 0.7) < 1e-9, detail);
+
+    return s_failures != 0;
+}
+'''
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Multi-year LED aging model simulation')
+    parser.add_argument('--years', type=int, default=10, help='Simulated years')
+    parser.add_argument('--l70', type=int, default=50000, help='Rated L70 hours at the reference temperature')
+    parser.add_argument('--ref-temp', type=int, default=55, help='Reference heatsink temperature in °C')
+    parser.add_argument('--ea', type=int, default=400, help='Activation energy in meV')
+    parser.add_argument('--max-gain', type=int, default=120, help='Maximum compensation gain in percent')
+    parser.add_argument('--tolerance', type=float, default=2.0,
+                        help='Allowed stress error in percent caused by the Q8 acceleration factor')
+    args = parser.parse_args()
+
+    with HostBuild() as build:
+        exe = build.compile(HARNESS, sources=[LYFI_DIR / 'led' / 'aging-model.c'], includes=[LYFI_DIR / 'led'])
+        run(exe, args.years, args.l70, args.ref_temp, args.ea, args.max_gain, args.tolerance,
+            error='aging simulation failed')
+
+if __name__ == '__main__':
+    main()
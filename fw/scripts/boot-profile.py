@@ -0,0 +1,123 @@
+"""Boot-time report of a device built with `CONFIG_DRVFX_INIT_PROFILING`.
+
+Fetches `borneo/boot-profile` and prints every init entry with the steps timed inside it (`K_INIT_STEP()`), the share
+of the boot each one took and a bar, followed by the time spent in each init level. Entries run on a worker task are
+tagged `async` or `deferred`; as they overlap, the time in entries can exceed the time the application was ready at.
+Failed entries are flagged with their return code. `--top` lists the slowest entries and steps only.
+
+A saved payload (`--save`) can be reported again with `--file`, e.g. to compare two builds.
+
+Usage:
+    python boot-profile.py coap://192.168.1.13
+    python boot-profile.py coap://192.168.1.13 --save before.cbor
+    python boot-profile.py --file before.cbor --top 10
+"""
+
+import argparse
+import asyncio
+from pathlib import Path
+
+from cbor2 import loads
+
+LEVELS = ['EARLY', 'PRE_KERNEL_1', 'PRE_KERNEL_2', 'POST_KERNEL', 'APPLICATION']
+FLAG_ASYNC = 0x01
+FLAG_DEFERRED = 0x02
+BAR_WIDTH = 30
+
+
+async def fetch(address: str) -> bytes:
+    from aiocoap import Context, Message, GET
+
+    ctx = await Context.create_client_context()
+    try:
+        response = await ctx.request(Message(code=GET, uri=f'{address.rstrip("/")}/borneo/boot-profile')).response
+    finally:
+        await ctx.shutdown()
+    if not response.code.is_successful():
+        raise SystemExit(f'{response.code}: is the firmware built with CONFIG_DRVFX_INIT_PROFILING?')
+    return response.payload
+
+
+def parse(payload: bytes) -> list:
+    keys = ['name', 'level', 'parent', 'start', 'duration', 'rc', 'flags']
+    return [dict(zip(keys, record)) for record in loads(payload)]
+
+
+def ms(us: int) -> str:
+    return f'{us / 1000:8.1f} ms' if us >= 0 else f'{"running":>11}'
+
+
+def kind(record: dict) -> str:
+    if record['parent'] >= 0:
+        return 'step'
+    if record['flags'] & FLAG_DEFERRED:
+        return 'deferred'
+    if record['flags'] & FLAG_ASYNC:
+        return 'async'
+    return LEVELS[record['level']]
+
+
+def report(records: list, top: int):
+    entries = [r for r in records if r['parent'] < 0]
+    if not entries:
+        print('No init records')
+        return
+    # The deferred entries start after the application is ready
+    ready = [r for r in entries if not r['flags'] & FLAG_DEFERRED and r['duration'] >= 0]
+    boot_end = max((r['start'] + r['duration'] for r in ready), default=0)
+    init_total = sum(max(r['duration'], 0) for r in entries)
+
+    if top:
+        print(f'Slowest {top} of {len(records)} entries and steps:')
+        for r in sorted(records, key=lambda r: r['duration'], reverse=True)[:top]:
+            print(f'  {r["name"]:<28} {kind(r):<12} {ms(r["duration"])}')
+        return
+
+    print(f'{"entry":<30} {"start":>11} {"duration":>11} {"share":>6}')
+    # Entries on worker tasks overlap, so each entry is followed by its own steps rather than by the next records
+    for i, entry in enumerate(records):
+        if entry['parent'] >= 0:
+            continue
+        for depth, r in [(0, entry)] + [(1, s) for s in records if s['parent'] == i]:
+            indent = '  ' * (depth + 1)
+            duration = max(r['duration'], 0)
+            share = 100.0 * duration / boot_end if boot_end else 0.0
+            bar = '#' * min(round(BAR_WIDTH * duration / boot_end), BAR_WIDTH) if boot_end else ''
+            tag = f'  [{kind(r)}]' if depth == 0 and r['flags'] else ''
+            failed = f'  FAILED rc={r["rc"]}' if r['rc'] else ''
+            print(f'{indent}{r["name"]:<{30 - len(indent)}} {ms(r["start"])} {ms(r["duration"])} {share:5.1f}% '
+                  f'{bar}{tag}{failed}')
+
+    print()
+    print('Per level:')
+    for level, name in enumerate(LEVELS):
+        level_entries = [r for r in entries if r['level'] == level]
+        if level_entries:
+            total = sum(max(r['duration'], 0) for r in level_entries)
+            print(f'  {name:<14} {len(level_entries):>3} entries {ms(total)}')
+    print(f'  {"in entries":<14} {len(entries):>3} entries {ms(init_total)}')
+    print(f'  {"app ready at":<26} {ms(boot_end)}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Boot-time profile report')
+    parser.add_argument('address', nargs='?', help='Device address, e.g. coap://192.168.1.13')
+    parser.add_argument('--file', help='Report a payload saved with --save instead of fetching one')
+    parser.add_argument('--save', help='Save the fetched payload to this file')
+    parser.add_argument('--top', type=int, default=0, help='Only list the N slowest entries and steps')
+    args = parser.parse_args()
+
+    if args.file:
+        payload = Path(args.file).read_bytes()
+    elif args.address:
+        payload = asyncio.run(fetch(args.address))
+        if args.save:
+            Path(args.save).write_bytes(payload)
+    else:
+        parser.error('an address or --file is required')
+
+    report(parse(payload), args.top)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,303 @@
+"""Checks and compares the text-keyed and the compact (`?compact`) CBOR schemas of the hot LyFi resources.
+
+Without an address it compiles the firmware's encoders (`lyfi/main/src/rpc/lyfi-core.c` and `cbor-common.c`) for the
+host against a fake LED, fan and sensor state, encodes `borneo/lyfi/status`, `/info` and `/schedule` in both schemas
+and reports the encoded size and the host encode time of each. With an address it fetches both forms from a device
+instead and reports their wire sizes.
+
+Either way the payloads are decoded and checked against the key enums of `rpc/cbor-common.h`: every compact key is the
+enum value of a text key (`LYFI_STATUS_KEY_TEMP_REMAIN` for `tempRemain`), both forms carry the same fields with the
+same values, and the compact colors are the text ones packed into big-endian 16-bit brightnesses.
+
+The host timings only rank the two schemas against each other, the encoders run on a TinyCBOR stub instead of the
+device's library.
+
+Usage:
+    python cbor-schema-bench.py --channels 5 --schedule-items 10
+    python cbor-schema-bench.py --address coap://192.168.1.13
+"""
+
+import argparse
+import asyncio
+import re
+import struct
+
+from cbor2 import loads
+
+from host_build import FW_DIR, LYFI_DIR, HostBuild, run
+
+RESOURCES = ['status', 'info', 'schedule']
+
+COAP_STUB = r'''#pragma once
+#include <stddef.h>
+#include <stdint.h>
+typedef struct { size_t length; const uint8_t* s; } coap_str_const_t;
+typedef struct { size_t length; uint8_t* s; } coap_string_t;
+typedef struct coap_pdu_t coap_pdu_t;
+typedef void (*coap_method_handler_t)(void*, void*, const coap_pdu_t*, const coap_string_t*, coap_pdu_t*);
+'''
+
+HARNESS = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <coap3/coap.h>
+
+// The encoders are static, so the RPC module is compiled into the harness
+#include "lyfi-core.c"
+
+static size_t s_channel_count;
+static struct led_factory_settings s_factory;
+static struct led_user_settings s_settings;
+static led_color_t s_color;
+
+size_t led_channel_count() { return s_channel_count; }
+const struct led_factory_settings* led_get_factory_settings() { return &s_factory; }
+const struct led_user_settings* led_get_settings() { return &s_settings; }
+const struct led_scheduler* led_get_schedule() { return &s_settings.scheduler; }
+uint8_t led_get_state() { return LED_STATE_NORMAL; }
+int32_t led_get_temporary_remaining() { return -1; }
+bool led_acclimation_is_enabled() { return true; }
+bool led_acclimation_is_activated() { return false; }
+bool led_cloud_is_enabled() { return true; }
+bool led_cloud_is_activated() { return false; }
+struct fan_status fan_get_status() { return (struct fan_status) { .power = 35 }; }
+
+int led_get_color(led_color_t color)
+{
+    memcpy(color, s_color, sizeof(led_color_t));
+    return 0;
+}
+
+// 42.3 ℃ and 1830 mA
+static int fake_temp(const struct drvfx_device* dev, int32_t* value)
+{
+    *value = 423;
+    return 0;
+}
+
+static int fake_current(const struct drvfx_device* dev, int32_t* value)
+{
+    *value = 1830;
+    return 0;
+}
+
+static const struct sensor_api s_temp_api = { .get_value = fake_temp };
+static const struct sensor_api s_current_api = { .get_value = fake_current };
+static const struct drvfx_device s_temp = { .name = "sensor.temp", .api = &s_temp_api };
+static const struct drvfx_device s_current = { .name = "sensor.led_current", .api = &s_current_api };
+
+const struct drvfx_device* k_device_get_binding(const char* name)
+{
+    return strcmp(name, "sensor.temp") == 0 ? &s_temp : &s_current;
+}
+
+static void fake_state(size_t item_count)
+{
+    s_channel_count = CONFIG_LYFI_LED_CHANNEL_COUNT;
+    s_factory.channel_count = CONFIG_LYFI_LED_CHANNEL_COUNT;
+    s_settings.mode = LED_MODE_SCHEDULED;
+    for (size_t ch = 0; ch < s_channel_count; ch++) {
+        struct led_channel_settings* channel = &s_factory.channels[ch];
+        snprintf(channel->name, sizeof(channel->name), "CH%zu", ch);
+        strcpy(channel->color, "#2040FF");
+        channel->wavelength = 450 + ch * 20;
+        s_color[ch] = (ch * 811 + 300) % 4096;
+        s_settings.manual_color[ch] = (ch * 523 + 100) % 4096;
+        s_settings.sun_color[ch] = LED_BRIGHTNESS_MAX - ch;
+    }
+    s_settings.scheduler.item_count = item_count;
+    for (size_t i = 0; i < item_count; i++) {
+        s_settings.scheduler.items[i].instant = 3600 * (8 + i);
+        memcpy(s_settings.scheduler.items[i].color, s_color, sizeof(led_color_t));
+    }
+}
+
+static int encode_status(CborEncoder* encoder, bool compact) { return _encode_status(encoder, compact); }
+static int encode_info(CborEncoder* encoder, bool compact) { return _encode_info(encoder, compact); }
+
+static int encode_schedule(CborEncoder* encoder, bool compact)
+{
+    return compact ? bo_rpc_borneo_lyfi_schedule_get_compact(NULL, encoder)
+                   : bo_rpc_borneo_lyfi_schedule_get(NULL, encoder);
+}
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Prints `<resource> <schema> <ns per encode> <payload in hex>`
+static int bench(const char* name, int (*encode)(CborEncoder*, bool), bool compact, int rounds)
+{
+    static uint8_t buf[4096];
+    CborEncoder encoder;
+    const int64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+        int rc = encode(&encoder, compact);
+        if (rc != 0 || cbor_encoder_get_extra_bytes_needed(&encoder) > 0) {
+            fprintf(stderr, "%s %s: encode failed (%d)\n", name, compact ? "compact" : "text", rc);
+            return -1;
+        }
+    }
+    const double ns = (double)(now_ns() - start) / rounds;
+    printf("%s %s %.1f ", name, compact ? "compact" : "text", ns);
+    const size_t size = cbor_encoder_get_buffer_size(&encoder, buf);
+    for (size_t i = 0; i < size; i++) {
+        printf("%02x", buf[i]);
+    }
+    printf("\n");
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    fake_state(atoi(argv[1]));
+    const int rounds = atoi(argv[2]);
+    for (int compact = 0; compact <= 1; compact++) {
+        if (bench("status", encode_status, compact, rounds) || bench("info", encode_info, compact, rounds)
+            || bench("schedule", encode_schedule, compact, rounds)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+'''
+
+
+def sdkconfig(channels: int) -> str:
+    return ('#pragma once\n'
+            f'#define CONFIG_LYFI_LED_CHANNEL_COUNT {channels}\n'
+            '#define CONFIG_LYFI_LED_NOMINAL_POWER 120\n'
+            '#define CONFIG_LYFI_NTC_SUPPORT 1\n'
+            '#define CONFIG_LYFI_MEAS_CURRENT_SUPPORT 1\n'
+            '#define CONFIG_LYFI_FAN_CTRL_SUPPORT 1\n'
+            + ''.join(f'#define CONFIG_LYFI_LED_CH{i}_ENABLED 1\n'
+                      f'#define CONFIG_LYFI_LED_CH{i}_BRIGHTNESS_PERCENT 100\n'
+                      f'#define CONFIG_LYFI_LED_CH{i}_POWER 12\n'
+                      for i in range(channels)))
+
+
+def key_enums() -> dict:
+    """Maps each key enum of `cbor-common.h` to {text key: compact key}, `TEMP_REMAIN` becomes `tempRemain`."""
+    header = (LYFI_DIR / 'rpc' / 'cbor-common.h').read_text()
+    enums = {}
+    for group in ['STATUS', 'INFO', 'CHANNEL', 'SCH_ITEM']:
+        keys = {}
+        for name, value in re.findall(rf'\bLYFI_{group}_KEY_(\w+) = (\d+)', header):
+            first, *rest = name.lower().split('_')
+            keys[first + ''.join(w.capitalize() for w in rest)] = int(value)
+        enums[group] = keys
+    return enums
+
+
+def check_map(path: str, text, compact, keys: dict, nested: dict = None) -> list:
+    """Returns the differences between a text-keyed map and its compact form."""
+    if not isinstance(text, dict) or not isinstance(compact, dict):
+        return [f'{path}: not a map']
+    errors = []
+    unknown = [k for k in text if k not in keys]
+    if unknown:
+        errors.append(f'{path}: text keys without an enum value {unknown}')
+    expected = {keys[k]: k for k in text if k in keys}
+    if set(compact) != set(expected):
+        errors.append(f'{path}: compact keys {sorted(compact)}, expected {sorted(expected)}')
+    for key, name in expected.items():
+        if key not in compact:
+            continue
+        value, packed = text[name], compact[key]
+        if nested and name in nested:
+            if not isinstance(value, list) or not isinstance(packed, list) or len(value) != len(packed):
+                errors.append(f'{path}.{name}: arrays differ')
+                continue
+            for i, (t, c) in enumerate(zip(value, packed)):
+                errors += check_map(f'{path}.{name}[{i}]', t, c, nested[name])
+        elif isinstance(value, list):
+            if packed != struct.pack(f'>{len(value)}H', *value):
+                errors.append(f'{path}.{name}: packed color {packed.hex()} is not {value}')
+        elif packed != value or type(packed) is not type(value):
+            errors.append(f'{path}.{name}: {packed!r} is not {value!r}')
+    return errors
+
+
+def check_payloads(name: str, text, compact, enums: dict) -> list:
+    if name == 'status':
+        return check_map(name, text, compact, enums['STATUS'])
+    if name == 'info':
+        return check_map(name, text, compact, enums['INFO'], {'channels': enums['CHANNEL']})
+    if not isinstance(text, list) or not isinstance(compact, list) or len(text) != len(compact):
+        return [f'{name}: arrays differ']
+    errors = []
+    for i, (t, c) in enumerate(zip(text, compact)):
+        errors += check_map(f'{name}[{i}]', t, c, enums['SCH_ITEM'])
+    return errors
+
+
+def encode_on_host(channels: int, items: int, rounds: int) -> dict:
+    """Runs the firmware encoders, returns {resource: {schema: (ns per encode, payload)}}."""
+    with HostBuild({'sdkconfig.h': sdkconfig(channels), 'coap3/coap.h': COAP_STUB}) as build:
+        # Only the encoders are reachable from main(), the linker drops the other RPCs and the LED calls they make
+        includes = [LYFI_DIR / 'rpc', LYFI_DIR / 'led', FW_DIR / '3rd-components' / 'smf' / 'include']
+        exe = build.compile(HARNESS, sources=[LYFI_DIR / 'rpc' / 'cbor-common.c'], includes=includes,
+                            flags=['-ffunction-sections', '-Wl,--gc-sections'])
+        out = run(exe, items, rounds, error='the firmware encoders failed', quiet=True).stdout
+    results = {}
+    for line in out.splitlines():
+        name, schema, ns, payload = line.split()
+        results.setdefault(name, {})[schema] = (float(ns), bytes.fromhex(payload))
+    return results
+
+
+async def fetch_payloads(address: str) -> dict:
+    import aiocoap
+    from aiocoap import Message, GET
+
+    ctx = await aiocoap.Context.create_client_context()
+    results = {}
+    for name in RESOURCES:
+        uri = f'{address}/borneo/lyfi/{name}'
+        text = (await ctx.request(Message(code=GET, uri=uri)).response).payload
+        compact = (await ctx.request(Message(code=GET, uri=uri + '?compact')).response).payload
+        results[name] = {'text': (None, text), 'compact': (None, compact)}
+    await ctx.shutdown()
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Text vs compact CBOR schema check and benchmark')
+    parser.add_argument('--address', help='Fetch real payloads from this device, e.g. coap://192.168.1.13')
+    parser.add_argument('--channels', type=int, default=5, help='Channel count of the host build')
+    parser.add_argument('--schedule-items', type=int, default=10, help='Schedule length of the fake LED state')
+    parser.add_argument('--rounds', type=int, default=20000, help='Encode rounds per measurement')
+    args = parser.parse_args()
+
+    if args.address:
+        results = asyncio.run(fetch_payloads(args.address))
+    else:
+        results = encode_on_host(args.channels, args.schedule_items, args.rounds)
+
+    enums = key_enums()
+    errors = []
+    for name in RESOURCES:
+        (text_ns, text), (compact_ns, compact) = results[name]['text'], results[name]['compact']
+        line = f'{name:<10} text {len(text):5d} B'
+        if text_ns is not None:
+            line += f' {text_ns / 1000:7.2f} us'
+        line += f'   compact {len(compact):5d} B'
+        if compact_ns is not None:
+            line += f' {compact_ns / 1000:7.2f} us'
+        print(f'{line}   ({100.0 * len(compact) / len(text):.0f}% of the bytes)')
+        errors += check_payloads(name, loads(text), loads(compact), enums)
+
+    for error in errors:
+        print(error)
+    if errors:
+        raise SystemExit('the compact schema does not match the text one')
+    print('compact payloads match the text ones through the key enums')
+
+
+if __name__ == '__main__':
+    main()
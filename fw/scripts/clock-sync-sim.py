@@ -0,0 +1,202 @@
+"""Host simulation of the fleet clock synchronization (`borneo-core/src/clock-sync.c`).
+
+Runs one master and several followers on a simulated timeline. Every follower has its own boot time and crystal error
+and talks to the master over a link with a fixed base delay, exponential queuing jitter in both directions and
+occasional Wi-Fi power-save stalls. The followers run the firmware's estimator: `clock-sync.c` is compiled for the
+host, and every exchange is handed to its response handler as a datagram with the four timestamps, so the delay filter,
+the minimum-delay pick and the skew estimate are the code that runs on the devices.
+
+Reports, per follower, when the estimate converged (stayed within `--threshold` of the true master time) and the
+residual error after convergence.
+
+The defaults model a quiet link. On a busy one (`--jitter 3000 --stall-rate 0.1`) the minimum-delay sample of the
+last 16 is often itself delayed by a millisecond or more, and the error keeps leaving the threshold now and then however
+long the simulation runs, so the convergence time reported there is only the time of the last excursion.
+
+Usage:
+    python clock-sync-sim.py --followers 8
+    python clock-sync-sim.py --duration 600 --jitter 3000 --stall-rate 0.1
+"""
+
+import argparse
+import ctypes
+import random
+import statistics
+from pathlib import Path
+
+from host_build import CORE_DIR, HostBuild
+
+SDKCONFIG = '#pragma once\n' \
+            '#define CONFIG_BORNEO_CLOCK_SYNC_ENABLED 1\n' \
+            '#define CONFIG_BORNEO_CLOCK_SYNC_PORT 5684\n' \
+            '#define CONFIG_BORNEO_CLOCK_SYNC_INTERVAL 250\n' \
+            '#define CONFIG_BORNEO_COAP_MULTICAST_ENABLED 1\n' \
+            '#define CONFIG_BORNEO_COAP_MULTICAST_ADDRESS "224.0.1.187"\n'
+
+# The types `borneo/coap.h` refers to, the estimator sends nothing over CoAP
+COAP_STUB = r'''#pragma once
+#include <stddef.h>
+#include <stdint.h>
+typedef struct { size_t length; const uint8_t* s; } coap_str_const_t;
+typedef struct { size_t length; uint8_t* s; } coap_string_t;
+typedef struct coap_pdu_t coap_pdu_t;
+typedef void (*coap_method_handler_t)(void*, void*, const coap_pdu_t*, const coap_string_t*, coap_pdu_t*);
+'''
+
+HARNESS = r'''
+#include <coap3/coap.h>
+#include "clock-sync.c"
+
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+// Only referenced by the init and role code, which the simulation does not run
+bool bo_coap_group_is_member(uint16_t group_id) { return true; }
+esp_err_t bo_nvs_user_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) { return ESP_FAIL; }
+void bo_nvs_auto_close(nvs_handle_t* handle) { }
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* length) { return ESP_FAIL; }
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length) { return ESP_FAIL; }
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_FAIL; }
+
+// A follower that has just found the master of group 1
+void sim_reset()
+{
+    clock_sync_reset_follower();
+    memset(&_estimate, 0, sizeof(_estimate));
+    _follower.master_id = 1;
+    _follower.group = 1;
+}
+
+// One request/response exchange, the response arrives at local time `t4`
+void sim_exchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+{
+    uint8_t buf[CLOCK_SYNC_RESPONSE_SIZE];
+    put_header(buf, CLOCK_SYNC_MSG_RESPONSE);
+    put_u32(&buf[4], ++_follower.seq);
+    put_i64(&buf[8], t1);
+    put_i64(&buf[16], t2);
+    put_i64(&buf[24], t3);
+    _follower.request_t1_us = t1;
+    const struct sockaddr_in from = { .sin_family = AF_INET };
+    clock_sync_handle(buf, sizeof(buf), &from, t4);
+}
+
+// Fleet time minus local time at `local_us`, as `bo_clock_sync_time_us()` computes it
+int64_t sim_offset_at(int64_t local_us) { return estimate_offset_at(&_estimate, local_us); }
+
+bool sim_locked() { return _estimate.locked; }
+'''
+
+
+def build_firmware(build: HostBuild) -> Path:
+    """Compiles `clock-sync.c` into a shared library for `load_firmware()`."""
+    return build.compile(HARNESS, includes=[CORE_DIR / 'src'], output='clock-sync.so', shared=True)
+
+
+def load_firmware(lib: Path):
+    fw = ctypes.CDLL(str(lib))
+    fw.sim_exchange.argtypes = [ctypes.c_int64] * 4
+    fw.sim_offset_at.argtypes = [ctypes.c_int64]
+    fw.sim_offset_at.restype = ctypes.c_int64
+    fw.sim_locked.restype = ctypes.c_bool
+    return fw
+
+
+class Clock:
+    """A local uptime counter with its own boot time and rate error."""
+
+    def __init__(self, boot_us: float, ppm: float):
+        self.boot_us = boot_us
+        self.rate = 1.0 + ppm * 1e-6
+
+    def read(self, true_us: float) -> int:
+        return int((true_us - self.boot_us) * self.rate)
+
+
+def link_delay(rng: random.Random, args) -> float:
+    delay = args.base_delay + rng.expovariate(1.0 / args.jitter)
+    if rng.random() < args.stall_rate:
+        delay += rng.uniform(0, args.stall)
+    return delay
+
+
+def simulate(fw, index: int, args):
+    rng = random.Random(args.seed * 1000 + index)
+    master = Clock(0.0, rng.uniform(-args.ppm, args.ppm))
+    follower = Clock(rng.uniform(-600e6, 600e6), rng.uniform(-args.ppm, args.ppm))
+    fw.sim_reset()
+
+    start_us = 700e6  # Both devices are up
+    end_us = start_us + args.duration * 1e6
+    interval_us = args.interval * 1000.0
+    errors = []  # (true time, error in us) after the first lock
+
+    t = start_us + rng.uniform(0, interval_us)
+    next_check = start_us
+    while t < end_us:
+        # One request/response exchange
+        t1 = follower.read(t)
+        t_at_master = t + link_delay(rng, args)
+        t2 = master.read(t_at_master)
+        t3 = master.read(t_at_master + args.turnaround)
+        t_back = t_at_master + args.turnaround + link_delay(rng, args)
+        fw.sim_exchange(t1, t2, t3, follower.read(t_back))
+
+        # Sample the error of the render-time fleet clock between exchanges
+        t_next = t + interval_us
+        while next_check < t_next:
+            if next_check >= t_back and fw.sim_locked():
+                local = follower.read(next_check)
+                fleet = local + fw.sim_offset_at(local)
+                errors.append((next_check, fleet - master.read(next_check)))
+            next_check += 100e3
+        t = t_next
+
+    converged_at = None
+    for i, (when, _) in enumerate(errors):
+        if all(abs(e) <= args.threshold for _, e in errors[i:]):
+            converged_at = (when - start_us) / 1e6
+            break
+    residual = [abs(e) for when, e in errors if converged_at is not None and (when - start_us) / 1e6 >= converged_at]
+    return converged_at, residual, master.rate, follower.rate
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Fleet clock synchronization simulation')
+    parser.add_argument('--followers', type=int, default=8)
+    parser.add_argument('--duration', type=float, default=300.0, help='Simulated time in seconds')
+    parser.add_argument('--interval', type=float, default=250.0,
+                        help='Poll interval in ms (CONFIG_BORNEO_CLOCK_SYNC_INTERVAL)')
+    parser.add_argument('--base-delay', type=float, default=1500.0, help='One-way base delay in us')
+    parser.add_argument('--jitter', type=float, default=1000.0, help='Mean one-way queuing delay in us')
+    parser.add_argument('--stall-rate', type=float, default=0.05, help='Probability of a power-save stall per packet')
+    parser.add_argument('--stall', type=float, default=100000.0, help='Max stall in us')
+    parser.add_argument('--turnaround', type=float, default=150.0, help='Master processing time in us')
+    parser.add_argument('--ppm', type=float, default=20.0, help='Max crystal error of every device')
+    parser.add_argument('--threshold', type=float, default=1000.0, help='Convergence threshold in us')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    with HostBuild({'sdkconfig.h': SDKCONFIG, 'coap3/coap.h': COAP_STUB}) as build:
+        fw = load_firmware(build_firmware(build))
+
+    all_residual = []
+    for i in range(args.followers):
+        converged_at, residual, master_rate, follower_rate = simulate(fw, i, args)
+        skew_ppm = (master_rate / follower_rate - 1.0) * 1e6
+        if converged_at is None:
+            print(f'follower {i}: skew {skew_ppm:+6.1f} ppm, did not converge')
+            continue
+        all_residual += residual
+        residual.sort()
+        print(f'follower {i}: skew {skew_ppm:+6.1f} ppm, converged after {converged_at:5.1f} s, '
+              f'residual p50={statistics.median(residual):6.0f} us max={residual[-1]:6.0f} us')
+
+    if all_residual:
+        all_residual.sort()
+        p95 = all_residual[min(len(all_residual) - 1, int(len(all_residual) * 0.95))]
+        print(f'All followers: residual p50={statistics.median(all_residual):.0f} us p95={p95:.0f} us '
+              f'max={all_residual[-1]:.0f} us')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,515 @@
+"""Stress test of the CoAP server loop and its notifications (`borneo-core/src/coap/coap.c`).
+
+Compiles the firmware's `coap.c` for Linux and runs its I/O task as a thread. The eventfd, `select()` and the
+producers are real, libcoap is replaced by a recording fake: `coap_io_process_with_fds()` waits on the descriptors it
+is given and optionally spends some time per call as if it handled a request, and the functions that touch the
+context record which thread called them and when.
+
+Producer threads hammer `bo_coap_notify_resource_changed()` on resources spanning several bitset words, with the
+default and throttled minimum intervals, while the loop fans out. Then:
+
+   - `stress`: libcoap is only ever entered from the I/O thread, every resource is notified after its last change
+     (no lost wake-up), and consecutive notifications of a resource respect its minimum interval
+   - `latency`: a single change to an idle resource is fanned out promptly
+   - `heartbeat`: with nothing changing, the heartbeat is sent every `BO_COAP_HEARTBEAT_INTERVAL_MS`
+   - `etag`: versioned resources get one ETag per schema the query selects, `?compact` and `?compact=1` share one
+   - `shutdown`: `BO_EVENT_SHUTDOWN_SCHEDULED` wakes the loop and ends the task
+
+Usage:
+    python coap-notify-stress.py --producers 4 --seconds 3 --request-cost-us 200
+"""
+
+import argparse
+
+from host_build import CORE_DIR, HostBuild, run
+
+RESOURCES = 40  # More than one 32-bit word of the dirty bitset
+NOTIFY_MIN_INTERVAL_MS = 100
+
+# The recording libcoap fake for `coap.c`, the rest comes from `host_build.STUBS`
+STUBS = {
+    'sdkconfig.h': '#pragma once\n'
+                   '#define CONFIG_BORNEO_COAP_RESPONSE_BUFFER_SIZE 1024\n'
+                   '#define CONFIG_BORNEO_COAP_TASK_STACK_SIZE 4096\n'
+                   f'#define CONFIG_BORNEO_COAP_NOTIFY_MIN_INTERVAL {NOTIFY_MIN_INTERVAL_MS}\n'
+                   '#define CONFIG_BORNEO_COAP_MULTICAST_ENABLED 0\n'
+                   '#define CONFIG_COAP_LOG_DEFAULT_LEVEL 0\n',
+    'coap3/coap.h': r'''#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+
+typedef struct { size_t length; const uint8_t* s; } coap_str_const_t;
+typedef struct { size_t length; uint8_t* s; } coap_string_t;
+typedef struct coap_context_t coap_context_t;
+typedef struct coap_endpoint_t coap_endpoint_t;
+typedef struct coap_session_t coap_session_t;
+typedef struct coap_pdu_t coap_pdu_t;
+typedef struct coap_resource_t coap_resource_t;
+typedef uint8_t coap_opt_t;
+typedef uint16_t coap_option_num_t;
+typedef struct { int unused; } coap_opt_filter_t;
+typedef struct { int unused; } coap_opt_iterator_t;
+typedef uint64_t coap_tick_t;
+typedef struct { union { struct sockaddr_in sin; } addr; } coap_address_t;
+typedef void (*coap_method_handler_t)(coap_resource_t*, coap_session_t*, const coap_pdu_t*, const coap_string_t*,
+                                      coap_pdu_t*);
+
+#define COAP_PROTO_UDP 1
+#define COAP_DEFAULT_PORT 5683
+#define COAP_RESOURCE_CHECK_TIME 2
+#define COAP_RESOURCE_FLAGS_RELEASE_URI 1
+#define COAP_REQUEST_GET 1
+#define COAP_REQUEST_POST 2
+#define COAP_REQUEST_PUT 3
+#define COAP_REQUEST_DELETE 4
+#define COAP_OPTION_IF_MATCH 1
+#define COAP_OPTION_ETAG 4
+#define COAP_MEDIATYPE_APPLICATION_CBOR 60
+#define COAP_RESPONSE_CODE(n) (((n) / 100 << 5) | ((n) % 100))
+
+// Implemented by the harness, which records the calling thread
+coap_context_t* coap_new_context(const coap_address_t* listen_addr);
+void coap_free_context(coap_context_t* ctx);
+int coap_io_process_with_fds(coap_context_t* ctx, uint32_t timeout_ms, int nfds, fd_set* readfds, fd_set* writefds,
+                             fd_set* exceptfds);
+coap_resource_t* coap_get_resource_from_uri_path(coap_context_t* ctx, coap_str_const_t* uri_path);
+int coap_resource_notify_observers(coap_resource_t* resource, const coap_string_t* query);
+coap_resource_t* coap_resource_init(coap_str_const_t* uri_path, int flags);
+void coap_add_resource(coap_context_t* ctx, coap_resource_t* resource);
+void coap_resource_set_userdata(coap_resource_t* resource, void* data);
+void* coap_resource_get_userdata(coap_resource_t* resource);
+
+static inline void coap_set_log_level(int level) { }
+static inline void coap_cleanup(void) { }
+static inline void coap_clock_init(void) { }
+static inline void coap_ticks(coap_tick_t* t) { *t = 0; }
+static inline void coap_address_init(coap_address_t* addr) { }
+static inline coap_endpoint_t* coap_new_endpoint(coap_context_t* ctx, const coap_address_t* addr, int proto)
+{
+    return (coap_endpoint_t*)ctx;
+}
+static inline void coap_register_request_handler(coap_resource_t* r, int method, coap_method_handler_t handler) { }
+static inline void coap_resource_set_get_observable(coap_resource_t* r, int mode) { }
+static inline void coap_option_filter_clear(coap_opt_filter_t* filter) { }
+static inline void coap_option_filter_set(coap_opt_filter_t* filter, coap_option_num_t num) { }
+static inline void coap_option_iterator_init(const coap_pdu_t* pdu, coap_opt_iterator_t* it, coap_opt_filter_t* f) { }
+static inline coap_opt_t* coap_option_next(coap_opt_iterator_t* it) { return NULL; }
+static inline size_t coap_opt_length(const coap_opt_t* opt) { return 0; }
+static inline const uint8_t* coap_opt_value(const coap_opt_t* opt) { return NULL; }
+static inline void coap_add_option(coap_pdu_t* pdu, coap_option_num_t num, size_t len, const uint8_t* data) { }
+static inline void coap_pdu_set_code(coap_pdu_t* pdu, int code) { }
+static inline void coap_add_data_blocked_response(const coap_pdu_t* request, coap_pdu_t* response, uint16_t type,
+                                                  int maxage, size_t length, const uint8_t* data) { }
+''',
+}
+
+HARNESS = r'''
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "coap.c"
+
+// Registered the way the firmware does, the linker script brackets the section with the start/end symbols
+#include "resources.h"
+
+#define RESOURCES (STRESS_RESOURCES + 2)
+
+static size_t s_heartbeat_index;
+static size_t s_stress_index[STRESS_RESOURCES]; ///< Position of `stress/<n>` in the section
+
+esp_event_base_t BO_SYSTEM_EVENTS = "BO_SYSTEM_EVENTS";
+esp_event_base_t BO_SNTP_EVENTS = "BO_SNTP_EVENTS";
+
+unsigned int coap_adjust_basetime(coap_context_t* ctx, coap_tick_t now) { return 0; }
+
+// The fake context and resources: a resource is its position in the section plus one
+struct coap_context_t {
+    int unused;
+};
+
+static struct coap_context_t s_context;
+static void* s_userdata[RESOURCES];
+static int s_request_cost_us;
+
+static pthread_t s_io_thread;
+static atomic_bool s_io_thread_known;
+static atomic_int s_foreign_calls; ///< libcoap entered from a thread other than the I/O task
+static atomic_int s_io_calls;
+
+struct record {
+    int64_t last_mark_us;
+    int64_t last_notify_us;
+    int64_t min_gap_us;
+    int64_t marks;
+    int64_t notifies;
+};
+
+static struct record s_records[RESOURCES];
+static pthread_mutex_t s_records_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The first caller is taken as the I/O task, checked against `_coap_server_task` once the stress phase is over
+static void on_libcoap_call()
+{
+    if (!atomic_load(&s_io_thread_known)) {
+        s_io_thread = pthread_self();
+        atomic_store(&s_io_thread_known, true);
+    }
+    else if (!pthread_equal(pthread_self(), s_io_thread)) {
+        atomic_fetch_add(&s_foreign_calls, 1);
+    }
+}
+
+coap_context_t* coap_new_context(const coap_address_t* listen_addr) { return &s_context; }
+
+void coap_free_context(coap_context_t* ctx) { }
+
+coap_resource_t* coap_resource_init(coap_str_const_t* uri_path, int flags)
+{
+    for (size_t i = 0; i < RESOURCES; i++) {
+        if (&_coap_resources_start[i].path == uri_path) {
+            return (coap_resource_t*)(i + 1);
+        }
+    }
+    return NULL;
+}
+
+void coap_add_resource(coap_context_t* ctx, coap_resource_t* resource) { }
+
+void coap_resource_set_userdata(coap_resource_t* resource, void* data) { s_userdata[(size_t)resource - 1] = data; }
+
+void* coap_resource_get_userdata(coap_resource_t* resource) { return s_userdata[(size_t)resource - 1]; }
+
+int coap_io_process_with_fds(coap_context_t* ctx, uint32_t timeout_ms, int nfds, fd_set* readfds, fd_set* writefds,
+                             fd_set* exceptfds)
+{
+    on_libcoap_call();
+    atomic_fetch_add(&s_io_calls, 1);
+
+    const int64_t started_us = esp_timer_get_time();
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    int rc = select(nfds, readfds, writefds, exceptfds, &tv);
+    if (rc < 0) {
+        return -1;
+    }
+    if (s_request_cost_us > 0) {
+        usleep(s_request_cost_us);
+    }
+    return (int)((esp_timer_get_time() - started_us) / 1000);
+}
+
+coap_resource_t* coap_get_resource_from_uri_path(coap_context_t* ctx, coap_str_const_t* uri_path)
+{
+    on_libcoap_call();
+    for (size_t i = 0; i < RESOURCES; i++) {
+        const coap_str_const_t* path = &_coap_resources_start[i].path;
+        if (path->length == uri_path->length && memcmp(path->s, uri_path->s, uri_path->length) == 0) {
+            return (coap_resource_t*)(i + 1);
+        }
+    }
+    return NULL;
+}
+
+int coap_resource_notify_observers(coap_resource_t* resource, const coap_string_t* query)
+{
+    on_libcoap_call();
+    const size_t index = (size_t)resource - 1;
+    const int64_t now_us = esp_timer_get_time();
+    pthread_mutex_lock(&s_records_lock);
+    struct record* r = &s_records[index];
+    if (r->notifies > 0 && now_us - r->last_notify_us < r->min_gap_us) {
+        r->min_gap_us = now_us - r->last_notify_us;
+    }
+    r->last_notify_us = now_us;
+    r->notifies++;
+    pthread_mutex_unlock(&s_records_lock);
+    return 1;
+}
+
+static int s_failures;
+
+static void check(const char* group, const char* name, bool ok, const char* detail)
+{
+    printf("%-10s %-52s %-6s %s\n", group, name, ok ? "ok" : "FAILED", detail);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static int setup_resources()
+{
+    if (_coap_resources_end - _coap_resources_start != RESOURCES) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < RESOURCES; i++) {
+        const coap_str_const_t* path = &_coap_resources_start[i].path;
+        unsigned n;
+        if (sscanf((const char*)path->s, "stress/%u", &n) == 1 && n < STRESS_RESOURCES) {
+            s_stress_index[n] = i;
+        }
+        else if (strcmp((const char*)path->s, BO_COAP_PATH_HEARTBEAT) == 0) {
+            s_heartbeat_index = i;
+        }
+        s_records[i].min_gap_us = INT64_MAX;
+    }
+    return 0;
+}
+
+static int mark(size_t index)
+{
+    pthread_mutex_lock(&s_records_lock);
+    s_records[index].last_mark_us = esp_timer_get_time();
+    s_records[index].marks++;
+    pthread_mutex_unlock(&s_records_lock);
+    return bo_coap_notify_resource_changed(&_coap_resources_start[index].path);
+}
+
+static atomic_bool s_producers_stop;
+static atomic_int s_mark_errors;
+
+static void* producer(void* arg)
+{
+    uint32_t rng = (uint32_t)(uintptr_t)arg * 2654435761u + 1;
+    while (!atomic_load(&s_producers_stop)) {
+        rng = rng * 1664525u + 1013904223u;
+        if (mark(s_stress_index[(rng >> 8) % STRESS_RESOURCES]) != 0) {
+            atomic_fetch_add(&s_mark_errors, 1);
+        }
+        // Bursts of back-to-back changes mixed with short pauses
+        if ((rng >> 4) % 8 == 0) {
+            usleep((rng >> 12) % 500);
+        }
+    }
+    return NULL;
+}
+
+static uint32_t interval_ms(size_t index)
+{
+    return _coap_resources_start[index].notify_interval_ms > 0 ? _coap_resources_start[index].notify_interval_ms
+                                                               : CONFIG_BORNEO_COAP_NOTIFY_MIN_INTERVAL;
+}
+
+static void test_stress(int producers, int seconds)
+{
+    char detail[160];
+    pthread_t threads[64];
+    for (int i = 0; i < producers; i++) {
+        pthread_create(&threads[i], NULL, producer, (void*)(uintptr_t)(i + 1));
+    }
+    usleep(seconds * 1000000);
+    atomic_store(&s_producers_stop, true);
+    for (int i = 0; i < producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    const int io_calls = atomic_load(&s_io_calls);
+
+    // Let the longest throttle expire so that every last change gets fanned out
+    usleep(600 * 1000);
+
+    pthread_mutex_lock(&s_records_lock);
+    int64_t marks = 0, notifies = 0;
+    int lost = 0, too_close = 0;
+    size_t worst_index = 0;
+    int64_t worst_gap_us = INT64_MAX;
+    for (size_t n = 0; n < STRESS_RESOURCES; n++) {
+        const size_t i = s_stress_index[n];
+        const struct record* r = &s_records[i];
+        marks += r->marks;
+        notifies += r->notifies;
+        if (r->marks > 0 && r->last_notify_us < r->last_mark_us) {
+            lost++;
+        }
+        // Intervals are compared in whole milliseconds by the firmware
+        if (r->min_gap_us != INT64_MAX && r->min_gap_us < (int64_t)(interval_ms(i) - 1) * 1000) {
+            too_close++;
+        }
+        if (r->min_gap_us < worst_gap_us) {
+            worst_gap_us = r->min_gap_us;
+            worst_index = i;
+        }
+    }
+    pthread_mutex_unlock(&s_records_lock);
+
+    snprintf(detail, sizeof(detail), "%d foreign calls, %d loop iterations", atomic_load(&s_foreign_calls), io_calls);
+    check("stress", "libcoap only entered from the I/O task",
+          atomic_load(&s_foreign_calls) == 0 && pthread_equal(s_io_thread, (pthread_t)_coap_server_task), detail);
+    snprintf(detail, sizeof(detail), "%d errors", atomic_load(&s_mark_errors));
+    check("stress", "every change accepted", atomic_load(&s_mark_errors) == 0, detail);
+    snprintf(detail, sizeof(detail), "%d of %d resources, %lld changes -> %lld notifications", lost, STRESS_RESOURCES,
+             (long long)marks, (long long)notifies);
+    check("stress", "every resource notified after its last change", lost == 0, detail);
+    snprintf(detail, sizeof(detail), "%d resources, closest %.1f ms apart (%s, min %u ms)", too_close,
+             worst_gap_us / 1000.0, (const char*)_coap_resources_start[worst_index].path.s, interval_ms(worst_index));
+    check("stress", "notifications respect the minimum interval", too_close == 0, detail);
+}
+
+static void test_latency()
+{
+    char detail[160];
+    const size_t index = s_stress_index[0]; // Kconfig default interval
+    int64_t worst_us = 0;
+    int missed = 0;
+    for (int i = 0; i < 20; i++) {
+        usleep((interval_ms(index) + 20) * 1000);
+        pthread_mutex_lock(&s_records_lock);
+        const int64_t before = s_records[index].notifies;
+        pthread_mutex_unlock(&s_records_lock);
+
+        const int64_t marked_us = esp_timer_get_time();
+        mark(index);
+        int64_t waited_us = 0;
+        for (;;) {
+            pthread_mutex_lock(&s_records_lock);
+            const bool done = s_records[index].notifies > before;
+            const int64_t notified_us = s_records[index].last_notify_us;
+            pthread_mutex_unlock(&s_records_lock);
+            if (done) {
+                waited_us = notified_us - marked_us;
+                break;
+            }
+            if (esp_timer_get_time() - marked_us > 1000000) {
+                missed++;
+                break;
+            }
+            usleep(100);
+        }
+        worst_us = waited_us > worst_us ? waited_us : worst_us;
+    }
+    snprintf(detail, sizeof(detail), "worst %.2f ms over 20 changes, %d missed", worst_us / 1000.0, missed);
+    check("latency", "an idle resource is notified promptly", missed == 0 && worst_us < 20000, detail);
+}
+
+static void test_heartbeat()
+{
+    char detail[160];
+    pthread_mutex_lock(&s_records_lock);
+    const int64_t before = s_records[s_heartbeat_index].notifies;
+    pthread_mutex_unlock(&s_records_lock);
+
+    usleep((BO_COAP_HEARTBEAT_INTERVAL_MS * 2 + 500) * 1000);
+
+    pthread_mutex_lock(&s_records_lock);
+    const int64_t beats = s_records[s_heartbeat_index].notifies - before;
+    const int64_t gap_us = s_records[s_heartbeat_index].min_gap_us;
+    pthread_mutex_unlock(&s_records_lock);
+    snprintf(detail, sizeof(detail), "%lld beats in %.1f s, closest %.1f ms apart", (long long)beats,
+             (BO_COAP_HEARTBEAT_INTERVAL_MS * 2 + 500) / 1000.0, gap_us == INT64_MAX ? 0.0 : gap_us / 1000.0);
+    check("heartbeat", "sent every interval while idle",
+          beats == 2 && gap_us >= (BO_COAP_HEARTBEAT_INTERVAL_MS - 1) * 1000LL, detail);
+}
+
+static uint32_t etag_generation() { return 7; }
+
+static void etag_for(const char* query, uint8_t etag[ETAG_SIZE])
+{
+    static const struct coap_resource_desc desc = { .get_generation = etag_generation };
+    const coap_string_t q = { strlen(query), (uint8_t*)query };
+    make_etag(&desc, &q, etag);
+}
+
+static void test_etag()
+{
+    static const char* const COMPACT[] = { "compact", "compact=1", "x=2&compact", "compact&x=2" };
+    static const char* const TEXT[] = { "", "x=2", "compacted", "notcompact" };
+    uint8_t ref[ETAG_SIZE], etag[ETAG_SIZE];
+    int wrong = 0;
+    etag_for("", ref);
+    for (size_t i = 0; i < 4; i++) {
+        etag_for(TEXT[i], etag);
+        wrong += memcmp(etag, ref, ETAG_SIZE) != 0;
+    }
+    etag_for("compact", ref);
+    for (size_t i = 0; i < 4; i++) {
+        etag_for(COMPACT[i], etag);
+        wrong += memcmp(etag, ref, ETAG_SIZE) != 0;
+    }
+    etag_for("", etag);
+    const bool differ = memcmp(etag, ref, ETAG_SIZE) != 0;
+    char detail[160];
+    snprintf(detail, sizeof(detail), "%d of 8 queries mismatched, schemas %s", wrong, differ ? "differ" : "collide");
+    check("etag", "one variant per schema, whatever the query spelling", wrong == 0 && differ, detail);
+}
+
+static void test_shutdown()
+{
+    char detail[160];
+    const int64_t started_us = esp_timer_get_time();
+    _bo_event_handler(NULL, BO_SYSTEM_EVENTS, BO_EVENT_SHUTDOWN_SCHEDULED, NULL);
+    pthread_join((pthread_t)_coap_server_task, NULL);
+    const int64_t took_us = esp_timer_get_time() - started_us;
+    snprintf(detail, sizeof(detail), "stopped in %.2f ms", took_us / 1000.0);
+    check("shutdown", "wakes the loop and ends the task", took_us < 100000 && _wakeup_fd < 0, detail);
+}
+
+int main(int argc, char** argv)
+{
+    const int producers = atoi(argv[1]);
+    const int seconds = atoi(argv[2]);
+    s_request_cost_us = atoi(argv[3]);
+
+    if (setup_resources() != 0 || _coap_init() != 0) {
+        printf("coap init failed\n");
+        return 1;
+    }
+
+    test_stress(producers, seconds);
+    test_latency();
+    test_heartbeat();
+    test_etag();
+    test_shutdown();
+    return s_failures != 0;
+}
+'''
+
+# Same job as the linker fragment of the firmware: bracket the resource table with `_coap_resources_start`/`_end`
+LINKER_FRAGMENT = '''
+SECTIONS {
+    .coap_resource_desc : {
+        _coap_resources_start = .;
+        KEEP(*(.coap_resource_desc))
+        _coap_resources_end = .;
+    }
+}
+INSERT AFTER .data;
+'''
+
+
+def resources_source() -> str:
+    lines = ['COAP_RESOURCE_DEFINE(BO_COAP_PATH_HEARTBEAT, true, NULL, NULL, NULL, NULL)',
+             'COAP_RESOURCE_DEFINE(BO_COAP_PATH_POWER, true, NULL, NULL, NULL, NULL)']
+    for n in range(RESOURCES):
+        # A third each with the Kconfig default, a short and a long throttle
+        if n % 3 == 0:
+            lines.append(f'COAP_RESOURCE_DEFINE("stress/{n}", true, NULL, NULL, NULL, NULL)')
+        else:
+            lines.append(f'COAP_RESOURCE_DEFINE_THROTTLED("stress/{n}", {20 if n % 3 == 1 else 250}, '
+                         'NULL, NULL, NULL, NULL)')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='CoAP server loop and notification stress test')
+    parser.add_argument('--producers', type=int, default=4, help='Threads marking resources as changed')
+    parser.add_argument('--seconds', type=int, default=3, help='Duration of the stress phase')
+    parser.add_argument('--request-cost-us', type=int, default=200,
+                        help='Time spent in every loop iteration as if a request was handled')
+    args = parser.parse_args()
+
+    with HostBuild(STUBS) as build:
+        build.write('resources.h', resources_source())
+        ld = build.write('resources.ld', LINKER_FRAGMENT)
+        exe = build.compile(HARNESS, includes=[CORE_DIR / 'src' / 'coap'],
+                            flags=['-include', 'esp_event.h', f'-DSTRESS_RESOURCES={RESOURCES}', f'-Wl,-T,{ld}'])
+        run(exe, args.producers, args.seconds, args.request_cost_us, error='CoAP stress test failed')
+
+if __name__ == '__main__':
+    main()
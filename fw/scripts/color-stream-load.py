@@ -0,0 +1,118 @@
+"""Load generator for the streaming color endpoint (`borneo/lyfi/color/stream`).
+
+Sends NON-confirmable, sequence-numbered color frames at a fixed rate while observing `borneo/lyfi/color`, then
+reports the achieved packet rate, the device-side accepted/dropped counters and the end-to-end latency from sending a
+frame to seeing its color in a notification.
+
+Channel 0 of every frame carries the low 12 bits of the sequence number, so notifications can be matched back to the
+frame that produced them. Latency includes the server-side notification coalescing window.
+
+Usage:
+    python color-stream-load.py coap://192.168.1.13 --rate 50 --duration 10 --channels 5
+"""
+
+import argparse
+import asyncio
+import logging
+import statistics
+import struct
+import time
+
+from cbor2 import dumps, loads
+import aiocoap
+from aiocoap import Message, GET, PUT, NON
+
+logging.basicConfig(level=logging.WARNING)
+
+LED_STATE_NORMAL = 0
+LED_STATE_DIMMING = 1
+BRIGHTNESS_MASK = 0x0FFF
+NO_RESPONSE_ALL = 26  # Suppress 2.xx, 4.xx and 5.xx responses (RFC 7967)
+
+
+def pack_frame(seq: int, channels: int) -> bytes:
+    color = [seq & BRIGHTNESS_MASK] + [(seq * 7 + ch * 97) & BRIGHTNESS_MASK for ch in range(1, channels)]
+    return struct.pack(f'>I{channels}H', seq & 0xFFFFFFFF, *color)
+
+
+def unpack_color(payload: bytes) -> list:
+    return list(struct.unpack(f'>{len(payload) // 2}H', payload))
+
+
+async def set_state(ctx, address: str, state: int):
+    msg = Message(code=PUT, uri=address + '/borneo/lyfi/state', payload=dumps(state))
+    await ctx.request(msg).response
+
+
+async def observe_color(ctx, address: str, sent: dict, latencies: list, stop: asyncio.Event):
+    request = Message(code=GET, uri=address + '/borneo/lyfi/color', observe=0)
+    pr = ctx.request(request)
+    await pr.response
+    async for msg in pr.observation:
+        now = time.perf_counter()
+        color = unpack_color(msg.payload)
+        # Match the newest frame whose tag equals channel 0
+        candidates = [seq for seq in sent if seq & BRIGHTNESS_MASK == color[0]]
+        if candidates:
+            latencies.append((now - sent[max(candidates)]) * 1000.0)
+        if stop.is_set():
+            break
+
+
+async def main():
+    parser = argparse.ArgumentParser(description='Streaming color endpoint load generator')
+    parser.add_argument('address', help='Device address, e.g. coap://192.168.1.13')
+    parser.add_argument('--rate', type=float, default=50.0, help='Frames per second')
+    parser.add_argument('--duration', type=float, default=10.0, help='Test duration in seconds')
+    parser.add_argument('--channels', type=int, default=5, help='LED channel count of the device')
+    args = parser.parse_args()
+
+    ctx = await aiocoap.Context.create_client_context()
+    await set_state(ctx, args.address, LED_STATE_DIMMING)
+
+    stream_uri = args.address + '/borneo/lyfi/color/stream'
+    before = loads((await ctx.request(Message(code=GET, uri=stream_uri)).response).payload)
+
+    sent = {}
+    latencies = []
+    stop = asyncio.Event()
+    observer = asyncio.create_task(observe_color(ctx, args.address, sent, latencies, stop))
+
+    period = 1.0 / args.rate
+    start = time.perf_counter()
+    seq = before.get('seq', 0) + 1
+    count = 0
+    while time.perf_counter() - start < args.duration:
+        msg = Message(code=PUT, uri=stream_uri, mtype=NON, no_response=NO_RESPONSE_ALL,
+                      payload=pack_frame(seq, args.channels))
+        sent[seq] = time.perf_counter()
+        ctx.request(msg)
+        seq += 1
+        count += 1
+        next_at = start + count * period
+        await asyncio.sleep(max(0.0, next_at - time.perf_counter()))
+    elapsed = time.perf_counter() - start
+
+    # Give the last notification a chance to arrive
+    await asyncio.sleep(0.5)
+    stop.set()
+    observer.cancel()
+
+    after = loads((await ctx.request(Message(code=GET, uri=stream_uri)).response).payload)
+    await set_state(ctx, args.address, LED_STATE_NORMAL)
+    await ctx.shutdown()
+
+    print(f'Sent:          {count} frames in {elapsed:.2f} s ({count / elapsed:.1f} frames/s)')
+    print(f'Accepted:      {after["accepted"] - before["accepted"]}')
+    print(f'Dropped:       {after["dropped"] - before["dropped"]}')
+    print(f'Lost:          {count - (after["accepted"] - before["accepted"]) - (after["dropped"] - before["dropped"])}')
+    print(f'Notifications: {len(latencies)} ({len(latencies) / elapsed:.1f} /s)')
+    if latencies:
+        latencies.sort()
+        p95 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.95))]
+        print(f'Latency (ms):  min={latencies[0]:.1f} p50={statistics.median(latencies):.1f} '
+              f'p95={p95:.1f} max={latencies[-1]:.1f}')
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,151 @@
+"""Cost of a drvfx device lookup versus the number of devices.
+
+Compiles the firmware's `drvfx/kernel/device.c` for the host with a table of generated devices, then times, per
+lookup of every device in turn:
+
+- `linear`: the former `k_device_get_binding()`, a pointer compare scan followed by a `strcmp()` scan
+- `hashed`: `k_device_get_binding()` on the perfect hash built by `k_device_init()`
+- `handle`: `DRVFX_DEVICE_GET()` plus `k_device_is_ready()`, what `fan_set_power()` does now
+
+Names are looked up from copies, so the pointer compare never hits, like a lookup from another file whose string
+literal was not merged. The host is much faster than an ESP32; compare the columns, not the absolute figures.
+
+Usage:
+    python device-lookup-bench.py --devices 4 8 16 32 64
+"""
+
+import argparse
+import subprocess
+
+from host_build import DRVFX_DIR, HostBuild
+
+HARNESS = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <drvfx/drvfx.h>
+
+#define DEVICE(i, name_)                                                                                               \
+    static struct drvfx_device_state s_state_##i = { .initialized = true };                                            \
+    __attribute__((section("drvfx_device"), used, aligned(__alignof(struct drvfx_device))))                            \
+    const struct drvfx_device dev_##i = { .name = name_, .state = &s_state_##i };
+
+DEVICES
+
+extern const struct drvfx_device __start_drvfx_device[];
+extern const struct drvfx_device __stop_drvfx_device[];
+
+static const struct drvfx_device* linear_get_binding(const char* name)
+{
+    for (const struct drvfx_device* dev = __start_drvfx_device; dev < __stop_drvfx_device; dev++) {
+        if (k_device_is_ready(dev) && (dev->name == name)) {
+            return dev;
+        }
+    }
+    for (const struct drvfx_device* dev = __start_drvfx_device; dev < __stop_drvfx_device; dev++) {
+        if (k_device_is_ready(dev) && (strcmp(name, dev->name) == 0)) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    long rounds = atol(argv[1]);
+    size_t count = __stop_drvfx_device - __start_drvfx_device;
+    if (k_device_init() != 0) {
+        return 1;
+    }
+
+    char** names = malloc(count * sizeof(char*));
+    for (size_t i = 0; i < count; i++) {
+        names[i] = strdup(__start_drvfx_device[i].name);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (k_device_get_binding(names[i]) != &__start_drvfx_device[i] || linear_get_binding(names[i]) == NULL) {
+            fprintf(stderr, "lookup of %s failed\n", names[i]);
+            return 1;
+        }
+    }
+    if (k_device_get_binding("no.such.device") != NULL) {
+        fprintf(stderr, "found a device that does not exist\n");
+        return 1;
+    }
+
+    volatile uintptr_t sink = 0;
+    double begin = now();
+    for (long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            sink += (uintptr_t)linear_get_binding(names[i]);
+        }
+    }
+    double linear = now() - begin;
+
+    begin = now();
+    for (long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            sink += (uintptr_t)k_device_get_binding(names[i]);
+        }
+    }
+    double hashed = now() - begin;
+
+    begin = now();
+    for (long r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            const struct drvfx_device* dev = HANDLE;
+            sink += k_device_is_ready(dev) ? (uintptr_t)dev : 0;
+        }
+    }
+    double handle = now() - begin;
+
+    double lookups = (double)rounds * count;
+    printf("%f %f %f\n", linear / lookups * 1e9, hashed / lookups * 1e9, handle / lookups * 1e9);
+    return 0;
+}
+'''
+
+# Shaped like the real ones, the prefix makes `strcmp()` work for its answer
+NAME_PREFIXES = ['sensor.', 'vreg.', 'fpwm.', 'adc.', 'rtc.']
+
+
+def device_names(count: int) -> list:
+    return [f'{NAME_PREFIXES[i % len(NAME_PREFIXES)]}dev{i}' for i in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='drvfx device lookup benchmark')
+    parser.add_argument('--devices', type=int, nargs='*', default=[4, 8, 16, 32, 64], help='Device counts')
+    parser.add_argument('--lookups', type=int, default=2_000_000, help='Lookups timed per method')
+    args = parser.parse_args()
+
+    with HostBuild() as build:
+
+        print(f'{"devices":>8} {"linear ns":>10} {"hashed ns":>10} {"handle ns":>10}')
+        for count in args.devices:
+            names = device_names(count)
+            devices = '\n'.join(f'DEVICE({i}, "{name}")' for i, name in enumerate(names))
+            # The last device is the worst case of the linear scan
+            source = HARNESS.replace('DEVICES', devices).replace('HANDLE', f'&dev_{count - 1}')
+            exe = build.compile(source, sources=[DRVFX_DIR / 'kernel' / 'device.c'],
+                                flags=['-D_drvfx_device_start=__start_drvfx_device',
+                                       '-D_drvfx_device_end=__stop_drvfx_device'])
+
+            result = subprocess.run([str(exe), str(max(args.lookups // count, 1))], capture_output=True, text=True)
+            if result.returncode != 0:
+                print(f'{count:>8} failed: {result.stderr.strip()}')
+                continue
+            linear, hashed, handle = (float(v) for v in result.stdout.split())
+            print(f'{count:>8} {linear:>10.1f} {hashed:>10.1f} {handle:>10.1f}')
+
+
+if __name__ == '__main__':
+    main()
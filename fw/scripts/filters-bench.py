@@ -0,0 +1,423 @@
+"""Tests and cost of the streaming sensor filters (`borneo-core/include/borneo/algo/filters.h`).
+
+Compiles the firmware's `filters.c` for the host and:
+
+1. Checks the filters against the response they are designed for:
+   - `step`: the EMA and the biquad settle on a step without overshooting more than a Butterworth does, and a real 0
+     sample stays 0 instead of re-initializing the EMA
+   - `impulse`: median-of-3/5/7 reject runs of 1/2/3 spikes, the EMA passes `alpha` of one, the biquad impulse
+     response matches a double precision reference within a few LSB
+   - `invalid`: the integer stand-ins for a NaN reading, INT32_MIN and INT32_MAX, go through the median-of-5 and EMA
+     chain of the sensor drivers without moving the output or overflowing, and frequencies that would make the
+     biquad coefficients NaN or unstable are refused
+   - `window`: min/max/mean/variance of the sliding window against brute force over random samples
+2. Times every filter per sample, next to the baselines they replaced: `qsort()` of a copy for the medians and a
+   rescan of the window for the statistics. The host is much faster than an ESP32; compare the rows, not the
+   absolute figures.
+
+Usage:
+    python filters-bench.py --samples 2000000
+"""
+
+import argparse
+
+from host_build import CORE_DIR, HostBuild, run
+
+HARNESS = r'''
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <borneo/algo/filters.h>
+
+static int s_failures;
+
+static void check(const char* group, const char* name, bool ok, const char* detail)
+{
+    printf("%-8s %-46s %-6s %s\n", group, name, ok ? "ok" : "FAILED", detail);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static uint32_t s_rng = 12345;
+
+static int32_t rnd(int32_t lo, int32_t hi)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return lo + (int32_t)((s_rng >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static int cmp_i32(const void* a, const void* b)
+{
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int32_t median_qsort(const int32_t* values, size_t n)
+{
+    int32_t copy[MEDIAN_FILTER_WINDOW_MAX];
+    memcpy(copy, values, n * sizeof(int32_t));
+    qsort(copy, n, sizeof(int32_t), cmp_i32);
+    return copy[n / 2];
+}
+
+// The same RBJ cookbook design in double precision, starting from rest
+struct biquad_ref {
+    double b0, b1, b2, a1, a2;
+    double x1, x2, y1, y2;
+};
+
+static void biquad_ref_init(struct biquad_ref* ref, double sample_rate, double cutoff)
+{
+    double w0 = 2.0 * M_PI * cutoff / sample_rate;
+    double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    double a0 = 1.0 + alpha;
+    memset(ref, 0, sizeof(*ref));
+    ref->b0 = (1.0 - cos(w0)) / 2.0 / a0;
+    ref->b1 = (1.0 - cos(w0)) / a0;
+    ref->b2 = ref->b0;
+    ref->a1 = -2.0 * cos(w0) / a0;
+    ref->a2 = (1.0 - alpha) / a0;
+}
+
+static double biquad_ref_update(struct biquad_ref* ref, double x)
+{
+    double y = ref->b0 * x + ref->b1 * ref->x1 + ref->b2 * ref->x2 - ref->a1 * ref->y1 - ref->a2 * ref->y2;
+    ref->x2 = ref->x1;
+    ref->x1 = x;
+    ref->y2 = ref->y1;
+    ref->y1 = y;
+    return y;
+}
+
+static void test_step()
+{
+    char detail[128];
+
+    struct ema_filter ema;
+    ema_filter_init(&ema, 1, 8);
+    ema_filter_update(&ema, 0);
+    int32_t y = 0, prev = 0;
+    bool monotonic = true;
+    int settle = -1;
+    for (int i = 0; i < 200; i++) {
+        y = ema_filter_update(&ema, 10000);
+        monotonic &= y >= prev && y <= 10000;
+        prev = y;
+        if (settle < 0 && 10000 - y <= 100) {
+            settle = i + 1;
+        }
+    }
+    // (7/8)^n < 1%: n >= 35, integer truncation may stop it a few counts short
+    snprintf(detail, sizeof(detail), "1%% after %d samples, ends at %d", settle, y);
+    check("step", "EMA 1/8 0 -> 10000 rises monotonically", monotonic && settle >= 30 && settle <= 40 && 10000 - y < 8,
+          detail);
+
+    ema_filter_init(&ema, 1, 8);
+    bool zero = ema_filter_update(&ema, 0) == 0 && ema_filter_update(&ema, 0) == 0 && ema.initialized;
+    check("step", "EMA keeps a real 0 sample", zero, "");
+
+    struct biquad_filter bq;
+    struct biquad_ref ref;
+    biquad_lowpass_init(&bq, 10000, 1000); // 10 Hz sampling, 1 Hz cut-off
+    biquad_ref_init(&ref, 10000, 1000);
+    biquad_filter_update(&bq, 0);
+    int32_t peak = 0;
+    double ref_peak = 0;
+    for (int i = 0; i < 500; i++) {
+        y = biquad_filter_update(&bq, 100000);
+        double yr = biquad_ref_update(&ref, 100000);
+        peak = y > peak ? y : peak;
+        ref_peak = yr > ref_peak ? yr : ref_peak;
+    }
+    // The analog Butterworth overshoots by 4.3%, its bilinear transform this close to Nyquist a bit more
+    snprintf(detail, sizeof(detail), "overshoot %.2f%% (double %.2f%%), ends at %d", (peak - 100000) / 1000.0,
+             (ref_peak - 100000) / 1000.0, y);
+    check("step", "biquad 1 Hz @ 10 Hz 0 -> 100000 settles", abs(y - 100000) <= 1 && fabs(peak - ref_peak) <= 4,
+          detail);
+
+    biquad_lowpass_init(&bq, 10000, 1000);
+    int32_t first = biquad_filter_update(&bq, 5000);
+    int32_t second = biquad_filter_update(&bq, 5000);
+    snprintf(detail, sizeof(detail), "first outputs %d, %d", first, second);
+    check("step", "biquad primed by its first sample", first == 5000 && second == 5000, detail);
+}
+
+static void test_impulse()
+{
+    char detail[128];
+    static const size_t SIZES[] = { 3, 5, 7 };
+    for (size_t s = 0; s < 3; s++) {
+        size_t size = SIZES[s];
+        size_t run = size / 2;
+        struct median_filter median;
+        median_filter_init(&median, size);
+        int32_t worst = 0;
+        for (int i = 0; i < 40; i++) {
+            int32_t x = (i >= 10 && i < 10 + (int)run) ? 1000000 : 100;
+            int32_t y = median_filter_update(&median, x);
+            if (abs(y - 100) > worst) {
+                worst = abs(y - 100);
+            }
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "median-of-%zu rejects %zu spikes in a row", size, run);
+        snprintf(detail, sizeof(detail), "worst deviation %d", worst);
+        check("impulse", name, worst == 0, detail);
+
+        // One more spike than the window can reject gets through
+        median_filter_init(&median, size);
+        worst = 0;
+        for (int i = 0; i < 40; i++) {
+            int32_t y = median_filter_update(&median, (i >= 10 && i < 10 + (int)run + 1) ? 1000000 : 100);
+            if (y > worst) {
+                worst = y;
+            }
+        }
+        snprintf(name, sizeof(name), "median-of-%zu passes %zu spikes in a row", size, run + 1);
+        check("impulse", name, worst == 1000000, "");
+    }
+
+    struct ema_filter ema;
+    ema_filter_init(&ema, 1, 8);
+    ema_filter_update(&ema, 0);
+    int32_t peak = ema_filter_update(&ema, 80000);
+    int32_t after = ema_filter_update(&ema, 0);
+    snprintf(detail, sizeof(detail), "peak %d, next %d", peak, after);
+    check("impulse", "EMA 1/8 passes 1/8 of a spike", peak == 10000 && after == 8750, detail);
+
+    struct biquad_filter bq;
+    struct biquad_ref ref;
+    biquad_lowpass_init(&bq, 50000, 2000);
+    biquad_ref_init(&ref, 50000, 2000);
+    int32_t worst = 0;
+    biquad_filter_update(&bq, 0);
+    for (int i = 0; i < 300; i++) {
+        int32_t x = i == 0 ? 1000000 : 0;
+        int32_t y = biquad_filter_update(&bq, x);
+        int32_t err = abs(y - (int32_t)lround(biquad_ref_update(&ref, x)));
+        if (err > worst) {
+            worst = err;
+        }
+    }
+    snprintf(detail, sizeof(detail), "worst error %d LSB of a 1000000 impulse", worst);
+    check("impulse", "biquad 2 Hz @ 50 Hz vs double reference", worst <= 4, detail);
+}
+
+static void test_invalid()
+{
+    char detail[128];
+    static const int32_t GLITCHES[] = { INT32_MIN, INT32_MAX };
+    for (size_t g = 0; g < 2; g++) {
+        struct median_filter median;
+        struct ema_filter ema;
+        median_filter_init(&median, 5);
+        ema_filter_init(&ema, 1, 4);
+        int32_t y = 0;
+        bool steady = true;
+        for (int i = 0; i < 30; i++) {
+            int32_t x = (i == 10 || i == 20 || i == 21) ? GLITCHES[g] : 2500;
+            y = ema_filter_update(&ema, median_filter_update(&median, x));
+            steady &= y == 2500;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "median-of-5 + EMA ignore %s", g == 0 ? "INT32_MIN" : "INT32_MAX");
+        snprintf(detail, sizeof(detail), "output %d", y);
+        check("invalid", name, steady, detail);
+    }
+
+    struct ema_filter ema;
+    ema_filter_init(&ema, 3, 4);
+    int32_t hi = 0, lo = 0;
+    for (int i = 0; i < 10; i++) {
+        hi = ema_filter_update(&ema, INT32_MAX);
+    }
+    for (int i = 0; i < 40; i++) {
+        lo = ema_filter_update(&ema, INT32_MIN);
+    }
+    // The division truncates toward zero, so a negative input is approached from above
+    snprintf(detail, sizeof(detail), "%d, then %d", hi, lo);
+    check("invalid", "EMA on INT32_MAX then INT32_MIN does not wrap", hi == INT32_MAX && lo <= INT32_MIN + 1, detail);
+
+    struct biquad_filter bq;
+    bool refused = biquad_lowpass_init(&bq, 10000, 5000) == -EINVAL && biquad_lowpass_init(&bq, 10000, 0) == -EINVAL
+        && biquad_lowpass_init(&bq, 0, 1000) == -EINVAL && biquad_lowpass_init(&bq, 10000, 4999) == 0;
+    check("invalid", "biquad refuses cut-off 0 or >= Nyquist", refused, "");
+
+    struct median_filter median;
+    struct window_stats stats;
+    bool sizes = median_filter_init(&median, 4) == -EINVAL && median_filter_init(&median, 9) == -EINVAL
+        && window_stats_init(&stats, 0) == -EINVAL && window_stats_init(&stats, WINDOW_STATS_CAPACITY + 1) == -EINVAL
+        && ema_filter_init(&ema, 0, 4) == -EINVAL && ema_filter_init(&ema, 5, 4) == -EINVAL;
+    check("invalid", "bad window sizes and alphas refused", sizes, "");
+
+    window_stats_init(&stats, 8);
+    bool empty = window_stats_min(&stats) == 0 && window_stats_max(&stats) == 0 && window_stats_mean(&stats) == 0
+        && window_stats_variance(&stats) == 0;
+    check("invalid", "empty window reads 0", empty, "");
+}
+
+static void test_window()
+{
+    char detail[128];
+    static const size_t SIZES[] = { 1, 2, 5, 16, WINDOW_STATS_CAPACITY };
+    for (size_t s = 0; s < 5; s++) {
+        size_t size = SIZES[s];
+        struct window_stats stats;
+        window_stats_init(&stats, size);
+        int32_t history[4096];
+        int mismatches = 0;
+        for (int i = 0; i < 4096; i++) {
+            // Runs of equal values and monotonic stretches exercise the deques
+            int32_t x = (i / 64) % 3 == 0 ? rnd(-8000000, 8000000) : (i / 64) % 3 == 1 ? i * 100 : 42;
+            history[i] = x;
+            window_stats_update(&stats, x);
+
+            size_t n = (size_t)i + 1 < size ? (size_t)i + 1 : size;
+            int32_t mn = INT32_MAX, mx = INT32_MIN;
+            int64_t sum = 0, sum_sq = 0;
+            for (size_t k = 0; k < n; k++) {
+                int32_t v = history[i - k];
+                mn = v < mn ? v : mn;
+                mx = v > mx ? v : mx;
+                sum += v;
+                sum_sq += (int64_t)v * v;
+            }
+            int64_t nn = (int64_t)n;
+            int32_t mean = (int32_t)(sum >= 0 ? (sum + nn / 2) / nn : (sum - nn / 2) / nn);
+            int64_t var = (nn * sum_sq - sum * sum) / (nn * nn);
+            if (window_stats_min(&stats) != mn || window_stats_max(&stats) != mx || window_stats_mean(&stats) != mean
+                || window_stats_variance(&stats) != var) {
+                mismatches++;
+            }
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "window of %zu vs brute force", size);
+        snprintf(detail, sizeof(detail), "%d mismatches in 4096 samples", mismatches);
+        check("window", name, mismatches == 0, detail);
+    }
+
+    // Every ordering of values with ties, for the fixed networks
+    int mismatches = 0;
+    int32_t v[7];
+    for (int n = 0; n < 2000000; n++) {
+        for (int k = 0; k < 7; k++) {
+            v[k] = rnd(0, 5);
+        }
+        mismatches += median3_i32(v[0], v[1], v[2]) != median_qsort(v, 3);
+        mismatches += median5_i32(v) != median_qsort(v, 5);
+        mismatches += median7_i32(v) != median_qsort(v, 7);
+    }
+    snprintf(detail, sizeof(detail), "%d mismatches in 2000000 draws", mismatches);
+    check("window", "median networks vs qsort", mismatches == 0, detail);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int64_t s_sink;
+
+#define TIME(name, n, ...)                                                                                             \
+    do {                                                                                                               \
+        double begin = now();                                                                                          \
+        for (long i = 0; i < (n); i++) {                                                                               \
+            __VA_ARGS__;                                                                                               \
+        }                                                                                                              \
+        printf("%s %.2f\n", name, (now() - begin) / (n) * 1e9);                                                        \
+    } while (0)
+
+static void bench(long n)
+{
+    int32_t* input = malloc(4096 * sizeof(int32_t));
+    for (int i = 0; i < 4096; i++) {
+        input[i] = 2000 + rnd(-50, 50) + (i % 97 == 0 ? 100000 : 0);
+    }
+#define X (input[i & 4095])
+
+    int32_t w[MEDIAN_FILTER_WINDOW_MAX] = { 0 };
+    TIME("median3-qsort", n, { w[i % 3] = X; s_sink += median_qsort(w, 3); });
+    TIME("median3", n, { w[i % 3] = X; s_sink += median3_i32(w[0], w[1], w[2]); });
+    TIME("median5-qsort", n, { w[i % 5] = X; s_sink += median_qsort(w, 5); });
+    TIME("median5", n, { w[i % 5] = X; s_sink += median5_i32(w); });
+    TIME("median7-qsort", n, { w[i % 7] = X; s_sink += median_qsort(w, 7); });
+    TIME("median7", n, { w[i % 7] = X; s_sink += median7_i32(w); });
+
+    struct median_filter median;
+    median_filter_init(&median, 5);
+    struct ema_filter ema;
+    ema_filter_init(&ema, 1, 8);
+    TIME("median5+ema", n, { s_sink += ema_filter_update(&ema, median_filter_update(&median, X)); });
+
+    struct biquad_filter bq;
+    biquad_lowpass_init(&bq, 10000, 1000);
+    TIME("biquad", n, { s_sink += biquad_filter_update(&bq, X); });
+
+    struct window_stats stats;
+    window_stats_init(&stats, WINDOW_STATS_CAPACITY);
+    TIME("window32", n, {
+        window_stats_update(&stats, X);
+        s_sink += window_stats_min(&stats) + window_stats_max(&stats) + window_stats_variance(&stats);
+    });
+
+    int32_t ring[WINDOW_STATS_CAPACITY] = { 0 };
+    TIME("window32-rescan", n, {
+        ring[i % WINDOW_STATS_CAPACITY] = X;
+        int32_t mn = INT32_MAX, mx = INT32_MIN;
+        int64_t sum = 0, sum_sq = 0;
+        for (int k = 0; k < WINDOW_STATS_CAPACITY; k++) {
+            mn = ring[k] < mn ? ring[k] : mn;
+            mx = ring[k] > mx ? ring[k] : mx;
+            sum += ring[k];
+            sum_sq += (int64_t)ring[k] * ring[k];
+        }
+        s_sink += mn + mx + (WINDOW_STATS_CAPACITY * sum_sq - sum * sum) / (WINDOW_STATS_CAPACITY * WINDOW_STATS_CAPACITY);
+    });
+    free(input);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        bench(atol(argv[1]));
+        return 0;
+    }
+    test_step();
+    test_impulse();
+    test_invalid();
+    test_window();
+    return s_failures != 0;
+}
+'''
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Sensor filter tests and benchmark')
+    parser.add_argument('--samples', type=int, default=2_000_000, help='Samples timed per filter')
+    args = parser.parse_args()
+
+    with HostBuild() as build:
+        exe = build.compile(HARNESS, sources=[CORE_DIR / 'src' / 'algo' / 'filters.c'],
+                            flags=['-include', 'stddef.h', '-include', 'stdint.h', '-include', 'stdbool.h'])
+        run(exe, error='filter tests failed')
+        print()
+
+        result = run(exe, args.samples, quiet=True)
+        print(f'{"filter":<16} {"ns/sample":>10}')
+        for line in result.stdout.splitlines():
+            name, ns = line.split()
+            print(f'{name:<16} {float(ns):>10.2f}')
+
+
+if __name__ == '__main__':
+    main()
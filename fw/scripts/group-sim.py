@@ -0,0 +1,406 @@
+"""Multi-fixture simulation of the synchronized group command (`borneo/lyfi/group/command`).
+
+Compiles the firmware's `lyfi/main/src/led/group.c` for the host, with the LED state machine reduced to its state
+transitions, and spawns one process per simulated fixture. Every node joins the CoAP multicast group, parses the NON
+POST the same way the firmware does and drops commands for groups it is not a member of. The others go through
+`led_schedule_group_command()`, and the node calls `led_group_command_poll()` at every render frame until the command
+is applied. Each node gets its own delivery delay (Wi-Fi power save holds multicast frames until the next DTIM
+beacon), clock offset (the residual SNTP error) and render frame phase, so the report shows how far apart the fixtures
+really switch, next to how far apart the datagram arrived.
+
+With `--test` the script only checks the firmware code: which commands are rejected when scheduled, and when and how
+the accepted ones are applied. With `--send-only` it only builds and sends the multicast command, which drives real
+devices on the LAN.
+
+Usage:
+    python group-sim.py --test
+    python group-sim.py --nodes 8 --group 3 --groups 3 3 3 3 0 5 5 3 --delay 500 --state 1 --color 100 200 300 400
+    python group-sim.py --send-only --interface 192.168.1.10 --group 3 --state 1 --color 0 0 0 0 4095
+"""
+
+import argparse
+import ctypes
+import errno
+import multiprocessing
+import random
+import socket
+import statistics
+import struct
+import time
+from pathlib import Path
+
+from cbor2 import dumps, loads
+
+from host_build import FW_DIR, LYFI_DIR, HostBuild
+
+MCAST_ADDRESS = '224.0.1.187'  # IPv4 "All CoAP Nodes", same as CONFIG_BORNEO_COAP_MULTICAST_ADDRESS
+COAP_PORT = 5683
+GROUP_COMMAND_PATH = 'borneo/lyfi/group/command'
+
+COAP_TYPE_NON = 1
+COAP_CODE_POST = 2
+COAP_OPTION_URI_PATH = 11
+COAP_OPTION_CONTENT_FORMAT = 12
+CONTENT_FORMAT_CBOR = 60
+
+RENDER_FRAME_MS = 10  # LED_UPDATE_PERIOD of the render task
+
+CHANNELS = 4
+
+STATE_NORMAL, STATE_DIMMING, STATE_TEMPORARY, STATE_PREVIEW, STATE_DISCO = range(5)
+
+SDKCONFIG = f'#pragma once\n#define CONFIG_LYFI_LED_CHANNEL_COUNT {CHANNELS}\n'
+
+HARNESS = r'''
+#include "group.c"
+
+struct led_status _led;
+portMUX_TYPE g_led_spinlock;
+
+static int64_t s_now_ms;
+static bool s_power_on = true;
+static uint8_t s_state;
+static led_color_t s_color;
+
+kernel_mode_t k_get_mode() { return KERNEL_MODE_NORMAL; }
+bool bo_power_is_on() { return s_power_on; }
+int64_t bo_rtc_get_timestamp_us() { return s_now_ms * 1000LL; }
+size_t led_channel_count() { return CONFIG_LYFI_LED_CHANNEL_COUNT; }
+uint8_t led_get_state() { return s_state; }
+
+// The transitions `led_switch_state()` allows
+int led_switch_state(uint8_t state)
+{
+    static const uint8_t FROM[LED_STATE_COUNT] = {
+        [LED_STATE_NORMAL] = 0x1F,
+        [LED_STATE_DIMMING] = 1 << LED_STATE_NORMAL | 1 << LED_STATE_TEMPORARY,
+        [LED_STATE_TEMPORARY] = 1 << LED_STATE_NORMAL,
+        [LED_STATE_PREVIEW] = 1 << LED_STATE_DIMMING,
+        [LED_STATE_DISCO] = 1 << LED_STATE_NORMAL,
+    };
+    if (state >= LED_STATE_COUNT || state == s_state || !(FROM[state] & (1 << s_state))) {
+        return -EINVAL;
+    }
+    s_state = state;
+    return 0;
+}
+
+// Like the firmware, only the dimming state takes a color
+int led_set_color(const led_color_t color)
+{
+    if (s_state != LED_STATE_DIMMING) {
+        return -EINVAL;
+    }
+    memcpy(s_color, color, sizeof(s_color));
+    return 0;
+}
+
+void sim_reset(uint8_t state, bool power_on)
+{
+    memset(&_led, 0, sizeof(_led));
+    memset(s_color, 0, sizeof(s_color));
+    s_state = state;
+    s_power_on = power_on;
+}
+
+int sim_schedule(int64_t now_ms, int64_t at_ms, int state, const uint16_t* color)
+{
+    struct led_group_command command = { .apply_at_ms = at_ms };
+    if (state >= 0) {
+        command.has_state = true;
+        command.state = (uint8_t)state;
+    }
+    if (color != NULL) {
+        command.has_color = true;
+        memcpy(command.color, color, sizeof(command.color));
+    }
+    s_now_ms = now_ms;
+    return led_schedule_group_command(&command);
+}
+
+// Runs one render frame, returns whether it applied the pending command
+bool sim_poll(int64_t now_ms)
+{
+    bool pending = _led.group_command.pending;
+    s_now_ms = now_ms;
+    led_group_command_poll();
+    return pending && !_led.group_command.pending;
+}
+
+uint8_t sim_state() { return s_state; }
+const uint16_t* sim_color() { return s_color; }
+'''
+
+
+def build_firmware(build: HostBuild) -> Path:
+    """Compiles `group.c` into a shared library for `load_firmware()`."""
+    return build.compile(HARNESS, includes=[LYFI_DIR / 'led', FW_DIR / '3rd-components' / 'smf' / 'include'],
+                         output='group.so', shared=True)
+
+
+def load_firmware(lib: Path):
+    fw = ctypes.CDLL(str(lib))
+    fw.sim_reset.argtypes = [ctypes.c_uint8, ctypes.c_bool]
+    fw.sim_schedule.argtypes = [ctypes.c_int64, ctypes.c_int64, ctypes.c_int, ctypes.POINTER(ctypes.c_uint16)]
+    fw.sim_poll.argtypes = [ctypes.c_int64]
+    fw.sim_poll.restype = ctypes.c_bool
+    fw.sim_state.restype = ctypes.c_uint8
+    fw.sim_color.restype = ctypes.POINTER(ctypes.c_uint16)
+    return fw
+
+
+def color_arg(color):
+    if color is None:
+        return None
+    return (ctypes.c_uint16 * CHANNELS)(*(list(color) + [0] * CHANNELS)[:CHANNELS])
+
+
+def encode_option(delta: int, value: bytes) -> bytes:
+    def nibble(n: int):
+        if n < 13:
+            return n, b''
+        if n < 269:
+            return 13, bytes([n - 13])
+        return 14, struct.pack('>H', n - 269)
+
+    d, d_ext = nibble(delta)
+    length, l_ext = nibble(len(value))
+    return bytes([(d << 4) | length]) + d_ext + l_ext + value
+
+
+def build_command(path: str, payload: bytes) -> bytes:
+    message_id = random.getrandbits(16)
+    pdu = struct.pack('>BBH', (1 << 6) | (COAP_TYPE_NON << 4), COAP_CODE_POST, message_id)
+    last = 0
+    for segment in path.split('/'):
+        pdu += encode_option(COAP_OPTION_URI_PATH - last, segment.encode())
+        last = COAP_OPTION_URI_PATH
+    pdu += encode_option(COAP_OPTION_CONTENT_FORMAT - last, bytes([CONTENT_FORMAT_CBOR]))
+    return pdu + b'\xff' + payload
+
+
+def parse_command(pdu: bytes):
+    """Returns `(uri_path, payload)` of a CoAP request, or `None` if it is not a POST."""
+    if len(pdu) < 4 or pdu[0] >> 6 != 1 or pdu[1] != COAP_CODE_POST:
+        return None
+    pos = 4 + (pdu[0] & 0x0F)
+    number = 0
+    segments = []
+    while pos < len(pdu) and pdu[pos] != 0xFF:
+        delta, length = pdu[pos] >> 4, pdu[pos] & 0x0F
+        pos += 1
+        ext = []
+        for n in (delta, length):
+            if n == 13:
+                ext.append(pdu[pos] + 13)
+                pos += 1
+            elif n == 14:
+                ext.append(struct.unpack_from('>H', pdu, pos)[0] + 269)
+                pos += 2
+            else:
+                ext.append(n)
+        number += ext[0]
+        if number == COAP_OPTION_URI_PATH:
+            segments.append(pdu[pos:pos + ext[1]].decode())
+        pos += ext[1]
+    payload = pdu[pos + 1:] if pos < len(pdu) else b''
+    return '/'.join(segments), payload
+
+
+def open_listener(interface: str, port: int) -> socket.socket:
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, 'SO_REUSEPORT'):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(('', port))
+    mreq = socket.inet_aton(MCAST_ADDRESS) + socket.inet_aton(interface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return sock
+
+
+def node_main(index: int, groups: list, args, lib: Path, ready, results):
+    rng = random.Random(args.seed * 1000 + index)
+    clock_offset_ms = rng.uniform(-args.clock_error, args.clock_error)
+    frame_phase_ms = rng.uniform(0, RENDER_FRAME_MS)
+
+    sock = open_listener(args.interface, args.port)
+    ready.put(index)
+    sock.settimeout(args.timeout)
+    try:
+        pdu = sock.recv(2048)
+    except socket.timeout:
+        results.put((index, 'timeout', None, None))
+        return
+    # Wi-Fi stations in power save only pick up buffered multicast frames at DTIM beacons
+    time.sleep(rng.uniform(0, args.network_jitter) / 1000.0)
+    received_ms = time.time() * 1000.0
+
+    request = parse_command(pdu)
+    if request is None or request[0] != GROUP_COMMAND_PATH:
+        results.put((index, 'ignored', received_ms, None))
+        return
+    command = loads(request[1])
+    if command['group'] != 0 and command['group'] not in groups:
+        results.put((index, 'not a member', received_ms, None))
+        return
+
+    # The node sees the sender's apply time through its own, slightly wrong, clock
+    fw = load_firmware(lib)
+    fw.sim_reset(STATE_NORMAL, True)
+    local_now_ms = received_ms + clock_offset_ms
+    state = command.get('state', -1)
+    if fw.sim_schedule(int(local_now_ms), command['at'], state, color_arg(command.get('color'))) != 0:
+        results.put((index, 'rejected', received_ms, None))
+        return
+
+    # The render task polls at the start of every frame
+    frame_ms = frame_phase_ms + (received_ms // RENDER_FRAME_MS + 1) * RENDER_FRAME_MS
+    while True:
+        time.sleep(max(0.0, frame_ms - time.time() * 1000.0) / 1000.0)
+        if fw.sim_poll(int(frame_ms + clock_offset_ms)):
+            break
+        frame_ms += RENDER_FRAME_MS
+    results.put((index, 'applied', received_ms, time.time() * 1000.0))
+
+
+def send_command(args) -> float:
+    command = {'group': args.group, 'at': int(time.time() * 1000) + args.delay}
+    if args.state is not None:
+        command['state'] = args.state
+    if args.color:
+        command['color'] = args.color
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(args.interface))
+    sock.sendto(build_command(GROUP_COMMAND_PATH, dumps(command)), (MCAST_ADDRESS, args.port))
+    sock.close()
+    print(f'Sent {command} to {MCAST_ADDRESS}:{args.port}')
+    return command['at']
+
+
+def run_tests(fw) -> bool:
+    """Checks `led_schedule_group_command()` and `led_group_command_poll()`, returns whether all cases passed."""
+    now = 1_700_000_000_000
+    color = [100, 200, 300, 400]
+    einval = -errno.EINVAL
+    # name, state before, power, apply time, state, color, expected result, frame to poll at, state after
+    cases = [
+        ('dimming with color', STATE_NORMAL, True, now + 300, STATE_DIMMING, color, 0, now + 300, STATE_DIMMING),
+        ('not before the apply time', STATE_NORMAL, True, now + 300, STATE_DIMMING, color, 0, now + 299, STATE_NORMAL),
+        ('color on its own', STATE_DIMMING, True, now + 300, -1, color, einval, None, None),
+        ('normal with color', STATE_DIMMING, True, now + 300, STATE_NORMAL, color, einval, None, None),
+        ('temporary with color', STATE_NORMAL, True, now + 300, STATE_TEMPORARY, color, einval, None, None),
+        ('disco with color', STATE_NORMAL, True, now + 300, STATE_DISCO, color, einval, None, None),
+        ('state on its own', STATE_DIMMING, True, now + 300, STATE_NORMAL, None, 0, now + 300, STATE_NORMAL),
+        ('brightness out of range', STATE_NORMAL, True, now, STATE_DIMMING, [4096, 0, 0, 0], einval, None, None),
+        ('no state and no color', STATE_NORMAL, True, now, -1, None, einval, None, None),
+        ('unknown state', STATE_NORMAL, True, now, 5, None, einval, None, None),
+        ('powered off', STATE_NORMAL, False, now + 300, STATE_DIMMING, color, einval, None, None),
+        ('10 s ahead', STATE_NORMAL, True, now + 10000, STATE_DIMMING, color, 0, now + 10000, STATE_DIMMING),
+        ('too far ahead', STATE_NORMAL, True, now + 10001, STATE_DIMMING, color, einval, None, None),
+        ('late, next frame', STATE_NORMAL, True, now - 500, STATE_DIMMING, color, 0, now, STATE_DIMMING),
+        ('2 s late', STATE_NORMAL, True, now - 2000, STATE_DIMMING, color, 0, now, STATE_DIMMING),
+        ('too late', STATE_NORMAL, True, now - 2001, STATE_DIMMING, color, einval, None, None),
+        ('far in the past', STATE_NORMAL, True, 0, STATE_DIMMING, color, einval, None, None),
+    ]
+
+    ok = True
+    print(f'{"case":<26} {"result":>7} {"applied":>8} {"state":>6}')
+    for name, before, power, at, state, col, expected, poll_at, after in cases:
+        fw.sim_reset(before, power)
+        rc = fw.sim_schedule(now, at, state, color_arg(col))
+        applied = fw.sim_poll(poll_at) if poll_at is not None else False
+        passed = rc == expected and (after is None or fw.sim_state() == after)
+        if passed and applied and col is not None:
+            passed = list(fw.sim_color()[:CHANNELS]) == col
+        if passed and poll_at is not None:
+            passed = applied == (poll_at >= at)
+        ok &= passed
+        print(f'{name:<26} {rc:>7} {str(applied):>8} {fw.sim_state():>6}{"" if passed else "  FAILED"}')
+
+    # A newer command replaces the pending one
+    fw.sim_reset(STATE_NORMAL, True)
+    replaced = (fw.sim_schedule(now, now + 100, STATE_DIMMING, color_arg(color)) == 0
+                and fw.sim_schedule(now, now + 200, STATE_DISCO, None) == 0
+                and not fw.sim_poll(now + 150) and fw.sim_poll(now + 200) and fw.sim_state() == STATE_DISCO)
+    ok &= replaced
+    print(f'{"replaced while pending":<26} {"":>7} {str(replaced):>8} {fw.sim_state():>6}'
+          f'{"" if replaced else "  FAILED"}')
+    return ok
+
+
+def spread(values: list) -> str:
+    if not values:
+        return 'n/a'
+    return f'{max(values) - min(values):.2f} ms (stdev {statistics.pstdev(values):.2f} ms)'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Synchronized group command simulation')
+    parser.add_argument('--nodes', type=int, default=8, help='Number of simulated fixtures')
+    parser.add_argument('--groups', type=int, nargs='*',
+                        help='Group of each node (0 = no membership), by default every node is in --group')
+    parser.add_argument('--group', type=int, default=1, help='Group addressed by the command, 0 addresses every node')
+    parser.add_argument('--delay', type=int, default=300, help='Apply time, in ms after sending')
+    parser.add_argument('--state', type=int, help='LED state to switch to, e.g. 1 for dimming')
+    parser.add_argument('--color', type=int, nargs='*', help='Brightness of every channel')
+    parser.add_argument('--network-jitter', type=float, default=100.0, help='Max extra delivery delay per node in ms')
+    parser.add_argument('--clock-error', type=float, default=2.0, help='Max per-node clock offset in ms (SNTP error)')
+    parser.add_argument('--interface', default='127.0.0.1', help='Address of the interface used for multicast')
+    parser.add_argument('--port', type=int, default=COAP_PORT)
+    parser.add_argument('--timeout', type=float, default=5.0)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--send-only', action='store_true', help='Only send the command, e.g. to real devices')
+    parser.add_argument('--test', action='store_true', help='Only test the firmware code')
+    args = parser.parse_args()
+
+    if args.send_only:
+        send_command(args)
+        return
+
+    with HostBuild({'sdkconfig.h': SDKCONFIG}) as build:
+        lib = build_firmware(build)
+        if args.test:
+            if not run_tests(load_firmware(lib)):
+                raise SystemExit('group command tests failed')
+            print('group command tests passed')
+            return
+        simulate(parser, args, lib)
+
+
+def simulate(parser, args, lib: Path):
+    groups = args.groups or [args.group] * args.nodes
+    if len(groups) != args.nodes:
+        parser.error('--groups needs one entry per node')
+
+    ready = multiprocessing.Queue()
+    results = multiprocessing.Queue()
+    nodes = [multiprocessing.Process(target=node_main, args=(i, [groups[i]], args, lib, ready, results))
+             for i in range(args.nodes)]
+    for node in nodes:
+        node.start()
+    for _ in nodes:
+        ready.get(timeout=args.timeout)
+
+    at_ms = send_command(args)
+    reports = sorted(results.get(timeout=args.timeout + args.delay / 1000.0 + 1.0) for _ in nodes)
+    for node in nodes:
+        node.join()
+
+    for index, outcome, received_ms, applied_ms in reports:
+        line = f'node {index:2d} group {groups[index]:3d}: {outcome}'
+        if applied_ms is not None:
+            line += f' {applied_ms - at_ms:+7.2f} ms from the apply time'
+        print(line)
+
+    received = [r[2] for r in reports if r[1] == 'applied']
+    applied = [r[3] for r in reports if r[1] == 'applied']
+    print(f'Applied on {len(applied)} of {args.nodes} nodes')
+    print(f'Arrival spread: {spread(received)}')
+    print(f'Apply spread:   {spread(applied)}')
+
+
+if __name__ == '__main__':
+    main()
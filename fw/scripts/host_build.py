@@ -0,0 +1,1041 @@
+"""Host builds of firmware sources for the test harnesses and benchmarks in this directory.
+
+A harness is a C file that includes or links the firmware code under test. `HostBuild` compiles it with the host
+compiler (`$CC`, `cc` by default) in a temporary directory that holds `STUBS`, the one set of fake ESP-IDF, FreeRTOS
+and TinyCBOR headers all harnesses share: FreeRTOS tasks, spinlocks, mutexes and queues run on pthreads, the timers on
+the monotonic clock, logging prints warnings and errors to stderr. borneo-core and drvfx are built from their real
+headers. A harness only adds what is specific to it, its `sdkconfig.h` and fakes of libraries whose calls it records.
+
+Usage from a harness script:
+
+    with HostBuild({'sdkconfig.h': '#define CONFIG_FOO 1\\n'}) as build:
+        exe = build.compile(HARNESS, sources=[CORE_DIR / 'src' / 'algo' / 'filters.c'])
+        run(exe, error='filter tests failed')
+"""
+
+import os
+import subprocess
+import tempfile
+from pathlib import Path
+
+FW_DIR = Path(__file__).resolve().parent.parent
+CORE_DIR = FW_DIR / 'components' / 'borneo-core'
+DRVFX_DIR = FW_DIR / 'components' / 'drvfx'
+LYFI_DIR = FW_DIR / 'lyfi' / 'main' / 'src'
+
+# Just enough of ESP-IDF, FreeRTOS and TinyCBOR for the firmware code the harnesses build
+STUBS = {
+    'sdkconfig.h': '#pragma once\n',
+    'freertos/FreeRTOS.h': r'''#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <freertos/portmacro.h>
+''',
+    'freertos/portmacro.h': r'''#pragma once
+#include <pthread.h>
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(ticks))
+// Spinlocks are mutexes, a zero-initialized one is unlocked like `portMUX_INITIALIZER_UNLOCKED`
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_MUTEX_INITIALIZER
+#define spinlock_initialize(mux) pthread_mutex_init((mux), NULL)
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux) pthread_mutex_unlock(mux)
+''',
+    'freertos/task.h': r'''#pragma once
+#include <freertos/FreeRTOS.h>
+typedef void* TaskHandle_t;
+struct host_task_start {
+    void (*fn)(void*);
+    void* arg;
+};
+static void* host_task_trampoline(void* p)
+{
+    struct host_task_start start = *(struct host_task_start*)p;
+    free(p);
+    start.fn(start.arg);
+    return NULL;
+}
+static inline BaseType_t xTaskCreate(void (*fn)(void*), const char* name, uint32_t stack, void* arg,
+                                     UBaseType_t prio, TaskHandle_t* task)
+{
+    struct host_task_start* start = malloc(sizeof(*start));
+    start->fn = fn;
+    start->arg = arg;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, host_task_trampoline, start) != 0) {
+        free(start);
+        return pdFAIL;
+    }
+    // Not detached, so a harness can join a task that ends with `vTaskDelete(NULL)`
+    if (task != NULL) {
+        *task = (TaskHandle_t)thread;
+    }
+    return pdPASS;
+}
+#define xTaskCreatePinnedToCore(fn, name, stack, arg, prio, task, core) xTaskCreate(fn, name, stack, arg, prio, task)
+#define xTaskGetCurrentTaskHandle() ((TaskHandle_t)pthread_self())
+#define vTaskDelete(task) pthread_exit(NULL)
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+static inline void vTaskDelay(TickType_t ticks) { usleep((useconds_t)ticks * 1000); }
+''',
+    'freertos/semphr.h': r'''#pragma once
+#include <freertos/FreeRTOS.h>
+// Only mutexes, the timeout is ignored. A handle that was never created, as in harnesses that skip the init, is
+// taken without waiting.
+typedef pthread_mutex_t* SemaphoreHandle_t;
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+    pthread_mutex_init(sem, NULL);
+    return sem;
+}
+#define xSemaphoreCreateRecursiveMutex() xSemaphoreCreateMutex()
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout)
+{
+    return sem == NULL || pthread_mutex_lock(sem) == 0;
+}
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return sem == NULL || pthread_mutex_unlock(sem) == 0;
+}
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_mutex_destroy(sem);
+    free(sem);
+}
+''',
+    'freertos/queue.h': r'''#pragma once
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+// A ring of fixed-size items under a mutex, the timeouts are in milliseconds like the ticks
+typedef struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t item_size;
+    UBaseType_t length;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t items[];
+}* QueueHandle_t;
+static inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(*queue) + (size_t)length * item_size);
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    queue->item_size = item_size;
+    queue->length = length;
+    return queue;
+}
+// Waits until `ready` holds or `ticks` passed, with the queue locked
+#define HOST_QUEUE_WAIT(queue, ready, ticks)                                                                           \
+    ({                                                                                                                 \
+        struct timespec _deadline;                                                                                     \
+        clock_gettime(CLOCK_REALTIME, &_deadline);                                                                     \
+        _deadline.tv_sec += (ticks) / 1000;                                                                            \
+        _deadline.tv_nsec += (long)((ticks) % 1000) * 1000000;                                                         \
+        if (_deadline.tv_nsec >= 1000000000) {                                                                         \
+            _deadline.tv_sec++;                                                                                        \
+            _deadline.tv_nsec -= 1000000000;                                                                           \
+        }                                                                                                              \
+        int _rc = 0;                                                                                                   \
+        while (!(ready) && (ticks) != 0 && _rc == 0) {                                                                 \
+            _rc = (ticks) == portMAX_DELAY ? pthread_cond_wait(&(queue)->changed, &(queue)->lock)                      \
+                                           : pthread_cond_timedwait(&(queue)->changed, &(queue)->lock, &_deadline);   \
+        }                                                                                                              \
+        (ready);                                                                                                       \
+    })
+static inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = HOST_QUEUE_WAIT(queue, queue->count < queue->length, ticks);
+    if (ok) {
+        memcpy(&queue->items[(queue->head + queue->count) % queue->length * queue->item_size], item, queue->item_size);
+        queue->count++;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+static inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = HOST_QUEUE_WAIT(queue, queue->count > 0, ticks);
+    if (ok) {
+        memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+#define xQueueSendToBack xQueueSend
+static inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+''',
+    'freertos/event_groups.h': '#pragma once\n#include <freertos/FreeRTOS.h>\ntypedef void* EventGroupHandle_t;\n',
+    'esp_err.h': r'''#pragma once
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+static inline const char* esp_err_to_name(esp_err_t err) { return err == ESP_OK ? "ESP_OK" : "ESP_ERR"; }
+''',
+    'esp_log.h': r'''#pragma once
+#include <stdio.h>
+#define ESP_LOG_SILENT(tag, fmt, ...) do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOG_PRINT(level, tag, fmt, ...) fprintf(stderr, level " %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_SILENT(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_SILENT(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_SILENT(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_PRINT("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_PRINT("E", tag, fmt, ##__VA_ARGS__)
+''',
+    'esp_event.h': r'''#pragma once
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t id, void* data);
+#define ESP_EVENT_ANY_ID -1
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t id = #id
+// Nothing is dispatched, a harness calls the handlers it tests itself
+static inline esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                                   void* arg)
+{
+    return ESP_OK;
+}
+static inline esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t handler)
+{
+    return ESP_OK;
+}
+static inline esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void* data, size_t size,
+                                       TickType_t timeout)
+{
+    return ESP_OK;
+}
+''',
+    'esp_system.h': '#pragma once\n#include <esp_err.h>\n',
+    'esp_attr.h': '#pragma once\n#define IRAM_ATTR\n#define DRAM_ATTR\n#define RTC_NOINIT_ATTR\n',
+    'esp_timer.h': r'''#pragma once
+#include <stdint.h>
+#include <time.h>
+static inline int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+''',
+    'esp_random.h': '#pragma once\n#include <stdint.h>\n#include <stdlib.h>\n#define esp_random() ((uint32_t)rand())\n',
+    'esp_rom_crc.h': r'''#pragma once
+#include <stdint.h>
+// Table-driven like the ROM one, so the CRC does not dominate the timings
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int b = 0; b < 8; b++) {
+                c = (c >> 1) ^ (0xEDB88320u & -(c & 1));
+            }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+''',
+    'esp_rom_md5.h': '#pragma once\n',
+    'esp_mac.h': '#pragma once\n',
+    'esp_sntp.h': '#pragma once\n',
+    'esp_netif.h': '#pragma once\n#include <netinet/in.h>\n#include <arpa/inet.h>\n#include <esp_event.h>\n'
+                   'ESP_EVENT_DECLARE_BASE(IP_EVENT);\nenum { IP_EVENT_STA_GOT_IP };\n',
+    'esp_vfs_eventfd.h': r'''#pragma once
+#include <sys/eventfd.h>
+#include <esp_err.h>
+#define EFD_SUPPORT_ISR 0
+typedef struct {
+    int max_fds;
+} esp_vfs_eventfd_config_t;
+#define ESP_VFS_EVENTD_CONFIG_DEFAULT() { .max_fds = 5 }
+#define esp_vfs_eventfd_register(config) ((void)(config), ESP_OK)
+''',
+    'esp_adc/adc_oneshot.h': '#pragma once\ntypedef int adc_channel_t;\n',
+    'driver/gpio.h': '#pragma once\n',
+    'driver/ledc.h': '#pragma once\n',
+    'cbor.h': r'''#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// The part of TinyCBOR the firmware uses, with its API and encoder semantics: once the buffer is full an encoder
+// keeps counting the bytes it would need. The parser walks definite and indefinite containers and strings, but does
+// not validate its input beyond what the firmware relies on.
+
+typedef enum CborType {
+    CborIntegerType = 0x00,
+    CborByteStringType = 0x40,
+    CborTextStringType = 0x60,
+    CborArrayType = 0x80,
+    CborMapType = 0xa0,
+    CborTagType = 0xc0,
+    CborSimpleType = 0xe0,
+    CborBooleanType = 0xf5,
+    CborNullType = 0xf6,
+    CborUndefinedType = 0xf7,
+    CborHalfFloatType = 0xf9,
+    CborFloatType = 0xfa,
+    CborDoubleType = 0xfb,
+    CborInvalidType = 0xff,
+} CborType;
+
+typedef enum CborError {
+    CborNoError = 0,
+    CborUnknownError,
+    CborErrorUnknownLength,
+    CborErrorAdvancePastEOF,
+    CborErrorUnexpectedEOF = 257,
+    CborErrorIllegalType = 260,
+    CborErrorTooManyItems = 768,
+    CborErrorTooFewItems,
+    CborErrorDataTooLarge = 1024,
+    CborErrorOutOfMemory = (int)(~0U / 2 + 1),
+} CborError;
+
+#define CborIndefiniteLength SIZE_MAX
+#define CBOR_HOST_UNKNOWN_LENGTH UINT32_MAX
+
+typedef struct CborEncoder {
+    union {
+        uint8_t* ptr;
+        ptrdiff_t bytes_needed;
+    } data;
+    uint8_t* end; ///< NULL once the buffer overflowed
+    size_t remaining; ///< Items left plus one, 0 if the length is indefinite
+    int flags;
+} CborEncoder;
+
+typedef struct CborParser {
+    const uint8_t* end;
+} CborParser;
+
+typedef struct CborValue {
+    const CborParser* parser;
+    const uint8_t* ptr;
+    uint32_t remaining; ///< Items left in the container, `CBOR_HOST_UNKNOWN_LENGTH` if indefinite
+    uint8_t type;
+} CborValue;
+
+/* ---- Encoder ---- */
+
+static inline CborError cbor_host_append(CborEncoder* encoder, const void* data, size_t len)
+{
+    if (encoder->end != NULL && (size_t)(encoder->end - encoder->data.ptr) >= len) {
+        memcpy(encoder->data.ptr, data, len);
+        encoder->data.ptr += len;
+        return CborNoError;
+    }
+    if (encoder->end != NULL) {
+        len -= encoder->end - encoder->data.ptr;
+        encoder->end = NULL;
+        encoder->data.bytes_needed = 0;
+    }
+    encoder->data.bytes_needed += len;
+    return CborErrorOutOfMemory;
+}
+
+static inline CborError cbor_host_encode_head(CborEncoder* encoder, uint8_t major, uint64_t value)
+{
+    uint8_t buf[9];
+    size_t len;
+    if (value < 24) {
+        buf[0] = major | (uint8_t)value;
+        len = 1;
+    }
+    else {
+        int bytes = value <= UINT8_MAX ? 1 : value <= UINT16_MAX ? 2 : value <= UINT32_MAX ? 4 : 8;
+        buf[0] = major | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27);
+        for (int i = 0; i < bytes; i++) {
+            buf[1 + i] = (uint8_t)(value >> (8 * (bytes - 1 - i)));
+        }
+        len = 1 + bytes;
+    }
+    if (encoder->remaining > 0) {
+        encoder->remaining--;
+    }
+    return cbor_host_append(encoder, buf, len);
+}
+
+static inline void cbor_encoder_init(CborEncoder* encoder, uint8_t* buffer, size_t size, int flags)
+{
+    encoder->data.ptr = buffer;
+    encoder->end = buffer + size;
+    encoder->remaining = 2;
+    encoder->flags = flags;
+}
+
+static inline CborError cbor_encode_uint(CborEncoder* encoder, uint64_t value)
+{
+    return cbor_host_encode_head(encoder, 0x00, value);
+}
+
+static inline CborError cbor_encode_negative_int(CborEncoder* encoder, uint64_t absolute_value)
+{
+    return cbor_host_encode_head(encoder, 0x20, absolute_value);
+}
+
+static inline CborError cbor_encode_int(CborEncoder* encoder, int64_t value)
+{
+    return value < 0 ? cbor_encode_negative_int(encoder, ~(uint64_t)value) : cbor_encode_uint(encoder, value);
+}
+
+static inline CborError cbor_encode_tag(CborEncoder* encoder, uint64_t tag)
+{
+    CborError err = cbor_host_encode_head(encoder, 0xc0, tag);
+    encoder->remaining += encoder->remaining > 0; // The tagged item follows
+    return err;
+}
+
+static inline CborError cbor_encode_simple_value(CborEncoder* encoder, uint8_t value)
+{
+    return cbor_host_encode_head(encoder, 0xe0, value);
+}
+
+static inline CborError cbor_encode_boolean(CborEncoder* encoder, bool value)
+{
+    return cbor_encode_simple_value(encoder, value ? 21 : 20);
+}
+
+static inline CborError cbor_encode_null(CborEncoder* encoder) { return cbor_encode_simple_value(encoder, 22); }
+
+static inline CborError cbor_encode_undefined(CborEncoder* encoder) { return cbor_encode_simple_value(encoder, 23); }
+
+static inline CborError cbor_host_encode_bits(CborEncoder* encoder, uint8_t head, uint64_t bits, int bytes)
+{
+    uint8_t buf[9] = { head };
+    for (int i = 0; i < bytes; i++) {
+        buf[1 + i] = (uint8_t)(bits >> (8 * (bytes - 1 - i)));
+    }
+    if (encoder->remaining > 0) {
+        encoder->remaining--;
+    }
+    return cbor_host_append(encoder, buf, 1 + bytes);
+}
+
+static inline CborError cbor_encode_half_float(CborEncoder* encoder, const void* value)
+{
+    uint16_t bits;
+    memcpy(&bits, value, sizeof(bits));
+    return cbor_host_encode_bits(encoder, 0xf9, bits, 2);
+}
+
+static inline CborError cbor_encode_float(CborEncoder* encoder, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return cbor_host_encode_bits(encoder, 0xfa, bits, 4);
+}
+
+static inline CborError cbor_encode_double(CborEncoder* encoder, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return cbor_host_encode_bits(encoder, 0xfb, bits, 8);
+}
+
+static inline CborError cbor_encode_byte_string(CborEncoder* encoder, const uint8_t* string, size_t length)
+{
+    CborError err = cbor_host_encode_head(encoder, 0x40, length);
+    CborError data_err = cbor_host_append(encoder, string, length);
+    return err ? err : data_err;
+}
+
+static inline CborError cbor_encode_text_string(CborEncoder* encoder, const char* string, size_t length)
+{
+    CborError err = cbor_host_encode_head(encoder, 0x60, length);
+    CborError data_err = cbor_host_append(encoder, string, length);
+    return err ? err : data_err;
+}
+
+static inline CborError cbor_encode_text_stringz(CborEncoder* encoder, const char* string)
+{
+    return cbor_encode_text_string(encoder, string, strlen(string));
+}
+
+static inline CborError cbor_host_create_container(CborEncoder* encoder, CborEncoder* container, size_t length,
+                                                   uint8_t major, size_t items)
+{
+    CborError err;
+    if (length == CborIndefiniteLength) {
+        static const uint8_t head[2] = { 0x9f, 0xbf };
+        if (encoder->remaining > 0) {
+            encoder->remaining--;
+        }
+        err = cbor_host_append(encoder, &head[major == 0xa0], 1);
+        container->remaining = 0;
+    }
+    else {
+        err = cbor_host_encode_head(encoder, major, length);
+        container->remaining = items + 1;
+    }
+    container->data = encoder->data;
+    container->end = encoder->end;
+    container->flags = length == CborIndefiniteLength;
+    return err;
+}
+
+static inline CborError cbor_encoder_create_array(CborEncoder* encoder, CborEncoder* array, size_t length)
+{
+    return cbor_host_create_container(encoder, array, length, 0x80, length);
+}
+
+static inline CborError cbor_encoder_create_map(CborEncoder* encoder, CborEncoder* map, size_t length)
+{
+    return cbor_host_create_container(encoder, map, length, 0xa0, length * 2);
+}
+
+static inline CborError cbor_encoder_close_container(CborEncoder* encoder, const CborEncoder* container)
+{
+    CborError err = CborNoError;
+    encoder->data = container->data;
+    encoder->end = container->end;
+    if (container->flags) {
+        static const uint8_t brk = 0xff;
+        err = cbor_host_append(encoder, &brk, 1);
+    }
+    else if (container->remaining != 1) {
+        return container->remaining == 0 ? CborErrorTooManyItems : CborErrorTooFewItems;
+    }
+    return encoder->end == NULL ? CborErrorOutOfMemory : err;
+}
+
+#define cbor_encoder_close_container_checked cbor_encoder_close_container
+
+static inline size_t cbor_encoder_get_buffer_size(const CborEncoder* encoder, const uint8_t* buffer)
+{
+    return encoder->end != NULL ? (size_t)(encoder->data.ptr - buffer) : 0;
+}
+
+static inline size_t cbor_encoder_get_extra_bytes_needed(const CborEncoder* encoder)
+{
+    return encoder->end != NULL ? 0 : (size_t)encoder->data.bytes_needed;
+}
+
+/* ---- Parser ---- */
+
+// Decodes the head at `*ptr`, `*value` is `UINT64_MAX` for an indefinite length
+static inline CborError cbor_host_read_head(const uint8_t** ptr, const uint8_t* end, uint8_t* major, uint64_t* value)
+{
+    if (*ptr >= end) {
+        return CborErrorUnexpectedEOF;
+    }
+    const uint8_t initial = *(*ptr)++;
+    const uint8_t info = initial & 0x1f;
+    *major = initial & 0xe0;
+    if (info < 24) {
+        *value = info;
+        return CborNoError;
+    }
+    if (info == 31) {
+        *value = UINT64_MAX;
+        return CborNoError;
+    }
+    if (info > 27) {
+        return CborErrorIllegalType;
+    }
+    const int bytes = 1 << (info - 24);
+    if (end - *ptr < bytes) {
+        return CborErrorUnexpectedEOF;
+    }
+    *value = 0;
+    for (int i = 0; i < bytes; i++) {
+        *value = (*value << 8) | *(*ptr)++;
+    }
+    return CborNoError;
+}
+
+static inline CborError cbor_host_skip(const uint8_t** ptr, const uint8_t* end)
+{
+    uint8_t major;
+    uint64_t value;
+    CborError err = cbor_host_read_head(ptr, end, &major, &value);
+    if (err != CborNoError) {
+        return err;
+    }
+    switch (major) {
+    case 0x40:
+    case 0x60:
+        if (value == UINT64_MAX) {
+            while (*ptr < end && **ptr != 0xff) {
+                if ((err = cbor_host_skip(ptr, end)) != CborNoError) {
+                    return err;
+                }
+            }
+            (*ptr)++;
+        }
+        else if ((uint64_t)(end - *ptr) < value) {
+            return CborErrorUnexpectedEOF;
+        }
+        else {
+            *ptr += value;
+        }
+        break;
+    case 0x80:
+    case 0xa0:
+        if (value == UINT64_MAX) {
+            while (*ptr < end && **ptr != 0xff) {
+                if ((err = cbor_host_skip(ptr, end)) != CborNoError) {
+                    return err;
+                }
+            }
+            (*ptr)++;
+        }
+        else {
+            for (uint64_t i = 0; i < (major == 0xa0 ? value * 2 : value); i++) {
+                if ((err = cbor_host_skip(ptr, end)) != CborNoError) {
+                    return err;
+                }
+            }
+        }
+        break;
+    case 0xc0:
+        return cbor_host_skip(ptr, end);
+    default:
+        break;
+    }
+    return *ptr <= end ? CborNoError : CborErrorUnexpectedEOF;
+}
+
+static inline void cbor_host_prepare(CborValue* it)
+{
+    if (it->remaining == 0 || it->ptr >= it->parser->end
+        || (it->remaining == CBOR_HOST_UNKNOWN_LENGTH && *it->ptr == 0xff)) {
+        it->type = CborInvalidType;
+        return;
+    }
+    const uint8_t initial = *it->ptr;
+    switch (initial & 0xe0) {
+    case 0x00:
+    case 0x20:
+        it->type = CborIntegerType;
+        break;
+    case 0xe0:
+        it->type = initial == 0xf4 ? CborBooleanType : initial >= 0xf5 && initial <= 0xfb ? initial : CborSimpleType;
+        break;
+    default:
+        it->type = initial & 0xe0;
+        break;
+    }
+}
+
+static inline CborError cbor_parser_init(const uint8_t* buffer, size_t size, uint32_t flags, CborParser* parser,
+                                         CborValue* it)
+{
+    parser->end = buffer + size;
+    it->parser = parser;
+    it->ptr = buffer;
+    it->remaining = 1;
+    cbor_host_prepare(it);
+    return size == 0 ? CborErrorUnexpectedEOF : CborNoError;
+}
+
+static inline CborType cbor_value_get_type(const CborValue* value) { return (CborType)value->type; }
+static inline bool cbor_value_is_valid(const CborValue* value) { return value->type != CborInvalidType; }
+static inline bool cbor_value_at_end(const CborValue* it)
+{
+    return it->remaining == 0 || (it->remaining == CBOR_HOST_UNKNOWN_LENGTH && *it->ptr == 0xff);
+}
+static inline bool cbor_value_is_integer(const CborValue* value) { return value->type == CborIntegerType; }
+static inline bool cbor_value_is_unsigned_integer(const CborValue* value)
+{
+    return value->type == CborIntegerType && (*value->ptr & 0xe0) == 0x00;
+}
+static inline bool cbor_value_is_negative_integer(const CborValue* value)
+{
+    return value->type == CborIntegerType && (*value->ptr & 0xe0) == 0x20;
+}
+static inline bool cbor_value_is_byte_string(const CborValue* value) { return value->type == CborByteStringType; }
+static inline bool cbor_value_is_text_string(const CborValue* value) { return value->type == CborTextStringType; }
+static inline bool cbor_value_is_array(const CborValue* value) { return value->type == CborArrayType; }
+static inline bool cbor_value_is_map(const CborValue* value) { return value->type == CborMapType; }
+static inline bool cbor_value_is_container(const CborValue* value)
+{
+    return value->type == CborArrayType || value->type == CborMapType;
+}
+static inline bool cbor_value_is_boolean(const CborValue* value) { return value->type == CborBooleanType; }
+static inline bool cbor_value_is_null(const CborValue* value) { return value->type == CborNullType; }
+static inline bool cbor_value_is_undefined(const CborValue* value) { return value->type == CborUndefinedType; }
+static inline bool cbor_value_is_float(const CborValue* value) { return value->type == CborFloatType; }
+static inline bool cbor_value_is_double(const CborValue* value) { return value->type == CborDoubleType; }
+
+static inline CborError cbor_value_advance(CborValue* it)
+{
+    if (!cbor_value_is_valid(it)) {
+        return CborErrorAdvancePastEOF;
+    }
+    CborError err = cbor_host_skip(&it->ptr, it->parser->end);
+    if (err != CborNoError) {
+        return err;
+    }
+    if (it->remaining != CBOR_HOST_UNKNOWN_LENGTH) {
+        it->remaining--;
+    }
+    cbor_host_prepare(it);
+    return CborNoError;
+}
+
+#define cbor_value_advance_fixed cbor_value_advance
+
+static inline CborError cbor_value_enter_container(const CborValue* it, CborValue* recursed)
+{
+    uint8_t major;
+    uint64_t length;
+    recursed->parser = it->parser;
+    recursed->ptr = it->ptr;
+    CborError err = cbor_host_read_head(&recursed->ptr, it->parser->end, &major, &length);
+    if (err != CborNoError) {
+        return err;
+    }
+    if (length == UINT64_MAX) {
+        recursed->remaining = CBOR_HOST_UNKNOWN_LENGTH;
+    }
+    else if (length > UINT32_MAX / 2) {
+        return CborErrorDataTooLarge;
+    }
+    else {
+        recursed->remaining = (uint32_t)(major == 0xa0 ? length * 2 : length);
+    }
+    cbor_host_prepare(recursed);
+    return CborNoError;
+}
+
+// Unlike TinyCBOR the container does not need to be read to its end
+static inline CborError cbor_value_leave_container(CborValue* it, const CborValue* recursed)
+{
+    return cbor_value_advance(it);
+}
+
+static inline CborError cbor_host_get_length(const CborValue* value, size_t* length)
+{
+    const uint8_t* ptr = value->ptr;
+    uint8_t major;
+    uint64_t n;
+    CborError err = cbor_host_read_head(&ptr, value->parser->end, &major, &n);
+    if (err != CborNoError) {
+        return err;
+    }
+    if (n == UINT64_MAX) {
+        return CborErrorUnknownLength;
+    }
+    *length = (size_t)n;
+    return CborNoError;
+}
+
+static inline CborError cbor_value_get_array_length(const CborValue* value, size_t* length)
+{
+    return cbor_host_get_length(value, length);
+}
+
+static inline CborError cbor_value_get_map_length(const CborValue* value, size_t* length)
+{
+    return cbor_host_get_length(value, length);
+}
+
+static inline CborError cbor_value_get_raw_integer(const CborValue* value, uint64_t* result)
+{
+    const uint8_t* ptr = value->ptr;
+    uint8_t major;
+    return cbor_host_read_head(&ptr, value->parser->end, &major, result);
+}
+
+static inline CborError cbor_value_get_uint64(const CborValue* value, uint64_t* result)
+{
+    return cbor_value_get_raw_integer(value, result);
+}
+
+static inline CborError cbor_value_get_int64(const CborValue* value, int64_t* result)
+{
+    uint64_t raw;
+    CborError err = cbor_value_get_raw_integer(value, &raw);
+    *result = cbor_value_is_negative_integer(value) ? (int64_t)~raw : (int64_t)raw;
+    return err;
+}
+
+static inline CborError cbor_value_get_int(const CborValue* value, int* result)
+{
+    int64_t v;
+    CborError err = cbor_value_get_int64(value, &v);
+    *result = (int)v;
+    return err;
+}
+
+static inline CborError cbor_value_get_int64_checked(const CborValue* value, int64_t* result)
+{
+    uint64_t raw;
+    CborError err = cbor_value_get_raw_integer(value, &raw);
+    if (err != CborNoError) {
+        return err;
+    }
+    if (raw > (uint64_t)INT64_MAX) {
+        return CborErrorDataTooLarge;
+    }
+    *result = cbor_value_is_negative_integer(value) ? (int64_t)~raw : (int64_t)raw;
+    return CborNoError;
+}
+
+static inline CborError cbor_value_get_int_checked(const CborValue* value, int* result)
+{
+    int64_t v;
+    CborError err = cbor_value_get_int64_checked(value, &v);
+    if (err != CborNoError) {
+        return err;
+    }
+    if (v < INT32_MIN || v > INT32_MAX) {
+        return CborErrorDataTooLarge;
+    }
+    *result = (int)v;
+    return CborNoError;
+}
+
+static inline CborError cbor_value_get_boolean(const CborValue* value, bool* result)
+{
+    *result = *value->ptr == 0xf5;
+    return CborNoError;
+}
+
+static inline CborError cbor_value_get_float(const CborValue* value, float* result)
+{
+    uint32_t bits = (uint32_t)value->ptr[1] << 24 | (uint32_t)value->ptr[2] << 16 | (uint32_t)value->ptr[3] << 8
+                    | value->ptr[4];
+    memcpy(result, &bits, sizeof(*result));
+    return CborNoError;
+}
+
+static inline CborError cbor_value_get_double(const CborValue* value, double* result)
+{
+    uint64_t bits = 0;
+    for (int i = 1; i <= 8; i++) {
+        bits = bits << 8 | value->ptr[i];
+    }
+    memcpy(result, &bits, sizeof(*result));
+    return CborNoError;
+}
+
+// Walks the chunks of a string, copying them to `buffer` unless it is NULL
+static inline CborError cbor_host_copy_string(const CborValue* value, uint8_t* buffer, size_t* buflen, bool nul,
+                                              CborValue* next)
+{
+    const uint8_t* ptr = value->ptr;
+    const uint8_t* end = value->parser->end;
+    uint8_t major;
+    uint64_t n;
+    CborError err = cbor_host_read_head(&ptr, end, &major, &n);
+    if (err != CborNoError) {
+        return err;
+    }
+    const bool chunked = n == UINT64_MAX;
+    size_t total = 0;
+    bool fits = true;
+    while (true) {
+        if (chunked) {
+            if (ptr >= end) {
+                return CborErrorUnexpectedEOF;
+            }
+            if (*ptr == 0xff) {
+                break;
+            }
+            if ((err = cbor_host_read_head(&ptr, end, &major, &n)) != CborNoError) {
+                return err;
+            }
+        }
+        if ((uint64_t)(end - ptr) < n) {
+            return CborErrorUnexpectedEOF;
+        }
+        if (buffer != NULL && total + n + nul <= *buflen) {
+            memcpy(buffer + total, ptr, n);
+        }
+        else {
+            fits = false;
+        }
+        total += n;
+        ptr += n;
+        if (!chunked) {
+            break;
+        }
+    }
+    if (buffer != NULL && !fits) {
+        return CborErrorOutOfMemory;
+    }
+    if (buffer != NULL && nul) {
+        buffer[total] = '\0';
+    }
+    *buflen = total;
+    if (next != NULL) {
+        *next = *value;
+        return cbor_value_advance(next);
+    }
+    return CborNoError;
+}
+
+static inline CborError cbor_value_calculate_string_length(const CborValue* value, size_t* length)
+{
+    return cbor_host_copy_string(value, NULL, length, false, NULL);
+}
+
+static inline CborError cbor_value_copy_byte_string(const CborValue* value, uint8_t* buffer, size_t* buflen,
+                                                    CborValue* next)
+{
+    return cbor_host_copy_string(value, buffer, buflen, false, next);
+}
+
+static inline CborError cbor_value_copy_text_string(const CborValue* value, char* buffer, size_t* buflen,
+                                                    CborValue* next)
+{
+    return cbor_host_copy_string(value, (uint8_t*)buffer, buflen, true, next);
+}
+
+// Leaves `element` invalid if the map has no such text key, like TinyCBOR
+static inline CborError cbor_value_map_find_value(const CborValue* map, const char* key, CborValue* element)
+{
+    const size_t key_len = strlen(key);
+    CborError err = cbor_value_enter_container(map, element);
+    while (err == CborNoError && !cbor_value_at_end(element)) {
+        bool match = false;
+        if (cbor_value_is_text_string(element)) {
+            const uint8_t* ptr = element->ptr;
+            uint8_t major;
+            uint64_t n;
+            if (cbor_host_read_head(&ptr, element->parser->end, &major, &n) == CborNoError && n == key_len
+                && (size_t)(element->parser->end - ptr) >= key_len) {
+                match = memcmp(ptr, key, key_len) == 0;
+            }
+        }
+        if ((err = cbor_value_advance(element)) != CborNoError) {
+            break;
+        }
+        if (match) {
+            return CborNoError;
+        }
+        err = cbor_value_advance(element);
+    }
+    element->type = CborInvalidType;
+    return err;
+}
+''',
+    # Declarations only, a harness that stores settings implements the NVS it needs
+    'nvs_flash.h': '#pragma once\n#include <nvs.h>\n',
+    'nvs.h': '#pragma once\n#include <stddef.h>\n#include <stdint.h>\n#include <esp_err.h>\n'
+             'typedef uint32_t nvs_handle_t;\ntypedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;\n'
+             'esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* handle);\n'
+             'void nvs_close(nvs_handle_t handle);\n'
+             + ''.join(f'esp_err_t nvs_get_{t}(nvs_handle_t h, const char* key, {c}* out);\n'
+                       f'esp_err_t nvs_set_{t}(nvs_handle_t h, const char* key, {c} value);\n'
+                       for t, c in [('u8', 'uint8_t'), ('u16', 'uint16_t'), ('u32', 'uint32_t'),
+                                    ('i32', 'int32_t'), ('i64', 'int64_t')])
+             + 'esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* length);\n'
+               'esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length);\n'
+               'esp_err_t nvs_erase_key(nvs_handle_t h, const char* key);\n'
+               'esp_err_t nvs_commit(nvs_handle_t h);\n',
+}
+
+
+class HostBuild:
+    """Temporary build directory with `STUBS` plus the harness specific `stubs`, which take precedence."""
+
+    def __init__(self, stubs: dict = None):
+        self.stubs = {**STUBS, **(stubs or {})}
+        self._tmp = None
+        self.path = None
+
+    def __enter__(self):
+        self._tmp = tempfile.TemporaryDirectory()
+        self.path = Path(self._tmp.name)
+        for name, text in self.stubs.items():
+            self.write(name, text)
+        return self
+
+    def __exit__(self, *exc):
+        self._tmp.cleanup()
+
+    def write(self, name: str, text: str) -> Path:
+        path = self.path / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(text)
+        return path
+
+    def compile(self, harness: str, sources=(), includes=(), flags=(), output: str = 'harness',
+                shared: bool = False) -> Path:
+        """Compiles `harness` with the firmware `sources` into an executable, or a shared library if `shared`.
+
+        `sdkconfig.h` is included first like ESP-IDF does, the stub directory comes before the firmware include
+        directories.
+        """
+        self.write('harness.c', harness)
+        out = self.path / output
+        cc = os.environ.get('CC', 'cc')
+        # The firmware formats `uint32_t` as `%lu`, which only matches the targets' `unsigned long`
+        cmd = [cc, '-O2', '-Wall', '-Wno-format', '-Wno-unused-function', '-include', 'sdkconfig.h',
+               '-D__aligned(x)=__attribute__((aligned(x)))', '-I', str(self.path)]
+        for path in includes:
+            cmd += ['-I', str(path)]
+        cmd += ['-I', str(CORE_DIR / 'include'), '-I', str(DRVFX_DIR / 'include'), *flags]
+        if shared:
+            cmd += ['-shared', '-fPIC']
+        cmd += [str(self.path / 'harness.c'), *(str(s) for s in sources), '-o', str(out), '-lm', '-lpthread']
+        subprocess.run(cmd, check=True)
+        return out
+
+
+def run(exe: Path, *args, error: str = None, quiet: bool = False, **kwargs) -> subprocess.CompletedProcess:
+    """Runs a harness and prints its report unless `quiet`; if it fails, prints its stderr and exits with `error`."""
+    kwargs.setdefault('text', True)
+    result = subprocess.run([str(exe), *(str(a) for a in args)], capture_output=True, **kwargs)
+    decode = lambda out: out if isinstance(out, str) else out.decode(errors='replace')
+    if not quiet:
+        print(decode(result.stdout), end='')
+    if result.returncode != 0:
+        print(decode(result.stderr).strip())
+        raise SystemExit(error or f'{Path(exe).name} failed')
+    return result
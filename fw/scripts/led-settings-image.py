@@ -0,0 +1,520 @@
+"""Tests of the LED settings image and the boot-time cost of loading it versus the key-per-field layout.
+
+Compiles the firmware's `lyfi/main/src/led/settings.c` for the host against an NVS emulator, then:
+
+1. Checks the image code: pack and load, the version upgrade chain (a version 1 image written by an older firmware
+   is read and rewritten as the current version), an image from a newer firmware, damaged images, and the
+   migration from the per-field keys, which are kept for a downgrade and as the fallback of a damaged image.
+2. Loads the settings the three ways a boot can, with `--filler` unrelated keys in the store:
+   - `per-key`: the per-field keys only, what a boot did before the image
+   - `migrate`: the first boot after the upgrade, per-field keys in, image out
+   - `image`: every later boot
+
+The emulator keeps items in 32-byte entries like NVS does and counts the lookups and the entries read and written.
+A lookup scans the items, the device has a hash list per page instead, so the host nanoseconds only rank the
+methods. `--lookup-us` and `--entry-us` turn the counts into a device estimate; measure them once on the target
+(the settings load logs its time) and pass them in.
+
+Usage:
+    python led-settings-image.py --filler 0 50 200
+"""
+
+import argparse
+
+from host_build import FW_DIR, LYFI_DIR, HostBuild, run
+
+CHANNELS = 4
+
+SDKCONFIG = (f'#pragma once\n#define CONFIG_LYFI_LED_CHANNEL_COUNT {CHANNELS}\n'
+             '#define CONFIG_LYFI_DEFAULT_PWM_FREQ 19000\n'
+             + ''.join(f'#define CONFIG_LYFI_LED_CH{i}_ENABLED 1\n'
+                       f'#define CONFIG_LYFI_LED_CH{i}_NAME "ch{i}"\n'
+                       f'#define CONFIG_LYFI_LED_CH{i}_COLOR "#ffffff"\n'
+                       f'#define CONFIG_LYFI_LED_CH{i}_WAVELENGTH 450\n'
+                       for i in range(CHANNELS)))
+
+HARNESS = r'''
+#include "settings.c"
+
+#include <time.h>
+
+const char* BO_SYSTEM_EVENTS = "bo";
+struct led_status _led;
+portMUX_TYPE g_led_spinlock;
+
+/* ---- NVS emulator: one namespace, items laid out in 32-byte entries ---- */
+
+#define NVS_ENTRY_SIZE 32
+#define NVS_ITEMS_MAX 1024
+
+struct nvs_item {
+    char key[16];
+    uint8_t type;
+    size_t size;
+    uint8_t* data;
+};
+
+static struct nvs_item s_items[NVS_ITEMS_MAX];
+static size_t s_item_count;
+static struct {
+    unsigned lookups;
+    unsigned entries_read;
+    unsigned entries_written;
+    unsigned commits;
+} s_stats;
+
+static unsigned nvs_entries(size_t size)
+{
+    // The header entry, plus the data entries of anything that does not fit its 8-byte payload
+    return 1 + (size > 8 ? (unsigned)((size + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE) : 0);
+}
+
+static struct nvs_item* nvs_find(const char* key)
+{
+    s_stats.lookups++;
+    for (size_t i = 0; i < s_item_count; i++) {
+        if (strncmp(s_items[i].key, key, sizeof(s_items[i].key)) == 0) {
+            s_stats.entries_read++; // The header entry, to confirm the key
+            return &s_items[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_get(const char* key, uint8_t type, void* out, size_t* size, bool exact)
+{
+    struct nvs_item* item = nvs_find(key);
+    if (item == NULL || item->type != type) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == NULL) {
+        *size = item->size;
+        return ESP_OK;
+    }
+    if (exact ? *size != item->size : *size < item->size) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    s_stats.entries_read += nvs_entries(item->size) - 1;
+    memcpy(out, item->data, item->size);
+    *size = item->size;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(const char* key, uint8_t type, const void* value, size_t size)
+{
+    struct nvs_item* item = nvs_find(key);
+    if (item != NULL && item->type == type && item->size == size && memcmp(item->data, value, size) == 0) {
+        return ESP_OK; // NVS skips writing an identical value
+    }
+    if (item == NULL) {
+        if (s_item_count == NVS_ITEMS_MAX) {
+            return ESP_FAIL;
+        }
+        item = &s_items[s_item_count++];
+        strncpy(item->key, key, sizeof(item->key));
+        item->data = NULL;
+    }
+    free(item->data);
+    item->type = type;
+    item->size = size;
+    item->data = malloc(size);
+    memcpy(item->data, value, size);
+    s_stats.entries_written += nvs_entries(size);
+    return ESP_OK;
+}
+
+#define NVS_INT(suffix, ctype, tag)                                                                                    \
+    esp_err_t nvs_get_##suffix(nvs_handle_t h, const char* key, ctype* out)                                            \
+    {                                                                                                                  \
+        size_t size = sizeof(ctype);                                                                                   \
+        return nvs_get(key, tag, out, &size, true);                                                                    \
+    }                                                                                                                  \
+    esp_err_t nvs_set_##suffix(nvs_handle_t h, const char* key, ctype value)                                           \
+    {                                                                                                                  \
+        return nvs_set(key, tag, &value, sizeof(value));                                                               \
+    }
+
+NVS_INT(u8, uint8_t, 1)
+NVS_INT(u16, uint16_t, 2)
+NVS_INT(u32, uint32_t, 4)
+NVS_INT(i32, int32_t, 0x14)
+NVS_INT(i64, int64_t, 0x18)
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* length)
+{
+    return nvs_get(key, 0x42, out, length, false);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length)
+{
+    return nvs_set(key, 0x42, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char* key)
+{
+    struct nvs_item* item = nvs_find(key);
+    if (item == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(item->data);
+    *item = s_items[--s_item_count];
+    s_stats.entries_written++; // Marking the entry erased
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    s_stats.commits++;
+    return ESP_OK;
+}
+
+static void nvs_reset()
+{
+    for (size_t i = 0; i < s_item_count; i++) {
+        free(s_items[i].data);
+    }
+    s_item_count = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+static void nvs_add_filler(int count)
+{
+    for (int i = 0; i < count; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "fill%d", i);
+        nvs_set_u32(0, key, (uint32_t)i);
+    }
+}
+
+/* ---- The rest of the firmware settings.c needs ---- */
+
+esp_err_t bo_nvs_user_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* out)
+{
+    *out = 1;
+    return ESP_OK;
+}
+
+esp_err_t bo_nvs_factory_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* out)
+{
+    *out = 2;
+    return ESP_OK;
+}
+
+void bo_nvs_auto_close(nvs_handle_t* handle) { }
+
+int bo_persist_register(const char* name, bo_persist_flush_fn flush, void* ctx) { return 0; }
+void bo_persist_mark_dirty(int section) { }
+
+esp_err_t bo_nvs_get_or_set_u8(nvs_handle_t h, const char* k, uint8_t* v, uint8_t d, bool* c) { return ESP_OK; }
+esp_err_t bo_nvs_get_or_set_u16(nvs_handle_t h, const char* k, uint16_t* v, uint16_t d, bool* c) { return ESP_OK; }
+esp_err_t bo_nvs_get_or_set_str(nvs_handle_t h, const char* k, char* v, size_t* l, const char* d, bool* c)
+{
+    return ESP_OK;
+}
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* ---- Tests ---- */
+
+static int s_failures;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __func__, __LINE__, #cond);                                           \
+            s_failures++;                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+static void sample_settings(struct led_user_settings* s)
+{
+    memset(s, 0, sizeof(*s));
+    s->mode = LED_MODE_SCHEDULED;
+    s->temporary_duration = 45;
+    s->correction_method = LED_CORRECTION_GAMMA;
+    s->tz_offset = -5 * 3600;
+    s->flags = LED_OPTION_TZ_ENABLED | LED_OPTION_ACCLIMATION_ENABLED | LED_OPTION_HAS_GEO_LOCATION;
+    s->location.lat = 47.5f;
+    s->location.lng = -122.25f;
+    s->acclimation.start_utc = 1750000000;
+    s->acclimation.duration = 21;
+    s->acclimation.start_percent = 40;
+    for (int ch = 0; ch < CONFIG_LYFI_LED_CHANNEL_COUNT; ch++) {
+        s->manual_color[ch] = 100 + ch;
+        s->sun_color[ch] = 200 + ch;
+        s->moon_color[ch] = 10 + ch;
+    }
+    s->scheduler.item_count = 3;
+    for (int i = 0; i < 3; i++) {
+        s->scheduler.items[i].instant = 3600 * (8 + i);
+        for (int ch = 0; ch < CONFIG_LYFI_LED_CHANNEL_COUNT; ch++) {
+            s->scheduler.items[i].color[ch] = 1000 * i + ch;
+        }
+    }
+}
+
+static bool settings_equal(const struct led_user_settings* a, const struct led_user_settings* b)
+{
+    return a->mode == b->mode && a->temporary_duration == b->temporary_duration
+        && a->correction_method == b->correction_method && a->tz_offset == b->tz_offset && a->flags == b->flags
+        && a->location.lat == b->location.lat && a->location.lng == b->location.lng
+        && a->acclimation.start_utc == b->acclimation.start_utc && a->acclimation.duration == b->acclimation.duration
+        && a->acclimation.start_percent == b->acclimation.start_percent
+        && memcmp(a->manual_color, b->manual_color, sizeof(led_color_t)) == 0
+        && memcmp(a->sun_color, b->sun_color, sizeof(led_color_t)) == 0
+        && memcmp(a->moon_color, b->moon_color, sizeof(led_color_t)) == 0
+        && a->scheduler.item_count == b->scheduler.item_count
+        && memcmp(a->scheduler.items, b->scheduler.items, sizeof(a->scheduler.items)) == 0;
+}
+
+/// What a firmware with image version 1 wrote: the same fields, the CRC over the payload only
+static void pack_v1(const struct led_user_settings* s, struct led_settings_image* image)
+{
+    led_image_pack(s, image);
+    image->header.version = 1;
+    image->header.crc32 = esp_rom_crc32_le(0, (const uint8_t*)image + sizeof(image->header),
+                                           sizeof(*image) - sizeof(image->header));
+}
+
+static void write_legacy(const struct led_user_settings* s)
+{
+    nvs_set_u8(0, LED_NVS_KEY_RUNNING_MODE, s->mode);
+    nvs_set_u32(0, LED_NVS_KEY_TEMPORARY_DURATION, s->temporary_duration);
+    nvs_set_blob(0, LED_NVS_KEY_SCHEDULER, &s->scheduler, sizeof(s->scheduler));
+    nvs_set_blob(0, LED_NVS_KEY_MANUAL_COLOR, s->manual_color, sizeof(led_color_t));
+    nvs_set_blob(0, LED_NVS_KEY_SUN_COLOR, s->sun_color, sizeof(led_color_t));
+    nvs_set_blob(0, LED_NVS_KEY_MOON_COLOR, s->moon_color, sizeof(led_color_t));
+    nvs_set_u8(0, LED_NVS_KEY_CORRECTION_METHOD, s->correction_method);
+    nvs_set_blob(0, LED_NVS_KEY_LOC, &s->location, sizeof(s->location));
+    nvs_set_u8(0, LED_NVS_KEY_TZ_ENABLED, !!(s->flags & LED_OPTION_TZ_ENABLED));
+    nvs_set_i32(0, LED_NVS_KEY_TZ_OFFSET, s->tz_offset);
+    nvs_set_u8(0, LED_NVS_KEY_ACCLIMATION_ENABLED, !!(s->flags & LED_OPTION_ACCLIMATION_ENABLED));
+    nvs_set_i64(0, LED_NVS_KEY_ACCLIMATION_START, s->acclimation.start_utc);
+    nvs_set_u8(0, LED_NVS_KEY_ACCLIMATION_DURATION, s->acclimation.duration);
+    nvs_set_u8(0, LED_NVS_KEY_ACCLIMATION_START_PERCENT, s->acclimation.start_percent);
+    nvs_set_u8(0, LED_NVS_KEY_CLOUD_ENABLED, !!(s->flags & LED_OPTION_CLOUD_ENABLED));
+    nvs_set_u8(0, LED_NVS_KEY_MOON_ENABLED, !!(s->flags & LED_OPTION_MOON_ENABLED));
+}
+
+static struct led_settings_image* stored_image()
+{
+    for (size_t i = 0; i < s_item_count; i++) {
+        if (strcmp(s_items[i].key, LED_NVS_KEY_IMAGE) == 0) {
+            return (struct led_settings_image*)s_items[i].data;
+        }
+    }
+    return NULL;
+}
+
+static void test_current_roundtrip()
+{
+    struct led_user_settings in, out;
+    static struct led_settings_image image;
+    sample_settings(&in);
+    led_image_pack(&in, &image);
+    uint16_t version = 0;
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image), sizeof(image), &image, &version) == 0);
+    CHECK(version == LED_SETTINGS_IMAGE_VERSION);
+    memset(&out, 0, sizeof(out));
+    led_image_unpack(&image, &out);
+    CHECK(settings_equal(&in, &out));
+}
+
+static void test_upgrade_chain()
+{
+    struct led_user_settings in, out;
+    static struct led_settings_image image, expected;
+    sample_settings(&in);
+    pack_v1(&in, &image);
+    led_image_pack(&in, &expected);
+
+    uint16_t version = 0;
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image), sizeof(image), &image, &version) == 0);
+    CHECK(version == 1);
+    CHECK(image.header.version == LED_SETTINGS_IMAGE_VERSION);
+    memset(&out, 0, sizeof(out));
+    led_image_unpack(&image, &out);
+    CHECK(settings_equal(&in, &out));
+
+    // Through the boot path: read as version 1, rewritten as the current one
+    nvs_reset();
+    pack_v1(&in, &image);
+    nvs_set_blob(0, LED_NVS_KEY_IMAGE, &image, sizeof(image));
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(settings_equal(&in, &_led.settings));
+    CHECK(stored_image() != NULL && memcmp(stored_image(), &expected, sizeof(expected)) == 0);
+}
+
+static void test_newer_image()
+{
+    struct led_user_settings in;
+    sample_settings(&in);
+    static uint8_t blob[sizeof(struct led_settings_image) + 16];
+    led_image_pack(&in, (struct led_settings_image*)blob);
+    struct led_settings_image_header* header = (struct led_settings_image_header*)blob;
+    memset(blob + sizeof(struct led_settings_image), 0x5a, 16);
+    header->version = LED_SETTINGS_IMAGE_VERSION + 1;
+    header->size = sizeof(blob);
+    header->crc32 = led_image_crc32(blob, sizeof(blob), header->version);
+
+    nvs_reset();
+    nvs_set_blob(0, LED_NVS_KEY_IMAGE, blob, sizeof(blob));
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(settings_equal(&in, &_led.settings));
+}
+
+static void test_damaged_images()
+{
+    struct led_user_settings in;
+    static struct led_settings_image image;
+    sample_settings(&in);
+    uint16_t version;
+
+    led_image_pack(&in, &image);
+    image.scheduler_items[0].instant ^= 1;
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image), sizeof(image), &image, &version) == -EINVAL);
+
+    // Caught by the version 2 CRC, version 1 did not cover the header
+    led_image_pack(&in, &image);
+    image.header.reserved[0] = 1;
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image), sizeof(image), &image, &version) == -EINVAL);
+
+    led_image_pack(&in, &image);
+    image.header.channel_count++;
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image), sizeof(image), &image, &version) == -EINVAL);
+
+    led_image_pack(&in, &image);
+    CHECK(led_image_migrate((uint8_t*)&image, sizeof(image) - 4, sizeof(image), &image, &version) == -EINVAL);
+
+    // No per-field keys to fall back to after the migration: the defaults
+    nvs_reset();
+    led_image_pack(&in, &image);
+    image.mode ^= 1;
+    nvs_set_blob(0, LED_NVS_KEY_IMAGE, &image, sizeof(image));
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(_led.settings.mode == LED_DEFAULT_SETTINGS.mode);
+    CHECK(_led.settings.tz_offset == LED_DEFAULT_SETTINGS.tz_offset);
+}
+
+static void test_legacy_migration()
+{
+    struct led_user_settings in;
+    sample_settings(&in);
+    nvs_reset();
+    write_legacy(&in);
+    const size_t legacy_count = s_item_count;
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(settings_equal(&in, &_led.settings));
+    CHECK(s_item_count == legacy_count + 1 && stored_image() != NULL);
+
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(settings_equal(&in, &_led.settings));
+
+    // A downgraded firmware still finds its per-field keys
+    struct led_user_settings downgraded;
+    memset(&downgraded, 0, sizeof(downgraded));
+    CHECK(led_load_legacy_settings(1, &downgraded) == 0);
+    CHECK(settings_equal(&in, &downgraded));
+
+    // An image damaged after the migration falls back to them instead of the defaults
+    struct led_settings_image* image = stored_image();
+    image->mode ^= 1;
+    memset(&_led.settings, 0, sizeof(_led.settings));
+    CHECK(led_load_user_settings() == 0);
+    CHECK(settings_equal(&in, &_led.settings));
+}
+
+/* ---- Benchmark ---- */
+
+enum { BENCH_PER_KEY, BENCH_MIGRATE, BENCH_IMAGE };
+
+static void bench_prepare(int method, int filler)
+{
+    struct led_user_settings in;
+    sample_settings(&in);
+    nvs_reset();
+    nvs_add_filler(filler);
+    write_legacy(&in);
+    if (method == BENCH_IMAGE) {
+        memset(&_led.settings, 0, sizeof(_led.settings));
+        led_load_user_settings();
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+static void bench(int method, int filler, int rounds)
+{
+    int64_t total_ns = 0;
+    for (int r = 0; r < rounds; r++) {
+        bench_prepare(method, filler);
+        memset(&_led.settings, 0, sizeof(_led.settings));
+        int64_t begin = now_ns();
+        int rc = method == BENCH_PER_KEY ? led_load_legacy_settings(1, &_led.settings) : led_load_user_settings();
+        total_ns += now_ns() - begin;
+        if (rc != 0) {
+            fprintf(stderr, "load failed: %d\n", rc);
+            exit(1);
+        }
+    }
+    printf("%u %u %u %u %f\n", s_stats.lookups, s_stats.entries_read, s_stats.entries_written, s_stats.commits,
+           (double)total_ns / rounds);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        bench(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]));
+        return 0;
+    }
+    test_current_roundtrip();
+    test_upgrade_chain();
+    test_newer_image();
+    test_damaged_images();
+    test_legacy_migration();
+    printf("%d\n", s_failures);
+    return s_failures != 0;
+}
+'''
+
+METHODS = ['per-key', 'migrate', 'image']
+
+
+def main():
+    parser = argparse.ArgumentParser(description='LED settings image tests and boot-time benchmark')
+    parser.add_argument('--filler', type=int, nargs='*', default=[0, 50, 200], help='Unrelated keys in the store')
+    parser.add_argument('--rounds', type=int, default=2000, help='Loads timed per method')
+    parser.add_argument('--lookup-us', type=float, default=30.0, help='Device cost of one NVS lookup')
+    parser.add_argument('--entry-us', type=float, default=4.0, help='Device cost of reading one 32-byte entry')
+    args = parser.parse_args()
+
+    with HostBuild({'sdkconfig.h': SDKCONFIG}) as build:
+        exe = build.compile(HARNESS, includes=[LYFI_DIR / 'led', FW_DIR / '3rd-components' / 'smf' / 'include'],
+                            flags=['-Wno-unused-value'])
+        run(exe, error='settings image tests failed', quiet=True)
+        print('settings image tests passed')
+        print()
+
+        print(f'{"filler":>6} {"method":>8} {"lookups":>8} {"read":>6} {"written":>8} {"commits":>8} '
+              f'{"host ns":>9} {"device us":>10}')
+        for filler in args.filler:
+            for i, method in enumerate(METHODS):
+                result = run(exe, i, filler, args.rounds, quiet=True)
+                lookups, read, written, commits, ns = result.stdout.split()
+                lookups, read = int(lookups), int(read)
+                device_us = lookups * args.lookup_us + read * args.entry_us
+                print(f'{filler:>6} {method:>8} {lookups:>8} {read:>6} {written:>8} {commits:>8} '
+                      f'{float(ns):>9.0f} {device_us:>10.0f}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,165 @@
+"""Tests of the NTC temperature conversion (`lyfi/main/src/drivers/sensor_temp.c`).
+
+Compiles the firmware's `sensor_temp.c` for the host once per pull-up variant of `NTC_MAPPING_TABLE` and checks the
+scaled-integer interpolation against a double precision reference over the full table:
+
+   - every voltage from the first entry to below the last one converts within half an LSB
+     (1/(2 * SENSOR_TEMP_SCALE) ℃) of the linear interpolation between the two neighbouring entries
+   - every table entry converts to exactly its whole degree, and the result never rises with the voltage
+   - voltages below the table clamp to its last degree
+   - a voltage above the first entry (open or disconnected NTC) converts to `NTC_BAD_TEMPERATURE`, and
+     `_fetch_sample()` fails with -EIO instead of reporting a temperature
+   - `sensor_temp_to_celsius()` rounds the fixed point value half away from zero, as `thermal_get_current_temp()`
+     and the RPC/CoAP temperature fields expect
+
+Usage:
+    python ntc-test.py
+"""
+
+from host_build import CORE_DIR, LYFI_DIR, HostBuild, run
+
+VARIANTS = ['CONFIG_LYFI_NTC_PU_4K7', 'CONFIG_LYFI_NTC_PU_10K']
+
+SDKCONFIG = '#pragma once\n#define CONFIG_LYFI_NTC_SUPPORT 1\n#define CONFIG_LYFI_NTC_ADC_CHANNEL 0\n'
+
+HARNESS = r'''
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// The conversion is static, so the driver is compiled into the harness
+#include "sensor_temp.c"
+
+const struct drvfx_device* k_device_get_binding(const char* name)
+{
+    (void)name;
+    return NULL;
+}
+
+static int32_t s_adc_mv;
+
+static int fake_read_mv(const struct drvfx_device* dev, adc_channel_t channel, int32_t* mv)
+{
+    *mv = s_adc_mv;
+    return 0;
+}
+
+static const struct adc_driver_api s_fake_adc_api = { .read_mv = fake_read_mv };
+static const struct drvfx_device s_fake_adc = { .name = "adc", .api = &s_fake_adc_api };
+
+// Feeds a fresh driver instance with a constant ADC voltage
+static int fetch_at(int32_t mv, int32_t* temp)
+{
+    static struct ntc_data data;
+    const struct drvfx_device dev = { .name = "sensor.temp", .data = &data };
+    data = (struct ntc_data) { .adc_dev = &s_fake_adc };
+    median_filter_init(&data.median, ADC_WINDOW_SIZE);
+    ema_filter_init(&data.ema, 1, 10);
+    s_adc_mv = mv;
+    const int rc = _fetch_sample(&dev);
+    *temp = data.temp_value;
+    return rc;
+}
+
+static int s_failures;
+
+static void check(const char* name, bool ok, const char* detail)
+{
+    printf("%-26s %-58s %-6s %s\n", VARIANT, name, ok ? "ok" : "FAILED", detail);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+// Linear interpolation between the neighbouring whole degrees, in double precision
+static double reference(int32_t mv)
+{
+    for (int i = 1; i < NTC_MAPPING_TABLE_SIZE; i++) {
+        if (mv >= NTC_MAPPING_TABLE[i]) {
+            return (i - 1) + (double)(NTC_MAPPING_TABLE[i - 1] - mv) / (NTC_MAPPING_TABLE[i - 1] - NTC_MAPPING_TABLE[i]);
+        }
+    }
+    return NTC_MAPPING_TABLE_SIZE - 1;
+}
+
+int main()
+{
+    char detail[160];
+
+    const int32_t hi = NTC_MAPPING_TABLE[0];
+    const int32_t lo = NTC_MAPPING_TABLE[NTC_MAPPING_TABLE_SIZE - 1] - 100;
+    double worst = 0.0;
+    int32_t worst_mv = 0, prev = INT32_MIN, rises = 0;
+    for (int32_t mv = hi; mv >= lo; mv--) {
+        const int32_t value = ntc_table_interpolate(mv);
+        const double err = fabs((double)value / SENSOR_TEMP_SCALE - reference(mv));
+        if (err > worst) {
+            worst = err;
+            worst_mv = mv;
+        }
+        if (value < prev) {
+            rises++;
+        }
+        prev = value;
+    }
+    snprintf(detail, sizeof(detail), "worst %.4f ℃ at %d mV, %d..%d mV", worst, worst_mv, lo, hi);
+    check("within half an LSB of the float reference", worst <= 0.5 / SENSOR_TEMP_SCALE + 1e-9, detail);
+    snprintf(detail, sizeof(detail), "%d rises", rises);
+    check("never rises with the voltage", rises == 0, detail);
+
+    int exact = 0;
+    for (int i = 0; i < NTC_MAPPING_TABLE_SIZE; i++) {
+        exact += ntc_table_interpolate(NTC_MAPPING_TABLE[i]) == i * SENSOR_TEMP_SCALE;
+    }
+    snprintf(detail, sizeof(detail), "%d of %d", exact, (int)NTC_MAPPING_TABLE_SIZE);
+    check("table entries convert to whole degrees", exact == NTC_MAPPING_TABLE_SIZE, detail);
+
+    int open = 0;
+    for (int32_t mv = NTC_MAPPING_TABLE[0] + 1; mv < 4095; mv++) {
+        open += ntc_table_interpolate(mv) == NTC_BAD_TEMPERATURE;
+    }
+    snprintf(detail, sizeof(detail), "%d of %d mV", open, 4094 - NTC_MAPPING_TABLE[0]);
+    check("open sensor converts to NTC_BAD_TEMPERATURE", open == 4094 - NTC_MAPPING_TABLE[0], detail);
+    int32_t temp;
+    int rc = fetch_at(NTC_MAPPING_TABLE[0] + 1, &temp);
+    snprintf(detail, sizeof(detail), "rc %d at %d mV", rc, NTC_MAPPING_TABLE[0] + 1);
+    check("_fetch_sample() fails with -EIO on an open sensor", rc == -EIO, detail);
+    rc = fetch_at(NTC_MAPPING_TABLE[25], &temp);
+    snprintf(detail, sizeof(detail), "rc %d, %d", rc, temp);
+    check("_fetch_sample() reports a connected sensor", rc == 0 && temp > 0 && temp <= 25 * SENSOR_TEMP_SCALE,
+          detail);
+    check("clamps below the table",
+          ntc_table_interpolate(0) == (NTC_MAPPING_TABLE_SIZE - 1) * SENSOR_TEMP_SCALE, "");
+
+    int wrong = 0;
+    for (int32_t value = -50 * SENSOR_TEMP_SCALE; value <= 150 * SENSOR_TEMP_SCALE; value++) {
+        wrong += sensor_temp_to_celsius(value) != (int32_t)lround((double)value / SENSOR_TEMP_SCALE);
+    }
+    snprintf(detail, sizeof(detail), "%d mismatches from -50 to 150 ℃", wrong);
+    check("sensor_temp_to_celsius() rounds like lround()", wrong == 0, detail);
+
+    return s_failures != 0;
+}
+'''
+
+
+def main():
+    failed = False
+    with HostBuild({'sdkconfig.h': SDKCONFIG}) as build:
+        for variant in VARIANTS:
+            exe = build.compile(HARNESS, sources=[CORE_DIR / 'src' / 'algo' / 'filters.c'],
+                                includes=[LYFI_DIR / 'drivers'], flags=[f'-D{variant}=1', f'-DVARIANT="{variant}"'],
+                                output=f'harness-{variant}')
+            try:
+                run(exe)
+            except SystemExit:
+                failed = True
+
+    if failed:
+        raise SystemExit('NTC tests failed')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,142 @@
+"""Compression ratio and decompression throughput of compressed OTA images versus the window size.
+
+Compresses a firmware image with `borneopy/borneo/ota_compress.py` for every window size, then decodes it with the
+firmware's decoder (`borneo-core/src/algo/lzss.c`) compiled for the host, fed in 1 KB chunks like the CoAP handlers
+do. Each row shows the compressed size, the decoder RAM (its state plus the window) and the decode throughput.
+
+The host runs the decoder much faster than an ESP32 does; `--device-slowdown` scales the host figure to a device
+estimate, which is compared to `--flash-rate`. Take that one from the `write_bytes_per_second` counter of
+`borneo/ota/coap/status` after a plain upload. The smallest window whose estimate keeps up with the flash and whose
+ratio stops improving is the one to use.
+
+Usage:
+    python ota-compress-bench.py build/lyfi.bin --windows 8 9 10 11 12 --flash-rate 180000
+"""
+
+import argparse
+import hashlib
+import importlib.util
+import subprocess
+import time
+from pathlib import Path
+
+from host_build import CORE_DIR, HostBuild
+
+# Loaded from its file, importing the `borneo` package would pull in its CoAP client and aiocoap
+_spec = importlib.util.spec_from_file_location(
+    'ota_compress', Path(__file__).resolve().parents[2] / 'borneopy' / 'borneo' / 'ota_compress.py')
+ota_compress = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(ota_compress)
+
+HARNESS = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <borneo/algo/lzss.h>
+
+static uint8_t* s_out;
+static size_t s_out_len;
+static uint8_t s_window[1 << LZSS_WINDOW_BITS_MAX];
+
+static int header(void* ctx, const struct lzss_header* h, uint8_t** window)
+{
+    *window = s_window;
+    return 0;
+}
+
+static int write_out(void* ctx, const uint8_t* buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        s_out[s_out_len++] = buf[i];
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    FILE* f = fopen(argv[1], "rb");
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* in = malloc(size);
+    fread(in, 1, size, f);
+    fclose(f);
+    int rounds = atoi(argv[3]);
+    s_out = malloc(strtoul(argv[4], 0, 0));
+
+    static const struct lzss_io io = { header, write_out };
+    static struct lzss_decoder dec;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int r = 0; r < rounds; r++) {
+        lzss_decoder_init(&dec, &io, NULL);
+        s_out_len = 0;
+        for (size_t off = 0; off < size; off += 1024) {
+            if (lzss_decoder_feed(&dec, in + off, size - off < 1024 ? size - off : 1024) != 0) {
+                fprintf(stderr, "lzss_decoder_feed failed at %zu\n", off);
+                return 1;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!lzss_decoder_done(&dec)) {
+        fprintf(stderr, "incomplete\n");
+        return 1;
+    }
+
+    FILE* o = fopen(argv[2], "wb");
+    fwrite(s_out, 1, s_out_len, o);
+    fclose(o);
+    double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    printf("%f %zu\n", seconds / rounds, sizeof(dec));
+    return 0;
+}
+'''
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compressed OTA window size benchmark')
+    parser.add_argument('image', help='Firmware image (.bin)')
+    parser.add_argument('--windows', type=int, nargs='*', default=[8, 9, 10, 11, 12], help='Window sizes in bits')
+    parser.add_argument('--lookahead', type=int, default=4, help='Lookahead size in bits')
+    parser.add_argument('--rounds', type=int, default=5, help='Decode rounds per measurement')
+    parser.add_argument('--flash-rate', type=float, default=150000.0, help='Flash write rate in bytes/s')
+    parser.add_argument('--device-slowdown', type=float, default=40.0,
+                        help='How much slower the device runs the decoder than this host')
+    args = parser.parse_args()
+
+    image = Path(args.image).read_bytes()
+    digest = hashlib.sha256(image).digest()
+
+    with HostBuild() as build:
+        tmp = build.path
+        exe = build.compile(HARNESS, sources=[CORE_DIR / 'src' / 'algo' / 'lzss.c'])
+
+        print(f'{len(image)} bytes, lookahead {1 << args.lookahead} bytes, flash {args.flash_rate / 1024:.0f} KiB/s')
+        print(f'{"window":>8} {"compressed":>11} {"ratio":>6} {"encode s":>9} {"RAM":>7} {"host MB/s":>10} '
+              f'{"device KiB/s":>13}')
+        for bits in args.windows:
+            started = time.monotonic()
+            blob = ota_compress.compress(image, bits, args.lookahead)
+            encode_s = time.monotonic() - started
+            (tmp / 'image.z').write_bytes(blob)
+
+            result = subprocess.run([str(exe), str(tmp / 'image.z'), str(tmp / 'image.out'), str(args.rounds),
+                                     str(len(image))], capture_output=True, text=True)
+            if result.returncode != 0:
+                print(f'{1 << bits:>8} decoder failed: {result.stderr.strip()}')
+                continue
+            if hashlib.sha256((tmp / 'image.out').read_bytes()).digest() != digest:
+                print(f'{1 << bits:>8} decoded image differs')
+                continue
+
+            seconds, state = result.stdout.split()
+            rate = len(image) / float(seconds)
+            device = rate / args.device_slowdown
+            print(f'{1 << bits:>8} {len(blob):>11} {100.0 * len(blob) / len(image):>5.1f}% {encode_s:>9.1f} '
+                  f'{int(state) + (1 << bits):>7} {rate / 1e6:>10.1f} {device / 1024:>13.0f}'
+                  f'{"" if device >= args.flash_rate else "  slower than the flash"}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,957 @@
+"""Delta firmware patches for the CoAP OTA (`borneo-core/include/borneo/algo/delta-patch.h`).
+
+`diff` builds a patch that turns the image running on a device into a new one, `apply` is the reference applier.
+`test` checks the firmware's C applier on the host: it compiles `delta-patch.c` with the host compiler, applies a
+patch to file-backed partitions while feeding it in random chunk sizes like the CoAP handlers do, verifies the
+SHA-256 of the result and reports how many bytes and requests the patch saves over the full image. Without
+`--old`/`--new` it synthesizes a pair of images: the new one has a few functions inserted, every code pointer past
+them relocated and a few constants changed, which is what a typical release looks like to the differ.
+
+`session` compiles the CoAP OTA handlers (`coap-ota-resources.c`) with RAM-backed partitions and drives them like a
+client: a windowed upload of a truncated patch must be refused and end its session, so that a Block1 upload of the
+full image and then a complete patch succeed after it.
+
+Usage:
+    python ota-delta.py diff old.bin new.bin update.patch
+    python ota-delta.py apply old.bin update.patch new.bin
+    python ota-delta.py test --old old.bin --new new.bin
+    python ota-delta.py test --size 1500000 --seed 3
+    python ota-delta.py session
+"""
+
+import argparse
+import hashlib
+import random
+import re
+import struct
+import sys
+from pathlib import Path
+
+from host_build import CORE_DIR, HostBuild, run
+
+MAGIC = b'BOD1'
+OP_END, OP_COPY, OP_ADD, OP_INSERT, OP_SEEK = range(5)
+
+SEED_LEN = 16  # Exact bytes needed to start a match
+INDEX_STEP = 4  # Only every 4th source offset is indexed, the target is scanned at every offset
+MIN_SCORE = 24  # A match must save at least this much over inserting its bytes
+GIVE_UP = 32  # Stop extending a match once this many more mismatches than matches follow its best end
+MIN_COPY = 4  # Shorter unchanged runs inside a match are cheaper as part of an ADD
+
+
+def varint(n: int) -> bytes:
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def read_varint(data: bytes, pos: int):
+    n = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        n |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return n, pos
+
+
+def exact_run(src: bytes, s: int, tgt: bytes, t: int) -> int:
+    """Length of the common prefix of `src[s:]` and `tgt[t:]`."""
+    limit = min(len(src) - s, len(tgt) - t)
+    n = 0
+    step = 256
+    while n < limit:
+        k = min(step, limit - n)
+        if src[s + n:s + n + k] == tgt[t + n:t + n + k]:
+            n += k
+        elif k > 1:
+            step = max(1, k // 8)
+        else:
+            break
+    return n
+
+
+def extend(src: bytes, s: int, tgt: bytes, t: int):
+    """Extends a match forward over sparse mismatches, returns `(length, score)` of its best end."""
+    length = score = best = best_len = 0
+    limit = min(len(src) - s, len(tgt) - t)
+    while length < limit:
+        run = exact_run(src, s + length, tgt, t + length)
+        length += run
+        score += run
+        if score > best:
+            best, best_len = score, length
+        if length >= limit or score < best - GIVE_UP:
+            break
+        length += 1  # The mismatching byte
+        score -= 1
+    return best_len, best
+
+
+def encode_match(ops: list, src: bytes, s: int, tgt: bytes, t: int, length: int):
+    delta = bytes((tgt[t + i] - src[s + i]) & 0xFF for i in range(length))
+    pos = 0
+    for m in re.finditer(b'\x00{%d,}' % MIN_COPY, delta):
+        if m.start() > pos:
+            ops.append(bytes([OP_ADD]) + varint(m.start() - pos) + delta[pos:m.start()])
+        ops.append(bytes([OP_COPY]) + varint(m.end() - m.start()))
+        pos = m.end()
+    if pos < length:
+        ops.append(bytes([OP_ADD]) + varint(length - pos) + delta[pos:])
+
+
+def diff(src: bytes, tgt: bytes) -> bytes:
+    index = {}
+    for i in range(0, len(src) - SEED_LEN + 1, INDEX_STEP):
+        index.setdefault(src[i:i + SEED_LEN], i)
+
+    ops = []
+    src_pos = 0
+    literal_start = 0
+    last_delta = None
+    t = 0
+    while t + SEED_LEN <= len(tgt):
+        candidates = []
+        s = index.get(tgt[t:t + SEED_LEN])
+        if s is not None:
+            candidates.append(s)
+        if last_delta is not None and 0 <= t + last_delta <= len(src) - 8 and t + last_delta != s:
+            if src[t + last_delta:t + last_delta + 8] == tgt[t:t + 8]:
+                candidates.append(t + last_delta)
+
+        best = None
+        for s in candidates:
+            length, score = extend(src, s, tgt, t)
+            if score >= MIN_SCORE and (best is None or score > best[2]):
+                best = (s, length, score)
+        if best is None:
+            t += 1
+            continue
+
+        s, length, _ = best
+        start = t
+        while start > literal_start and s > 0 and tgt[start - 1] == src[s - 1]:
+            start -= 1
+            s -= 1
+            length += 1
+
+        if start > literal_start:
+            ops.append(bytes([OP_INSERT]) + varint(start - literal_start) + tgt[literal_start:start])
+        if s != src_pos:
+            d = s - src_pos
+            ops.append(bytes([OP_SEEK]) + varint((d << 1) ^ (d >> 63)))
+        encode_match(ops, src, s, tgt, start, length)
+
+        src_pos = s + length
+        last_delta = s - start
+        t = literal_start = start + length
+
+    if literal_start < len(tgt):
+        ops.append(bytes([OP_INSERT]) + varint(len(tgt) - literal_start) + tgt[literal_start:])
+    ops.append(bytes([OP_END]))
+
+    header = MAGIC + struct.pack('<II', len(src), len(tgt)) + hashlib.sha256(src).digest() \
+        + hashlib.sha256(tgt).digest()
+    return header + b''.join(ops)
+
+
+def apply(src: bytes, patch: bytes) -> bytes:
+    if patch[:4] != MAGIC:
+        raise ValueError('Not a delta patch')
+    source_size, target_size = struct.unpack_from('<II', patch, 4)
+    if hashlib.sha256(src[:source_size]).digest() != patch[12:44]:
+        raise ValueError('The patch was made for a different source image')
+
+    out = bytearray()
+    pos = 76
+    s = 0
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        n, pos = read_varint(patch, pos)
+        if op == OP_COPY:
+            out += src[s:s + n]
+            s += n
+        elif op == OP_ADD:
+            out += bytes((src[s + i] + patch[pos + i]) & 0xFF for i in range(n))
+            s += n
+            pos += n
+        elif op == OP_INSERT:
+            out += patch[pos:pos + n]
+            pos += n
+        elif op == OP_SEEK:
+            s += (n >> 1) ^ -(n & 1)
+        else:
+            raise ValueError(f'Unknown operation {op}')
+
+    if len(out) != target_size or hashlib.sha256(out).digest() != patch[44:76]:
+        raise ValueError('Patched image does not match the target')
+    return bytes(out)
+
+
+def synthesize(size: int, seed: int):
+    """A pair of images with 32-bit code pointers, shaped like two consecutive builds."""
+    rng = random.Random(seed)
+    base = 0x400D0000
+    words = []
+    for _ in range(size // 4):
+        if rng.random() < 0.15:
+            words.append(('ptr', rng.randrange(size)))
+        else:
+            words.append(('op', rng.getrandbits(32) & 0x00FFFFFF))  # Instruction bytes are far from random
+
+    def render(words):
+        return b''.join(struct.pack('<I', base + v if k == 'ptr' else v) for k, v in words)
+
+    old = render(words)
+    new_words = list(words)
+    for _ in range(3):
+        at = rng.randrange(len(new_words))
+        inserted = [('op', rng.getrandbits(24)) for _ in range(rng.randrange(64, 512))]
+        shift = len(inserted) * 4
+        new_words = [(k, v + shift if k == 'ptr' and v >= at * 4 else v) for k, v in new_words]
+        new_words[at:at] = inserted
+    for _ in range(20):
+        new_words[rng.randrange(len(new_words))] = ('op', rng.getrandbits(24))
+    return old, render(new_words)
+
+
+HARNESS = r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <borneo/algo/delta-patch.h>
+
+struct files { FILE* source; FILE* target; size_t source_part; size_t target_part; };
+
+static int header(void* ctx, const struct delta_patch_header* h)
+{
+    struct files* f = ctx;
+    return h->source_size <= f->source_part && h->target_size <= f->target_part ? 0 : -1;
+}
+
+static int read_source(void* ctx, size_t offset, uint8_t* buf, size_t len)
+{
+    struct files* f = ctx;
+    return fseek(f->source, (long)offset, SEEK_SET) == 0 && fread(buf, 1, len, f->source) == len ? 0 : -5;
+}
+
+static int write_target(void* ctx, const uint8_t* buf, size_t len)
+{
+    struct files* f = ctx;
+    return fwrite(buf, 1, len, f->target) == len ? 0 : -5;
+}
+
+int main(int argc, char** argv)
+{
+    struct files f = { fopen(argv[1], "rb"), fopen(argv[2], "r+b"), strtoul(argv[3], 0, 0), strtoul(argv[4], 0, 0) };
+    srand(atoi(argv[5]));
+    static const struct delta_patch_io io = { header, read_source, write_target };
+    static struct delta_patch patch;
+    delta_patch_init(&patch, &io, &f);
+
+    static uint8_t chunk[1024];
+    size_t n, total = 0;
+    for (;;) {
+        size_t want = 1 + rand() % sizeof(chunk); // Like the Block1 and windowed upload chunks
+        if ((n = fread(chunk, 1, want, stdin)) == 0) {
+            break;
+        }
+        total += n;
+        int rc = delta_patch_feed(&patch, chunk, n);
+        if (rc != 0) {
+            fprintf(stderr, "delta_patch_feed failed: %d\n", rc);
+            return 1;
+        }
+    }
+    printf("%zu %zu %d\n", total, sizeof(patch), delta_patch_done(&patch));
+    return delta_patch_done(&patch) ? 0 : 1;
+}
+'''
+
+
+# What `coap-ota-resources.c` needs beyond `host_build.STUBS`: RAM-backed OTA partitions, SHA-256 and just enough of
+# libcoap for the harness to call the handlers with a request and read back the response
+SESSION_STUBS = {
+    'sdkconfig.h': '#pragma once\n'
+                   '#define CONFIG_BORNEO_EDITION_CE 1\n'
+                   '#define CONFIG_BORNEO_OTA_WINDOW_SIZE 8\n'
+                   '#define CONFIG_BORNEO_OTA_WRITER_BUFFERS 2\n'
+                   '#define CONFIG_BORNEO_OTA_LZSS_WINDOW_BITS_MAX 12\n'
+                   '#define CONFIG_BORNEO_OTA_RESUME_COMMIT_PAGES 16\n',
+    'esp_http_client.h': '#pragma once\n',
+    'esp_flash_partitions.h': '#pragma once\n',
+    'esp_partition.h': r'''#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size);
+''',
+    'esp_ota_ops.h': r'''#pragma once
+#include <esp_partition.h>
+typedef uint32_t esp_ota_handle_t;
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe
+const esp_partition_t* esp_ota_get_running_partition(void);
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from);
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
+esp_err_t esp_ota_resume(const esp_partition_t* partition, size_t erase_size, size_t image_offset,
+                         esp_ota_handle_t* out_handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+''',
+    'mbedtls/sha256.h': r'''#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+typedef struct {
+    uint32_t state[8];
+    uint64_t total;
+    uint8_t block[64];
+} mbedtls_sha256_context;
+static inline void host_sha256_block(uint32_t* h, const uint8_t* p)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+#define HOST_ROR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+    uint32_t w[64], v[8];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = HOST_ROR(w[i - 15], 7) ^ HOST_ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = HOST_ROR(w[i - 2], 17) ^ HOST_ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, h, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = v[7] + (HOST_ROR(v[4], 6) ^ HOST_ROR(v[4], 11) ^ HOST_ROR(v[4], 25))
+                      + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+        uint32_t t2 = (HOST_ROR(v[0], 2) ^ HOST_ROR(v[0], 13) ^ HOST_ROR(v[0], 22))
+                      + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(&v[1], &v[0], 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+#undef HOST_ROR
+    for (int i = 0; i < 8; i++) {
+        h[i] += v[i];
+    }
+}
+static inline void mbedtls_sha256_init(mbedtls_sha256_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+static inline void mbedtls_sha256_free(mbedtls_sha256_context* ctx) { }
+static inline int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224)
+{
+    static const uint32_t iv[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->total = 0;
+    return 0;
+}
+static inline int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        ctx->block[ctx->total++ % 64] = data[i];
+        if (ctx->total % 64 == 0) {
+            host_sha256_block(ctx->state, ctx->block);
+        }
+    }
+    return 0;
+}
+static inline int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, uint8_t* digest)
+{
+    const uint64_t bits = ctx->total * 8;
+    const uint8_t pad = 0x80, zero = 0;
+    mbedtls_sha256_update(ctx, &pad, 1);
+    while (ctx->total % 64 != 56) {
+        mbedtls_sha256_update(ctx, &zero, 1);
+    }
+    for (int i = 7; i >= 0; i--) {
+        const uint8_t b = (uint8_t)(bits >> (8 * i));
+        mbedtls_sha256_update(ctx, &b, 1);
+    }
+    for (int i = 0; i < 32; i++) {
+        digest[i] = (uint8_t)(ctx->state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    return 0;
+}
+''',
+    'coap3/coap.h': r'''#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+typedef struct { size_t length; const uint8_t* s; } coap_str_const_t;
+typedef struct { size_t length; uint8_t* s; } coap_string_t;
+typedef struct coap_resource_t coap_resource_t;
+typedef struct coap_session_t coap_session_t;
+typedef struct { size_t length; uint8_t value[4]; } coap_opt_t;
+typedef struct { int unused; } coap_opt_iterator_t;
+typedef int coap_pdu_code_t;
+// A request carries at most a Block1 option and a payload, a response records its code, Block1 option and payload
+typedef struct coap_pdu_t {
+    coap_pdu_code_t code;
+    coap_opt_t block1;
+    const uint8_t* data;
+    size_t data_len;
+    uint8_t payload[1024];
+} coap_pdu_t;
+typedef void (*coap_method_handler_t)(coap_resource_t*, coap_session_t*, const coap_pdu_t*, const coap_string_t*,
+                                      coap_pdu_t*);
+
+#define COAP_RESPONSE_CODE(n) (((n) / 100 << 5) | ((n) % 100))
+#define COAP_REQUEST_CODE_GET 1
+#define COAP_REQUEST_CODE_POST 2
+#define COAP_REQUEST_CODE_PUT 3
+#define COAP_RESPONSE_CODE_CREATED COAP_RESPONSE_CODE(201)
+#define COAP_RESPONSE_CODE_CHANGED COAP_RESPONSE_CODE(204)
+#define COAP_RESPONSE_CODE_CONTENT COAP_RESPONSE_CODE(205)
+#define COAP_RESPONSE_CODE_CONTINUE COAP_RESPONSE_CODE(231)
+#define COAP_RESPONSE_CODE_BAD_REQUEST COAP_RESPONSE_CODE(400)
+#define COAP_RESPONSE_CODE_NOT_FOUND COAP_RESPONSE_CODE(404)
+#define COAP_RESPONSE_CODE_NOT_ALLOWED COAP_RESPONSE_CODE(405)
+#define COAP_RESPONSE_CODE_REQUEST_TOO_LARGE COAP_RESPONSE_CODE(413)
+#define COAP_RESPONSE_CODE_INTERNAL_ERROR COAP_RESPONSE_CODE(500)
+#define COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE COAP_RESPONSE_CODE(503)
+#define COAP_RESPONSE_CODE_GATEWAY_TIMEOUT COAP_RESPONSE_CODE(504)
+#define COAP_OPTION_BLOCK1 27
+#define COAP_MEDIATYPE_APPLICATION_CBOR 60
+
+static inline coap_opt_t* coap_check_option(const coap_pdu_t* pdu, int number, coap_opt_iterator_t* it)
+{
+    return number == COAP_OPTION_BLOCK1 && pdu->block1.length > 0 ? (coap_opt_t*)&pdu->block1 : NULL;
+}
+static inline const uint8_t* coap_opt_value(const coap_opt_t* opt) { return opt->value; }
+static inline size_t coap_opt_length(const coap_opt_t* opt) { return opt->length; }
+static inline unsigned int coap_decode_var_bytes(const uint8_t* buf, size_t len)
+{
+    unsigned int n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n = n << 8 | buf[i];
+    }
+    return n;
+}
+static inline unsigned int coap_encode_var_safe(uint8_t* buf, size_t size, unsigned int value)
+{
+    unsigned int len = 0;
+    for (unsigned int v = value; v != 0; v >>= 8) {
+        len++;
+    }
+    for (unsigned int i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    }
+    return len;
+}
+static inline int coap_add_option(coap_pdu_t* pdu, int number, size_t len, const uint8_t* data)
+{
+    if (number == COAP_OPTION_BLOCK1) {
+        pdu->block1.length = len > 0 ? len : 1; // A zero value is encoded without bytes
+        memset(pdu->block1.value, 0, sizeof(pdu->block1.value));
+        memcpy(pdu->block1.value, data, len);
+    }
+    return 1;
+}
+static inline int coap_get_data(const coap_pdu_t* pdu, size_t* len, const uint8_t** data)
+{
+    *len = pdu->data_len;
+    *data = pdu->data;
+    return pdu->data_len > 0;
+}
+static inline coap_pdu_code_t coap_pdu_get_code(const coap_pdu_t* pdu) { return pdu->code; }
+static inline void coap_pdu_set_code(coap_pdu_t* pdu, coap_pdu_code_t code) { pdu->code = code; }
+static inline int coap_add_data(coap_pdu_t* pdu, size_t len, const uint8_t* data)
+{
+    memcpy(pdu->payload, data, len);
+    pdu->data = pdu->payload;
+    pdu->data_len = len;
+    return 1;
+}
+static inline int coap_add_data_blocked_response(const coap_pdu_t* request, coap_pdu_t* response, uint16_t type,
+                                                 int maxage, size_t len, const uint8_t* data)
+{
+    response->code = COAP_RESPONSE_CODE_CONTENT;
+    return coap_add_data(response, len, data);
+}
+''',
+}
+
+SESSION_HARNESS = r'''
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "coap-ota-resources.c"
+
+/* ---- RAM-backed "running" and "next" OTA partitions ---- */
+
+static esp_partition_t s_partitions[2] = { { .label = "ota_0" }, { .label = "ota_1" } };
+static uint8_t* s_flash[2];
+static esp_ota_handle_t s_handle;
+static bool s_handle_open;
+static size_t s_write_pos;
+static int s_aborts, s_boot = -1, s_reboots;
+
+const esp_partition_t* esp_ota_get_running_partition(void) { return &s_partitions[0]; }
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from)
+{
+    return &s_partitions[1];
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size)
+{
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, s_flash[partition - s_partitions] + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle)
+{
+    if (s_handle_open) {
+        return ESP_ERR_INVALID_STATE; // Like a partition still being written by an earlier session
+    }
+    memset(s_flash[1], 0xff, partition->size);
+    s_write_pos = 0;
+    s_handle_open = true;
+    *out_handle = ++s_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_resume(const esp_partition_t* partition, size_t erase_size, size_t image_offset,
+                         esp_ota_handle_t* out_handle)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size)
+{
+    if (!s_handle_open || handle != s_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_write_pos + size > s_partitions[1].size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_flash[1] + s_write_pos, data, size);
+    s_write_pos += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (!s_handle_open || handle != s_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_handle_open = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (!s_handle_open || handle != s_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_handle_open = false;
+    s_aborts++;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition)
+{
+    s_boot = partition - s_partitions;
+    return ESP_OK;
+}
+
+void bo_system_reboot_later(uint32_t delay_ms) { s_reboots++; }
+
+/* ---- One NVS namespace in RAM ---- */
+
+static struct {
+    char key[16];
+    uint8_t value[64];
+    size_t len;
+} s_nvs[4];
+
+static int nvs_find(const char* key)
+{
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(s_nvs[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t bo_nvs_user_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle)
+{
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void bo_nvs_auto_close(nvs_handle_t* handle) { }
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* out, size_t* length)
+{
+    int i = nvs_find(key);
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (*length < s_nvs[i].len) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, s_nvs[i].value, s_nvs[i].len);
+    *length = s_nvs[i].len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length)
+{
+    int i = nvs_find(key);
+    if (i < 0 && (i = nvs_find("")) < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    strncpy(s_nvs[i].key, key, sizeof(s_nvs[i].key) - 1);
+    memcpy(s_nvs[i].value, value, length);
+    s_nvs[i].len = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char* key)
+{
+    int i = nvs_find(key);
+    if (i < 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    memset(&s_nvs[i], 0, sizeof(s_nvs[i]));
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+
+/* ---- The parts of `coap.c` the handlers call ---- */
+
+static const char* query_find(const coap_string_t* query, const char* option)
+{
+    const size_t len = strlen(option);
+    for (const char* p = (const char*)query->s; *p != '\0'; p++) {
+        if (strncmp(p, option, len) == 0 && (p[len] == '\0' || p[len] == '&' || p[len] == '=')) {
+            return p;
+        }
+        if ((p = strchr(p, '&')) == NULL) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+bool bo_coap_query_has(const coap_string_t* query, const char* option) { return query_find(query, option) != NULL; }
+
+int bo_coap_query_get_uint(const coap_string_t* query, const char* option, uint32_t* value)
+{
+    const char* item = query_find(query, option);
+    if (item == NULL || item[strlen(option)] != '=') {
+        return -ENOENT;
+    }
+    *value = (uint32_t)strtoul(item + strlen(option) + 1, NULL, 10);
+    return 0;
+}
+
+void bo_coap_respond_cbor(const coap_pdu_t* request, coap_pdu_t* response, bo_coap_cbor_encoder_t encode,
+                          const struct CborValue* args)
+{
+    uint8_t buf[256];
+    CborEncoder encoder;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    BO_COAP_TRY(encode(args, &encoder), response);
+    coap_add_data_blocked_response(request, response, COAP_MEDIATYPE_APPLICATION_CBOR, 0,
+                                   cbor_encoder_get_buffer_size(&encoder, buf), buf);
+}
+
+/* ---- Client ---- */
+
+#define CHUNK 1024
+
+static coap_pdu_t s_response;
+
+// Calls `handler` like the CoAP task does and returns the response code as a number, e.g. 204
+static int request(coap_method_handler_t handler, coap_pdu_code_t method, const char* query, const uint8_t* data,
+                   size_t len, int64_t block1)
+{
+    coap_pdu_t req = { .code = method, .data = data, .data_len = len };
+    if (block1 >= 0) {
+        uint8_t buf[4];
+        coap_add_option(&req, COAP_OPTION_BLOCK1, coap_encode_var_safe(buf, sizeof(buf), (unsigned int)block1), buf);
+    }
+    coap_string_t q = { strlen(query), (uint8_t*)query };
+    memset(&s_response, 0, sizeof(s_response));
+    handler(NULL, NULL, &req, &q, &s_response);
+    return (s_response.code >> 5) * 100 + (s_response.code & 0x1f);
+}
+
+// Sends `bytes` as a windowed upload, every chunk is acknowledged once the writer task made room for it
+static int stream_upload(const uint8_t* bytes, size_t size, bool patch)
+{
+    uint8_t buf[64];
+    CborEncoder encoder, map;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    cbor_encoder_create_map(&encoder, &map, 2);
+    cbor_encode_text_stringz(&map, "size");
+    cbor_encode_uint(&map, size);
+    cbor_encode_text_stringz(&map, "patch");
+    cbor_encode_boolean(&map, patch);
+    cbor_encoder_close_container(&encoder, &map);
+    const size_t len = cbor_encoder_get_buffer_size(&encoder, buf);
+    int code = request(coap_hnd_stream_post, COAP_REQUEST_CODE_POST, "", buf, len, -1);
+    if (code != 205) {
+        return code;
+    }
+    for (size_t offset = 0; offset < size; offset += CHUNK) {
+        char query[32];
+        snprintf(query, sizeof(query), "o=%zu", offset);
+        const size_t n = size - offset < CHUNK ? size - offset : CHUNK;
+        while ((code = request(coap_hnd_stream_put, COAP_REQUEST_CODE_PUT, query, bytes + offset, n, -1)) == 503) {
+            usleep(100);
+        }
+        if (code != 204) {
+            return code;
+        }
+    }
+    return 204;
+}
+
+// Sends `bytes` as a Block1 upload of 1024-byte blocks, returns the code of the last block
+static int block1_upload(const uint8_t* bytes, size_t size)
+{
+    int code = 0;
+    for (size_t num = 0; num * CHUNK < size; num++) {
+        const size_t n = size - num * CHUNK < CHUNK ? size - num * CHUNK : CHUNK;
+        const bool more = (num + 1) * CHUNK < size;
+        code = request(coap_hnd_download, COAP_REQUEST_CODE_PUT, "", bytes + num * CHUNK, n,
+                       (int64_t)(num << 4 | more << 3 | 6));
+        if (code != (more ? 231 : 201)) {
+            return code;
+        }
+    }
+    return code;
+}
+
+// Completes the upload, waiting while the writer task is still decoding
+static int complete(const uint8_t* image, size_t size)
+{
+    uint8_t buf[64], digest[32];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, image, size);
+    mbedtls_sha256_finish(&ctx, digest);
+    CborEncoder encoder, map;
+    cbor_encoder_init(&encoder, buf, sizeof(buf), 0);
+    cbor_encoder_create_map(&encoder, &map, 1);
+    cbor_encode_text_stringz(&map, "checksum");
+    cbor_encode_byte_string(&map, digest, sizeof(digest));
+    cbor_encoder_close_container(&encoder, &map);
+    int code;
+    while ((code = request(coap_hnd_download, COAP_REQUEST_CODE_POST, "", buf,
+                           cbor_encoder_get_buffer_size(&encoder, buf), -1))
+           == 503) {
+        usleep(100);
+    }
+    return code;
+}
+
+static bool status_idle()
+{
+    request(coap_hnd_status_get, COAP_REQUEST_CODE_GET, "", NULL, 0, -1);
+    CborParser parser;
+    CborValue it, value;
+    char status[16];
+    size_t len = sizeof(status);
+    return cbor_parser_init(s_response.data, s_response.data_len, 0, &parser, &it) == CborNoError
+           && cbor_value_map_find_value(&it, "update_status", &value) == CborNoError
+           && cbor_value_copy_text_string(&value, status, &len, NULL) == CborNoError && strcmp(status, "idle") == 0;
+}
+
+static uint8_t* load(const char* path, size_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* data = malloc(*size);
+    if (fread(data, 1, *size, f) != *size) {
+        exit(2);
+    }
+    fclose(f);
+    return data;
+}
+
+static int s_failures;
+
+static void check(const char* name, bool ok, const char* detail)
+{
+    printf("%-56s %-6s %s\n", name, ok ? "ok" : "FAILED", detail);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t old_size, new_size, patch_size;
+    const uint8_t* old = load(argv[1], &old_size);
+    const uint8_t* new = load(argv[2], &new_size);
+    const uint8_t* patch = load(argv[3], &patch_size);
+    for (int i = 0; i < 2; i++) {
+        s_partitions[i].size = strtoul(argv[4], NULL, 0);
+        s_flash[i] = malloc(s_partitions[i].size);
+        memset(s_flash[i], 0xff, s_partitions[i].size);
+    }
+    memcpy(s_flash[0], old, old_size);
+    char detail[128];
+
+    // The header and the first instructions are in, so the image has been begun when the patch runs out
+    const size_t truncated = patch_size / 2;
+    int put = stream_upload(patch, truncated, true);
+    int code = complete(new, new_size);
+    snprintf(detail, sizeof(detail), "%zu of %zu bytes, PUT %d, POST %d", truncated, patch_size, put, code);
+    check("truncated delta patch is refused", put == 204 && code == 400, detail);
+    snprintf(detail, sizeof(detail), "%d aborted", s_aborts);
+    check("its image is aborted and the session ends", s_aborts == 1 && !s_handle_open && status_idle(), detail);
+
+    code = block1_upload(new, new_size);
+    int post = complete(new, new_size);
+    snprintf(detail, sizeof(detail), "last block %d, POST %d", code, post);
+    check("a Block1 upload starts after it", code == 201 && post == 201, detail);
+    snprintf(detail, sizeof(detail), "boot partition %d, %d reboots", s_boot, s_reboots);
+    check("its image is written and booted", memcmp(s_flash[1], new, new_size) == 0 && s_boot == 1 && s_reboots == 1,
+          detail);
+
+    s_boot = -1;
+    put = stream_upload(patch, patch_size, true);
+    post = complete(new, new_size);
+    snprintf(detail, sizeof(detail), "PUT %d, POST %d, boot partition %d", put, post, s_boot);
+    check("a complete delta patch is applied after both",
+          put == 204 && post == 201 && memcmp(s_flash[1], new, new_size) == 0 && s_boot == 1, detail);
+
+    return s_failures != 0;
+}
+'''
+
+
+def run_test(args) -> int:
+    if args.old and args.new:
+        old, new = Path(args.old).read_bytes(), Path(args.new).read_bytes()
+    else:
+        old, new = synthesize(args.size, args.seed)
+
+    patch = diff(old, new)
+    if apply(old, patch) != new:
+        print('Reference applier produced a different image')
+        return 1
+
+    partition = max(len(old), len(new)) + 65536
+    with HostBuild() as build:
+        tmp = build.path
+        exe = build.compile(HARNESS, sources=[CORE_DIR / 'src' / 'algo' / 'delta-patch.c'], flags=['-Werror'])
+
+        # File-backed "running" and "next" OTA partitions, erased flash reads as 0xFF
+        (tmp / 'ota_0.bin').write_bytes(old + b'\xff' * (partition - len(old)))
+        (tmp / 'ota_1.bin').write_bytes(b'\xff' * partition)
+        result = run(exe, tmp / 'ota_0.bin', tmp / 'ota_1.bin', partition, partition, args.seed, input=patch,
+                     text=False, quiet=True, error='Device applier failed')
+        fed, ram, _ = map(int, result.stdout.split())
+        written = (tmp / 'ota_1.bin').read_bytes()[:len(new)]
+
+    if hashlib.sha256(written).digest() != hashlib.sha256(new).digest():
+        print('Device applier produced a different image')
+        return 1
+
+    blocks = lambda n: -(-n // args.block_size)
+    print(f'Source {len(old)} bytes, target {len(new)} bytes, patch {len(patch)} bytes '
+          f'({100.0 * len(patch) / len(new):.1f}% of the image)')
+    print(f'Transferred {fed} bytes in {blocks(fed)} requests of {args.block_size} bytes, '
+          f'the full image needs {blocks(len(new))}')
+    print(f'Applier state: {ram} bytes, SHA-256 of the patched partition matches')
+    return 0
+
+
+def run_session(args) -> int:
+    old, new = synthesize(args.size, args.seed)
+    patch = diff(old, new)
+    partition = max(len(old), len(new)) + 65536
+    with HostBuild(SESSION_STUBS) as build:
+        tmp = build.path
+        exe = build.compile(SESSION_HARNESS,
+                            sources=[CORE_DIR / 'src' / 'algo' / 'delta-patch.c', CORE_DIR / 'src' / 'algo' / 'lzss.c'],
+                            includes=[CORE_DIR / 'src' / 'coap' / 'resources'])
+        for name, data in [('old.bin', old), ('new.bin', new), ('update.patch', patch)]:
+            (tmp / name).write_bytes(data)
+        run(exe, tmp / 'old.bin', tmp / 'new.bin', tmp / 'update.patch', partition, error='OTA session tests failed')
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Delta firmware patches')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    p = sub.add_parser('diff', help='Build a patch from the running image to a new one')
+    p.add_argument('old')
+    p.add_argument('new')
+    p.add_argument('patch')
+
+    p = sub.add_parser('apply', help='Apply a patch with the reference applier')
+    p.add_argument('old')
+    p.add_argument('patch')
+    p.add_argument('new')
+
+    p = sub.add_parser('test', help='Check the firmware applier against file-backed partitions')
+    p.add_argument('--old', help='Running image, synthesized if omitted')
+    p.add_argument('--new', help='New image, synthesized if omitted')
+    p.add_argument('--size', type=int, default=1024 * 1024, help='Size of the synthesized images')
+    p.add_argument('--block-size', type=int, default=1024, help='Upload chunk size used for the request count')
+    p.add_argument('--seed', type=int, default=1)
+
+    p = sub.add_parser('session', help='Check the CoAP OTA handlers with delta uploads')
+    p.add_argument('--size', type=int, default=128 * 1024, help='Size of the synthesized images')
+    p.add_argument('--seed', type=int, default=1)
+
+    args = parser.parse_args()
+    if args.command == 'diff':
+        old, new = Path(args.old).read_bytes(), Path(args.new).read_bytes()
+        patch = diff(old, new)
+        Path(args.patch).write_bytes(patch)
+        print(f'{len(patch)} bytes, {100.0 * len(patch) / len(new):.1f}% of the image')
+    elif args.command == 'apply':
+        Path(args.new).write_bytes(apply(Path(args.old).read_bytes(), Path(args.patch).read_bytes()))
+    elif args.command == 'session':
+        sys.exit(run_session(args))
+    else:
+        sys.exit(run_test(args))
+
+
+if __name__ == '__main__':
+    main()